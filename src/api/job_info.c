@@ -1332,6 +1332,141 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	return rc;
 }
 
+static int _cmp_job_id(const void *x, const void *y)
+{
+	uint32_t a = *(uint32_t *) x, b = *(uint32_t *) y;
+
+	if (a < b)
+		return -1;
+	if (a > b)
+		return 1;
+	return 0;
+}
+
+/*
+ * Merge a delta response into a previous job information response: records
+ * of purged and changed jobs are dropped, then the changed records appended.
+ * slurmctld does not resend pending jobs only because their expected start
+ * time passed, so move those up to the time of the response as it would.
+ */
+static void _merge_job_delta(job_info_msg_t *job_info,
+			     job_info_delta_msg_t *delta)
+{
+	job_info_msg_t *changes = delta->job_info;
+	slurm_job_info_t *job_ptr;
+	uint32_t *ids, id_cnt = 0, new_cnt = 0, i;
+
+	ids = xcalloc(delta->purged_cnt + changes->record_count + 1,
+		      sizeof(uint32_t));
+	for (i = 0; i < delta->purged_cnt; i++)
+		ids[id_cnt++] = delta->purged_job_ids[i];
+	for (i = 0; i < changes->record_count; i++)
+		ids[id_cnt++] = changes->job_array[i].job_id;
+	qsort(ids, id_cnt, sizeof(uint32_t), _cmp_job_id);
+
+	for (i = 0; i < job_info->record_count; i++) {
+		if (bsearch(&job_info->job_array[i].job_id, ids, id_cnt,
+			    sizeof(uint32_t), _cmp_job_id)) {
+			slurm_free_job_info_members(&job_info->job_array[i]);
+			continue;
+		}
+		if (new_cnt != i)
+			job_info->job_array[new_cnt] = job_info->job_array[i];
+		new_cnt++;
+	}
+	xfree(ids);
+
+	if (changes->record_count) {
+		xrealloc(job_info->job_array,
+			 sizeof(slurm_job_info_t) *
+			 (new_cnt + changes->record_count));
+		memcpy(&job_info->job_array[new_cnt], changes->job_array,
+		       sizeof(slurm_job_info_t) * changes->record_count);
+		new_cnt += changes->record_count;
+		/* Members now owned by job_info */
+		xfree(changes->job_array);
+		changes->record_count = 0;
+	}
+	job_info->record_count = new_cnt;
+	job_info->last_update = changes->last_update;
+
+	for (i = 0; i < job_info->record_count; i++) {
+		job_ptr = &job_info->job_array[i];
+		if (!IS_JOB_PENDING(job_ptr) || !job_ptr->start_time ||
+		    (job_ptr->start_time >= job_info->last_update))
+			continue;
+		job_ptr->start_time = job_info->last_update;
+		if (job_ptr->time_limit != NO_VAL) {
+			job_ptr->end_time = MAX(job_ptr->end_time,
+						job_ptr->start_time +
+						job_ptr->time_limit * 60);
+		}
+	}
+}
+
+/*
+ * slurm_load_jobs_delta - issue RPC to get the job information which changed
+ *	since the previous call and merge it into the previous response.
+ *	Only the local cluster is queried.
+ * IN/OUT job_info_msg_pptr - NULL on the first call, afterwards the response
+ *	of the previous call, which is updated in place or replaced
+ * IN show_flags - job filtering options, must be the same on every call
+ * RET 0 or -1 on error, the previous response is left untouched on error
+ * NOTE: a job's last_sched_eval is only updated when other job fields change
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int slurm_load_jobs_delta(job_info_msg_t **job_info_msg_pptr,
+				 uint16_t show_flags)
+{
+	slurm_msg_t req_msg, resp_msg;
+	job_info_delta_request_msg_t req;
+	job_info_delta_msg_t *delta;
+	job_info_msg_t *job_info = *job_info_msg_pptr;
+	int rc = SLURM_SUCCESS;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+	memset(&req, 0, sizeof(req));
+	if (job_info) {
+		req.epoch    = job_info->delta_epoch;
+		req.sequence = job_info->delta_seq;
+	}
+	req.show_flags   = (show_flags | SHOW_LOCAL) & (~SHOW_FEDERATION);
+	req_msg.msg_type = REQUEST_JOB_INFO_DELTA;
+	req_msg.data     = &req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					   working_cluster_rec) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO_DELTA:
+		delta = (job_info_delta_msg_t *) resp_msg.data;
+		if (!job_info || (delta->flags & JOB_DELTA_FULL)) {
+			slurm_free_job_info_msg(job_info);
+			job_info = delta->job_info;
+			delta->job_info = NULL;
+		} else
+			_merge_job_delta(job_info, delta);
+		job_info->delta_epoch = delta->epoch;
+		job_info->delta_seq = delta->sequence;
+		*job_info_msg_pptr = job_info;
+		slurm_free_job_info_delta_msg(delta);
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		break;
+	default:
+		rc = SLURM_UNEXPECTED_MSG_ERROR;
+		break;
+	}
+	if (rc)
+		slurm_seterrno(rc);
+
+	return rc;
+}
+
 /*
  * slurm_load_job_user - issue RPC to get slurm information about all jobs
  *	to be run as the specified user
@@ -38,6 +38,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -153,3 +154,111 @@ extern int slurm_submit_batch_pack_job(List job_req_list,
 
 	return SLURM_SUCCESS;
 }
+
+/* Send one REQUEST_SUBMIT_BATCH_JOB_BULK and append its results to resp */
+static int _submit_bulk_chunk(List job_req_list,
+			      submit_bulk_response_msg_t *resp)
+{
+	int rc;
+	slurm_msg_t req_msg;
+	slurm_msg_t resp_msg;
+	submit_bulk_response_msg_t *chunk_resp;
+	uint32_t job_cnt = list_count(job_req_list);
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	req_msg.msg_type = REQUEST_SUBMIT_BATCH_JOB_BULK;
+	req_msg.data     = job_req_list;
+
+	rc = slurm_send_recv_controller_msg(&req_msg, &resp_msg,
+					    working_cluster_rec);
+	if (rc == SLURM_ERROR)
+		return SLURM_ERROR;
+	switch (resp_msg.msg_type) {
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+	case RESPONSE_SUBMIT_BATCH_JOB_BULK:
+		chunk_resp = (submit_bulk_response_msg_t *) resp_msg.data;
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+	}
+
+	if (chunk_resp->job_cnt != job_cnt) {
+		slurm_free_submit_bulk_response_msg(chunk_resp);
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+	}
+	xrecalloc(resp->job_id, resp->job_cnt + job_cnt, sizeof(uint32_t));
+	xrecalloc(resp->error_code, resp->job_cnt + job_cnt, sizeof(uint32_t));
+	memcpy(resp->job_id + resp->job_cnt, chunk_resp->job_id,
+	       job_cnt * sizeof(uint32_t));
+	memcpy(resp->error_code + resp->job_cnt, chunk_resp->error_code,
+	       job_cnt * sizeof(uint32_t));
+	resp->job_cnt += job_cnt;
+	if (chunk_resp->job_submit_user_msg) {
+		if (resp->job_submit_user_msg)
+			xstrcat(resp->job_submit_user_msg, "\n");
+		xstrcat(resp->job_submit_user_msg,
+			chunk_resp->job_submit_user_msg);
+	}
+	slurm_free_submit_bulk_response_msg(chunk_resp);
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * slurm_submit_batch_job_bulk - issue RPCs to submit many independent batch
+ *				 jobs for later execution. Each RPC creates up
+ *				 to SUBMIT_BULK_MAX_JOBS jobs.
+ * NOTE: free the response using slurm_free_submit_bulk_response_msg
+ * IN job_req_list - List of batch job requests, type job_desc_msg_t
+ * OUT resp - job ID and error code of each job in job_req_list order
+ * RET SLURM_SUCCESS if every RPC was processed, even if individual jobs were
+ *	rejected, otherwise return SLURM_ERROR with errno set
+ */
+extern int slurm_submit_batch_job_bulk(List job_req_list,
+				       submit_bulk_response_msg_t **resp)
+{
+	int rc = SLURM_SUCCESS;
+	job_desc_msg_t *req;
+	List chunk_list;
+	ListIterator iter;
+
+	*resp = xmalloc(sizeof(submit_bulk_response_msg_t));
+
+	/* The requests are owned by job_req_list, not by chunk_list */
+	chunk_list = list_create(NULL);
+	iter = list_iterator_create(job_req_list);
+	while ((req = (job_desc_msg_t *) list_next(iter))) {
+		/*
+		 * set session id for this request
+		 */
+		if (req->alloc_sid == NO_VAL)
+			req->alloc_sid = getsid(0);
+		list_append(chunk_list, req);
+		if (list_count(chunk_list) < SUBMIT_BULK_MAX_JOBS)
+			continue;
+		if ((rc = _submit_bulk_chunk(chunk_list, *resp)))
+			break;
+		list_flush(chunk_list);
+	}
+	list_iterator_destroy(iter);
+
+	if (!rc && list_count(chunk_list))
+		rc = _submit_bulk_chunk(chunk_list, *resp);
+	FREE_NULL_LIST(chunk_list);
+
+	if (rc) {
+		/* errno was set by _submit_bulk_chunk() */
+		slurm_free_submit_bulk_response_msg(*resp);
+		*resp = NULL;
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
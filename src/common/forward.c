@@ -38,10 +38,12 @@
 \*****************************************************************************/
 
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "slurm/slurm.h"
@@ -52,519 +54,1001 @@
 #include "src/common/slurm_route.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_interface.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+/*
+ * The branches of a forward tree are driven by a single event loop rather
+ * than a thread per branch. Each branch connects to the first node of its
+ * hostlist, sends it the message along with the rest of the hostlist to
+ * forward to, and waits for the replies of the whole branch. Connections are
+ * opened without blocking and all branches waiting to connect or for replies
+ * are polled together, each with its own deadline, so the cost of a fan-out
+ * is bounded by the sockets in flight rather than by threads.
+ */
+typedef enum {
+	FWD_BRANCH_NEW,		/* Not connected, may wait to retry */
+	FWD_BRANCH_CONNECT,	/* Connection in progress */
+	FWD_BRANCH_RECV,	/* Message sent, waiting for replies */
+	FWD_BRANCH_DONE		/* All nodes replied or marked failed */
+} fwd_state_t;
+
 typedef struct {
-	pthread_cond_t *notify;
-	int            *p_thr_count;
-	slurm_msg_t *orig_msg;
-	List ret_list;
-	int timeout;
-	hostlist_t tree_hl;
-	pthread_mutex_t *tree_mutex;
-} fwd_tree_t;
+	slurm_addr_t addr;	/* address of name */
+	int fd;			/* connection to name, -1 if none */
+	hostlist_t hl;		/* nodes name forwards the message to */
+	char *name;		/* node the message is sent to */
+	int refused_cnt;	/* connections refused */
+	bool no_reuse;		/* reused connection failed, open a new one */
+	bool reused;		/* fd taken from the idle connections */
+	fwd_state_t state;
+	int steps;		/* tree levels below name */
+	int64_t connect_start;	/* msec, start of the connection */
+	int64_t deadline;	/* msec, end of the current state */
+	int timeout;		/* msec, time for one tree level to reply */
+	int wait;		/* msec, time to wait for replies */
+} fwd_branch_t;
+
+typedef struct {
+	fwd_branch_t *branch;	/* branches of the tree */
+	int branch_cnt;
+	int branch_size;
+	forward_struct_t *fwd_struct; /* forward_msg() data, NULL for
+				 * start_msg_tree() */
+	header_t header;	/* forward_msg() header to send */
+	bool keep_conn;		/* keep connections open once answered */
+	slurm_msg_t *orig_msg;	/* start_msg_tree() message to send */
+	List ret_list;		/* start_msg_tree() replies */
+	int timeout;		/* msec, start_msg_tree() timeout */
+} fwd_engine_t;
+
+static int64_t _now_msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((int64_t) ts.tv_sec * 1000) + (ts.tv_nsec / 1000000);
+}
 
-static void _start_msg_tree_internal(hostlist_t hl, hostlist_t* sp_hl,
-				     fwd_tree_t *fwd_tree_in,
-				     int hl_count);
-static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
-				  forward_struct_t *fwd_struct,
-				  header_t *header, int timeout,
-				  int hl_count);
+/*
+ * Connections kept open once answered, at most one per node. Only the thread
+ * using a connection holds it, so it is removed from the table while in use.
+ */
+typedef struct {
+	int fd;
+	time_t last_used;
+	char *name;
+} fwd_idle_conn_t;
 
-void _destroy_tree_fwd(fwd_tree_t *fwd_tree)
+static pthread_mutex_t idle_conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *idle_conn_hash = NULL;
+static time_t idle_conn_sweep = 0;
+
+static void _idle_conn_id(void *item, const char **key, uint32_t *key_len)
 {
-	if (fwd_tree) {
-		if (fwd_tree->tree_hl)
-			hostlist_destroy(fwd_tree->tree_hl);
+	fwd_idle_conn_t *conn = item;
 
-		/*
-		 * Lock and decrease thread counter, start_msg_tree is waiting
-		 * for a null thread count to exit its main loop
-		 */
-		slurm_mutex_lock(fwd_tree->tree_mutex);
-		(*(fwd_tree->p_thr_count))--;
-		slurm_cond_signal(fwd_tree->notify);
-		slurm_mutex_unlock(fwd_tree->tree_mutex);
+	*key = conn->name;
+	*key_len = strlen(conn->name);
+}
 
-		xfree(fwd_tree);
-	}
+static void _idle_conn_free(void *item)
+{
+	fwd_idle_conn_t *conn = item;
+
+	if (!conn)	/* xhash_delete() of a missing key */
+		return;
+	if ((conn->fd >= 0) && (close(conn->fd) < 0))
+		error("close(%d): %m", conn->fd);
+	xfree(conn->name);
+	xfree(conn);
 }
 
-void *_forward_thread(void *arg)
+static void _idle_conn_expired(void *item, void *arg)
 {
-	forward_msg_t *fwd_msg = (forward_msg_t *)arg;
-	forward_struct_t *fwd_struct = fwd_msg->fwd_struct;
-	Buf buffer = init_buf(BUF_SIZE);	/* probably enough for header */
-	List ret_list = NULL;
+	fwd_idle_conn_t *conn = item;
+	List expired = arg;
+
+	if (difftime(time(NULL), conn->last_used) >= KEEP_CONN_IDLE)
+		list_append(expired, xstrdup(conn->name));
+}
+
+/*
+ * Take the idle connection to a node
+ * RET connected fd or -1 if none is usable
+ */
+static int _idle_conn_get(char *name)
+{
+	fwd_idle_conn_t *conn;
+	struct pollfd pfd;
 	int fd = -1;
-	ret_data_info_t *ret_data_info = NULL;
-	char *name = NULL;
-	hostlist_t hl = hostlist_create(fwd_msg->header.forward.nodelist);
-	slurm_addr_t addr;
-	char *buf = NULL;
-	int steps = 0;
-	int start_timeout = fwd_msg->timeout;
-
-	/* repeat until we are sure the message was sent */
-	while ((name = hostlist_shift(hl))) {
-		if (slurm_conf_get_addr(name, &addr) == SLURM_ERROR) {
-			error("forward_thread: can't find address for host "
-			      "%s, check slurm.conf", name);
-			slurm_mutex_lock(&fwd_struct->forward_mutex);
-			mark_as_failed_forward(&fwd_struct->ret_list, name,
-					       SLURM_UNKNOWN_FORWARD_ADDR);
- 			free(name);
-			if (hostlist_count(hl) > 0) {
-				slurm_mutex_unlock(&fwd_struct->forward_mutex);
-				continue;
-			}
-			goto cleanup;
-		}
-		if ((fd = slurm_open_msg_conn(&addr)) < 0) {
-			error("forward_thread to %s: %m", name);
 
-			slurm_mutex_lock(&fwd_struct->forward_mutex);
-			mark_as_failed_forward(
-				&fwd_struct->ret_list, name,
-				SLURM_COMMUNICATIONS_CONNECTION_ERROR);
-			free(name);
-			if (hostlist_count(hl) > 0) {
-				slurm_mutex_unlock(&fwd_struct->forward_mutex);
-				/* Abandon tree. This way if all the
-				 * nodes in the branch are down we
-				 * don't have to time out for each
-				 * node serially.
-				 */
-				_forward_msg_internal(hl, NULL, fwd_struct,
-						      &fwd_msg->header, 0,
-						      hostlist_count(hl));
-				continue;
-			}
-			goto cleanup;
+	slurm_mutex_lock(&idle_conn_lock);
+	conn = idle_conn_hash ? xhash_pop_str(idle_conn_hash, name) : NULL;
+	slurm_mutex_unlock(&idle_conn_lock);
+	if (!conn)
+		return -1;
+
+	/*
+	 * Nothing is expected on an idle connection, so anything to read means
+	 * the node closed it or restarted.
+	 */
+	pfd.fd = conn->fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if ((difftime(time(NULL), conn->last_used) < KEEP_CONN_IDLE) &&
+	    (poll(&pfd, 1, 0) == 0)) {
+		fd = conn->fd;
+		conn->fd = -1;
+		xfree(conn->name);
+		xfree(conn);
+	} else {
+		debug3("%s: dropping idle connection to %s", __func__, name);
+		_idle_conn_free(conn);
+	}
+	return fd;
+}
+
+/* Keep a connection to a node open for reuse, consumes fd */
+static void _idle_conn_put(char *name, int fd)
+{
+	fwd_idle_conn_t *conn;
+	List expired = NULL;
+	char *tmp;
+	time_t now = time(NULL);
+
+	conn = xmalloc(sizeof(fwd_idle_conn_t));
+	conn->fd = fd;
+	conn->last_used = now;
+	conn->name = xstrdup(name);
+
+	slurm_mutex_lock(&idle_conn_lock);
+	if (!idle_conn_hash)
+		idle_conn_hash = xhash_init(_idle_conn_id, _idle_conn_free);
+	xhash_delete_str(idle_conn_hash, name);
+	xhash_add(idle_conn_hash, conn);
+	if (difftime(now, idle_conn_sweep) >= 60) {
+		idle_conn_sweep = now;
+		expired = list_create(slurm_destroy_char);
+		xhash_walk(idle_conn_hash, _idle_conn_expired, expired);
+		while ((tmp = list_pop(expired))) {
+			xhash_delete_str(idle_conn_hash, tmp);
+			xfree(tmp);
 		}
-		buf = hostlist_ranged_string_xmalloc(hl);
-
-		xfree(fwd_msg->header.forward.nodelist);
-		fwd_msg->header.forward.nodelist = buf;
-		fwd_msg->header.forward.cnt = hostlist_count(hl);
-#if 0
-		info("sending %d forwards (%s) to %s",
-		     fwd_msg->header.forward.cnt,
-		     fwd_msg->header.forward.nodelist, name);
-#endif
-		if (fwd_msg->header.forward.nodelist[0]) {
-			debug3("forward: send to %s along with %s",
-			       name, fwd_msg->header.forward.nodelist);
-		} else
-			debug3("forward: send to %s ", name);
+	}
+	slurm_mutex_unlock(&idle_conn_lock);
+	FREE_NULL_LIST(expired);
+}
 
-		pack_header(&fwd_msg->header, buffer);
+/* Return true if connections for this message type may be kept open */
+static bool _keep_conn_type(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_PING:
+	case REQUEST_NODE_REGISTRATION_STATUS:
+	case REQUEST_HEALTH_CHECK:
+	case REQUEST_ACCT_GATHER_UPDATE:
+		return true;
+	default:
+		return false;
+	}
+}
 
-		/* add forward data to buffer */
-		if (remaining_buf(buffer) < fwd_struct->buf_len) {
-			int new_size = buffer->processed + fwd_struct->buf_len;
-			new_size += 1024; /* padded for paranoia */
-			xrealloc_nz(buffer->head, new_size);
-			buffer->size = new_size;
-		}
-		if (fwd_struct->buf_len) {
-			memcpy(&buffer->head[buffer->processed],
-			       fwd_struct->buf, fwd_struct->buf_len);
-			buffer->processed += fwd_struct->buf_len;
-		}
+/*
+ * Responsiveness of the nodes messages were sent to, used to shape the trees
+ * of later messages. The first node of each branch forwards the message to the
+ * rest, so a slow or unreachable branch head delays the whole branch, first
+ * until it times out and then again while the branch is retried node by node.
+ */
+#define FWD_FAIL_AGE	300	/* secs, failure history kept */
+#define FWD_SLOW_MSEC	200	/* smoothed connect time of a slow node */
 
-		/*
-		 * forward message
-		 */
-		if (slurm_msg_sendto(fd,
-				     get_buf_data(buffer),
-				     get_buf_offset(buffer)) < 0) {
-			error("forward_thread: slurm_msg_sendto: %m");
-
-			slurm_mutex_lock(&fwd_struct->forward_mutex);
-			mark_as_failed_forward(&fwd_struct->ret_list, name,
-					       errno);
-			free(name);
-			if (hostlist_count(hl) > 0) {
-				free_buf(buffer);
-				buffer = init_buf(fwd_struct->buf_len);
-				slurm_mutex_unlock(&fwd_struct->forward_mutex);
-				close(fd);
-				fd = -1;
-				/* Abandon tree. This way if all the
-				 * nodes in the branch are down we
-				 * don't have to time out for each
-				 * node serially.
-				 */
-				_forward_msg_internal(hl, NULL, fwd_struct,
-						      &fwd_msg->header, 0,
-						      hostlist_count(hl));
-				continue;
-			}
-			goto cleanup;
-		}
+typedef struct {
+	time_t fail_time;	/* last failure, 0 if it replied since */
+	char *name;
+	int rtt;		/* msec, smoothed connect time, -1 if unknown */
+} fwd_node_stat_t;
 
-		/* These messages don't have a return message, but if
-		 * we got here things worked out so make note of the
-		 * list of nodes as success.
-		 */
-		if ((fwd_msg->header.msg_type == REQUEST_SHUTDOWN) ||
-		    (fwd_msg->header.msg_type == REQUEST_RECONFIGURE) ||
-		    (fwd_msg->header.msg_type == REQUEST_REBOOT_NODES)) {
-			slurm_mutex_lock(&fwd_struct->forward_mutex);
-			ret_data_info = xmalloc(sizeof(ret_data_info_t));
-			list_push(fwd_struct->ret_list, ret_data_info);
-			ret_data_info->node_name = xstrdup(name);
-			free(name);
-			while ((name = hostlist_shift(hl))) {
-				ret_data_info =
-					xmalloc(sizeof(ret_data_info_t));
-				list_push(fwd_struct->ret_list, ret_data_info);
-				ret_data_info->node_name = xstrdup(name);
-				free(name);
-			}
-			goto cleanup;
-		}
+typedef enum {
+	FWD_NODE_OK,		/* responsive or no history */
+	FWD_NODE_SLOW,		/* slow to accept connections */
+	FWD_NODE_FAILED		/* failed recently */
+} fwd_node_rank_t;
 
-		if (fwd_msg->header.forward.cnt > 0) {
-			static int message_timeout = -1;
-			if (message_timeout < 0)
-				message_timeout =
-					slurm_get_msg_timeout() * 1000;
-			if (!fwd_msg->header.forward.tree_width)
-				fwd_msg->header.forward.tree_width =
-					slurm_get_tree_width();
-			steps = (fwd_msg->header.forward.cnt+1) /
-					fwd_msg->header.forward.tree_width;
-			fwd_msg->timeout = (message_timeout*steps);
-			/* info("got %d * %d = %d", message_timeout, */
-			/*      steps, fwd_msg->timeout); */
-			steps++;
-			fwd_msg->timeout += (start_timeout*steps);
-			/* info("now  + %d*%d = %d", start_timeout, */
-			/*      steps, fwd_msg->timeout); */
-		}
+static pthread_mutex_t node_stat_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *node_stat_hash = NULL;
 
-		ret_list = slurm_receive_msgs(fd, steps, fwd_msg->timeout);
-		/* info("sent %d forwards got %d back", */
-		/*      fwd_msg->header.forward.cnt, list_count(ret_list)); */
+static void _node_stat_id(void *item, const char **key, uint32_t *key_len)
+{
+	fwd_node_stat_t *stat = item;
 
-		if (!ret_list || (fwd_msg->header.forward.cnt != 0
-				  && list_count(ret_list) <= 1)) {
-			slurm_mutex_lock(&fwd_struct->forward_mutex);
-			mark_as_failed_forward(&fwd_struct->ret_list, name,
-					       errno);
-			free(name);
-			FREE_NULL_LIST(ret_list);
-			if (hostlist_count(hl) > 0) {
-				free_buf(buffer);
-				buffer = init_buf(fwd_struct->buf_len);
-				slurm_mutex_unlock(&fwd_struct->forward_mutex);
-				close(fd);
-				fd = -1;
-				continue;
-			}
-			goto cleanup;
-		} else if ((fwd_msg->header.forward.cnt+1)
-			  != list_count(ret_list)) {
-			/* this should never be called since the above
-			   should catch the failed forwards and pipe
-			   them back down, but this is here so we
-			   never have to worry about a locked
-			   mutex */
-			ListIterator itr = NULL;
-			char *tmp = NULL;
-			int first_node_found = 0;
-			hostlist_iterator_t host_itr
-				= hostlist_iterator_create(hl);
-			error("We shouldn't be here.  We forwarded to %d "
-			      "but only got %d back",
-			      (fwd_msg->header.forward.cnt+1),
-			      list_count(ret_list));
-			while ((tmp = hostlist_next(host_itr))) {
-				int node_found = 0;
-				itr = list_iterator_create(ret_list);
-				while ((ret_data_info = list_next(itr))) {
-					if (!ret_data_info->node_name) {
-						first_node_found = 1;
-						ret_data_info->node_name =
-							xstrdup(name);
-					}
-					if (!xstrcmp(tmp,
-						   ret_data_info->node_name)) {
-						node_found = 1;
-						break;
-					}
-				}
-				list_iterator_destroy(itr);
-				if (!node_found) {
-					mark_as_failed_forward(
-						&fwd_struct->ret_list,
-						tmp,
-						SLURM_COMMUNICATIONS_CONNECTION_ERROR);
-				}
-				free(tmp);
-			}
-			hostlist_iterator_destroy(host_itr);
-			if (!first_node_found) {
-				mark_as_failed_forward(
-					&fwd_struct->ret_list,
-					name,
-					SLURM_COMMUNICATIONS_CONNECTION_ERROR);
-			}
-		}
-		break;
+	*key = stat->name;
+	*key_len = strlen(stat->name);
+}
+
+static void _node_stat_free(void *item)
+{
+	fwd_node_stat_t *stat = item;
+
+	if (!stat)
+		return;
+	xfree(stat->name);
+	xfree(stat);
+}
+
+/* Find or add a node's record, call with node_stat_lock held */
+static fwd_node_stat_t *_node_stat_get(const char *name)
+{
+	fwd_node_stat_t *stat;
+
+	if (!node_stat_hash)
+		node_stat_hash = xhash_init(_node_stat_id, _node_stat_free);
+	if (!(stat = xhash_get_str(node_stat_hash, name))) {
+		stat = xmalloc(sizeof(fwd_node_stat_t));
+		stat->name = xstrdup(name);
+		stat->rtt = -1;
+		xhash_add(node_stat_hash, stat);
 	}
-	slurm_mutex_lock(&fwd_struct->forward_mutex);
-	if (ret_list) {
-		while ((ret_data_info = list_pop(ret_list)) != NULL) {
-			if (!ret_data_info->node_name) {
-				ret_data_info->node_name = xstrdup(name);
-			}
-			list_push(fwd_struct->ret_list, ret_data_info);
-			debug3("got response from %s",
-			       ret_data_info->node_name);
-		}
-		FREE_NULL_LIST(ret_list);
+	return stat;
+}
+
+/* Record whether a node replied */
+static void _node_stat_reply(const char *name, bool failed)
+{
+	fwd_node_stat_t *stat;
+
+	if (!name)
+		return;
+	slurm_mutex_lock(&node_stat_lock);
+	if (failed) {
+		_node_stat_get(name)->fail_time = time(NULL);
+	} else if (node_stat_hash &&
+		   (stat = xhash_get_str(node_stat_hash, name))) {
+		stat->fail_time = 0;
 	}
-	free(name);
-cleanup:
-	if ((fd >= 0) && close(fd) < 0)
-		error ("close(%d): %m", fd);
-	hostlist_destroy(hl);
-	destroy_forward(&fwd_msg->header.forward);
-	free_buf(buffer);
-	slurm_cond_signal(&fwd_struct->notify);
-	slurm_mutex_unlock(&fwd_struct->forward_mutex);
-	xfree(fwd_msg);
+	slurm_mutex_unlock(&node_stat_lock);
+}
+
+/* Record the time taken to connect to a node */
+static void _node_stat_rtt(const char *name, int64_t msec)
+{
+	fwd_node_stat_t *stat;
+
+	slurm_mutex_lock(&node_stat_lock);
+	stat = _node_stat_get(name);
+	if (stat->rtt < 0)
+		stat->rtt = msec;
+	else
+		stat->rtt = ((stat->rtt * 3) + msec) / 4;
+	slurm_mutex_unlock(&node_stat_lock);
+}
+
+static fwd_node_rank_t _node_stat_rank(const char *name, time_t now)
+{
+	fwd_node_stat_t *stat;
+	fwd_node_rank_t rank = FWD_NODE_OK;
+
+	slurm_mutex_lock(&node_stat_lock);
+	if (node_stat_hash && (stat = xhash_get_str(node_stat_hash, name))) {
+		if (stat->fail_time &&
+		    (difftime(now, stat->fail_time) < FWD_FAIL_AGE))
+			rank = FWD_NODE_FAILED;
+		else if (stat->rtt >= FWD_SLOW_MSEC)
+			rank = FWD_NODE_SLOW;
+	}
+	slurm_mutex_unlock(&node_stat_lock);
 
-	return (NULL);
+	return rank;
 }
 
-void *_fwd_tree_thread(void *arg)
+/* Record that a node could not be sent the message or did not reply */
+static void _fwd_fail(fwd_engine_t *eng, char *name, int err)
 {
-	fwd_tree_t *fwd_tree = (fwd_tree_t *)arg;
-	List ret_list = NULL;
-	char *name = NULL;
-	char *buf = NULL;
-	slurm_msg_t send_msg;
-
-	slurm_msg_t_init(&send_msg);
-	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
-	send_msg.data = fwd_tree->orig_msg->data;
-	send_msg.protocol_version = fwd_tree->orig_msg->protocol_version;
-
-	/* repeat until we are sure the message was sent */
-	while ((name = hostlist_shift(fwd_tree->tree_hl))) {
-		if (slurm_conf_get_addr(name, &send_msg.address)
-		    == SLURM_ERROR) {
-			error("fwd_tree_thread: can't find address for host "
-			      "%s, check slurm.conf", name);
-			slurm_mutex_lock(fwd_tree->tree_mutex);
-			mark_as_failed_forward(&fwd_tree->ret_list, name,
-					       SLURM_UNKNOWN_FORWARD_ADDR);
- 			slurm_cond_signal(fwd_tree->notify);
-			slurm_mutex_unlock(fwd_tree->tree_mutex);
-			free(name);
+	_node_stat_reply(name, true);
+	if (!eng->fwd_struct) {
+		mark_as_failed_forward(&eng->ret_list, name, err);
+		return;
+	}
+	slurm_mutex_lock(&eng->fwd_struct->forward_mutex);
+	mark_as_failed_forward(&eng->fwd_struct->ret_list, name, err);
+	slurm_cond_signal(&eng->fwd_struct->notify);
+	slurm_mutex_unlock(&eng->fwd_struct->forward_mutex);
+}
 
+/* Add the replies of a branch to the replies of the tree */
+static void _fwd_done(fwd_engine_t *eng, List ret_list)
+{
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		_node_stat_reply(ret_data_info->node_name,
+				 (ret_data_info->type ==
+				  RESPONSE_FORWARD_FAILED));
+	}
+	list_iterator_destroy(itr);
+
+	if (!eng->fwd_struct) {
+		list_transfer(eng->ret_list, ret_list);
+		return;
+	}
+	slurm_mutex_lock(&eng->fwd_struct->forward_mutex);
+	while ((ret_data_info = list_pop(ret_list))) {
+		debug3("got response from %s", ret_data_info->node_name);
+		list_push(eng->fwd_struct->ret_list, ret_data_info);
+	}
+	slurm_cond_signal(&eng->fwd_struct->notify);
+	slurm_mutex_unlock(&eng->fwd_struct->forward_mutex);
+}
+
+/*
+ * Add a branch sending the message to the nodes of hl, consumed
+ * IN timeout - msec for one tree level to reply, 0 for MessageTimeout
+ */
+static void _fwd_add_branch(fwd_engine_t *eng, hostlist_t hl, int timeout)
+{
+	fwd_branch_t *branch;
+
+	if (eng->branch_cnt >= eng->branch_size) {
+		eng->branch_size = MAX(eng->branch_size * 2, 16);
+		xrealloc(eng->branch, sizeof(fwd_branch_t) * eng->branch_size);
+	}
+	branch = &eng->branch[eng->branch_cnt++];
+	memset(branch, 0, sizeof(fwd_branch_t));
+	branch->fd = -1;
+	branch->hl = hl;
+	branch->state = FWD_BRANCH_NEW;
+	if (timeout <= 0)
+		timeout = slurm_get_msg_timeout() * 1000;
+	branch->timeout = timeout;
+}
+
+/*
+ * Add the branches of a tree split by route_g_split_hostlist(), consumed.
+ * Within each branch, the first node that neither failed recently nor is slow
+ * to connect becomes the branch head. Nodes that failed recently are taken out
+ * of the branches and sent the message directly, up to tree_width of them, so
+ * they don't hold up a head waiting for their replies. The route plugin's
+ * split, which follows the switch topology with route/topology, is otherwise
+ * kept as is.
+ */
+static void _fwd_add_tree(fwd_engine_t *eng, hostlist_t *sp_hl, int hl_count,
+			  uint16_t tree_width, int timeout)
+{
+	hostlist_t hl, new_hl;
+	hostlist_iterator_t itr;
+	fwd_node_rank_t rank, head_rank;
+	char *name, *head;
+	int i, isolate_cnt = 0;
+	time_t now = time(NULL);
+
+	if (!tree_width)
+		tree_width = slurm_get_tree_width();
+
+	for (i = 0; i < hl_count; i++) {
+		hl = sp_hl[i];
+		if (hostlist_count(hl) <= 1) {
+			_fwd_add_branch(eng, hl, timeout);
 			continue;
 		}
 
-		send_msg.forward.timeout = fwd_tree->timeout;
-		if ((send_msg.forward.cnt = hostlist_count(fwd_tree->tree_hl))){
-			buf = hostlist_ranged_string_xmalloc(
-					fwd_tree->tree_hl);
-			send_msg.forward.nodelist = buf;
-		} else
-			send_msg.forward.nodelist = NULL;
+		head = NULL;
+		head_rank = FWD_NODE_FAILED;
+		itr = hostlist_iterator_create(hl);
+		while ((name = hostlist_next(itr))) {
+			rank = _node_stat_rank(name, now);
+			if ((rank == FWD_NODE_FAILED) &&
+			    (isolate_cnt < tree_width) &&
+			    (hostlist_count(hl) > 1)) {
+				debug3("forward: sending to %s directly, it failed recently",
+				       name);
+				hostlist_remove(itr);
+				_fwd_add_branch(eng, hostlist_create(name),
+						timeout);
+				isolate_cnt++;
+			} else if (!head || (rank < head_rank)) {
+				free(head);
+				head = strdup(name);
+				head_rank = rank;
+			}
+			free(name);
+		}
+		hostlist_iterator_destroy(itr);
+
+		name = hostlist_nth(hl, 0);
+		if (head && xstrcmp(head, name)) {
+			debug3("forward: %s heads the branch instead of %s",
+			       head, name);
+			new_hl = hostlist_create(head);
+			hostlist_delete_host(hl, head);
+			hostlist_push_list(new_hl, hl);
+			hostlist_destroy(hl);
+			hl = new_hl;
+		}
+		free(name);
+		free(head);
+		_fwd_add_branch(eng, hl, timeout);
+	}
+}
 
-		if (send_msg.forward.nodelist && send_msg.forward.nodelist[0]) {
+/*
+ * Abandon a branch whose first node failed, sending the message directly to
+ * each of its remaining nodes. This way if all the nodes in the branch are
+ * down we don't have to time out for each node serially.
+ */
+static void _fwd_split_branch(fwd_engine_t *eng, int inx)
+{
+	fwd_branch_t *branch = &eng->branch[inx];
+	hostlist_t hl = branch->hl;
+	char *name;
+
+	branch->hl = NULL;
+	branch->state = FWD_BRANCH_DONE;
+	while ((name = hostlist_shift(hl))) {
+		_fwd_add_branch(eng, hostlist_create(name),
+				eng->fwd_struct ? 0 : eng->timeout);
+		free(name);
+	}
+	hostlist_destroy(hl);
+}
+
+static void _fwd_close(fwd_branch_t *branch)
+{
+	if ((branch->fd >= 0) && (close(branch->fd) < 0))
+		error("close(%d): %m", branch->fd);
+	branch->fd = -1;
+}
+
+/*
+ * Figure out where the branch is in the tree and set the time to wait for
+ * its replies (timeout+message_timeout per step) to let the children time out
+ */
+static void _fwd_set_wait(fwd_branch_t *branch, forward_t *forward)
+{
+	static int message_timeout = -1;
+	int tree_width;
+
+	if (message_timeout < 0)
+		message_timeout = slurm_get_msg_timeout() * 1000;
+
+	branch->steps = 0;
+	branch->wait = branch->timeout;
+	if (forward->cnt > 0) {
+		tree_width = forward->tree_width;
+		if (!tree_width)
+			tree_width = slurm_get_tree_width();
+		branch->steps = (forward->cnt + 1) / tree_width;
+		branch->wait = message_timeout * branch->steps;
+		branch->steps++;
+		branch->wait += branch->timeout * branch->steps;
+	}
+}
+
+/* Send the message to the branch's first node once connected */
+static int _fwd_send(fwd_engine_t *eng, fwd_branch_t *branch)
+{
+	forward_t *forward;
+	Buf buffer;
+	int rc;
+
+	if (!eng->fwd_struct) {
+		slurm_msg_t send_msg;
+
+		slurm_msg_t_init(&send_msg);
+		send_msg.msg_type = eng->orig_msg->msg_type;
+		send_msg.data = eng->orig_msg->data;
+		send_msg.protocol_version = eng->orig_msg->protocol_version;
+		send_msg.flags |= SLURM_MSG_RET_CHUNKS;
+		if (eng->keep_conn)
+			send_msg.flags |= SLURM_MSG_KEEP_CONN;
+		send_msg.forward.timeout = branch->timeout;
+		if ((send_msg.forward.cnt = hostlist_count(branch->hl))) {
+			send_msg.forward.nodelist =
+				hostlist_ranged_string_xmalloc(branch->hl);
 			debug3("Tree sending to %s along with %s",
-			       name, send_msg.forward.nodelist);
+			       branch->name, send_msg.forward.nodelist);
 		} else
-			debug3("Tree sending to %s", name);
+			debug3("Tree sending to %s", branch->name);
+		rc = slurm_send_node_msg(branch->fd, &send_msg);
+		xfree(send_msg.forward.nodelist);
+		if (rc < 0)
+			return SLURM_ERROR;
+		_fwd_set_wait(branch, &send_msg.forward);
+		return SLURM_SUCCESS;
+	}
 
-		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
-						     fwd_tree->timeout);
+	forward = &eng->header.forward;
+	forward->nodelist = hostlist_ranged_string_xmalloc(branch->hl);
+	forward->cnt = hostlist_count(branch->hl);
+	if (forward->nodelist[0]) {
+		debug3("forward: send to %s along with %s",
+		       branch->name, forward->nodelist);
+	} else
+		debug3("forward: send to %s ", branch->name);
+
+	buffer = init_buf(BUF_SIZE);	/* probably enough for header */
+	pack_header(&eng->header, buffer);
+	xfree(forward->nodelist);
+
+	/* add forward data to buffer */
+	if (remaining_buf(buffer) < eng->fwd_struct->buf_len) {
+		int new_size = buffer->processed + eng->fwd_struct->buf_len;
+		new_size += 1024; /* padded for paranoia */
+		xrealloc_nz(buffer->head, new_size);
+		buffer->size = new_size;
+	}
+	if (eng->fwd_struct->buf_len) {
+		memcpy(&buffer->head[buffer->processed],
+		       eng->fwd_struct->buf, eng->fwd_struct->buf_len);
+		buffer->processed += eng->fwd_struct->buf_len;
+	}
+	rc = slurm_msg_sendto(branch->fd, get_buf_data(buffer),
+			      get_buf_offset(buffer));
+	free_buf(buffer);
+	if (rc < 0) {
+		error("forward: slurm_msg_sendto: %m");
+		return SLURM_ERROR;
+	}
 
-		xfree(send_msg.forward.nodelist);
+	_fwd_set_wait(branch, forward);
+	return SLURM_SUCCESS;
+}
 
-		if (ret_list) {
-			int ret_cnt = list_count(ret_list);
-			/* This is most common if a slurmd is running
-			   an older version of Slurm than the
-			   originator of the message.
-			*/
-			if ((ret_cnt <= send_msg.forward.cnt) &&
-			    (errno != SLURM_COMMUNICATIONS_CONNECTION_ERROR)) {
-				error("fwd_tree_thread: %s failed to forward "
-				      "the message, expecting %d ret got only "
-				      "%d",
-				      name, send_msg.forward.cnt + 1, ret_cnt);
-				if (ret_cnt > 1) { /* not likely */
-					ret_data_info_t *ret_data_info = NULL;
-					ListIterator itr =
-						list_iterator_create(ret_list);
-					while ((ret_data_info =
-						list_next(itr))) {
-						if (xstrcmp(ret_data_info->
-							    node_name, name))
-							hostlist_delete_host(
-								fwd_tree->
-								tree_hl,
-								ret_data_info->
-								node_name);
-					}
-					list_iterator_destroy(itr);
-				}
-			}
+/*
+ * A connection kept open from an earlier message failed, most likely because
+ * the node restarted. Open a new one rather than marking the node failed.
+ * RET true if the branch will retry
+ */
+static bool _fwd_reuse_failed(fwd_branch_t *branch)
+{
+	if (!branch->reused)
+		return false;
+	debug3("forward: idle connection to %s failed, reconnecting",
+	       branch->name);
+	_fwd_close(branch);
+	branch->reused = false;
+	branch->no_reuse = true;
+	branch->state = FWD_BRANCH_NEW;
+	branch->deadline = 0;
+	return true;
+}
 
-			slurm_mutex_lock(fwd_tree->tree_mutex);
-			list_transfer(fwd_tree->ret_list, ret_list);
-			slurm_cond_signal(fwd_tree->notify);
-			slurm_mutex_unlock(fwd_tree->tree_mutex);
-			FREE_NULL_LIST(ret_list);
-			/* try next node */
-			if (ret_cnt <= send_msg.forward.cnt) {
-				free(name);
-				/* Abandon tree. This way if all the
-				 * nodes in the branch are down we
-				 * don't have to time out for each
-				 * node serially.
-				 */
-				_start_msg_tree_internal(
-					fwd_tree->tree_hl, NULL,
-					fwd_tree,
-					hostlist_count(fwd_tree->tree_hl));
-				continue;
-			}
-		} else {
-			/* This should never happen (when this was
-			 * written slurm_send_addr_recv_msgs always
-			 * returned a list */
-			error("fwd_tree_thread: no return list given from "
-			      "slurm_send_addr_recv_msgs spawned for %s",
-			      name);
-			slurm_mutex_lock(fwd_tree->tree_mutex);
-			mark_as_failed_forward(
-				&fwd_tree->ret_list, name,
-				SLURM_COMMUNICATIONS_CONNECTION_ERROR);
- 			slurm_cond_signal(fwd_tree->notify);
-			slurm_mutex_unlock(fwd_tree->tree_mutex);
-			free(name);
+/* The first node of a branch could not be sent the message */
+static void _fwd_send_failed(fwd_engine_t *eng, int inx, int err)
+{
+	fwd_branch_t *branch = &eng->branch[inx];
+
+	if (_fwd_reuse_failed(branch))
+		return;
+	_fwd_close(branch);
+	_fwd_fail(eng, branch->name, err);
+	free(branch->name);
+	branch->name = NULL;
+	_fwd_split_branch(eng, inx);
+}
 
-			continue;
-		}
+/*
+ * A connection to the first node of a branch failed. With start_msg_tree(),
+ * retry refused connections once a second for up to MessageTimeout (at most
+ * 10 seconds) so hierarchical communications survive slurmd restarts.
+ */
+static void _fwd_connect_failed(fwd_engine_t *eng, int inx, int64_t now)
+{
+	static int conn_timeout = -1;
+	fwd_branch_t *branch = &eng->branch[inx];
+	int err = errno;
+
+	if (conn_timeout < 0)
+		conn_timeout = MIN(slurm_get_msg_timeout(), 10);
+
+	_fwd_close(branch);
+	errno = err;
+	if ((errno == ECONNREFUSED) && !eng->fwd_struct &&
+	    (branch->refused_cnt < conn_timeout)) {
+		if (!branch->refused_cnt)
+			debug3("connect refused, retrying");
+		branch->refused_cnt++;
+		branch->state = FWD_BRANCH_NEW;
+		branch->deadline = now + 1000;
+		return;
+	}
+	error("forward: connect to %s: %m", branch->name);
+	_fwd_send_failed(eng, inx, SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+}
 
-		free(name);
+static void _fwd_start_send(fwd_engine_t *eng, int inx, int64_t now);
 
-		/* check for error and try again */
-		if (errno == SLURM_COMMUNICATIONS_CONNECTION_ERROR)
- 			continue;
+/* Start connecting a branch to its first node */
+static void _fwd_connect(fwd_engine_t *eng, int inx, int64_t now)
+{
+	static int tcp_timeout = -1;
+	fwd_branch_t *branch = &eng->branch[inx];
 
-		break;
+	if (tcp_timeout < 0)
+		tcp_timeout = slurm_get_tcp_timeout() * 1000;
+
+	while (!branch->name) {
+		if (!(branch->name = hostlist_shift(branch->hl))) {
+			branch->state = FWD_BRANCH_DONE;
+			return;
+		}
+		if (slurm_conf_get_addr(branch->name, &branch->addr) ==
+		    SLURM_ERROR) {
+			error("forward: can't find address for host %s, check slurm.conf",
+			      branch->name);
+			_fwd_fail(eng, branch->name,
+				  SLURM_UNKNOWN_FORWARD_ADDR);
+			free(branch->name);
+			branch->name = NULL;
+		}
 	}
 
-	_destroy_tree_fwd(fwd_tree);
+	if (eng->keep_conn && !branch->no_reuse &&
+	    ((branch->fd = _idle_conn_get(branch->name)) >= 0)) {
+		branch->reused = true;
+		_fwd_start_send(eng, inx, now);
+		return;
+	}
 
-	return NULL;
+	if ((branch->fd = slurm_open_stream_start(&branch->addr)) < 0) {
+		_fwd_connect_failed(eng, inx, now);
+		return;
+	}
+	branch->state = FWD_BRANCH_CONNECT;
+	branch->connect_start = now;
+	branch->deadline = now + tcp_timeout;
 }
 
-static void _start_msg_tree_internal(hostlist_t hl, hostlist_t* sp_hl,
-				     fwd_tree_t *fwd_tree_in,
-				     int hl_count)
+/* A branch's connection completed or failed, send it the message */
+static void _fwd_connected(fwd_engine_t *eng, int inx, int64_t now)
 {
-	int j;
-	fwd_tree_t *fwd_tree;
+	fwd_branch_t *branch = &eng->branch[inx];
 
-	xassert((hl || sp_hl) && !(hl && sp_hl));
-	xassert(fwd_tree_in);
-	xassert(fwd_tree_in->p_thr_count);
-	xassert(fwd_tree_in->tree_mutex);
-	xassert(fwd_tree_in->notify);
-	xassert(fwd_tree_in->ret_list);
+	if (slurm_open_stream_done(branch->fd) != SLURM_SUCCESS) {
+		_fwd_connect_failed(eng, inx, now);
+		return;
+	}
+	_node_stat_rtt(branch->name, now - branch->connect_start);
+	_fwd_start_send(eng, inx, now);
+}
 
-	if (hl)
-		xassert(hl_count == hostlist_count(hl));
+/* Send a connected branch the message and start waiting for its replies */
+static void _fwd_start_send(fwd_engine_t *eng, int inx, int64_t now)
+{
+	fwd_branch_t *branch = &eng->branch[inx];
+	List ret_list;
+	ret_data_info_t *ret_data_info;
+	char *name;
 
-	if (fwd_tree_in->timeout <= 0)
-		/* convert secs to msec */
-		fwd_tree_in->timeout  = slurm_get_msg_timeout() * 1000;
-
-	for (j = 0; j < hl_count; j++) {
-		fwd_tree = xmalloc(sizeof(fwd_tree_t));
-		memcpy(fwd_tree, fwd_tree_in, sizeof(fwd_tree_t));
-
-		if (sp_hl) {
-			fwd_tree->tree_hl = sp_hl[j];
-			sp_hl[j] = NULL;
-		} else if (hl) {
-			char *name = hostlist_shift(hl);
-			fwd_tree->tree_hl = hostlist_create(name);
+	if (_fwd_send(eng, branch) != SLURM_SUCCESS) {
+		_fwd_send_failed(eng, inx, errno);
+		return;
+	}
+
+	/*
+	 * These messages don't have a return message, but if we got here
+	 * things worked out so make note of the list of nodes as success.
+	 */
+	if (eng->fwd_struct &&
+	    ((eng->header.msg_type == REQUEST_SHUTDOWN) ||
+	     (eng->header.msg_type == REQUEST_RECONFIGURE) ||
+	     (eng->header.msg_type == REQUEST_REBOOT_NODES))) {
+		_fwd_close(branch);
+		ret_list = list_create(destroy_data_info);
+		name = branch->name;
+		do {
+			ret_data_info = xmalloc(sizeof(ret_data_info_t));
+			ret_data_info->node_name = xstrdup(name);
+			list_push(ret_list, ret_data_info);
 			free(name);
-		}
+		} while ((name = hostlist_shift(branch->hl)));
+		branch->name = NULL;
+		branch->state = FWD_BRANCH_DONE;
+		_fwd_done(eng, ret_list);
+		FREE_NULL_LIST(ret_list);
+		return;
+	}
 
-		/*
-		 * Lock and increase thread counter, we need that to protect
-		 * the start_msg_tree waiting loop that was originally designed
-		 * around a "while ((count < host_count))" loop. In case where a
-		 * fwd thread was not able to get all the return codes from
-		 * children, the waiting loop was deadlocked.
-		 */
-		slurm_mutex_lock(fwd_tree->tree_mutex);
-		(*fwd_tree->p_thr_count)++;
-		slurm_mutex_unlock(fwd_tree->tree_mutex);
+	branch->state = FWD_BRANCH_RECV;
+	branch->deadline = now + branch->wait;
+}
 
-		slurm_thread_create_detached(NULL, _fwd_tree_thread, fwd_tree);
+/*
+ * The replies of a forward_msg() branch lack some nodes. This should never
+ * happen since the branch's first node should catch its failed forwards and
+ * pipe them back down.
+ */
+static void _fwd_missing(fwd_engine_t *eng, fwd_branch_t *branch,
+			 List ret_list)
+{
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	hostlist_iterator_t host_itr;
+	char *tmp;
+	bool first_node_found = false, node_found;
+
+	error("We shouldn't be here.  We forwarded to %d but only got %d back",
+	      hostlist_count(branch->hl) + 1, list_count(ret_list));
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (!ret_data_info->node_name) {
+			first_node_found = true;
+			ret_data_info->node_name = xstrdup(branch->name);
+		}
+	}
+	host_itr = hostlist_iterator_create(branch->hl);
+	while ((tmp = hostlist_next(host_itr))) {
+		node_found = false;
+		list_iterator_reset(itr);
+		while ((ret_data_info = list_next(itr))) {
+			if (!xstrcmp(tmp, ret_data_info->node_name)) {
+				node_found = true;
+				break;
+			}
+		}
+		if (!node_found) {
+			_fwd_fail(eng, tmp,
+				  SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		}
+		free(tmp);
+	}
+	hostlist_iterator_destroy(host_itr);
+	list_iterator_destroy(itr);
+	if (!first_node_found) {
+		_fwd_fail(eng, branch->name,
+			  SLURM_COMMUNICATIONS_CONNECTION_ERROR);
 	}
 }
 
-static void _forward_msg_internal(hostlist_t hl, hostlist_t* sp_hl,
-				  forward_struct_t *fwd_struct,
-				  header_t *header, int timeout,
-				  int hl_count)
+/*
+ * Take the replies a branch's first node sent ahead of its own, if ret_list
+ * holds such a partial reply. The branch keeps waiting for the rest.
+ * RET true if ret_list was a partial reply, consumed
+ */
+static bool _fwd_partial(fwd_engine_t *eng, fwd_branch_t *branch,
+			 List ret_list)
 {
-	int j;
-	forward_msg_t *fwd_msg = NULL;
-	char *buf = NULL, *tmp_char = NULL;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	bool partial = false;
+
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		if (ret_data_info->type == RESPONSE_FORWARD_PARTIAL) {
+			list_delete_item(itr);
+			partial = true;
+		}
+	}
+	if (!partial) {
+		list_iterator_destroy(itr);
+		return false;
+	}
+	list_iterator_reset(itr);
+	while ((ret_data_info = list_next(itr))) {
+		if (!ret_data_info->node_name ||
+		    (hostlist_delete_host(branch->hl,
+					  ret_data_info->node_name) <= 0)) {
+			error("forward: unexpected reply from %s in %s's branch",
+			      ret_data_info->node_name, branch->name);
+			list_delete_item(itr);
+		}
+	}
+	list_iterator_destroy(itr);
+	debug3("forward: %d replies from %s's branch ahead of the rest",
+	       list_count(ret_list), branch->name);
+	_fwd_done(eng, ret_list);
+	FREE_NULL_LIST(ret_list);
+	return true;
+}
 
-	if (timeout <= 0)
-		/* convert secs to msec */
-		timeout  = slurm_get_msg_timeout() * 1000;
+/*
+ * Read the replies of a branch, or note it timed out
+ * IN timed_out - deadline passed before any reply
+ */
+static void _fwd_recv(fwd_engine_t *eng, int inx, int64_t now, bool timed_out)
+{
+	fwd_branch_t *branch = &eng->branch[inx];
+	List ret_list = NULL;
+	ListIterator itr;
+	ret_data_info_t *ret_data_info;
+	int fwd_cnt = hostlist_count(branch->hl), ret_cnt = 0, err;
+
+	if (timed_out) {
+		err = SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT;
+		error("forward: no reply from %s: %s",
+		      branch->name, slurm_strerror(err));
+	} else {
+		ret_list = slurm_receive_msgs(branch->fd, branch->steps,
+					      MAX(branch->deadline - now, 1));
+		err = errno;
+		if (!ret_list && (err != SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT) &&
+		    _fwd_reuse_failed(branch))
+			return;
+		if (ret_list && _fwd_partial(eng, branch, ret_list))
+			return;
+	}
+	if (ret_list && eng->keep_conn) {
+		_idle_conn_put(branch->name, branch->fd);
+		branch->fd = -1;
+	}
+	_fwd_close(branch);
+	branch->reused = false;
+	branch->no_reuse = false;
+	if (ret_list) {
+		ret_cnt = list_count(ret_list);
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			if (eng->fwd_struct && (ret_cnt != fwd_cnt + 1))
+				continue;	/* see _fwd_missing() */
+			if (!ret_data_info->node_name) {
+				ret_data_info->node_name =
+					xstrdup(branch->name);
+			}
+		}
+		list_iterator_destroy(itr);
+	}
 
-	for (j = 0; j < hl_count; j++) {
-		fwd_msg = xmalloc(sizeof(forward_msg_t));
+	if (eng->fwd_struct) {
+		if (!ret_list || (fwd_cnt && (ret_cnt <= 1))) {
+			/* Try the branch's next node */
+			_fwd_fail(eng, branch->name, err);
+			free(branch->name);
+			branch->name = NULL;
+			FREE_NULL_LIST(ret_list);
+			branch->state = FWD_BRANCH_NEW;
+			branch->deadline = 0;
+			if (!hostlist_count(branch->hl))
+				branch->state = FWD_BRANCH_DONE;
+			return;
+		}
+		if (ret_cnt != fwd_cnt + 1)
+			_fwd_missing(eng, branch, ret_list);
+		_fwd_done(eng, ret_list);
+		FREE_NULL_LIST(ret_list);
+		free(branch->name);
+		branch->name = NULL;
+		branch->state = FWD_BRANCH_DONE;
+		return;
+	}
 
-		fwd_msg->fwd_struct = fwd_struct;
+	if (!ret_list) {
+		mark_as_failed_forward(&ret_list, branch->name, err);
+		ret_cnt = 1;
+	} else if (ret_cnt <= fwd_cnt) {
+		/*
+		 * This is most common if a slurmd is running an older
+		 * version of Slurm than the originator of the message.
+		 */
+		error("forward: %s failed to forward the message, expecting %d ret got only %d",
+		      branch->name, fwd_cnt + 1, ret_cnt);
+		if (ret_cnt > 1) {	/* not likely */
+			itr = list_iterator_create(ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				if (xstrcmp(ret_data_info->node_name,
+					    branch->name))
+					hostlist_delete_host(
+						branch->hl,
+						ret_data_info->node_name);
+			}
+			list_iterator_destroy(itr);
+		}
+	}
+	_fwd_done(eng, ret_list);
+	FREE_NULL_LIST(ret_list);
+	free(branch->name);
+	branch->name = NULL;
+	if (ret_cnt <= fwd_cnt)
+		_fwd_split_branch(eng, inx);
+	else
+		branch->state = FWD_BRANCH_DONE;
+}
 
-		fwd_msg->timeout = timeout;
+/* Drive all branches of the tree until every node replied or failed */
+static void _fwd_engine_run(fwd_engine_t *eng)
+{
+	struct pollfd *pfd = NULL;
+	int *pfd_inx = NULL;
+	int pfd_size = 0, pfd_cnt, i, rc, wait;
+	int64_t now, next;
+	fwd_branch_t *branch;
+
+	while (1) {
+		now = _now_msec();
+
+		/* Start connections and expire deadlines */
+		for (i = 0; i < eng->branch_cnt; i++) {
+			branch = &eng->branch[i];
+			if (branch->state == FWD_BRANCH_DONE)
+				continue;
+			if (branch->deadline > now)
+				continue;
+			if (branch->state == FWD_BRANCH_NEW) {
+				_fwd_connect(eng, i, now);
+			} else if (branch->state == FWD_BRANCH_CONNECT) {
+				errno = ETIMEDOUT;
+				error("forward: connect to %s: %m",
+				      branch->name);
+				_fwd_send_failed(
+					eng, i,
+					SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			} else if (branch->state == FWD_BRANCH_RECV) {
+				_fwd_recv(eng, i, now, true);
+			}
+		}
 
-		memcpy(&fwd_msg->header.orig_addr,
-		       &header->orig_addr,
-		       sizeof(slurm_addr_t));
+		if (pfd_size < eng->branch_cnt) {
+			pfd_size = eng->branch_cnt;
+			xrealloc(pfd, sizeof(struct pollfd) * pfd_size);
+			xrealloc(pfd_inx, sizeof(int) * pfd_size);
+		}
+		pfd_cnt = 0;
+		next = INT64_MAX;
+		for (i = 0; i < eng->branch_cnt; i++) {
+			branch = &eng->branch[i];
+			if (branch->state == FWD_BRANCH_DONE)
+				continue;
+			next = MIN(next, branch->deadline);
+			if (branch->state == FWD_BRANCH_NEW)
+				continue;
+			pfd[pfd_cnt].fd = branch->fd;
+			if (branch->state == FWD_BRANCH_CONNECT)
+				pfd[pfd_cnt].events = POLLOUT;
+			else
+				pfd[pfd_cnt].events = POLLIN;
+			pfd[pfd_cnt].revents = 0;
+			pfd_inx[pfd_cnt++] = i;
+		}
+		if (next == INT64_MAX)
+			break;		/* All branches done */
 
-		fwd_msg->header.version = header->version;
-		fwd_msg->header.flags = header->flags;
-		fwd_msg->header.msg_type = header->msg_type;
-		fwd_msg->header.body_length = header->body_length;
-		fwd_msg->header.ret_list = NULL;
-		fwd_msg->header.ret_cnt = 0;
+		wait = MAX(next - _now_msec(), 0);
+		if ((rc = poll(pfd, pfd_cnt, wait)) < 0) {
+			if ((errno != EINTR) && (errno != EAGAIN))
+				error("forward: poll: %m");
+			continue;
+		}
+		if (rc == 0)
+			continue;
 
-		if (sp_hl) {
-			buf = hostlist_ranged_string_xmalloc(sp_hl[j]);
-			hostlist_destroy(sp_hl[j]);
-		} else {
-			tmp_char = hostlist_shift(hl);
-			buf = xstrdup(tmp_char);
-			free(tmp_char);
+		now = _now_msec();
+		for (i = 0; i < pfd_cnt; i++) {
+			if (!pfd[i].revents)
+				continue;
+			branch = &eng->branch[pfd_inx[i]];
+			if (branch->state == FWD_BRANCH_CONNECT)
+				_fwd_connected(eng, pfd_inx[i], now);
+			else if (branch->state == FWD_BRANCH_RECV)
+				_fwd_recv(eng, pfd_inx[i], now, false);
 		}
+	}
+
+	xfree(pfd);
+	xfree(pfd_inx);
+}
 
-		forward_init(&fwd_msg->header.forward, NULL);
-		fwd_msg->header.forward.nodelist = buf;
-		slurm_thread_create_detached(NULL, _forward_thread, fwd_msg);
+static void _fwd_engine_free(fwd_engine_t *eng)
+{
+	int i;
+
+	for (i = 0; i < eng->branch_cnt; i++) {
+		FREE_NULL_HOSTLIST(eng->branch[i].hl);
+		xassert(!eng->branch[i].name);
 	}
+	xfree(eng->branch);
+	xfree(eng);
+}
+
+/* Thread running the event loop for a forward_msg() call */
+static void *_fwd_engine_thread(void *arg)
+{
+	fwd_engine_t *eng = arg;
+
+	_fwd_engine_run(eng);
+	_fwd_engine_free(eng);
+
+	return NULL;
 }
 
 /*
@@ -584,6 +1068,16 @@ extern void forward_init(forward_t *forward, forward_t *from)
 	}
 }
 
+/* Return true if CommunicationParameters=PersistNodeConn is configured */
+extern bool forward_keep_conn(void)
+{
+	char *comm_params = slurm_get_comm_parameters();
+	bool keep_conn = (xstrcasestr(comm_params, "PersistNodeConn") != NULL);
+
+	xfree(comm_params);
+	return keep_conn;
+}
+
 /*
  * forward_msg        - logic to forward a message which has been received and
  *                      accumulate the return codes from processes getting the
@@ -601,6 +1095,7 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 	hostlist_t hl = NULL;
 	hostlist_t* sp_hl;
 	int hl_count = 0;
+	fwd_engine_t *eng;
 
 	if (!forward_struct->ret_list) {
 		error("didn't get a ret_list from forward_struct");
@@ -616,8 +1111,20 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
 		return SLURM_ERROR;
 	}
 
-	_forward_msg_internal(NULL, sp_hl, forward_struct, header,
-			      forward_struct->timeout, hl_count);
+	eng = xmalloc(sizeof(fwd_engine_t));
+	eng->fwd_struct = forward_struct;
+	memcpy(&eng->header.orig_addr, &header->orig_addr,
+	       sizeof(slurm_addr_t));
+	eng->header.version = header->version;
+	eng->header.flags = header->flags | SLURM_MSG_RET_CHUNKS;
+	eng->header.msg_type = header->msg_type;
+	eng->header.body_length = header->body_length;
+	eng->keep_conn = (header->flags & SLURM_MSG_KEEP_CONN) &&
+			 forward_keep_conn();
+	forward_init(&eng->header.forward, NULL);
+	_fwd_add_tree(eng, sp_hl, hl_count, header->forward.tree_width,
+		      forward_struct->timeout);
+	slurm_thread_create_detached(NULL, _fwd_engine_thread, eng);
 
 	xfree(sp_hl);
 	hostlist_destroy(hl);
@@ -638,12 +1145,8 @@ extern int forward_msg(forward_struct_t *forward_struct, header_t *header)
  */
 extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 {
-	fwd_tree_t fwd_tree;
-	pthread_mutex_t tree_mutex;
-	pthread_cond_t notify;
-	int count = 0;
+	fwd_engine_t *eng;
 	List ret_list = NULL;
-	int thr_count = 0;
 	int host_count = 0;
 	hostlist_t* sp_hl;
 	int hl_count = 0;
@@ -659,39 +1162,27 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout)
 		error("unable to split forward hostlist");
 		return NULL;
 	}
-	slurm_mutex_init(&tree_mutex);
-	slurm_cond_init(&notify, NULL);
 
 	ret_list = list_create(destroy_data_info);
 
-	memset(&fwd_tree, 0, sizeof(fwd_tree));
-	fwd_tree.orig_msg = msg;
-	fwd_tree.ret_list = ret_list;
-	fwd_tree.timeout = timeout;
-	fwd_tree.notify = &notify;
-	fwd_tree.p_thr_count = &thr_count;
-	fwd_tree.tree_mutex = &tree_mutex;
-
-	_start_msg_tree_internal(NULL, sp_hl, &fwd_tree, hl_count);
+	if (timeout <= 0)
+		/* convert secs to msec */
+		timeout  = slurm_get_msg_timeout() * 1000;
 
+	eng = xmalloc(sizeof(fwd_engine_t));
+	eng->orig_msg = msg;
+	eng->keep_conn = forward_keep_conn() && _keep_conn_type(msg->msg_type);
+	eng->ret_list = ret_list;
+	eng->timeout = timeout;
+	_fwd_add_tree(eng, sp_hl, hl_count, msg->forward.tree_width, timeout);
 	xfree(sp_hl);
 
-	slurm_mutex_lock(&tree_mutex);
-
-	count = list_count(ret_list);
-	debug2("Tree head got back %d looking for %d", count, host_count);
-	while (thr_count > 0) {
-		slurm_cond_wait(&notify, &tree_mutex);
-		count = list_count(ret_list);
-		debug2("Tree head got back %d", count);
-	}
-	xassert(count >= host_count);	/* Tree head did not get all responses,
-					 * but no more active fwd threads!*/
-	slurm_mutex_unlock(&tree_mutex);
-
-	slurm_mutex_destroy(&tree_mutex);
-	slurm_cond_destroy(&notify);
+	_fwd_engine_run(eng);
+	_fwd_engine_free(eng);
 
+	debug2("Tree head got back %d looking for %d",
+	       list_count(ret_list), host_count);
+	xassert(list_count(ret_list) >= host_count);
 	return ret_list;
 }
 
@@ -720,9 +1211,39 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err)
 	return;
 }
 
-extern void forward_wait(slurm_msg_t * msg)
+#define FWD_CHUNK_WAIT	2	/* secs, wait before sending replies ahead */
+
+/* Send the replies collected so far up the tree ahead of our own reply */
+static int _send_partial(slurm_msg_t *msg, int fd, List ret_list)
 {
-	int count = 0;
+	slurm_msg_t part_msg;
+
+	slurm_msg_t_init(&part_msg);
+	part_msg.address = msg->address;
+	part_msg.auth_index = msg->auth_index;
+	part_msg.flags = msg->flags;
+	part_msg.msg_type = RESPONSE_FORWARD_PARTIAL;
+	part_msg.protocol_version = msg->protocol_version;
+	part_msg.ret_list = ret_list;
+	debug3("forward: sending %d replies ahead", list_count(ret_list));
+
+	return slurm_send_node_msg(fd, &part_msg);
+}
+
+/*
+ * forward_wait - wait for the replies of the nodes a message was forwarded to
+ * If the sender set SLURM_MSG_RET_CHUNKS, replies collected while waiting
+ * longer than FWD_CHUNK_WAIT are sent ahead to it on fd once a second, so a
+ * node slow to reply doesn't hold back those of the rest of the subtree.
+ */
+extern void forward_wait(slurm_msg_t * msg, int fd)
+{
+	int count = 0, sent = 0;
+	bool chunks = (msg->flags & SLURM_MSG_RET_CHUNKS) && (fd >= 0);
+	struct timespec ts;
+	time_t now, next_chunk = time(NULL) + FWD_CHUNK_WAIT;
+	List part_list;
+	ret_data_info_t *ret_data_info;
 
 	/* wait for all the other messages on the tree under us */
 	if (msg->forward_struct) {
@@ -734,13 +1255,43 @@ extern void forward_wait(slurm_msg_t * msg)
 
 		debug2("Got back %d", count);
 		while ((count < msg->forward_struct->fwd_cnt)) {
-			slurm_cond_wait(&msg->forward_struct->notify,
-					&msg->forward_struct->forward_mutex);
+			if (!chunks) {
+				slurm_cond_wait(&msg->forward_struct->notify,
+						&msg->forward_struct->
+						forward_mutex);
+			} else {
+				ts.tv_sec = next_chunk;
+				ts.tv_nsec = 0;
+				slurm_cond_timedwait(
+					&msg->forward_struct->notify,
+					&msg->forward_struct->forward_mutex,
+					&ts);
+			}
 
 			if (msg->ret_list != NULL) {
-				count = list_count(msg->ret_list);
+				count = sent + list_count(msg->ret_list);
 			}
 			debug2("Got back %d", count);
+
+			now = time(NULL);
+			if (!chunks || (now < next_chunk) ||
+			    (count >= msg->forward_struct->fwd_cnt))
+				continue;
+			next_chunk = now + 1;
+			if (!msg->ret_list || !list_count(msg->ret_list))
+				continue;
+			part_list = list_create(destroy_data_info);
+			while ((ret_data_info = list_pop(msg->ret_list)))
+				list_append(part_list, ret_data_info);
+			slurm_mutex_unlock(&msg->forward_struct->forward_mutex);
+			if (_send_partial(msg, fd, part_list) < 0) {
+				/* The sender retries the missing nodes */
+				error("forward: sending replies ahead: %m");
+				chunks = false;
+			}
+			sent += list_count(part_list);
+			FREE_NULL_LIST(part_list);
+			slurm_mutex_lock(&msg->forward_struct->forward_mutex);
 		}
 		debug2("Got them all");
 		slurm_mutex_unlock(&msg->forward_struct->forward_mutex);
@@ -111,7 +111,26 @@ extern List start_msg_tree(hostlist_t hl, slurm_msg_t *msg, int timeout);
  */
 extern void mark_as_failed_forward(List *ret_list, char *node_name, int err);
 
-extern void forward_wait(slurm_msg_t *msg);
+/*
+ * forward_wait - wait for the replies of the nodes the message was forwarded
+ *	to, sending them ahead on fd if they are slow to complete and the
+ *	sender set SLURM_MSG_RET_CHUNKS
+ * IN: msg - reply about to be sent
+ * IN: fd  - connection the reply is sent on
+ */
+extern void forward_wait(slurm_msg_t *msg, int fd);
+
+/*
+ * With CommunicationParameters=PersistNodeConn, connections used for node
+ * health RPCs (ping, registration status, health check and accounting
+ * gather updates) are sent with SLURM_MSG_KEEP_CONN and kept open once
+ * answered. The sender reuses an idle connection for up to KEEP_CONN_IDLE
+ * seconds; the receiver waits a minute longer before closing it.
+ */
+#define KEEP_CONN_IDLE 300
+
+/* Return true if CommunicationParameters=PersistNodeConn is configured */
+extern bool forward_keep_conn(void);
 
 /*
  * no_resp_forward - Used to respond for nodes not able to respond since
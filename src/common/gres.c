@@ -5178,6 +5178,9 @@ static void *_job_state_dup(void *gres_data)
 
 	new_gres_ptr = xmalloc(sizeof(gres_job_state_t));
 	new_gres_ptr->cpus_per_gres	= gres_ptr->cpus_per_gres;
+	new_gres_ptr->def_cpus_per_gres	= gres_ptr->def_cpus_per_gres;
+	new_gres_ptr->def_mem_per_gres	= gres_ptr->def_mem_per_gres;
+	new_gres_ptr->flags		= gres_ptr->flags;
 	new_gres_ptr->gres_name		= xstrdup(gres_ptr->gres_name);
 	new_gres_ptr->gres_per_job	= gres_ptr->gres_per_job;
 	new_gres_ptr->gres_per_node	= gres_ptr->gres_per_node;
@@ -83,6 +83,7 @@ xhash_t* node_hash_table = NULL;
 int node_record_count = 0;		/* count in node_record_table_ptr */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
+node_sched_table_t node_sched_table = { 0 };
 
 /* Local function defiitions */
 static int	_build_single_nodeline_info(slurm_conf_node_t *node_ptr,
@@ -792,6 +793,7 @@ extern int init_node_conf (void)
 	node_record_count = 0;
 	xfree(node_record_table_ptr);
 	xhash_free(node_hash_table);
+	node_sched_table_fini();
 
 	if (config_list)	/* delete defunct configuration entries */
 		(void) _delete_config_record ();
@@ -822,6 +824,7 @@ extern void node_fini2 (void)
 
 	xfree(node_record_table_ptr);
 	node_record_count = 0;
+	node_sched_table_fini();
 }
 
 
@@ -1039,6 +1042,55 @@ extern void cr_fini_global_core_data(void)
 	xfree(cr_node_cores_offset);
 }
 
+static void _node_sched_table_set(struct node_record *node_ptr, int n,
+				  uint16_t fast_schedule)
+{
+	if (fast_schedule) {
+		node_sched_table.cpus[n] = node_ptr->config_ptr->cpus;
+		node_sched_table.real_memory[n] =
+			node_ptr->config_ptr->real_memory;
+	} else {
+		node_sched_table.cpus[n] = node_ptr->cpus;
+		node_sched_table.real_memory[n] = node_ptr->real_memory;
+	}
+	node_sched_table.mem_spec_limit[n] = node_ptr->mem_spec_limit;
+}
+
+/* (re)build node_sched_table from the node records */
+extern void node_sched_table_init(struct node_record *node_ptr, int node_cnt,
+				  uint16_t fast_schedule)
+{
+	int n;
+
+	node_sched_table_fini();
+
+	node_sched_table.node_cnt = node_cnt;
+	node_sched_table.cpus = xcalloc(node_cnt, sizeof(uint16_t));
+	node_sched_table.real_memory = xcalloc(node_cnt, sizeof(uint64_t));
+	node_sched_table.mem_spec_limit = xcalloc(node_cnt, sizeof(uint64_t));
+	node_sched_table.sched_weight = xcalloc(node_cnt, sizeof(uint64_t));
+	for (n = 0; n < node_cnt; n++)
+		_node_sched_table_set(node_ptr + n, n, fast_schedule);
+}
+
+/* Refresh a node's node_sched_table entry after its configuration changed */
+extern void node_sched_table_update(int node_inx, uint16_t fast_schedule)
+{
+	if ((node_inx < 0) || (node_inx >= node_sched_table.node_cnt))
+		return;
+	_node_sched_table_set(node_record_table_ptr + node_inx, node_inx,
+			      fast_schedule);
+}
+
+extern void node_sched_table_fini(void)
+{
+	xfree(node_sched_table.cpus);
+	xfree(node_sched_table.real_memory);
+	xfree(node_sched_table.mem_spec_limit);
+	xfree(node_sched_table.sched_weight);
+	node_sched_table.node_cnt = 0;
+}
+
 /* return the coremap index to the first core of the given node */
 
 extern uint32_t cr_get_coremap_offset(uint32_t node_index)
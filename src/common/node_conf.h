@@ -138,8 +138,6 @@ struct node_record {
 					 * use for scheduling purposes */
 	List gres_list;			/* list of gres state info managed by
 					 * plugins */
-	uint64_t sched_weight;		/* Node's weight for scheduling
-					 * purposes. For cons_tres use */
 	uint32_t weight;		/* orignal weight, used only for state
 					 * save/restore, DO NOT use for
 					 * scheduling purposes. */
@@ -178,6 +176,24 @@ extern time_t last_node_update;		/* time of last node record update */
 extern uint16_t *cr_node_num_cores;
 extern uint32_t *cr_node_cores_offset;
 
+/*
+ * Node fields read by the scheduling loops, kept in arrays indexed like
+ * node_record_table_ptr. Scanning thousands of nodes then only touches the
+ * few fields needed rather than pulling every node_record through the cache.
+ * The CPU and memory counts are the configured or the actual values depending
+ * upon FastSchedule, as the node selection plugins would use them.
+ */
+typedef struct node_sched_table {
+	int node_cnt;			/* entries in each array */
+	uint16_t *cpus;			/* CPUs available for scheduling */
+	uint64_t *real_memory;		/* MB of memory for scheduling */
+	uint64_t *mem_spec_limit;	/* MB of specialized/system memory */
+	uint64_t *sched_weight;		/* weight for scheduling, set for each
+					 * job by the slurmctld, for cons_tres */
+} node_sched_table_t;
+
+extern node_sched_table_t node_sched_table;
+
 /*
  * bitmap2node_name_sortable - given a bitmap, build a list of comma
  *	separated node names. names may include regular expressions
@@ -324,6 +340,15 @@ extern void cr_init_global_core_data(struct node_record *node_ptr,
 
 extern void cr_fini_global_core_data(void);
 
+/* (re)build node_sched_table from the node records */
+extern void node_sched_table_init(struct node_record *node_ptr, int node_cnt,
+				  uint16_t fast_schedule);
+
+/* Refresh a node's node_sched_table entry after its configuration changed */
+extern void node_sched_table_update(int node_inx, uint16_t fast_schedule);
+
+extern void node_sched_table_fini(void);
+
 /*return the coremap index to the first core of the given node */
 extern uint32_t cr_get_coremap_offset(uint32_t node_index);
 
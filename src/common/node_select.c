@@ -114,6 +114,8 @@ static slurm_select_ops_t *ops = NULL;
 static plugin_context_t **select_context = NULL;
 static pthread_mutex_t select_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
+static pthread_mutex_t job_test_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t job_test_cnt = 0;
 
 typedef struct _plugin_args {
 	char *plugin_type;
@@ -523,6 +525,10 @@ extern int select_g_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	if (slurm_select_init(0) < 0)
 		return SLURM_ERROR;
 
+	slurm_mutex_lock(&job_test_lock);
+	job_test_cnt++;
+	slurm_mutex_unlock(&job_test_lock);
+
 	return (*(ops[select_context_default].job_test))
 		(job_ptr, bitmap,
 		 min_nodes, max_nodes,
@@ -531,6 +537,18 @@ extern int select_g_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		 exc_core_bitmap);
 }
 
+/* Return the count of select_g_job_test() calls made so far */
+extern uint64_t select_g_job_test_count(void)
+{
+	uint64_t cnt;
+
+	slurm_mutex_lock(&job_test_lock);
+	cnt = job_test_cnt;
+	slurm_mutex_unlock(&job_test_lock);
+
+	return cnt;
+}
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after select_g_job_test(). Executed from slurmctld.
@@ -470,6 +470,9 @@ extern int select_g_job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			     List *preemptee_job_list,
 			     bitstr_t *exc_core_bitmap);
 
+/* Return the count of select_g_job_test() calls made so far */
+extern uint64_t select_g_job_test_count(void);
+
 /*
  * Note initiation of job is about to begin. Called immediately
  * after select_g_job_test(). Executed from slurmctld.
@@ -497,6 +497,17 @@ static slurm_cli_opt_t slurm_opt_bbf = {
 	.reset_func = arg_reset_burst_buffer_file,
 };
 
+COMMON_SBATCH_STRING_OPTION(bulk_file);
+static slurm_cli_opt_t slurm_opt_bulk = {
+	.name = "bulk",
+	.has_arg = required_argument,
+	.val = LONG_OPT_BULK,
+	.sbatch_early_pass = true,
+	.set_func_sbatch = arg_set_bulk_file,
+	.get_func = arg_get_bulk_file,
+	.reset_func = arg_reset_bulk_file,
+};
+
 static int arg_set_bcast(slurm_opt_t *opt, const char *arg)
 {
 	if (!opt->srun_opt)
@@ -3512,6 +3523,7 @@ static slurm_cli_opt_t *common_options[] = {
 	&slurm_opt_bell,
 	&slurm_opt_bb,
 	&slurm_opt_bbf,
+	&slurm_opt_bulk,
 	&slurm_opt_c_constraint,
 	&slurm_opt_checkpoint,
 	&slurm_opt_chdir,
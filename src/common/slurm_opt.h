@@ -75,6 +75,7 @@ enum {
 	LONG_OPT_BCAST,
 	LONG_OPT_BELL,
 	LONG_OPT_BLRTS_IMAGE,
+	LONG_OPT_BULK,
 	LONG_OPT_BURST_BUFFER_FILE,
 	LONG_OPT_BURST_BUFFER_SPEC,
 	LONG_OPT_CHECKPOINT,
@@ -198,6 +199,7 @@ typedef struct sbatch_opt {
 
 	char *array_inx;		/* --array			*/
 	char *batch_features;		/* --batch			*/
+	char *bulk_file;		/* --bulk=file			*/
 	int ckpt_interval;		/* --checkpoint (int minutes)	*/
 	char *export_env;		/* --export			*/
 	char *export_file;		/* --export-file=file		*/
@@ -4102,7 +4102,7 @@ int slurm_send_node_msg(int fd, slurm_msg_t * msg)
 	if (!msg->forward.tree_width)
 		msg->forward.tree_width = slurm_get_tree_width();
 
-	forward_wait(msg);
+	forward_wait(msg, fd);
 
 	if (difftime(time(NULL), start_time) >= 60) {
 		(void) g_slurm_auth_destroy(auth_cred);
@@ -104,5 +104,9 @@
 #define SLURMDBD_CONNECTION     0x0002
 #define SLURM_MSG_KEEP_BUFFER   0x0004
 #define SLURM_DROP_PRIV		0x0008
+#define SLURM_MSG_KEEP_CONN	0x0010	/* Sender will reuse the connection
+					 * once answered */
+#define SLURM_MSG_RET_CHUNKS	0x0020	/* Sender accepts forwarded replies
+					 * over several messages */
 
 #endif
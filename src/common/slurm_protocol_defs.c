@@ -128,6 +128,8 @@ extern void slurm_msg_t_copy(slurm_msg_t *dest, slurm_msg_t *src)
 	dest->forward = src->forward;
 	dest->ret_list = src->ret_list;
 	dest->forward_struct = src->forward_struct;
+	/* Replies may be sent ahead of forward_wait() if the sender allows */
+	dest->flags |= src->flags & SLURM_MSG_RET_CHUNKS;
 	dest->orig_addr.sin_addr.s_addr = 0;
 	return;
 }
@@ -787,6 +789,21 @@ extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg)
 	}
 }
 
+extern void slurm_free_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg)
+{
+	xfree(msg);
+}
+
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg)
+{
+	if (msg) {
+		slurm_free_job_info_msg(msg->job_info);
+		xfree(msg->purged_job_ids);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_job_step_info_request_msg(job_step_info_request_msg_t *msg)
 {
 	xfree(msg);
@@ -1582,6 +1599,30 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		for (i = 0; i < msg->rpc_class_count; i++) {
+			xfree(msg->rpc_class_name[i]);
+		}
+		xfree(msg->rpc_class_name);
+		xfree(msg->rpc_class_depth);
+		xfree(msg->rpc_class_max_depth);
+		xfree(msg->rpc_class_active);
+		xfree(msg->rpc_class_cnt);
+		xfree(msg->rpc_class_wait_time);
+		xfree(msg->rpc_class_max_wait);
+		for (i = 0; i < msg->state_load_count; i++) {
+			xfree(msg->state_load_name[i]);
+		}
+		xfree(msg->state_load_name);
+		xfree(msg->state_load_time);
+		for (i = 0; i < msg->job_hash_count; i++) {
+			xfree(msg->job_hash_name[i]);
+		}
+		xfree(msg->job_hash_name);
+		xfree(msg->job_hash_size);
+		xfree(msg->job_hash_records);
+		xfree(msg->job_hash_probe_sum);
+		xfree(msg->job_hash_probe_max);
+		xfree(msg->job_hash_resizes);
 		xfree(msg);
 	}
 }
@@ -2519,6 +2560,14 @@ extern void slurm_free_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg)
 	xfree(msg);
 }
 
+extern void slurm_free_node_heartbeat_msg(node_heartbeat_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->node_name);
+		xfree(msg);
+	}
+}
+
 /*
  * structured as a static lookup table, which allows this
  * to be thread safe while avoiding any heap allocation
@@ -3980,6 +4029,22 @@ extern void slurm_free_submit_response_response_msg(submit_response_msg_t * msg)
 	}
 }
 
+/*
+ * slurm_free_submit_bulk_response_msg - free bulk job submit response message
+ * IN msg - pointer to bulk job submit response message
+ * NOTE: buffer is loaded by slurm_submit_batch_job_bulk
+ */
+extern void slurm_free_submit_bulk_response_msg(
+	submit_bulk_response_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->job_id);
+		xfree(msg->error_code);
+		xfree(msg->job_submit_user_msg);
+		xfree(msg);
+	}
+}
+
 
 /*
  * slurm_free_ctl_conf - free slurm control information response message
@@ -4885,6 +4950,7 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_TAKEOVER:
 	case REQUEST_SHUTDOWN_IMMEDIATE:
 	case RESPONSE_FORWARD_FAILED:
+	case RESPONSE_FORWARD_PARTIAL:
 	case REQUEST_DAEMON_STATUS:
 	case REQUEST_HEALTH_CHECK:
 	case REQUEST_ACCT_GATHER_UPDATE:
@@ -4928,6 +4994,9 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case RESPONSE_PING_SLURMD:
 		slurm_free_ping_slurmd_resp(data);
 		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		slurm_free_node_heartbeat_msg(data);
+		break;
 	case RESPONSE_JOB_ARRAY_ERRORS:
 		slurm_free_job_array_resp(data);
 		break;
@@ -5015,9 +5084,13 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		break;
 	case REQUEST_JOB_PACK_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_JOB_PACK:
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
 	case RESPONSE_JOB_PACK_ALLOCATION:
 		FREE_NULL_LIST(data);
 		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_BULK:
+		slurm_free_submit_bulk_response_msg(data);
+		break;
 	case REQUEST_SET_FS_DAMPENING_FACTOR:
 		slurm_free_set_fs_dampening_factor_msg(data);
 		break;
@@ -5030,6 +5103,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case RESPONSE_BURST_BUFFER_STATUS:
 		slurm_free_bb_status_resp_msg(data);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		slurm_free_job_info_delta_request_msg(data);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		slurm_free_job_info_delta_msg(data);
+		break;
 	default:
 		error("invalid type trying to be freed %u", type);
 		break;
@@ -5198,6 +5277,8 @@ rpc_num2string(uint16_t opcode)
 		return "RESPONSE_LICENSE_INFO";
 	case REQUEST_SET_FS_DAMPENING_FACTOR:
 		return "REQUEST_SET_FS_DAMPENING_FACTOR,";
+	case MESSAGE_NODE_HEARTBEAT:
+		return "MESSAGE_NODE_HEARTBEAT";
 
 	case REQUEST_BUILD_INFO:				/* 2001 */
 		return "REQUEST_BUILD_INFO";
@@ -5305,6 +5386,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_BURST_BUFFER_STATUS";
 	case RESPONSE_BURST_BUFFER_STATUS:
 		return "RESPONSE_BURST_BUFFER_STATUS";
+	case REQUEST_JOB_INFO_DELTA:
+		return "REQUEST_JOB_INFO_DELTA";
+	case RESPONSE_JOB_INFO_DELTA:
+		return "RESPONSE_JOB_INFO_DELTA";
 
 	case REQUEST_UPDATE_JOB:				/* 3001 */
 		return "REQUEST_UPDATE_JOB";
@@ -5394,6 +5479,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_JOB_PACK_ALLOC_INFO";
 	case REQUEST_SUBMIT_BATCH_JOB_PACK:
 		return "REQUEST_SUBMIT_BATCH_JOB_PACK";
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
+		return "REQUEST_SUBMIT_BATCH_JOB_BULK";
+	case RESPONSE_SUBMIT_BATCH_JOB_BULK:
+		return "RESPONSE_SUBMIT_BATCH_JOB_BULK";
 
 	case REQUEST_JOB_STEP_CREATE:				/* 5001 */
 		return "REQUEST_JOB_STEP_CREATE";
@@ -5547,6 +5636,8 @@ rpc_num2string(uint16_t opcode)
 
 	case RESPONSE_FORWARD_FAILED:				/* 9001 */
 		return "RESPONSE_FORWARD_FAILED";
+	case RESPONSE_FORWARD_PARTIAL:
+		return "RESPONSE_FORWARD_PARTIAL";
 
 	case ACCOUNTING_UPDATE_MSG:				/* 10001 */
 		return "ACCOUNTING_UPDATE_MSG";
@@ -208,6 +208,7 @@ typedef enum {
 	RESPONSE_LICENSE_INFO,
 	REQUEST_SET_FS_DAMPENING_FACTOR,
 	RESPONSE_NODE_REGISTRATION,
+	MESSAGE_NODE_HEARTBEAT,
 
 	PERSIST_RC = 1433, /* To mirror the DBD_RC this is replacing */
 	/* Don't make any messages in this range as this is what the DBD uses
@@ -270,6 +271,8 @@ typedef enum {
 	RESPONSE_CONTROL_STATUS,
 	REQUEST_BURST_BUFFER_STATUS,
 	RESPONSE_BURST_BUFFER_STATUS,
+	REQUEST_JOB_INFO_DELTA,
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -313,6 +316,8 @@ typedef enum {
 	RESPONSE_JOB_PACK_ALLOCATION,
 	REQUEST_JOB_PACK_ALLOC_INFO,
 	REQUEST_SUBMIT_BATCH_JOB_PACK,
+	REQUEST_SUBMIT_BATCH_JOB_BULK,
+	RESPONSE_SUBMIT_BATCH_JOB_BULK,
 
 	REQUEST_CTLD_MULT_MSG = 4500,
 	RESPONSE_CTLD_MULT_MSG,
@@ -405,6 +410,7 @@ typedef enum {
 	RESPONSE_SLURM_REROUTE_MSG,
 
 	RESPONSE_FORWARD_FAILED = 9001,
+	RESPONSE_FORWARD_PARTIAL,
 
 	ACCOUNTING_UPDATE_MSG = 10001,
 	ACCOUNTING_FIRST_REG,
@@ -452,12 +458,6 @@ typedef struct forward_struct {
 	int timeout;
 } forward_struct_t;
 
-typedef struct forward_message {
-	forward_struct_t *fwd_struct;
-	header_t header;
-	int timeout;
-} forward_msg_t;
-
 typedef struct slurm_protocol_config {
 	uint32_t control_cnt;
 	slurm_addr_t *controller_addr;
@@ -606,6 +606,24 @@ typedef struct job_info_request_msg {
 				 * jobs. */
 } job_info_request_msg_t;
 
+typedef struct job_info_delta_request_msg {
+	time_t epoch;		/* epoch of the previous response, 0 if none */
+	uint64_t sequence;	/* sequence of the previous response */
+	uint16_t show_flags;
+} job_info_delta_request_msg_t;
+
+#define JOB_DELTA_FULL	0x0001	/* job_info holds every job, replace the
+				 * client's copy rather than merge */
+
+typedef struct job_info_delta_msg {
+	time_t epoch;		/* slurmctld instance the sequence belongs to */
+	uint64_t sequence;	/* pass in the next request */
+	uint16_t flags;		/* JOB_DELTA_* */
+	job_info_msg_t *job_info; /* new and changed job records */
+	uint32_t purged_cnt;
+	uint32_t *purged_job_ids; /* jobs to remove from the client's copy */
+} job_info_delta_msg_t;
+
 typedef struct job_step_info_request_msg {
 	time_t last_update;
 	uint32_t job_id;
@@ -1211,6 +1229,12 @@ typedef struct ping_slurmd_resp_msg {
 	uint64_t free_mem;	/* Free memory in MiB */
 } ping_slurmd_resp_msg_t;
 
+typedef struct node_heartbeat_msg {
+	uint32_t cpu_load;	/* CPU load * 100 */
+	uint64_t free_mem;	/* Free memory in MiB */
+	char *node_name;
+} node_heartbeat_msg_t;
+
 typedef struct license_info_request_msg {
 	time_t last_update;
 	uint16_t show_flags;
@@ -1366,6 +1390,9 @@ extern void slurm_free_return_code_msg(return_code_msg_t * msg);
 extern void slurm_free_reroute_msg(reroute_msg_t *msg);
 extern void slurm_free_job_alloc_info_msg(job_alloc_info_msg_t * msg);
 extern void slurm_free_job_info_request_msg(job_info_request_msg_t *msg);
+extern void slurm_free_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg);
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t *msg);
 extern void slurm_free_job_step_info_request_msg(
 		job_step_info_request_msg_t *msg);
 extern void slurm_free_front_end_info_request_msg(
@@ -1392,6 +1419,7 @@ extern void slurm_free_forward_data_msg(forward_data_msg_t *msg);
 extern void slurm_free_comp_msg_list(void *x);
 extern void slurm_free_composite_msg(composite_msg_t *msg);
 extern void slurm_free_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg);
+extern void slurm_free_node_heartbeat_msg(node_heartbeat_msg_t *msg);
 
 #define	slurm_free_timelimit_msg(msg) \
 	slurm_free_kill_job_msg(msg)
@@ -1480,6 +1508,8 @@ extern void slurm_free_resource_allocation_response_msg (
 		resource_allocation_response_msg_t * msg);
 extern void slurm_free_job_step_create_response_msg(
 		job_step_create_response_msg_t * msg);
+extern void slurm_free_submit_bulk_response_msg(
+	submit_bulk_response_msg_t *msg);
 extern void slurm_free_submit_response_response_msg(
 		submit_response_msg_t * msg);
 extern void slurm_free_ctl_conf(slurm_ctl_conf_info_msg_t * config_ptr);
@@ -123,6 +123,24 @@ extern int slurm_accept_msg_conn(int open_fd, slurm_addr_t *slurm_address);
  */
 extern int slurm_open_stream(slurm_addr_t *slurm_address, bool retry);
 
+/* slurm_open_stream_start
+ * begins a client connection to stream server without waiting for it to
+ *	complete, for callers polling many connections at once. Once the
+ *	file descriptor is writable, call slurm_open_stream_done()
+ * IN slurm_address 	- slurm_addr_t of the connection destination
+ * RET int              - file descriptor of the connection, or SLURM_ERROR
+ */
+extern int slurm_open_stream_start(slurm_addr_t *slurm_address);
+
+/* slurm_open_stream_done
+ * completes a connection begun by slurm_open_stream_start() and restores
+ *	blocking I/O on it
+ * IN open_fd		- file descriptor of the connection
+ * RET int		- SLURM_SUCCESS, or SLURM_ERROR with errno set to the
+ *			  connect error
+ */
+extern int slurm_open_stream_done(int open_fd);
+
 /* slurm_get_stream_addr
  * esentially a encapsilated get_sockname
  * IN open_fd 		- file descriptor to retreive slurm_addr_t for
@@ -69,6 +69,7 @@
 #include "src/common/xassert.h"
 
 #define _pack_job_info_msg(msg,buf)		_pack_buffer_msg(msg,buf)
+#define _pack_job_info_delta_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_job_step_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
 #define _pack_burst_buffer_info_resp_msg(msg,buf) _pack_buffer_msg(msg,buf)
 #define _pack_front_end_info_msg(msg,buf)	_pack_buffer_msg(msg,buf)
@@ -153,6 +154,12 @@ static void _pack_submit_response_msg(submit_response_msg_t * msg,
 static int _unpack_submit_response_msg(submit_response_msg_t ** msg,
 				       Buf buffer,
 				       uint16_t protocol_version);
+static void _pack_submit_bulk_response_msg(submit_bulk_response_msg_t *msg,
+					   Buf buffer,
+					   uint16_t protocol_version);
+static int _unpack_submit_bulk_response_msg(submit_bulk_response_msg_t **msg,
+					    Buf buffer,
+					    uint16_t protocol_version);
 
 static void _pack_node_info_request_msg(
 	node_info_request_msg_t * msg, Buf buffer,
@@ -362,6 +369,15 @@ static int _unpack_job_info_request_msg(job_info_request_msg_t**
 					msg, Buf buffer,
 					uint16_t protocol_version);
 
+static void _pack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg, Buf buffer,
+	uint16_t protocol_version);
+static int _unpack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t **msg, Buf buffer,
+	uint16_t protocol_version);
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+				      uint16_t protocol_version);
+
 static void _pack_job_step_info_req_msg(job_step_info_request_msg_t * msg,
 					Buf buffer,
 					uint16_t protocol_version);
@@ -706,6 +722,11 @@ static void _pack_ping_slurmd_resp(ping_slurmd_resp_msg_t *msg,
 static int _unpack_ping_slurmd_resp(ping_slurmd_resp_msg_t **msg_ptr,
 				    Buf buffer, uint16_t protocol_version);
 
+static void _pack_node_heartbeat_msg(node_heartbeat_msg_t *msg,
+				     Buf buffer, uint16_t protocol_version);
+static int _unpack_node_heartbeat_msg(node_heartbeat_msg_t **msg_ptr,
+				      Buf buffer, uint16_t protocol_version);
+
 static void _pack_license_info_request_msg(license_info_request_msg_t *msg,
 					   Buf buffer,
 					   uint16_t protocol_version);
@@ -979,6 +1000,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		break;
 	case REQUEST_JOB_PACK_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_JOB_PACK:
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
 		_pack_job_desc_list_msg((List) msg->data, buffer,
 					msg->protocol_version);
 		break;
@@ -1058,6 +1080,11 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					  msg->data, buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_BULK:
+		_pack_submit_bulk_response_msg(
+			(submit_bulk_response_msg_t *) msg->data, buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_JOB_ALLOCATION_INFO:
 	case RESPONSE_RESOURCE_ALLOCATION:
 		_pack_resource_allocation_response_msg
@@ -1428,6 +1455,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	case PMI_KVS_PUT_RESP:
 		break;	/* no data in message */
 	case RESPONSE_FORWARD_FAILED:
+	case RESPONSE_FORWARD_PARTIAL:
 		break;
 	case REQUEST_TRIGGER_GET:
 	case RESPONSE_TRIGGER_GET:
@@ -1519,6 +1547,10 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_ping_slurmd_resp((ping_slurmd_resp_msg_t *)msg->data,
 				       buffer, msg->protocol_version);
 		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		_pack_node_heartbeat_msg((node_heartbeat_msg_t *)msg->data,
+					 buffer, msg->protocol_version);
+		break;
 	case REQUEST_LICENSE_INFO:
 		 _pack_license_info_request_msg((license_info_request_msg_t *)
 						msg->data,
@@ -1581,6 +1613,14 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 		_pack_bb_status_resp_msg((bb_status_resp_msg_t *)(msg->data),
 					 buffer, msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_pack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t *) msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		_pack_job_info_delta_msg((slurm_msg_t *) msg, buffer);
+		break;
 	default:
 		debug("No pack method for msg type %u", msg->msg_type);
 		return EINVAL;
@@ -1681,6 +1721,7 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 		break;
 	case REQUEST_JOB_PACK_ALLOCATION:
 	case REQUEST_SUBMIT_BATCH_JOB_PACK:
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
 		rc = _unpack_job_desc_list_msg((List *) &(msg->data),
 					       buffer, msg->protocol_version);
 		break;
@@ -1764,6 +1805,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 						 & (msg->data), buffer,
 						 msg->protocol_version);
 		break;
+	case RESPONSE_SUBMIT_BATCH_JOB_BULK:
+		rc = _unpack_submit_bulk_response_msg(
+			(submit_bulk_response_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_JOB_ALLOCATION_INFO:
 	case RESPONSE_RESOURCE_ALLOCATION:
 		rc = _unpack_resource_allocation_response_msg(
@@ -2167,6 +2213,7 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 	case PMI_KVS_PUT_RESP:
 		break;	/* no data */
 	case RESPONSE_FORWARD_FAILED:
+	case RESPONSE_FORWARD_PARTIAL:
 		break;
 	case REQUEST_TRIGGER_GET:
 	case RESPONSE_TRIGGER_GET:
@@ -2267,6 +2314,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					      &msg->data, buffer,
 					      msg->protocol_version);
 		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		rc = _unpack_node_heartbeat_msg((node_heartbeat_msg_t **)
+						&msg->data, buffer,
+						msg->protocol_version);
+		break;
 	case RESPONSE_LICENSE_INFO:
 		rc = _unpack_license_info_msg((license_info_msg_t **)&(msg->data),
 					      buffer,
@@ -2339,6 +2391,16 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 			(bb_status_resp_msg_t **)&(msg->data), buffer,
 			msg->protocol_version);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_request_msg(
+			(job_info_delta_request_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **) &(msg->data), buffer,
+			msg->protocol_version);
+		break;
 	default:
 		debug("No unpack method for msg type %u", msg->msg_type);
 		return EINVAL;
@@ -3713,6 +3775,54 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_submit_bulk_response_msg(submit_bulk_response_msg_t *msg,
+					   Buf buffer,
+					   uint16_t protocol_version)
+{
+	xassert(msg);
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		pack32_array(msg->job_id, msg->job_cnt, buffer);
+		pack32_array(msg->error_code, msg->job_cnt, buffer);
+		packstr(msg->job_submit_user_msg, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported", __func__,
+		      protocol_version);
+	}
+}
+
+static int _unpack_submit_bulk_response_msg(submit_bulk_response_msg_t **msg,
+					    Buf buffer,
+					    uint16_t protocol_version)
+{
+	submit_bulk_response_msg_t *resp;
+	uint32_t uint32_tmp;
+
+	xassert(msg);
+	resp = xmalloc(sizeof(submit_bulk_response_msg_t));
+	*msg = resp;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpack32_array(&resp->job_id, &resp->job_cnt, buffer);
+		safe_unpack32_array(&resp->error_code, &uint32_tmp, buffer);
+		if (uint32_tmp != resp->job_cnt)
+			goto unpack_error;
+		safe_unpackstr_xmalloc(&resp->job_submit_user_msg,
+				       &uint32_tmp, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported", __func__,
+		      protocol_version);
+		goto unpack_error;
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_submit_bulk_response_msg(resp);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static int _unpack_node_info_msg(node_info_msg_t **msg, Buf buffer,
 				 uint16_t protocol_version)
 {
@@ -5185,6 +5295,79 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t *msg, Buf buffer,
+	uint16_t protocol_version)
+{
+	xassert(msg);
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		pack_time(msg->epoch, buffer);
+		pack64(msg->sequence, buffer);
+		pack16(msg->show_flags, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+	}
+}
+
+static int _unpack_job_info_delta_request_msg(
+	job_info_delta_request_msg_t **msg, Buf buffer,
+	uint16_t protocol_version)
+{
+	job_info_delta_request_msg_t *req;
+
+	req = xmalloc(sizeof(job_info_delta_request_msg_t));
+	*msg = req;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpack_time(&req->epoch, buffer);
+		safe_unpack64(&req->sequence, buffer);
+		safe_unpack16(&req->show_flags, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_request_msg(req);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
+/* NOTE: packed by pack_delta_jobs() in slurmctld/job_mgr.c */
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t **msg, Buf buffer,
+				      uint16_t protocol_version)
+{
+	job_info_delta_msg_t *delta;
+
+	delta = xmalloc(sizeof(job_info_delta_msg_t));
+	*msg = delta;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpack_time(&delta->epoch, buffer);
+		safe_unpack64(&delta->sequence, buffer);
+		safe_unpack16(&delta->flags, buffer);
+		if (_unpack_job_info_msg(&delta->job_info, buffer,
+					 protocol_version))
+			goto unpack_error;
+		safe_unpack32_array(&delta->purged_job_ids,
+				    &delta->purged_cnt, buffer);
+	} else {
+		error("%s: protocol_version %hu not supported",
+		      __func__, protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(delta);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* Translate bitmap representation from hex to decimal format, replacing
  * array_task_str and store the bitmap in job->array_bitmap. */
 static void _xlate_task_str(job_info_t *job_ptr)
@@ -10317,6 +10500,48 @@ _unpack_slurm_addr_array(slurm_addr_t ** slurm_address,
 }
 
 
+/*
+ * Replies that differ only by node name, such as every node of a broadcast
+ * returning SLURM_SUCCESS, are packed as a single record naming all of the
+ * nodes in hostlist form.
+ */
+typedef struct {
+	uint32_t err;
+	hostlist_t hl;
+	uint32_t return_code;
+	uint16_t type;
+} ret_group_t;
+
+static void _ret_group_free(void *object)
+{
+	ret_group_t *group = object;
+
+	if (group) {
+		FREE_NULL_HOSTLIST(group->hl);
+		xfree(group);
+	}
+}
+
+static int _ret_group_find(void *x, void *key)
+{
+	ret_group_t *group = x, *match = key;
+
+	return ((group->type == match->type) && (group->err == match->err) &&
+		(group->return_code == match->return_code));
+}
+
+/* Return true if replies of this type can be grouped with others */
+static bool _ret_groupable(ret_data_info_t *ret_data_info)
+{
+	if (!ret_data_info->node_name)
+		return false;
+	if (ret_data_info->type == RESPONSE_FORWARD_FAILED)
+		return true;
+	if ((ret_data_info->type == RESPONSE_SLURM_RC) && ret_data_info->data)
+		return true;
+	return false;
+}
+
 static void
 _pack_ret_list(List ret_list,
 	       uint16_t size_val, Buf buffer,
@@ -10324,12 +10549,52 @@ _pack_ret_list(List ret_list,
 {
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
+	ret_group_t key, *group;
+	List groups = NULL;
+	return_code_msg_t rc_msg;
 	slurm_msg_t msg;
+	char *hosts;
 
 	slurm_msg_t_init(&msg);
 	msg.protocol_version = protocol_version;
+	if (protocol_version < SLURM_20_02_PROTOCOL_VERSION) {
+		itr = list_iterator_create(ret_list);
+		while ((ret_data_info = list_next(itr))) {
+			pack32((uint32_t)ret_data_info->err, buffer);
+			pack16((uint16_t)ret_data_info->type, buffer);
+			packstr(ret_data_info->node_name, buffer);
+
+			msg.msg_type = ret_data_info->type;
+			msg.data = ret_data_info->data;
+			pack_msg(&msg, buffer);
+		}
+		list_iterator_destroy(itr);
+		return;
+	}
+
+	groups = list_create(_ret_group_free);
 	itr = list_iterator_create(ret_list);
 	while ((ret_data_info = list_next(itr))) {
+		if (_ret_groupable(ret_data_info)) {
+			key.err = ret_data_info->err;
+			key.type = ret_data_info->type;
+			key.return_code = 0;
+			if (ret_data_info->data) {
+				key.return_code = ((return_code_msg_t *)
+						   ret_data_info->data)->
+						  return_code;
+			}
+			if (!(group = list_find_first(groups, _ret_group_find,
+						      &key))) {
+				group = xmalloc(sizeof(ret_group_t));
+				*group = key;
+				group->hl = hostlist_create(NULL);
+				list_append(groups, group);
+			}
+			hostlist_push_host(group->hl, ret_data_info->node_name);
+			continue;
+		}
+		pack32(1, buffer);
 		pack32((uint32_t)ret_data_info->err, buffer);
 		pack16((uint16_t)ret_data_info->type, buffer);
 		packstr(ret_data_info->node_name, buffer);
@@ -10339,6 +10604,26 @@ _pack_ret_list(List ret_list,
 		pack_msg(&msg, buffer);
 	}
 	list_iterator_destroy(itr);
+
+	itr = list_iterator_create(groups);
+	while ((group = list_next(itr))) {
+		pack32(hostlist_count(group->hl), buffer);
+		pack32(group->err, buffer);
+		pack16(group->type, buffer);
+		hosts = hostlist_ranged_string_xmalloc(group->hl);
+		packstr(hosts, buffer);
+		xfree(hosts);
+
+		msg.msg_type = group->type;
+		msg.data = NULL;
+		if (group->type == RESPONSE_SLURM_RC) {
+			rc_msg.return_code = group->return_code;
+			msg.data = &rc_msg;
+		}
+		pack_msg(&msg, buffer);
+	}
+	list_iterator_destroy(itr);
+	FREE_NULL_LIST(groups);
 }
 
 static int
@@ -10347,27 +10632,91 @@ _unpack_ret_list(List *ret_list,
 		 uint16_t protocol_version)
 {
 	int i = 0;
-	uint32_t uint32_tmp;
+	uint32_t uint32_tmp, node_cnt = 1, err;
+	uint16_t type;
 	ret_data_info_t *ret_data_info = NULL;
 	slurm_msg_t msg;
+	hostlist_t hl = NULL;
+	char *hosts = NULL, *name;
+	return_code_msg_t *rc_msg;
 
 	slurm_msg_t_init(&msg);
 	msg.protocol_version = protocol_version;
 
 	*ret_list = list_create(destroy_data_info);
 
-	for (i=0; i<size_val; i++) {
-		ret_data_info = xmalloc(sizeof(ret_data_info_t));
-		list_push(*ret_list, ret_data_info);
+	if (protocol_version < SLURM_20_02_PROTOCOL_VERSION) {
+		for (i=0; i<size_val; i++) {
+			ret_data_info = xmalloc(sizeof(ret_data_info_t));
+			list_push(*ret_list, ret_data_info);
 
-		safe_unpack32((uint32_t *)&ret_data_info->err, buffer);
-		safe_unpack16(&ret_data_info->type, buffer);
-		safe_unpackstr_xmalloc(&ret_data_info->node_name,
-				       &uint32_tmp, buffer);
-		msg.msg_type = ret_data_info->type;
+			safe_unpack32((uint32_t *)&ret_data_info->err, buffer);
+			safe_unpack16(&ret_data_info->type, buffer);
+			safe_unpackstr_xmalloc(&ret_data_info->node_name,
+					       &uint32_tmp, buffer);
+			msg.msg_type = ret_data_info->type;
+			if (unpack_msg(&msg, buffer) != SLURM_SUCCESS)
+				goto unpack_error;
+			ret_data_info->data = msg.data;
+		}
+
+		return SLURM_SUCCESS;
+	}
+
+	while (i < size_val) {
+		safe_unpack32(&node_cnt, buffer);
+		if ((node_cnt == 0) || (node_cnt > (size_val - i)))
+			goto unpack_error;
+		if (node_cnt == 1) {
+			ret_data_info = xmalloc(sizeof(ret_data_info_t));
+			list_push(*ret_list, ret_data_info);
+
+			safe_unpack32((uint32_t *)&ret_data_info->err, buffer);
+			safe_unpack16(&ret_data_info->type, buffer);
+			safe_unpackstr_xmalloc(&ret_data_info->node_name,
+					       &uint32_tmp, buffer);
+			msg.msg_type = ret_data_info->type;
+			if (unpack_msg(&msg, buffer) != SLURM_SUCCESS)
+				goto unpack_error;
+			ret_data_info->data = msg.data;
+			i++;
+			continue;
+		}
+
+		/* A group of nodes with the same reply */
+		safe_unpack32(&err, buffer);
+		safe_unpack16(&type, buffer);
+		safe_unpackstr_xmalloc(&hosts, &uint32_tmp, buffer);
+		if ((type != RESPONSE_SLURM_RC) &&
+		    (type != RESPONSE_FORWARD_FAILED))
+			goto unpack_error;
+		msg.msg_type = type;
+		msg.data = NULL;
 		if (unpack_msg(&msg, buffer) != SLURM_SUCCESS)
 			goto unpack_error;
-		ret_data_info->data = msg.data;
+		hl = hostlist_create(hosts);
+		xfree(hosts);
+		if (hostlist_count(hl) != node_cnt) {
+			slurm_free_msg_data(type, msg.data);
+			goto unpack_error;
+		}
+		while ((name = hostlist_shift(hl))) {
+			ret_data_info = xmalloc(sizeof(ret_data_info_t));
+			ret_data_info->err = err;
+			ret_data_info->type = type;
+			ret_data_info->node_name = xstrdup(name);
+			free(name);
+			if (msg.data) {
+				rc_msg = xmalloc(sizeof(return_code_msg_t));
+				memcpy(rc_msg, msg.data,
+				       sizeof(return_code_msg_t));
+				ret_data_info->data = rc_msg;
+			}
+			list_push(*ret_list, ret_data_info);
+		}
+		FREE_NULL_HOSTLIST(hl);
+		slurm_free_msg_data(type, msg.data);
+		i += node_cnt;
 	}
 
 	return SLURM_SUCCESS;
@@ -10377,6 +10726,8 @@ unpack_error:
 		error("_unpack_ret_list: message type %u, record %d of %u",
 		      ret_data_info->type, i, size_val);
 	}
+	FREE_NULL_HOSTLIST(hl);
+	xfree(hosts);
 	FREE_NULL_LIST(*ret_list);
 	*ret_list = NULL;
 	return SLURM_ERROR;
@@ -11154,6 +11505,42 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_node_heartbeat_msg(node_heartbeat_msg_t *msg,
+				     Buf buffer, uint16_t protocol_version)
+{
+	xassert(msg);
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		pack32(msg->cpu_load, buffer);
+		pack64(msg->free_mem, buffer);
+		packstr(msg->node_name, buffer);
+	}
+}
+
+static int _unpack_node_heartbeat_msg(node_heartbeat_msg_t **msg_ptr,
+				      Buf buffer, uint16_t protocol_version)
+{
+	node_heartbeat_msg_t *msg;
+	uint32_t uint32_tmp;
+
+	xassert(msg_ptr);
+	msg = xmalloc(sizeof(node_heartbeat_msg_t));
+	*msg_ptr = msg;
+
+	if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+		safe_unpack32(&msg->cpu_load, buffer);
+		safe_unpack64(&msg->free_mem, buffer);
+		safe_unpackstr_xmalloc(&msg->node_name, &uint32_tmp, buffer);
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_node_heartbeat_msg(msg);
+	*msg_ptr = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_checkpoint_msg(checkpoint_msg_t *msg, Buf buffer,
 		     uint16_t protocol_version)
@@ -12203,6 +12590,27 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 
 			safe_unpack32(&msg->bf_active,		buffer);
 			safe_unpack32(&msg->bf_backfilled_pack_jobs, buffer);
+
+			if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->schedule_equiv_lookups,
+					      buffer);
+				safe_unpack32(&msg->schedule_equiv_hits,
+					      buffer);
+				safe_unpack32(&msg->bf_equiv_lookups, buffer);
+				safe_unpack32(&msg->bf_equiv_hits, buffer);
+				safe_unpack32(&msg->fairshare_cycle_counter,
+					      buffer);
+				safe_unpack32(&msg->fairshare_cycle_last,
+					      buffer);
+				safe_unpack32(&msg->fairshare_cycle_max,
+					      buffer);
+				safe_unpack32(&msg->fairshare_cycle_sum,
+					      buffer);
+				safe_unpack32(&msg->fairshare_last_sets,
+					      buffer);
+				safe_unpack32(&msg->fairshare_last_sorted,
+					      buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
@@ -12231,6 +12639,65 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+			safe_unpack32(&msg->rpc_worker_count, buffer);
+			safe_unpack32(&msg->rpc_unread_count, buffer);
+			safe_unpackstr_array(&msg->rpc_class_name,
+					     &msg->rpc_class_count, buffer);
+			safe_unpack32_array(&msg->rpc_class_depth,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_class_max_depth,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_class_active,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_class_cnt,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_class_wait_time,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_class_max_wait,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_class_count)
+				goto unpack_error;
+			safe_unpackstr_array(&msg->state_load_name,
+					     &msg->state_load_count, buffer);
+			safe_unpack64_array(&msg->state_load_time,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->state_load_count)
+				goto unpack_error;
+			safe_unpackstr_array(&msg->job_hash_name,
+					     &msg->job_hash_count, buffer);
+			safe_unpack32_array(&msg->job_hash_size,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->job_hash_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->job_hash_records,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->job_hash_count)
+				goto unpack_error;
+			safe_unpack64_array(&msg->job_hash_probe_sum,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->job_hash_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->job_hash_probe_max,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->job_hash_count)
+				goto unpack_error;
+			safe_unpack32_array(&msg->job_hash_resizes,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->job_hash_count)
+				goto unpack_error;
+		}
 	} else {
 		error("%s: protocol_version %hu not supported",
 		      __func__, protocol_version);
@@ -539,6 +539,55 @@ error:
 	return SLURM_ERROR;
 }
 
+extern int slurm_open_stream_start(slurm_addr_t *addr)
+{
+	int fd, rc, err;
+
+	if ((addr->sin_family == 0) || (addr->sin_port == 0)) {
+		error("Error connecting, bad data: family = %u, port = %u",
+		      addr->sin_family, addr->sin_port);
+		slurm_seterrno(SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+		return SLURM_ERROR;
+	}
+
+	if ((fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+		error("Error creating slurm stream socket: %m");
+		slurm_seterrno(errno);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(fd);
+	fd_set_nonblocking(fd);
+
+	rc = connect(fd, (struct sockaddr const *) addr, sizeof(*addr));
+	if ((rc < 0) && (errno != EINPROGRESS)) {
+		err = errno;
+		debug2("slurm_connect failed: %m");
+		(void) close(fd);
+		slurm_seterrno(err);
+		return SLURM_ERROR;
+	}
+
+	return fd;
+}
+
+extern int slurm_open_stream_done(int fd)
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+		return SLURM_ERROR;
+	if (err) {
+		slurm_seterrno(err);
+		debug2("slurm_connect failed: %m");
+		slurm_seterrno(err);
+		return SLURM_ERROR;
+	}
+	fd_set_blocking(fd);
+
+	return SLURM_SUCCESS;
+}
+
 /* Put the local address of FD into *ADDR and its length in *LEN.  */
 extern int slurm_get_stream_addr(int fd, slurm_addr_t *addr )
 {
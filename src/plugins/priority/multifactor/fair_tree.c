@@ -42,11 +42,16 @@
 #include <math.h>
 #include <stdlib.h>
 
+#include "src/common/timers.h"
+
 #include "fair_tree.h"
 
 static int  _ft_decay_apply_new_usage(struct job_record *job, time_t *start);
 static void _apply_priority_fs(void);
 
+/* Sibling sets ranked and sorted in the last _apply_priority_fs() */
+static uint32_t ft_set_cnt = 0, ft_sorted_cnt = 0;
+
 /* Fair Tree code called from the decay thread loop */
 extern void fair_tree_decay(List jobs, time_t start)
 {
@@ -55,6 +60,7 @@ extern void fair_tree_decay(List jobs, time_t start)
 	assoc_mgr_lock_t locks =
 		{ WRITE_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
 		  NO_LOCK, NO_LOCK, NO_LOCK };
+	DEF_TIMERS;
 
 	/* apply decayed usage */
 	lock_slurmctld(job_write_lock);
@@ -63,13 +69,25 @@ extern void fair_tree_decay(List jobs, time_t start)
 
 	/* calculate fs factor for associations */
 	assoc_mgr_lock(&locks);
+	START_TIMER;
 	_apply_priority_fs();
+	END_TIMER;
 	assoc_mgr_unlock(&locks);
 
+	slurmctld_diag_stats.fairshare_cycle_counter++;
+	slurmctld_diag_stats.fairshare_cycle_last = DELTA_TIMER;
+	slurmctld_diag_stats.fairshare_cycle_sum += DELTA_TIMER;
+	if (slurmctld_diag_stats.fairshare_cycle_max < DELTA_TIMER)
+		slurmctld_diag_stats.fairshare_cycle_max = DELTA_TIMER;
+	slurmctld_diag_stats.fairshare_last_sets = ft_set_cnt;
+	slurmctld_diag_stats.fairshare_last_sorted = ft_sorted_cnt;
+	if (priority_debug) {
+		info("Fair Tree fairshare calculated in %s, %u of %u sibling sets sorted",
+		     TIME_STR, ft_sorted_cnt, ft_set_cnt);
+	}
+
 	/* assign job priorities */
-	lock_slurmctld(job_write_lock);
-	list_for_each(jobs, (ListForF) decay_apply_weighted_factors, &start);
-	unlock_slurmctld(job_write_lock);
+	decay_apply_weighted_factors_list(jobs, &start);
 }
 
 
@@ -158,6 +176,23 @@ static int _cmp_level_fs(const void *x,
 	return (*a)->user ? -1 : 1;
 }
 
+static int _cmp_level_fs_list(void *x, void *y)
+{
+	return _cmp_level_fs(x, y);
+}
+
+/* Return true if siblings are already in _cmp_level_fs() order */
+static bool _sorted_level_fs(slurmdb_assoc_rec_t **siblings, size_t count)
+{
+	size_t i;
+
+	for (i = 1; i < count; i++) {
+		if (_cmp_level_fs(&siblings[i - 1], &siblings[i]) > 0)
+			return false;
+	}
+	return true;
+}
+
 
 /* Calculate LF = S / U for an association.
  *
@@ -297,7 +332,10 @@ static slurmdb_assoc_rec_t** _merge_accounts(
 
 
 /* Calculate fairshare for each child then sort children by fairshare value
- * (level_fs). Once they are sorted, operate on each child in sorted order.
+ * (level_fs). The children list of an account is itself kept in that order, so
+ * only sibling sets whose order changed since the last calculation (typically
+ * those below associations which accrued usage) need sorting again.
+ * Once they are sorted, operate on each child in sorted order.
  * This portion of the tree is now sorted and users are given a fairshare value
  * based on the order they are operated on. The basic equation is
  * (rank / g_user_assoc_count), though ties are allowed. The rank is
@@ -311,18 +349,21 @@ static slurmdb_assoc_rec_t** _merge_accounts(
  *	   the same rank as the account's highest ranked user
  *
  * IN siblings - array of siblings
+ * IN sibling_list - children list from which siblings was copied, or NULL if
+ *	siblings merges the children of several accounts
  * IN assoc_level - depth in the tree (root is 0)
  * IN/OUT rank - current user ranking, starting at g_user_assoc_count
  * IN/OUT rnt - rank, no ties (what rank would be if no tie exists)
  * IN account_tied - is this account tied with the previous user
  */
-static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
+static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings, List sibling_list,
 			  uint16_t assoc_level, uint32_t *rank,
 			  uint32_t *rnt, bool account_tied)
 {
 	slurmdb_assoc_rec_t *assoc = NULL;
 	long double prev_level_fs = (long double) NO_VAL;
 	bool tied = false;
+	ListIterator itr;
 	size_t i;
 
 	/* Calculate level_fs for each child */
@@ -330,7 +371,20 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 		_calc_assoc_fs(assoc);
 
 	/* Sort children by level_fs */
-	qsort(siblings, i, sizeof(slurmdb_assoc_rec_t *), _cmp_level_fs);
+	ft_set_cnt++;
+	if (!_sorted_level_fs(siblings, i)) {
+		ft_sorted_cnt++;
+		if (sibling_list) {
+			list_sort(sibling_list, _cmp_level_fs_list);
+			itr = list_iterator_create(sibling_list);
+			for (i = 0; (assoc = list_next(itr)); i++)
+				siblings[i] = assoc;
+			list_iterator_destroy(itr);
+		} else {
+			qsort(siblings, i, sizeof(slurmdb_assoc_rec_t *),
+			      _cmp_level_fs);
+		}
+	}
 
 	/* Iterate through children in sorted order. If it's a user, calculate
 	 * fs_factor, otherwise recurse. */
@@ -370,8 +424,10 @@ static void _calc_tree_fs(slurmdb_assoc_rec_t** siblings,
 						   i + merge_count,
 						   assoc_level);
 
-			_calc_tree_fs(children, assoc_level+1,
-				      rank, rnt, tied);
+			_calc_tree_fs(children,
+				      merge_count ? NULL :
+				      assoc->usage->children_list,
+				      assoc_level+1, rank, rnt, tied);
 
 			/* Skip over any merged accounts */
 			i += merge_count;
@@ -403,7 +459,9 @@ static void _apply_priority_fs(void)
 		children,
 		&child_count);
 
-	_calc_tree_fs(children, 0, &rank, &rnt, false);
+	ft_set_cnt = ft_sorted_cnt = 0;
+	_calc_tree_fs(children, assoc_mgr_root_assoc->usage->children_list, 0,
+		      &rank, &rnt, false);
 
 	xfree(children);
 }
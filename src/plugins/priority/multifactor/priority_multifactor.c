@@ -67,6 +67,7 @@
 #include "src/common/xstring.h"
 #include "src/common/gres.h"
 
+#include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/read_config.h"
 
@@ -139,6 +140,8 @@ static bool favor_small; /* favor small jobs over large */
 static uint16_t damp_factor = 1;  /* weight for age factor */
 static uint32_t max_age; /* time when not to add any more
 			  * priority to a job if reached */
+static uint32_t age_bucket = 1; /* seconds of age worth one point of
+				 * priority */
 static uint16_t enforce;     /* AccountingStorageEnforce */
 static uint32_t weight_age;  /* weight for age factor */
 static uint32_t weight_assoc;/* weight for assoc factor */
@@ -158,6 +161,13 @@ bool priority_debug = 0;
 
 static void _priority_p_set_assoc_usage_debug(slurmdb_assoc_rec_t *assoc);
 static void _set_assoc_usage_efctv(slurmdb_assoc_rec_t *assoc);
+static void _set_job_priority_factors(time_t start_time,
+				      struct job_record *job_ptr,
+				      bool assoc_locked);
+static void _set_priority_factors(time_t start_time,
+				  struct job_record *job_ptr,
+				  priority_factors_object_t *factors,
+				  bool assoc_locked);
 
 /*
  * apply decay factor to all associations usage_raw
@@ -412,8 +422,10 @@ static int _set_children_usage_efctv(List children_list)
 
 /* job_ptr should already have the partition priority and such added here
  * before had we will be adding to it
+ * IN assoc_locked - set if the caller holds the assoc_mgr assoc read lock
  */
-static double _get_fairshare_priority(struct job_record *job_ptr)
+static double _get_fairshare_priority(struct job_record *job_ptr,
+				      bool assoc_locked)
 {
 	slurmdb_assoc_rec_t *job_assoc;
 	slurmdb_assoc_rec_t *fs_assoc = NULL;
@@ -424,12 +436,14 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 	if (!calc_fairshare)
 		return 0;
 
-	assoc_mgr_lock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_lock(&locks);
 
 	job_assoc = job_ptr->assoc_ptr;
 
 	if (!job_assoc) {
-		assoc_mgr_unlock(&locks);
+		if (!assoc_locked)
+			assoc_mgr_unlock(&locks);
 		error("Job %u has no association.  Unable to "
 		      "compute fairshare.", job_ptr->job_id);
 		return 0;
@@ -465,7 +479,8 @@ static double _get_fairshare_priority(struct job_record *job_ptr)
 			     fs_assoc->usage->shares_norm, priority_fs);
 		}
 	}
-	assoc_mgr_unlock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_unlock(&locks);
 
 	return priority_fs;
 }
@@ -516,15 +531,136 @@ static double _get_tres_prio_weighted(double *tres_factors)
 	return tmp_tres;
 }
 
-/* Returns the priority after applying the weight factors */
+/*
+ * Apply the configured weights to a job's priority factors
+ * RET sum of the weighted TRES factors
+ */
+static double _weight_priority_factors(priority_factors_object_t *factors)
+{
+	double tmp_tres = 0.0;
+
+	factors->priority_age   *= (double)weight_age;
+	factors->priority_assoc *= (double)weight_assoc;
+	factors->priority_fs    *= (double)weight_fs;
+	factors->priority_js    *= (double)weight_js;
+	factors->priority_part  *= (double)weight_part;
+	factors->priority_qos   *= (double)weight_qos;
+
+	if (weight_tres && factors->priority_tres)
+		tmp_tres = _get_tres_prio_weighted(factors->priority_tres);
+
+	return tmp_tres;
+}
+
+/* Sum weighted priority factors, as yet unbounded */
+static double _sum_priority_factors(priority_factors_object_t *factors,
+				    double tmp_tres)
+{
+	return factors->priority_age
+		+ factors->priority_assoc
+		+ factors->priority_fs
+		+ factors->priority_js
+		+ factors->priority_part
+		+ factors->priority_qos
+		+ tmp_tres
+		+ (double)(((int64_t)factors->priority_site) - NICE_OFFSET)
+		- (double)(((int64_t)factors->nice) - NICE_OFFSET);
+}
+
+/* Priority 0 is reserved for held jobs, and priorities have 32 bits */
+static double _bound_priority(struct job_record *job_ptr, double priority)
+{
+	if (priority < 1)
+		return 1;
+	if (priority > (double) 0xffffffff) {
+		error("Job %u priority exceeds 32 bits", job_ptr->job_id);
+		return (double) 0xffffffff;
+	}
+	return priority;
+}
+
+/*
+ * Set the priority of a job in each of its partitions from its weighted
+ * priority factors
+ */
+static void _set_part_priorities(struct job_record *job_ptr)
+{
+	struct part_record *part_ptr;
+	double priority_part;
+	ListIterator part_iterator;
+	char *multi_part_str = NULL;
+	int i = 0;
+
+	if (!job_ptr->part_ptr_list)
+		return;
+
+	if (!job_ptr->priority_array) {
+		i = list_count(job_ptr->part_ptr_list) + 1;
+		job_ptr->priority_array = xcalloc(i, sizeof(uint32_t));
+	}
+
+	i = 0;
+	list_sort(job_ptr->part_ptr_list, priority_sort_part_tier);
+	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+	while ((part_ptr = list_next(part_iterator))) {
+		double part_tres = 0.0;
+
+		if (weight_tres) {
+			double part_tres_factors[slurmctld_tres_cnt];
+			memset(part_tres_factors, 0,
+			       sizeof(double) * slurmctld_tres_cnt);
+			_get_tres_factors(job_ptr, part_ptr,
+					  part_tres_factors);
+			part_tres = _get_tres_prio_weighted(part_tres_factors);
+		}
+
+		priority_part = part_ptr->priority_job_factor /
+			(double)part_max_priority *
+			(double)weight_part;
+		priority_part +=
+			 (job_ptr->prio_factors->priority_age
+			 + job_ptr->prio_factors->priority_assoc
+			 + job_ptr->prio_factors->priority_fs
+			 + job_ptr->prio_factors->priority_js
+			 + job_ptr->prio_factors->priority_qos
+			 + part_tres
+			 + (double)
+			   (((int64_t)job_ptr->prio_factors->priority_site)
+			    - NICE_OFFSET)
+			 - (double)
+			   (((int64_t)job_ptr->prio_factors->nice)
+			    - NICE_OFFSET));
+		priority_part = _bound_priority(job_ptr, priority_part);
+
+		if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
+		    (job_ptr->priority_array[i] < (uint32_t) priority_part))
+			job_ptr->priority_array[i] = (uint32_t) priority_part;
+		if (priority_debug) {
+			xstrfmtcat(multi_part_str, multi_part_str ?
+				   ", %s=%u" : "%s=%u", part_ptr->name,
+				   job_ptr->priority_array[i]);
+		}
+		i++;
+	}
+	if (priority_debug && multi_part_str)
+		info("%pJ multi-partition priorities: %s",
+		     job_ptr, multi_part_str);
+	xfree(multi_part_str);
+	list_iterator_destroy(part_iterator);
+}
+
+/*
+ * Returns the priority after applying the weight factors
+ * IN assoc_locked - set if the caller holds the assoc_mgr assoc and QOS read
+ *	locks
+ */
 static uint32_t _get_priority_internal(time_t start_time,
-				       struct job_record *job_ptr)
+				       struct job_record *job_ptr,
+				       bool assoc_locked)
 {
 	double priority	= 0.0;
 	priority_factors_object_t pre_factors;
-	uint64_t tmp_64;
 	double tmp_tres = 0.0;
-	char *multi_part_str = NULL;
 
 	if (job_ptr->direct_set_prio && (job_ptr->priority > 0)) {
 		if (job_ptr->prio_factors) {
@@ -549,7 +685,7 @@ static uint32_t _get_priority_internal(time_t start_time,
 		return 0;
 	}
 
-	set_priority_factors(start_time, job_ptr);
+	_set_job_priority_factors(start_time, job_ptr, assoc_locked);
 
 	if (priority_debug) {
 		memcpy(&pre_factors, job_ptr->prio_factors,
@@ -564,117 +700,11 @@ static uint32_t _get_priority_internal(time_t start_time,
 	} else	/* clang needs this memset to avoid a warning */
 		memset(&pre_factors, 0, sizeof(priority_factors_object_t));
 
-	job_ptr->prio_factors->priority_age  *= (double)weight_age;
-	job_ptr->prio_factors->priority_assoc *= (double)weight_assoc;
-	job_ptr->prio_factors->priority_fs   *= (double)weight_fs;
-	job_ptr->prio_factors->priority_js   *= (double)weight_js;
-	job_ptr->prio_factors->priority_part *= (double)weight_part;
-	job_ptr->prio_factors->priority_qos  *= (double)weight_qos;
-
-	if (weight_tres && job_ptr->prio_factors->priority_tres) {
-		double *tres_factors = NULL;
-		tres_factors = job_ptr->prio_factors->priority_tres;
-		tmp_tres = _get_tres_prio_weighted(tres_factors);
-	}
-
-	priority = job_ptr->prio_factors->priority_age
-		+ job_ptr->prio_factors->priority_assoc
-		+ job_ptr->prio_factors->priority_fs
-		+ job_ptr->prio_factors->priority_js
-		+ job_ptr->prio_factors->priority_part
-		+ job_ptr->prio_factors->priority_qos
-		+ tmp_tres
-		+ (double)(((int64_t)job_ptr->prio_factors->priority_site)
-			   - NICE_OFFSET)
-		- (double)(((int64_t)job_ptr->prio_factors->nice)
-			   - NICE_OFFSET);
+	tmp_tres = _weight_priority_factors(job_ptr->prio_factors);
+	priority = _sum_priority_factors(job_ptr->prio_factors, tmp_tres);
 
-	/* Priority 0 is reserved for held jobs */
-	if (priority < 1)
-		priority = 1;
-
-	tmp_64 = (uint64_t) priority;
-	if (tmp_64 > 0xffffffff) {
-		error("Job %u priority exceeds 32 bits", job_ptr->job_id);
-		tmp_64 = 0xffffffff;
-		priority = (double) tmp_64;
-	}
-
-	if (job_ptr->part_ptr_list) {
-		struct part_record *part_ptr;
-		double priority_part;
-		ListIterator part_iterator;
-		int i = 0;
-
-		if (!job_ptr->priority_array) {
-			i = list_count(job_ptr->part_ptr_list) + 1;
-			job_ptr->priority_array = xcalloc(i, sizeof(uint32_t));
-		}
-
-		i = 0;
-		list_sort(job_ptr->part_ptr_list, priority_sort_part_tier);
-		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
-		while ((part_ptr = (struct part_record *)
-			list_next(part_iterator))) {
-			double part_tres = 0.0;
-
-			if (weight_tres) {
-				double part_tres_factors[slurmctld_tres_cnt];
-				memset(part_tres_factors, 0,
-				       sizeof(double) * slurmctld_tres_cnt);
-				_get_tres_factors(job_ptr, part_ptr,
-						  part_tres_factors);
-				part_tres = _get_tres_prio_weighted(
-							part_tres_factors);
-			}
-
-			priority_part = part_ptr->priority_job_factor /
-				(double)part_max_priority *
-				(double)weight_part;
-			priority_part +=
-				 (job_ptr->prio_factors->priority_age
-				 + job_ptr->prio_factors->priority_assoc
-				 + job_ptr->prio_factors->priority_fs
-				 + job_ptr->prio_factors->priority_js
-				 + job_ptr->prio_factors->priority_qos
-				 + part_tres
-				 + (double)
-				   (((int64_t)job_ptr->prio_factors->priority_site)
-				    - NICE_OFFSET)
-				 - (double)
-				   (((int64_t)job_ptr->prio_factors->nice)
-				    - NICE_OFFSET));
-
-			/* Priority 0 is reserved for held jobs */
-			if (priority_part < 1)
-				priority_part = 1;
-
-			tmp_64 = (uint64_t) priority_part;
-			if (tmp_64 > 0xffffffff) {
-				error("Job %u priority exceeds 32 bits",
-				      job_ptr->job_id);
-				tmp_64 = 0xffffffff;
-				priority_part = (double) tmp_64;
-			}
-			if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
-			    (job_ptr->priority_array[i] <
-			     (uint32_t) priority_part)) {
-				job_ptr->priority_array[i] =
-					(uint32_t) priority_part;
-			}
-			if (priority_debug) {
-				xstrfmtcat(multi_part_str, multi_part_str ?
-					   ", %s=%u" : "%s=%u", part_ptr->name,
-					   job_ptr->priority_array[i]);
-			}
-			i++;
-		}
-		if (priority_debug && multi_part_str)
-			info("%pJ multi-partition priorities: %s",
-			     job_ptr, multi_part_str);
-		xfree(multi_part_str);
-		list_iterator_destroy(part_iterator);
-	}
+	priority = _bound_priority(job_ptr, priority);
+	_set_part_priorities(job_ptr);
 
 	if (priority_debug) {
 		int i;
@@ -1192,6 +1222,17 @@ static int _apply_new_usage(struct job_record *job_ptr,
 }
 
 
+static int _decay_apply_new_usage(struct job_record *job_ptr,
+				  time_t *start_time_ptr)
+{
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+
+	(void) decay_apply_new_usage(job_ptr, start_time_ptr);
+
+	return SLURM_SUCCESS;
+}
+
 static int _decay_apply_new_usage_and_weighted_factors(
 	struct job_record *job_ptr,
 	time_t *start_time_ptr)
@@ -1382,19 +1423,24 @@ static void *_decay_thread(void *no_data)
 		site_factor_g_update();
 
 		if (!(flags & PRIORITY_FLAGS_FAIR_TREE)) {
-			list_for_each(
-				job_list,
-				(ListForF) _decay_apply_new_usage_and_weighted_factors,
-				&start_time
-				);
+			list_for_each(job_list,
+				      (ListForF) _decay_apply_new_usage,
+				      &start_time);
 		}
 
 		unlock_slurmctld(job_write_lock);
 
+		if (!(flags & PRIORITY_FLAGS_FAIR_TREE))
+			decay_apply_weighted_factors_list(job_list,
+							  &start_time);
+
 	get_usage:
 		if (flags & PRIORITY_FLAGS_FAIR_TREE)
 			fair_tree_decay(job_list, start_time);
 
+		/* Job priorities may have been reordered */
+		sched_event_all();
+
 		g_last_ran = start_time;
 
 		_write_last_decay_ran(g_last_ran, last_reset);
@@ -1550,6 +1596,10 @@ static void _internal_setup(void)
 	enforce = slurm_get_accounting_storage_enforce();
 	max_age = slurm_get_priority_max_age();
 	weight_age = slurm_get_priority_weight_age();
+	if (weight_age && (max_age > weight_age))
+		age_bucket = max_age / weight_age;
+	else
+		age_bucket = 1;
 	weight_assoc = slurm_get_priority_weight_assoc();
 	weight_fs = slurm_get_priority_weight_fairshare();
 	weight_js = slurm_get_priority_weight_job_size();
@@ -1851,7 +1901,7 @@ extern uint32_t priority_p_set(uint32_t last_prio, struct job_record *job_ptr)
 	 */
 	site_factor_g_set(job_ptr);
 
-	priority = _get_priority_internal(time(NULL), job_ptr);
+	priority = _get_priority_internal(time(NULL), job_ptr, false);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
 
@@ -2064,42 +2114,282 @@ extern bool decay_apply_new_usage(struct job_record *job_ptr,
 }
 
 
-extern int decay_apply_weighted_factors(struct job_record *job_ptr,
-					 time_t *start_time_ptr)
+/* Priority 0 is reserved for held jobs. Also skip priority
+ * re_calculation for non-pending jobs. */
+static bool _skip_weighted_factors(struct job_record *job_ptr)
+{
+	return ((job_ptr->priority == 0) ||
+		IS_JOB_POWER_UP_NODE(job_ptr) ||
+		(!IS_JOB_PENDING(job_ptr) &&
+		 !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)));
+}
+
+/* Set a job's priority if changed, as PRIORITY_FLAGS_INCR_ONLY permits */
+static void _set_job_priority(struct job_record *job_ptr, uint32_t new_prio)
+{
+	if ((job_ptr->priority != new_prio) &&
+	    (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
+	     (job_ptr->priority < new_prio))) {
+		job_ptr->priority = new_prio;
+		last_job_update = time(NULL);
+	}
+
+	debug2("priority for job %u is now %u",
+	       job_ptr->job_id, job_ptr->priority);
+}
+
+static void _apply_weighted_factors(struct job_record *job_ptr,
+				    time_t start_time, bool assoc_locked)
 {
+	_set_job_priority(job_ptr, _get_priority_internal(start_time, job_ptr,
+							  assoc_locked));
+}
+
+/*
+ * Test if a job's priority can be set from factors calculated into other
+ * storage, which is the case if it was last calculated from its factors
+ * and its TRES factor array has the configured size.
+ */
+static bool _factors_reusable(struct job_record *job_ptr)
+{
+	priority_factors_object_t *old = job_ptr->prio_factors;
+
+	if (!old || priority_debug || job_ptr->direct_set_prio ||
+	    !job_ptr->details)
+		return false;
+	if (weight_tres &&
+	    (!old->priority_tres || (old->tres_cnt != slurmctld_tres_cnt)))
+		return false;
+	return true;
+}
+
+/*
+ * Return true if a job's new weighted priority factors are the same as when
+ * its priority was last calculated and its priority is still the one
+ * calculated from them, so setting it again would change nothing.
+ */
+static bool _priority_factors_unchanged(struct job_record *job_ptr,
+					priority_factors_object_t *factors,
+					double tmp_tres)
+{
+	priority_factors_object_t *old = job_ptr->prio_factors;
+	double priority;
 	uint32_t new_prio;
 
-	/* Always return SUCCESS so that list_for_each will
-	 * continue processing list of jobs. */
+	if ((factors->priority_age   != old->priority_age)   ||
+	    (factors->priority_assoc != old->priority_assoc) ||
+	    (factors->priority_fs    != old->priority_fs)    ||
+	    (factors->priority_js    != old->priority_js)    ||
+	    (factors->priority_part  != old->priority_part)  ||
+	    (factors->priority_qos   != old->priority_qos)   ||
+	    (factors->priority_site  != old->priority_site)  ||
+	    (factors->nice           != old->nice))
+		return false;
+	if (weight_tres &&
+	    memcmp(factors->priority_tres, old->priority_tres,
+		   sizeof(double) * slurmctld_tres_cnt))
+		return false;
 
 	/*
-	 * Priority 0 is reserved for held jobs. Also skip priority
-	 * re_calculation for non-pending jobs.
+	 * The scheduler sets the priority of a job in several partitions to
+	 * that in the partition it is considering, so check the priority
+	 * itself too.
 	 */
-	if ((job_ptr->priority == 0) ||
-	    IS_JOB_POWER_UP_NODE(job_ptr) ||
-	    (!IS_JOB_PENDING(job_ptr) &&
-	     !(flags & PRIORITY_FLAGS_CALCULATE_RUNNING)))
-		return SLURM_SUCCESS;
+	priority = _sum_priority_factors(factors, tmp_tres);
+	if (priority < 1)
+		priority = 1;
+	if (priority > (double) 0xffffffff)
+		priority = (double) 0xffffffff;
+	new_prio = (uint32_t) priority;
+	if (flags & PRIORITY_FLAGS_INCR_ONLY)
+		return (job_ptr->priority >= new_prio);
+	return (job_ptr->priority == new_prio);
+}
 
-	new_prio = _get_priority_internal(*start_time_ptr, job_ptr);
-	if (((flags & PRIORITY_FLAGS_INCR_ONLY) == 0) ||
-	    (job_ptr->priority < new_prio)) {
-		job_ptr->priority = new_prio;
-		last_job_update = time(NULL);
+/*
+ * Set a job's priority from weighted priority factors calculated by
+ * decay_apply_weighted_factors_list(), rather than calculating them again
+ */
+static void _apply_priority_factors(struct job_record *job_ptr,
+				    priority_factors_object_t *factors,
+				    double tmp_tres)
+{
+	priority_factors_object_t *old = job_ptr->prio_factors;
+	double priority;
+
+	old->priority_age   = factors->priority_age;
+	old->priority_assoc = factors->priority_assoc;
+	old->priority_fs    = factors->priority_fs;
+	old->priority_js    = factors->priority_js;
+	old->priority_part  = factors->priority_part;
+	old->priority_qos   = factors->priority_qos;
+	old->priority_site  = factors->priority_site;
+	old->nice           = factors->nice;
+	if (weight_tres) {
+		memcpy(old->priority_tres, factors->priority_tres,
+		       sizeof(double) * slurmctld_tres_cnt);
 	}
 
-	debug2("priority for job %u is now %u",
-	       job_ptr->job_id, job_ptr->priority);
+	priority = _bound_priority(job_ptr,
+				   _sum_priority_factors(old, tmp_tres));
+	_set_part_priorities(job_ptr);
+	_set_job_priority(job_ptr, (uint32_t) priority);
+}
+
+extern int decay_apply_weighted_factors(struct job_record *job_ptr,
+					 time_t *start_time_ptr)
+{
+	/* Always return SUCCESS so that list_for_each will
+	 * continue processing list of jobs. */
+
+	if (_skip_weighted_factors(job_ptr))
+		return SLURM_SUCCESS;
+
+	_apply_weighted_factors(job_ptr, *start_time_ptr, false);
 
 	return SLURM_SUCCESS;
 }
 
+/* A job priority change found by decay_apply_weighted_factors_list() */
+typedef struct {
+	uint32_t job_id;
+	bool recalc;		/* calculate from scratch, factors not set */
+	priority_factors_object_t factors;	/* weighted factors */
+	double tmp_tres;	/* weighted TRES factor sum */
+} prio_change_t;
+
+extern void decay_apply_weighted_factors_list(List job_list,
+					      time_t *start_time_ptr)
+{
+	static time_t conf_update = 0, part_update = 0;
+	/* Read lock on jobs, nodes and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+	/* Write lock on jobs, read lock on nodes and partitions */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, NO_LOCK };
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+	double tres_factors[slurmctld_tres_cnt + 1];
+	priority_factors_object_t factors;
+	struct job_record *job_ptr;
+	ListIterator itr;
+	prio_change_t *changes = NULL, *change;
+	int change_cnt = 0, change_size = 0, job_cnt = 0, i;
+	bool recalc_all = false, job_changed;
+	time_t job_update;
+	double tmp_tres;
+
+	/*
+	 * Find the jobs whose priority changed under read locks, so jobs can
+	 * still be read meanwhile.
+	 */
+	lock_slurmctld(job_read_lock);
+	assoc_mgr_lock(&locks);
+	/*
+	 * The partition factors of jobs in several partitions are not in
+	 * their prio_factors, and weights may have changed.
+	 */
+	if ((conf_update != slurmctld_conf.last_update) ||
+	    (part_update != last_part_update)) {
+		conf_update = slurmctld_conf.last_update;
+		part_update = last_part_update;
+		recalc_all = true;
+	}
+	job_update = last_job_update;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		/* Don't need to handle finished jobs. */
+		if (IS_JOB_FINISHED(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+		    _skip_weighted_factors(job_ptr))
+			continue;
+		job_cnt++;
+
+		if (change_cnt >= change_size) {
+			change_size = change_size ? (change_size * 2) : 64;
+			xrealloc(changes, sizeof(prio_change_t) * change_size);
+		}
+		change = &changes[change_cnt];
+		memset(change, 0, sizeof(prio_change_t));
+		change->job_id = job_ptr->job_id;
+		if (recalc_all || !_factors_reusable(job_ptr)) {
+			change->recalc = true;
+			change_cnt++;
+			continue;
+		}
+
+		memset(&factors, 0, sizeof(priority_factors_object_t));
+		if (weight_tres) {
+			memset(tres_factors, 0, sizeof(tres_factors));
+			factors.priority_tres = tres_factors;
+		}
+		_set_priority_factors(*start_time_ptr, job_ptr, &factors, true);
+		tmp_tres = _weight_priority_factors(&factors);
+		if (_priority_factors_unchanged(job_ptr, &factors, tmp_tres))
+			continue;
+
+		change->factors = factors;
+		if (weight_tres) {
+			change->factors.priority_tres =
+				xcalloc(slurmctld_tres_cnt, sizeof(double));
+			memcpy(change->factors.priority_tres, tres_factors,
+			       sizeof(double) * slurmctld_tres_cnt);
+		}
+		change->tmp_tres = tmp_tres;
+		change_cnt++;
+	}
+	list_iterator_destroy(itr);
+	assoc_mgr_unlock(&locks);
+	unlock_slurmctld(job_read_lock);
+
+	if (!change_cnt)
+		goto fini;
+
+	/*
+	 * Apply the changes under the write lock. A job changed between the
+	 * locks may have been given new factors, so calculate again then.
+	 */
+	lock_slurmctld(job_write_lock);
+	assoc_mgr_lock(&locks);
+	job_changed = (last_job_update != job_update);
+	for (i = 0; i < change_cnt; i++) {
+		change = &changes[i];
+		job_ptr = find_job_record(change->job_id);
+		if (!job_ptr || IS_JOB_FINISHED(job_ptr) ||
+		    IS_JOB_COMPLETING(job_ptr) ||
+		    _skip_weighted_factors(job_ptr))
+			continue;
+		if (change->recalc || job_changed ||
+		    !_factors_reusable(job_ptr)) {
+			_apply_weighted_factors(job_ptr, *start_time_ptr,
+						true);
+		} else {
+			_apply_priority_factors(job_ptr, &change->factors,
+						change->tmp_tres);
+		}
+	}
+	assoc_mgr_unlock(&locks);
+	unlock_slurmctld(job_write_lock);
+
+fini:
+	for (i = 0; i < change_cnt; i++)
+		xfree(changes[i].factors.priority_tres);
+	xfree(changes);
+
+	debug2("%s: priority of %d of %d jobs recalculated",
+	       __func__, change_cnt, job_cnt);
+}
 
 extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 {
-	slurmdb_qos_rec_t *qos_ptr = NULL;
+	_set_job_priority_factors(start_time, job_ptr, false);
+}
 
+static void _set_job_priority_factors(time_t start_time,
+				      struct job_record *job_ptr,
+				      bool assoc_locked)
+{
 	xassert(job_ptr);
 
 	if (!job_ptr->prio_factors) {
@@ -2112,6 +2402,23 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		       sizeof(priority_factors_object_t));
 	}
 
+	_set_priority_factors(start_time, job_ptr, job_ptr->prio_factors,
+			      assoc_locked);
+}
+
+/*
+ * Set a job's unweighted priority factors
+ * IN/OUT factors - cleared factors to set. If priority_tres is set it is used
+ *	for the TRES factors, otherwise the TRES arrays are allocated.
+ * IN assoc_locked - set if the caller holds the assoc_mgr assoc read lock
+ */
+static void _set_priority_factors(time_t start_time,
+				  struct job_record *job_ptr,
+				  priority_factors_object_t *factors,
+				  bool assoc_locked)
+{
+	slurmdb_qos_rec_t *qos_ptr = NULL;
+
 	qos_ptr = job_ptr->qos_ptr;
 
 	if (weight_age && job_ptr->details->accrue_time) {
@@ -2123,17 +2430,22 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		 */
 		if (start_time > job_ptr->details->accrue_time)
 			diff = start_time - job_ptr->details->accrue_time;
+		/*
+		 * Age in whole points of priority, so the age factor of a
+		 * job only changes when its priority would.
+		 */
+		diff -= diff % age_bucket;
 
 		if (diff < max_age)
-			job_ptr->prio_factors->priority_age =
+			factors->priority_age =
 				(double)diff / (double)max_age;
 		else
-			job_ptr->prio_factors->priority_age = 1.0;
+			factors->priority_age = 1.0;
 	}
 
 	if (job_ptr->assoc_ptr && weight_fs) {
-		job_ptr->prio_factors->priority_fs =
-			_get_fairshare_priority(job_ptr);
+		factors->priority_fs =
+			_get_fairshare_priority(job_ptr, assoc_locked);
 	}
 
 	/* FIXME: this should work off the product of TRESBillingWeights */
@@ -2156,12 +2468,12 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 		if (flags & PRIORITY_FLAGS_SIZE_RELATIVE) {
 			uint32_t time_limit = 1;
 			/* Job size in CPUs (based upon average CPUs/Node */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes *
 				(double)cluster_cpus /
 				(double)node_record_count;
-			if (cpu_cnt > job_ptr->prio_factors->priority_js) {
-				job_ptr->prio_factors->priority_js =
+			if (cpu_cnt > factors->priority_js) {
+				factors->priority_js =
 					(double)cpu_cnt;
 			}
 			/* Divide by job time limit */
@@ -2169,80 +2481,80 @@ extern void set_priority_factors(time_t start_time, struct job_record *job_ptr)
 				time_limit = job_ptr->time_limit;
 			else if (job_ptr->part_ptr)
 				time_limit = job_ptr->part_ptr->max_time;
-			job_ptr->prio_factors->priority_js /= time_limit;
+			factors->priority_js /= time_limit;
 			/* Normalize to max value of 1.0 */
-			job_ptr->prio_factors->priority_js /= cluster_cpus;
+			factors->priority_js /= cluster_cpus;
 			if (favor_small) {
-				job_ptr->prio_factors->priority_js =
+				factors->priority_js =
 					(double) 1.0 -
-					job_ptr->prio_factors->priority_js;
+					factors->priority_js;
 			}
 		} else if (favor_small) {
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)(node_record_count - min_nodes)
 				/ (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)(cluster_cpus - cpu_cnt)
 					/ (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		} else {	/* favor large */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes / (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)cpu_cnt / (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		}
-		if (job_ptr->prio_factors->priority_js < .0)
-			job_ptr->prio_factors->priority_js = 0.0;
-		else if (job_ptr->prio_factors->priority_js > 1.0)
-			job_ptr->prio_factors->priority_js = 1.0;
+		if (factors->priority_js < .0)
+			factors->priority_js = 0.0;
+		else if (factors->priority_js > 1.0)
+			factors->priority_js = 1.0;
 	}
 
 	if (job_ptr->part_ptr && job_ptr->part_ptr->priority_job_factor &&
 	    weight_part) {
-		job_ptr->prio_factors->priority_part =
+		factors->priority_part =
 			(flags & PRIORITY_FLAGS_NO_NORMAL_PART) ?
 			job_ptr->part_ptr->priority_job_factor :
 			job_ptr->part_ptr->norm_priority;
 	}
 
-	job_ptr->prio_factors->priority_site = job_ptr->site_factor;
+	factors->priority_site = job_ptr->site_factor;
 
 	if (job_ptr->assoc_ptr && weight_assoc)
-		job_ptr->prio_factors->priority_assoc =
+		factors->priority_assoc =
 			(flags & PRIORITY_FLAGS_NO_NORMAL_ASSOC) ?
 			job_ptr->assoc_ptr->priority :
 			job_ptr->assoc_ptr->usage->priority_norm;
 
 	if (qos_ptr && qos_ptr->priority && weight_qos) {
-		job_ptr->prio_factors->priority_qos =
+		factors->priority_qos =
 			(flags & PRIORITY_FLAGS_NO_NORMAL_QOS) ?
 			qos_ptr->priority :
 			qos_ptr->usage->norm_priority;
 	}
 
 	if (job_ptr->details)
-		job_ptr->prio_factors->nice = job_ptr->details->nice;
+		factors->nice = job_ptr->details->nice;
 	else
-		job_ptr->prio_factors->nice = NICE_OFFSET;
+		factors->nice = NICE_OFFSET;
 
 	if (weight_tres) {
-		if (!job_ptr->prio_factors->priority_tres) {
-			job_ptr->prio_factors->priority_tres =
+		if (!factors->priority_tres) {
+			factors->priority_tres =
 				xcalloc(slurmctld_tres_cnt, sizeof(double));
-			job_ptr->prio_factors->tres_weights =
+			factors->tres_weights =
 				xcalloc(slurmctld_tres_cnt, sizeof(double));
-			memcpy(job_ptr->prio_factors->tres_weights, weight_tres,
+			memcpy(factors->tres_weights, weight_tres,
 			       sizeof(double) * slurmctld_tres_cnt);
-			job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
+			factors->tres_cnt = slurmctld_tres_cnt;
 		}
 
 		_get_tres_factors(job_ptr, job_ptr->part_ptr,
-				  job_ptr->prio_factors->priority_tres);
+				  factors->priority_tres);
 	}
 }
 
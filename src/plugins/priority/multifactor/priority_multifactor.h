@@ -57,6 +57,15 @@ extern bool decay_apply_new_usage(
 		struct job_record *job_ptr, time_t *start_time_ptr);
 extern int  decay_apply_weighted_factors(
 		struct job_record *job_ptr, time_t *start_time_ptr);
+/*
+ * Apply decay_apply_weighted_factors() to every job in the list, skipping
+ * jobs whose priority factors have not changed since their priority was last
+ * calculated. The factors are calculated under job read locks, then only the
+ * changed jobs are updated under the job write lock.
+ * NOTE: Caller must not hold any slurmctld or assoc_mgr locks
+ */
+extern void decay_apply_weighted_factors_list(
+		List job_list, time_t *start_time_ptr);
 extern void set_assoc_usage_norm(slurmdb_assoc_rec_t *assoc);
 extern void set_priority_factors(time_t start_time, struct job_record *job_ptr);
 
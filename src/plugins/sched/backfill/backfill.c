@@ -94,7 +94,8 @@
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
-#include "backfill.h"
+#include "src/plugins/sched/backfill/backfill.h"
+#include "src/plugins/sched/backfill/node_space.h"
 
 #define BACKFILL_INTERVAL	30
 #define BACKFILL_RESOLUTION	60
@@ -115,6 +116,8 @@
 #define MAX_BF_MAX_TIME                3600
 #define MAX_BF_MIN_AGE_RESERVE         (30 * 24 * 60 * 60) /* 30 days */
 #define MAX_BF_MIN_PRIO_RESERVE        INFINITE
+#define MAX_BF_PLAN_AGE                3600
+#define MAX_BF_THREADS                 64
 #define MAX_BF_YIELD_INTERVAL          10000000 /* 10 seconds in usec */
 #define MAX_MAX_RPC_CNT                1000
 #define MAX_YIELD_SLEEP                10000000 /* 10 seconds in usec */
@@ -124,13 +127,6 @@
 #define MAX_BF_MAX_JOB_USER_PART       MAX_BF_MAX_JOB_TEST
 #define MAX_BF_MAX_JOB_PART            MAX_BF_MAX_JOB_TEST
 
-typedef struct node_space_map {
-	time_t begin_time;
-	time_t end_time;
-	bitstr_t *avail_bitmap;
-	int next;	/* next record, by time, zero termination */
-} node_space_map_t;
-
 /*
  * Pack job scheduling structures
  * NOTE: An individial pack job component can be submitted to multiple
@@ -160,6 +156,88 @@ typedef struct deadlock_part_struct {
 	struct part_record *part_ptr;
 } deadlock_part_struct_t;
 
+/*
+ * Reservation made for a pending job by a backfill cycle. With bf_plan_age,
+ * the next cycle reuses the job's planned start time and nodes rather than
+ * testing the job again if nothing the reservation depends upon has changed,
+ * see _plan_reuse().
+ */
+typedef struct bf_plan_rec {
+	uint32_t array_task_id;
+	uint32_t job_id;
+	uint64_t job_key;		/* rec_table key, see _plan_job_key() */
+	bitstr_t *node_bitmap;		/* nodes reserved */
+	struct part_record *part_ptr;
+	time_t plan_time;		/* when the job was tested */
+	time_t start_time;		/* planned start time */
+	uint32_t time_limit;		/* minutes reserved */
+	bool valid;			/* may be reused */
+} bf_plan_rec_t;
+
+/* Reservations made by one backfill cycle, in the order they were made */
+typedef struct bf_plan {
+	bitstr_t *avail_bitmap;		/* nodes available to the cycle */
+	time_t config_update;
+	time_t part_update;
+	time_t resv_update;
+	time_t sched_start;		/* start of the cycle */
+	int rec_cnt;
+	int rec_size;
+	bf_plan_rec_t *recs;
+	xhash_t *rec_table;		/* recs by job, once complete */
+} bf_plan_t;
+
+/*
+ * State of one backfill cycle, shared by the threads testing its job queues.
+ * Jobs are tested under read locks, while scheduler state is updated under
+ * the write locks held by the backfill thread. With bf_threads, one thread at
+ * a time updates scheduler state and jobs are only tested while none does so.
+ * Each thread waits in _cycle_test_begin() until all others are also ready to
+ * test a job (or are done), so the slow will-run tests of jobs in different
+ * queues overlap.
+ */
+typedef struct bf_cycle {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;		/* signalled on any change below */
+	int active_cnt;			/* threads still testing jobs */
+	bool state_busy;		/* a thread is updating state */
+	int test_cnt;			/* threads testing a job */
+	uint32_t test_round;		/* incremented as waiting tests start */
+	int wait_cnt;			/* threads waiting to test a job */
+	int yield_rc;			/* _yield_locks() return code */
+	uint32_t yield_cnt;		/* count of locks yielded */
+	bool yield_req;			/* thread asked to yield locks */
+	int yield_wait_cnt;		/* threads waiting for locks to yield */
+	bool locks_shared;		/* read locks held for tests */
+	bool lock_req;			/* thread asked to switch locks */
+
+	int thread_cnt;			/* threads running _test_jobs() */
+	List *job_queues;		/* job_queue_rec_t lists */
+	int queue_cnt;
+	int next_queue;			/* next queue to start testing */
+
+	time_t config_update;
+	node_space_map_t *node_space;
+	time_t node_update;		/* last_node_update at cycle start */
+	time_t orig_sched_start;
+	time_t part_update;
+	bf_plan_t *plan;		/* reservations made by this cycle */
+	bool plan_broken;		/* resources allocated or released */
+	bitstr_t *plan_freed;		/* nodes last_plan reserved earlier in
+					 * the cycle for other jobs or times */
+	int plan_next;			/* next record of last_plan to match */
+	int plan_reused;		/* reservations taken from last_plan */
+	int rc;				/* 1 if system state changed */
+	time_t sched_start;
+	struct timeval start_tv;
+	uint32_t state_changes;		/* jobs or nodes updated by others
+					 * while locks were traded */
+	bool stop;			/* end the cycle */
+	int job_test_count;
+	int test_time_count;
+	time_t window_end;
+} bf_cycle_t;
+
 /* Diagnostic  statistics */
 extern diag_stats_t slurmctld_diag_stats;
 uint32_t bf_sleep_usec = 0;
@@ -185,6 +263,8 @@ static int bf_job_part_count_reserve = 0;
 static int bf_max_job_array_resv = BF_MAX_JOB_ARRAY_RESV;
 static int bf_min_age_reserve = 0;
 static uint32_t bf_min_prio_reserve = 0;
+static int bf_plan_age = 0;
+static bf_plan_t *last_plan = NULL;	/* reservations of the last cycle */
 static List deadlock_global_list;
 static bool bf_hetjob_immediate = false;
 static uint16_t bf_hetjob_prio = 0;
@@ -200,19 +280,23 @@ static bool assoc_limit_stop = false;
 static int max_rpc_cnt = 0;
 static int yield_interval = YIELD_INTERVAL;
 static int yield_sleep   = YIELD_SLEEP;
+static int bf_threads = 1;
 static List pack_job_list = NULL;
 static xhash_t *user_usage_map = NULL; /* look up user usage when no assoc */
 
 /*********************** local functions *********************/
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs);
 static void _adjust_hetjob_prio(uint32_t *prio, uint32_t val);
 static int  _attempt_backfill(void);
 static int  _clear_job_start_times(void *x, void *arg);
 static int  _clear_qos_blocked_times(void *x, void *arg);
+static void _cycle_enter(bf_cycle_t *cycle);
+static void _cycle_exit(bf_cycle_t *cycle);
+static void _cycle_test_begin(bf_cycle_t *cycle);
+static void _cycle_test_end(bf_cycle_t *cycle);
+static int  _cycle_yield_locks(bf_cycle_t *cycle);
 static void _do_diag_stats(struct timeval *tv1, struct timeval *tv2);
+static void _equiv_add(xhash_t *equiv_table, char **equiv_key,
+		       time_t start_time, bool window_tested);
 static uint32_t _get_job_max_tl(struct job_record *job_ptr, time_t now,
 				node_space_map_t *node_space);
 static bool _hetjob_any_resv(struct job_record *het_leader);
@@ -232,6 +316,17 @@ static int  _pack_find_map(void *x, void *key);
 static void _pack_map_del(void *x);
 static void _pack_rec_del(void *x);
 static void _pack_start_clear(void);
+static bf_plan_t *_plan_create(bitstr_t *avail_bitmap, time_t sched_start);
+static void _plan_free(bf_plan_t *plan);
+static void _plan_record(bf_cycle_t *cycle, struct job_record *job_ptr,
+			 struct part_record *part_ptr, uint32_t time_limit,
+			 bitstr_t *node_bitmap, time_t plan_time, bool valid);
+static bf_plan_rec_t *_plan_reuse(bf_cycle_t *cycle,
+				  struct job_record *job_ptr,
+				  struct part_record *part_ptr,
+				  uint32_t time_limit, uint32_t min_nodes,
+				  time_t now);
+static void _plan_validate(bitstr_t *avail_bitmap);
 static time_t _pack_start_find(struct job_record *job_ptr, time_t now);
 static void _pack_start_set(struct job_record *job_ptr, time_t latest_start,
 			    uint32_t comp_time_limit);
@@ -242,11 +337,18 @@ static void _pack_start_test(node_space_map_t *node_space,
 			     uint32_t pack_job_id);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space);
+static void _run_test_threads(bf_cycle_t *cycle);
 static int  _set_hetjob_details(void *x, void *arg);
+static List *_split_job_queue(List job_queue, int *queue_cnt);
 static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
-static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve);
+static int  _test_job(bf_cycle_t *cycle, struct job_record *job_ptr,
+		      uint32_t orig_time_limit, uint32_t bit_flags,
+		      bool exclusive, bitstr_t **avail_bitmap,
+		      uint32_t min_nodes, uint32_t max_nodes,
+		      uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+		      bool *changed);
+static void _test_jobs(bf_cycle_t *cycle);
+static void *_test_jobs_thread(void *arg);
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
 		       uint32_t req_nodes, bitstr_t *exc_core_bitmap);
@@ -282,25 +384,23 @@ static void _dump_job_test(struct job_record *job_ptr, bitstr_t *avail_bitmap,
 	xfree(node_list);
 }
 
-/* Log resource allocate table */
-static void _dump_node_space_table(node_space_map_t *node_space_ptr)
+static void _dump_node_space_rec(time_t begin_time, time_t end_time,
+				 bitstr_t *avail_bitmap, void *arg)
 {
-	int i = 0;
 	char begin_buf[32], end_buf[32], *node_list;
 
+	slurm_make_time_str(&begin_time, begin_buf, sizeof(begin_buf));
+	slurm_make_time_str(&end_time, end_buf, sizeof(end_buf));
+	node_list = bitmap2node_name(avail_bitmap);
+	info("Begin:%s End:%s Nodes:%s", begin_buf, end_buf, node_list);
+	xfree(node_list);
+}
+
+/* Log resource allocate table */
+static void _dump_node_space_table(node_space_map_t *node_space)
+{
 	info("=========================================");
-	while (1) {
-		slurm_make_time_str(&node_space_ptr[i].begin_time,
-				    begin_buf, sizeof(begin_buf));
-		slurm_make_time_str(&node_space_ptr[i].end_time,
-				    end_buf, sizeof(end_buf));
-		node_list = bitmap2node_name(node_space_ptr[i].avail_bitmap);
-		info("Begin:%s End:%s Nodes:%s",
-		     begin_buf, end_buf, node_list);
-		xfree(node_list);
-		if ((i = node_space_ptr[i].next) == 0)
-			break;
-	}
+	node_space_walk(node_space, _dump_node_space_rec, NULL);
 	info("=========================================");
 }
 
@@ -816,6 +916,17 @@ static void _load_config(void)
 		}
 	}
 
+	bf_plan_age = 0;
+	if ((tmp_ptr = xstrcasestr(sched_params, "bf_plan_age="))) {
+		int plan_age = atoi(tmp_ptr + 12);
+		if (plan_age < 0 || plan_age > MAX_BF_PLAN_AGE) {
+			error("Invalid SchedulerParameters bf_plan_age: %d",
+			      plan_age);
+		} else {
+			bf_plan_age = plan_age;
+		}
+	}
+
 	bf_min_prio_reserve = 0;
 	if ((tmp_ptr = xstrcasestr(sched_params, "bf_min_prio_reserve="))) {
 		char *end_ptr = NULL;
@@ -845,6 +956,17 @@ static void _load_config(void)
 	}
 
 
+	if ((tmp_ptr = xstrcasestr(sched_params, "bf_threads="))) {
+		bf_threads = atoi(tmp_ptr + 11);
+		if ((bf_threads < 1) || (bf_threads > MAX_BF_THREADS)) {
+			error("Invalid SchedulerParameters bf_threads: %d",
+			      bf_threads);
+			bf_threads = 1;
+		}
+	} else {
+		bf_threads = 1;
+	}
+
 	if ((tmp_ptr = xstrcasestr(sched_params, "bf_yield_interval="))) {
 		yield_interval = atoi(tmp_ptr + 18);
 		if ((yield_interval <= 0) ||
@@ -1022,6 +1144,23 @@ extern void *backfill_agent(void *args)
 	return NULL;
 }
 
+/* Run one backfill cycle in the calling thread, see slurmctld -s */
+extern void backfill_run_cycle(void)
+{
+	/* Read config and partitions; Write jobs and nodes */
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+
+	_load_config();
+	if (!pack_job_list)
+		pack_job_list = list_create(_pack_map_del);
+
+	lock_slurmctld(all_locks);
+	_pack_start_clear();
+	(void) _attempt_backfill();
+	unlock_slurmctld(all_locks);
+}
+
 /* Clear the start_time for all pending jobs. This is used to ensure that a job which
  * can run in multiple partitions has its start_time set to the smallest
  * value in any of those partitions. */
@@ -1045,6 +1184,10 @@ static int _yield_locks(int64_t usec)
 	bool load_config = false;
 	int yield_rpc_cnt;
 
+	/* Nothing else needs the locks during a scheduling replay */
+	if (slurmctld_config.sched_replay)
+		return 0;
+
 	yield_rpc_cnt = MAX((max_rpc_cnt / 10), 20);
 	job_update  = last_job_update;
 	node_update = last_node_update;
@@ -1480,44 +1623,817 @@ static bool _job_exceeds_max_bf_param(struct job_record *job_ptr,
 	return false;
 }
 
+static void _job_queue_rec_del(void *x)
+{
+	xfree(x);
+}
+
+static int _part_ptr_cmp(const void *a, const void *b)
+{
+	struct part_record *part1 = *(struct part_record **) a;
+	struct part_record *part2 = *(struct part_record **) b;
+
+	if (part1 < part2)
+		return -1;
+	return (part1 > part2);
+}
+
+static int _part_inx(struct part_record **part_array, int part_cnt,
+		     struct part_record *part_ptr)
+{
+	struct part_record **found;
+
+	found = bsearch(&part_ptr, part_array, part_cnt,
+			sizeof(struct part_record *), _part_ptr_cmp);
+	if (!found)
+		return -1;
+	return (found - part_array);
+}
+
+static int _group_find(int *group, int inx)
+{
+	while (group[inx] != inx) {
+		group[inx] = group[group[inx]];
+		inx = group[inx];
+	}
+	return inx;
+}
+
+static void _group_join(int *group, int inx1, int inx2)
+{
+	if ((inx1 < 0) || (inx2 < 0))
+		return;
+	group[_group_find(group, inx1)] = _group_find(group, inx2);
+}
+
+/* Put all partitions the job may run in into the group of partition inx */
+static void _group_job_parts(int *group, struct part_record **part_array,
+			     int part_cnt, struct job_record *job_ptr, int inx)
+{
+	struct part_record *part_ptr;
+	ListIterator part_iter;
+
+	_group_join(group, inx, _part_inx(part_array, part_cnt,
+					  job_ptr->part_ptr));
+	if (!job_ptr->part_ptr_list)
+		return;
+	part_iter = list_iterator_create(job_ptr->part_ptr_list);
+	while ((part_ptr = list_next(part_iter)))
+		_group_join(group, inx, _part_inx(part_array, part_cnt,
+						  part_ptr));
+	list_iterator_destroy(part_iter);
+}
+
+/*
+ * Split the sorted job queue for bf_threads. Partitions are grouped so that
+ * no two groups share any node or pending job (including hetjob components),
+ * and each group gets its own queue, still in priority order. Jobs in
+ * different queues can then be tested concurrently.
+ * IN job_queue - consumed
+ * OUT queue_cnt - number of queues returned
+ * RET array of job queues, largest first, xfree() the array
+ */
+static List *_split_job_queue(List job_queue, int *queue_cnt)
+{
+	struct part_record **part_array, *part_ptr;
+	struct job_record *job_ptr, *leader_ptr, *comp_ptr;
+	job_queue_rec_t *job_queue_rec;
+	ListIterator iter, comp_iter;
+	List *job_queues = NULL, tmp_queue;
+	int *group = NULL, *queue_inx = NULL;
+	int part_cnt = 0, i, j, inx;
+
+	if ((bf_threads == 1) || !(part_cnt = list_count(part_list)))
+		goto single;
+
+	part_array = xcalloc(part_cnt, sizeof(struct part_record *));
+	iter = list_iterator_create(part_list);
+	for (i = 0; (part_ptr = list_next(iter)) && (i < part_cnt); i++)
+		part_array[i] = part_ptr;
+	list_iterator_destroy(iter);
+	qsort(part_array, part_cnt, sizeof(struct part_record *),
+	      _part_ptr_cmp);
+
+	group = xcalloc(part_cnt, sizeof(int));
+	for (i = 0; i < part_cnt; i++)
+		group[i] = i;
+	for (i = 0; i < part_cnt; i++) {
+		if (!part_array[i]->node_bitmap)
+			continue;
+		for (j = i + 1; j < part_cnt; j++) {
+			if (part_array[j]->node_bitmap &&
+			    bit_overlap(part_array[i]->node_bitmap,
+					part_array[j]->node_bitmap))
+				_group_join(group, i, j);
+		}
+	}
+
+	iter = list_iterator_create(job_queue);
+	while ((job_queue_rec = list_next(iter))) {
+		job_ptr = job_queue_rec->job_ptr;
+		inx = _part_inx(part_array, part_cnt, job_queue_rec->part_ptr);
+		if (inx < 0)
+			break;
+		if (job_ptr->pack_job_id &&
+		    (leader_ptr = find_job_record(job_ptr->pack_job_id)) &&
+		    leader_ptr->pack_job_list) {
+			comp_iter = list_iterator_create(
+				leader_ptr->pack_job_list);
+			while ((comp_ptr = list_next(comp_iter)))
+				_group_job_parts(group, part_array, part_cnt,
+						 comp_ptr, inx);
+			list_iterator_destroy(comp_iter);
+		} else {
+			_group_job_parts(group, part_array, part_cnt, job_ptr,
+					 inx);
+		}
+	}
+	list_iterator_destroy(iter);
+	if (job_queue_rec) {
+		/* Partition not found, should never happen */
+		xfree(part_array);
+		xfree(group);
+		goto single;
+	}
+
+	*queue_cnt = 0;
+	queue_inx = xcalloc(part_cnt, sizeof(int));
+	while ((job_queue_rec = list_pop(job_queue))) {
+		inx = _part_inx(part_array, part_cnt, job_queue_rec->part_ptr);
+		inx = _group_find(group, inx);
+		if (!queue_inx[inx]) {
+			queue_inx[inx] = ++(*queue_cnt);
+			xrecalloc(job_queues, *queue_cnt, sizeof(List));
+			job_queues[*queue_cnt - 1] =
+				list_create(_job_queue_rec_del);
+		}
+		list_append(job_queues[queue_inx[inx] - 1], job_queue_rec);
+	}
+	FREE_NULL_LIST(job_queue);
+	xfree(part_array);
+	xfree(group);
+	xfree(queue_inx);
+
+	/* Start with the largest queues */
+	for (i = 1; i < *queue_cnt; i++) {
+		tmp_queue = job_queues[i];
+		for (j = i; (j > 0) && (list_count(job_queues[j - 1]) <
+					list_count(tmp_queue)); j--)
+			job_queues[j] = job_queues[j - 1];
+		job_queues[j] = tmp_queue;
+	}
+	return job_queues;
+
+single:
+	*queue_cnt = 1;
+	job_queues = xmalloc(sizeof(List));
+	job_queues[0] = job_queue;
+	return job_queues;
+}
+
+/*
+ * Switch between the locks needed to update scheduler state and the read
+ * locks under which jobs are tested, letting waiting RPCs run in between.
+ * Stop the cycle if the configuration or partitions changed meanwhile, and
+ * count job or node updates, which may have released resources.
+ */
+static void _share_locks(bf_cycle_t *cycle, bool shared)
+{
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	slurmctld_lock_t test_locks = {
+		READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+	time_t job_update = last_job_update;
+	time_t node_update = last_node_update;
+
+	if (shared) {
+		unlock_slurmctld(all_locks);
+		lock_slurmctld(test_locks);
+	} else {
+		unlock_slurmctld(test_locks);
+		lock_slurmctld(all_locks);
+	}
+
+	if ((last_job_update != job_update) ||
+	    (last_node_update != node_update))
+		cycle->state_changes++;
+	if ((slurmctld_conf.last_update != cycle->config_update) ||
+	    (last_part_update != cycle->part_update)) {
+		if (!cycle->stop && (debug_flags & DEBUG_FLAG_BACKFILL))
+			info("backfill: system state changed while testing "
+			     "jobs, breaking out");
+		cycle->rc = 1;
+		cycle->stop = true;
+	}
+}
+
+/* Record the locks a test thread holds on behalf of the backfill thread */
+static void _delegate_locks(bool shared)
+{
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	slurmctld_lock_t test_locks = {
+		READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+
+	if (shared) {
+		unlock_slurmctld_delegate(all_locks);
+		lock_slurmctld_delegate(test_locks);
+	} else {
+		unlock_slurmctld_delegate(test_locks);
+		lock_slurmctld_delegate(all_locks);
+	}
+}
+
+/* Wait until no thread updates state or tests a job, then update state */
+static void _cycle_enter(bf_cycle_t *cycle)
+{
+	if (cycle->thread_cnt <= 1)
+		return;
+
+	slurm_mutex_lock(&cycle->mutex);
+	while (cycle->state_busy || cycle->test_cnt || cycle->locks_shared ||
+	       cycle->lock_req)
+		slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	cycle->state_busy = true;
+	slurm_mutex_unlock(&cycle->mutex);
+}
+
+/*
+ * Once no active thread is left to join them (the others wait to yield locks),
+ * have the backfill thread share its locks and start the waiting tests
+ */
+static void _cycle_start_tests(bf_cycle_t *cycle)
+{
+	if (cycle->wait_cnt &&
+	    ((cycle->wait_cnt + cycle->yield_wait_cnt) == cycle->active_cnt))
+		cycle->lock_req = true;
+	slurm_cond_broadcast(&cycle->cond);
+}
+
+/* Stop updating state, the calling thread is done testing jobs */
+static void _cycle_exit(bf_cycle_t *cycle)
+{
+	if (cycle->thread_cnt <= 1)
+		return;
+
+	slurm_mutex_lock(&cycle->mutex);
+	cycle->state_busy = false;
+	cycle->active_cnt--;
+	_cycle_start_tests(cycle);
+	slurm_mutex_unlock(&cycle->mutex);
+}
+
+/*
+ * Stop updating state and wait until jobs can be tested under read locks.
+ * With bf_threads, also wait for the other threads to be ready to test their
+ * jobs (or to yield locks), then test concurrently with them. Locks are not
+ * yielded meanwhile, so the job's state is as prepared.
+ */
+static void _cycle_test_begin(bf_cycle_t *cycle)
+{
+	uint32_t test_round;
+
+	if (cycle->thread_cnt <= 1) {
+		_share_locks(cycle, true);
+		return;
+	}
+
+	slurm_mutex_lock(&cycle->mutex);
+	test_round = cycle->test_round;
+	cycle->state_busy = false;
+	cycle->wait_cnt++;
+	_cycle_start_tests(cycle);
+	while (test_round == cycle->test_round)
+		slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	slurm_mutex_unlock(&cycle->mutex);
+	_delegate_locks(true);
+}
+
+/* Wait for all tests to end and the locks to be reacquired, update state */
+static void _cycle_test_end(bf_cycle_t *cycle)
+{
+	if (cycle->thread_cnt <= 1) {
+		_share_locks(cycle, false);
+		return;
+	}
+
+	slurm_mutex_lock(&cycle->mutex);
+	if (--cycle->test_cnt == 0)
+		cycle->lock_req = true;
+	slurm_cond_broadcast(&cycle->cond);
+	while (cycle->state_busy || cycle->test_cnt || cycle->locks_shared ||
+	       cycle->lock_req)
+		slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	cycle->state_busy = true;
+	slurm_mutex_unlock(&cycle->mutex);
+	_delegate_locks(false);
+}
+
+/*
+ * Yield locks as _yield_locks(). With bf_threads, first let the other threads
+ * test the jobs they prepared and use the results, then have the thread which
+ * holds the locks release them once every thread waits to yield. No thread
+ * then keeps a job's available nodes or reservation test across the yield.
+ */
+static int _cycle_yield_locks(bf_cycle_t *cycle)
+{
+	uint32_t yield_cnt;
+	int rc;
+
+	if (cycle->thread_cnt <= 1)
+		return _yield_locks(yield_sleep);
+
+	slurm_mutex_lock(&cycle->mutex);
+	yield_cnt = cycle->yield_cnt;
+	cycle->state_busy = false;
+	cycle->yield_wait_cnt++;
+	_cycle_start_tests(cycle);
+	while ((yield_cnt == cycle->yield_cnt) &&
+	       (cycle->yield_req || cycle->state_busy || cycle->test_cnt ||
+		cycle->locks_shared || cycle->lock_req || cycle->wait_cnt ||
+		(cycle->yield_wait_cnt < cycle->active_cnt)))
+		slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	if (yield_cnt == cycle->yield_cnt) {
+		cycle->yield_req = true;
+		slurm_cond_broadcast(&cycle->cond);
+		while (cycle->yield_req)
+			slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	}
+	rc = cycle->yield_rc;
+	cycle->yield_wait_cnt--;
+	while (cycle->state_busy || cycle->test_cnt || cycle->locks_shared ||
+	       cycle->lock_req)
+		slurm_cond_wait(&cycle->cond, &cycle->mutex);
+	cycle->state_busy = true;
+	slurm_mutex_unlock(&cycle->mutex);
+
+	return rc;
+}
+
+static void *_test_jobs_thread(void *arg)
+{
+	/* Held by the backfill thread, which waits for this one */
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+
+	lock_slurmctld_delegate(all_locks);
+	_test_jobs((bf_cycle_t *) arg);
+	unlock_slurmctld_delegate(all_locks);
+
+	return NULL;
+}
+
+/*
+ * Run _test_jobs() in threads. Switch locks for their tests and yield locks
+ * whenever they ask.
+ */
+static void _run_test_threads(bf_cycle_t *cycle)
+{
+	pthread_t *thread_ids;
+	bool shared;
+	int i, rc;
+
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill: testing %d job queues with %d threads",
+		     cycle->queue_cnt, cycle->thread_cnt);
+
+	slurm_mutex_init(&cycle->mutex);
+	slurm_cond_init(&cycle->cond, NULL);
+	cycle->active_cnt = cycle->thread_cnt;
+	thread_ids = xcalloc(cycle->thread_cnt, sizeof(pthread_t));
+	for (i = 0; i < cycle->thread_cnt; i++)
+		slurm_thread_create(&thread_ids[i], _test_jobs_thread, cycle);
+
+	slurm_mutex_lock(&cycle->mutex);
+	while (cycle->active_cnt) {
+		if (cycle->lock_req) {
+			shared = !cycle->locks_shared;
+			slurm_mutex_unlock(&cycle->mutex);
+			_share_locks(cycle, shared);
+			slurm_mutex_lock(&cycle->mutex);
+			cycle->locks_shared = shared;
+			cycle->lock_req = false;
+			if (shared) {
+				cycle->test_cnt = cycle->wait_cnt;
+				cycle->wait_cnt = 0;
+				cycle->test_round++;
+			}
+			slurm_cond_broadcast(&cycle->cond);
+		} else if (cycle->yield_req) {
+			slurm_mutex_unlock(&cycle->mutex);
+			rc = _yield_locks(yield_sleep);
+			slurm_mutex_lock(&cycle->mutex);
+			cycle->yield_rc = rc;
+			cycle->yield_cnt++;
+			cycle->yield_req = false;
+			slurm_cond_broadcast(&cycle->cond);
+		} else {
+			slurm_cond_wait(&cycle->cond, &cycle->mutex);
+		}
+	}
+	slurm_mutex_unlock(&cycle->mutex);
+
+	for (i = 0; i < cycle->thread_cnt; i++)
+		pthread_join(thread_ids[i], NULL);
+	xfree(thread_ids);
+	slurm_mutex_destroy(&cycle->mutex);
+	slurm_cond_destroy(&cycle->cond);
+}
+
+/* Keep a change the select plugin made to a tested job's copy */
+#define MERGE_TEST_VALUE(cur, test, orig)				\
+	do {								\
+		if (((test) != (orig)) && ((cur) == (orig)))		\
+			(cur) = (test);					\
+	} while (0)
+
+/*
+ * Record that jobs with key *equiv_key can not start now (or at all within the
+ * backfill window if window_tested), the key is moved into the table
+ */
+static void _equiv_add(xhash_t *equiv_table, char **equiv_key,
+		       time_t start_time, bool window_tested)
+{
+	job_equiv_t *equiv;
+
+	if (!*equiv_key)
+		return;
+	if ((equiv = job_equiv_add(equiv_table, *equiv_key))) {
+		equiv->start_time = start_time;
+		equiv->window_tested = window_tested;
+	}
+	*equiv_key = NULL;
+}
+
+/* Start recording the reservations made by a cycle */
+static bf_plan_t *_plan_create(bitstr_t *avail_bitmap, time_t sched_start)
+{
+	bf_plan_t *plan = xmalloc(sizeof(bf_plan_t));
+
+	plan->avail_bitmap = bit_copy(avail_bitmap);
+	plan->config_update = slurmctld_conf.last_update;
+	plan->part_update = last_part_update;
+	plan->resv_update = last_resv_update;
+	plan->sched_start = sched_start;
+
+	return plan;
+}
+
+static void _plan_free(bf_plan_t *plan)
+{
+	int i;
+
+	if (!plan)
+		return;
+	for (i = 0; i < plan->rec_cnt; i++)
+		FREE_NULL_BITMAP(plan->recs[i].node_bitmap);
+	xfree(plan->recs);
+	xhash_free(plan->rec_table);
+	FREE_NULL_BITMAP(plan->avail_bitmap);
+	xfree(plan);
+}
+
+static uint64_t _plan_job_key(struct job_record *job_ptr)
+{
+	return ((uint64_t) job_ptr->job_id << 32) | job_ptr->array_task_id;
+}
+
+static void _plan_rec_key(void *item, const char **key, uint32_t *key_len)
+{
+	bf_plan_rec_t *rec = item;
+
+	*key = (const char *) &rec->job_key;
+	*key_len = sizeof(rec->job_key);
+}
+
+/* Return the reservation period of a plan record, rounded as in node_space */
+static void _plan_rec_period(bf_plan_rec_t *rec, uint32_t *start_time,
+			     uint32_t *end_reserve)
+{
+	*end_reserve = rec->start_time + (rec->time_limit * 60);
+	*start_time  = (rec->start_time / backfill_resolution) *
+		       backfill_resolution;
+	*end_reserve = (*end_reserve / backfill_resolution) *
+		       backfill_resolution;
+}
+
+/* Mark the reservations of the last cycle the job's nodes could serve */
+static void _plan_invalidate_parts(bitstr_t *node_bitmap)
+{
+	bf_plan_rec_t *rec;
+	int i;
+
+	for (i = 0, rec = last_plan->recs; i < last_plan->rec_cnt; i++, rec++) {
+		if (rec->valid && rec->part_ptr->node_bitmap &&
+		    bit_overlap(node_bitmap, rec->part_ptr->node_bitmap))
+			rec->valid = false;
+	}
+}
+
+/*
+ * Decide which reservations of the last cycle the new one may reuse.
+ * The whole plan is dropped if the configuration, partitions, advance
+ * reservations or available nodes changed. Resources released earlier than
+ * planned (a job ended before its time limit or was suspended) invalidate
+ * the reservations of every partition sharing the job's nodes, as those jobs
+ * might now start earlier. Jobs started since only invalidate the
+ * reservations they overlap.
+ * IN avail_bitmap - nodes available to the new cycle
+ */
+static void _plan_validate(bitstr_t *avail_bitmap)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	bf_plan_rec_t *rec;
+	time_t plan_end;
+	int i;
+
+	if (!last_plan)
+		return;
+	if (!bf_plan_age ||
+	    (last_plan->config_update != slurmctld_conf.last_update) ||
+	    (last_plan->part_update != last_part_update) ||
+	    (last_plan->resv_update != last_resv_update) ||
+	    !bit_equal(last_plan->avail_bitmap, avail_bitmap)) {
+		if (debug_flags & DEBUG_FLAG_BACKFILL)
+			info("backfill: state changed, not reusing %d reservations of last cycle",
+			     last_plan->rec_cnt);
+		_plan_free(last_plan);
+		last_plan = NULL;
+		return;
+	}
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = list_next(job_iterator))) {
+		if (IS_JOB_PENDING(job_ptr) || !job_ptr->job_resrcs ||
+		    !job_ptr->job_resrcs->node_bitmap)
+			continue;
+		if (IS_JOB_SUSPENDED(job_ptr)) {
+			if (job_ptr->suspend_time >= last_plan->sched_start)
+				_plan_invalidate_parts(
+					job_ptr->job_resrcs->node_bitmap);
+			continue;
+		}
+		if (!IS_JOB_RUNNING(job_ptr)) {
+			if (job_ptr->end_time < last_plan->sched_start)
+				continue;
+			if ((job_ptr->time_limit != NO_VAL) &&
+			    (job_ptr->time_limit != INFINITE)) {
+				plan_end = job_ptr->start_time +
+					   (job_ptr->time_limit * 60);
+				if ((job_ptr->end_time + backfill_resolution) >=
+				    plan_end)
+					continue;	/* Ended as planned */
+			}
+			_plan_invalidate_parts(job_ptr->job_resrcs->node_bitmap);
+			continue;
+		}
+		if ((job_ptr->start_time < last_plan->sched_start) ||
+		    !job_ptr->node_bitmap)
+			continue;
+		for (i = 0, rec = last_plan->recs; i < last_plan->rec_cnt;
+		     i++, rec++) {
+			if (rec->valid &&
+			    (job_ptr->end_time > rec->start_time) &&
+			    bit_overlap(job_ptr->node_bitmap,
+					rec->node_bitmap))
+				rec->valid = false;
+		}
+	}
+	list_iterator_destroy(job_iterator);
+}
+
+/*
+ * Return the last cycle's reservation for a job in a partition, or NULL.
+ * Reservations the last cycle made before it which this cycle has not made
+ * again by now are skipped, and their nodes noted as freed.
+ */
+static bf_plan_rec_t *_plan_find(bf_cycle_t *cycle,
+				 struct job_record *job_ptr,
+				 struct part_record *part_ptr)
+{
+	bf_plan_rec_t *rec;
+	uint64_t job_key;
+	int i, rec_inx;
+
+	if (!last_plan->rec_table) {
+		last_plan->rec_table = xhash_init(_plan_rec_key, NULL);
+		for (i = 0; i < last_plan->rec_cnt; i++)
+			xhash_add(last_plan->rec_table, &last_plan->recs[i]);
+	}
+
+	job_key = _plan_job_key(job_ptr);
+	rec = xhash_get(last_plan->rec_table, (char *) &job_key,
+			sizeof(job_key));
+	if (!rec || (rec->part_ptr != part_ptr))
+		return NULL;
+	rec_inx = rec - last_plan->recs;
+	if (rec_inx < cycle->plan_next)
+		return NULL;	/* Reservation already skipped */
+	for ( ; cycle->plan_next < rec_inx; cycle->plan_next++) {
+		bit_or(cycle->plan_freed,
+		       last_plan->recs[cycle->plan_next].node_bitmap);
+	}
+
+	return rec;
+}
+
+/*
+ * Return the reservation of the last cycle to reuse for a job about to be
+ * tested, or NULL to test it. A reservation is only reused if no nodes of
+ * the job's partition were freed by this cycle reserving them differently
+ * (or not yet) for higher priority jobs, no resources were allocated or
+ * released since this cycle began, it is still in the future and younger
+ * than bf_plan_age, and its nodes remain usable by the job.
+ */
+static bf_plan_rec_t *_plan_reuse(bf_cycle_t *cycle,
+				  struct job_record *job_ptr,
+				  struct part_record *part_ptr,
+				  uint32_t time_limit, uint32_t min_nodes,
+				  time_t now)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	bf_plan_rec_t *rec;
+	uint32_t start_time, end_reserve;
+
+	if (!last_plan || !cycle->plan || cycle->plan_broken ||
+	    job_ptr->pack_job_id)
+		return NULL;
+	if (last_node_update != cycle->node_update) {
+		cycle->plan_broken = true;
+		return NULL;
+	}
+	if (!(rec = _plan_find(cycle, job_ptr, part_ptr)))
+		return NULL;
+	if (!rec->valid || (rec->time_limit != time_limit) ||
+	    (rec->start_time <= now) ||
+	    (difftime(now, rec->plan_time) >= bf_plan_age) ||
+	    bit_overlap(cycle->plan_freed, part_ptr->node_bitmap))
+		return NULL;
+
+	if ((bit_set_count(rec->node_bitmap) < min_nodes) ||
+	    !bit_super_set(rec->node_bitmap, part_ptr->node_bitmap) ||
+	    !bit_super_set(rec->node_bitmap, up_node_bitmap) ||
+	    bit_overlap(rec->node_bitmap, bf_ignore_node_bitmap) ||
+	    (detail_ptr->exc_node_bitmap &&
+	     bit_overlap(rec->node_bitmap, detail_ptr->exc_node_bitmap)) ||
+	    (detail_ptr->req_node_bitmap &&
+	     !bit_super_set(detail_ptr->req_node_bitmap, rec->node_bitmap)))
+		return NULL;
+
+	_plan_rec_period(rec, &start_time, &end_reserve);
+	if (node_space_conflict(cycle->node_space, start_time, end_reserve, 0,
+				rec->node_bitmap))
+		return NULL;
+
+	return rec;
+}
+
+/*
+ * Add a reservation made by this cycle to its plan. If the last cycle
+ * reserved other nodes or times for the job, note its nodes as freed.
+ * IN node_bitmap - nodes reserved
+ * IN plan_time - when the job was tested
+ * IN valid - reservation may be reused by the next cycle
+ */
+static void _plan_record(bf_cycle_t *cycle, struct job_record *job_ptr,
+			 struct part_record *part_ptr, uint32_t time_limit,
+			 bitstr_t *node_bitmap, time_t plan_time, bool valid)
+{
+	bf_plan_t *plan = cycle->plan;
+	bf_plan_rec_t *rec;
+
+	if (!plan)
+		return;
+
+	if (last_plan && (rec = _plan_find(cycle, job_ptr, part_ptr))) {
+		if ((rec->start_time != job_ptr->start_time) ||
+		    (rec->time_limit != time_limit) ||
+		    !bit_equal(rec->node_bitmap, node_bitmap))
+			bit_or(cycle->plan_freed, rec->node_bitmap);
+		cycle->plan_next++;
+	}
+
+	if (plan->rec_cnt >= plan->rec_size) {
+		plan->rec_size = MAX(plan->rec_size * 2, 64);
+		xrealloc(plan->recs, sizeof(bf_plan_rec_t) * plan->rec_size);
+	}
+	rec = &plan->recs[plan->rec_cnt++];
+	rec->array_task_id = job_ptr->array_task_id;
+	rec->job_id = job_ptr->job_id;
+	rec->job_key = _plan_job_key(job_ptr);
+	rec->node_bitmap = bit_copy(node_bitmap);
+	rec->part_ptr = part_ptr;
+	rec->plan_time = plan_time;
+	rec->start_time = job_ptr->start_time;
+	rec->time_limit = time_limit;
+	rec->valid = valid;
+}
+
+/*
+ * Test a job for backfill scheduling with _try_sched() under read locks, so
+ * that RPCs only reading state need not wait for the test. The select plugin
+ * tests a copy of the job record, which shares the job's other data except
+ * for its GRES list (the plugin sets GPU defaults and scheduling counts in
+ * it), and the results are merged into the job once the cycle's locks are
+ * held again. The job keeps its original time limit while other threads can
+ * update it.
+ * IN orig_time_limit - time limit to restore, job_ptr->time_limit is tested
+ * IN bit_flags - TEST_NOW_ONLY or 0
+ * IN exclusive - test with whole nodes only
+ * OUT changed - set if the cycle stopped or the job was updated meanwhile
+ *	(started, held, cancelled or moved to another partition), in which
+ *	case the test result must not be used
+ * Other arguments and RET as _try_sched()
+ */
+static int _test_job(bf_cycle_t *cycle, struct job_record *job_ptr,
+		     uint32_t orig_time_limit, uint32_t bit_flags,
+		     bool exclusive, bitstr_t **avail_bitmap,
+		     uint32_t min_nodes, uint32_t max_nodes,
+		     uint32_t req_nodes, bitstr_t *exc_core_bitmap,
+		     bool *changed)
+{
+	struct job_record test_job, orig_job;
+	struct job_details test_details, orig_details, *detail_ptr;
+	uint32_t time_limit = job_ptr->time_limit;
+	int rc;
+
+	job_ptr->time_limit = orig_time_limit;
+	_cycle_test_begin(cycle);
+	if (cycle->stop) {
+		_cycle_test_end(cycle);
+		*changed = true;
+		return ESLURM_NODES_BUSY;
+	}
+
+	detail_ptr = job_ptr->details;
+	test_job = *job_ptr;
+	test_details = *detail_ptr;
+	test_job.details = &test_details;
+	test_job.job_resrcs = NULL;
+	test_job.gres_list = gres_plugin_job_state_dup(job_ptr->gres_list);
+	test_job.time_limit = time_limit;
+	test_job.bit_flags |= (BACKFILL_TEST | bit_flags);
+	if (exclusive) {
+		test_details.share_res = 0;
+		test_details.whole_node = 1;
+	}
+	orig_job = test_job;
+	orig_details = test_details;
+	rc = _try_sched(&test_job, avail_bitmap, min_nodes, max_nodes,
+			req_nodes, exc_core_bitmap);
+	_cycle_test_end(cycle);
+
+	free_job_resources(&test_job.job_resrcs);
+	FREE_NULL_LIST(test_job.gres_list);
+	/* Writers ran while the locks were traded */
+	if (cycle->stop || (job_ptr->time_limit != orig_time_limit) ||
+	    (job_ptr->details != detail_ptr) || !IS_JOB_PENDING(job_ptr) ||
+	    !_job_runnable_now(job_ptr) ||
+	    (job_ptr->part_ptr != orig_job.part_ptr)) {
+		if (test_details.mc_ptr != orig_details.mc_ptr)
+			xfree(test_details.mc_ptr);
+		*changed = true;
+		return rc;
+	}
+
+	job_ptr->time_limit = time_limit;
+	job_ptr->start_time = test_job.start_time;
+	MERGE_TEST_VALUE(job_ptr->req_switch, test_job.req_switch,
+			 orig_job.req_switch);
+	MERGE_TEST_VALUE(job_ptr->total_cpus, test_job.total_cpus,
+			 orig_job.total_cpus);
+	MERGE_TEST_VALUE(detail_ptr->core_spec, test_details.core_spec,
+			 orig_details.core_spec);
+	MERGE_TEST_VALUE(detail_ptr->min_cpus, test_details.min_cpus,
+			 orig_details.min_cpus);
+	MERGE_TEST_VALUE(detail_ptr->min_gres_cpu, test_details.min_gres_cpu,
+			 orig_details.min_gres_cpu);
+	MERGE_TEST_VALUE(detail_ptr->pn_min_memory, test_details.pn_min_memory,
+			 orig_details.pn_min_memory);
+	if (!exclusive)
+		MERGE_TEST_VALUE(detail_ptr->whole_node,
+				 test_details.whole_node,
+				 orig_details.whole_node);
+	if (test_details.mc_ptr != orig_details.mc_ptr) {
+		/* Default multi-core data added by the select plugin */
+		if (!detail_ptr->mc_ptr)
+			detail_ptr->mc_ptr = test_details.mc_ptr;
+		else
+			xfree(test_details.mc_ptr);
+	}
+
+	return rc;
+}
+
 static int _attempt_backfill(void)
 {
 	DEF_TIMERS;
 	List job_queue;
-	job_queue_rec_t *job_queue_rec;
-	int bb, i, j, node_space_recs, mcs_select = 0;
-	slurmdb_qos_rec_t *qos_ptr = NULL;
-	struct job_record *job_ptr;
-	struct part_record *part_ptr;
-	uint32_t end_time, end_reserve, deadline_time_limit, boot_time;
-	uint32_t orig_end_time;
-	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
-	uint32_t min_nodes, max_nodes, req_nodes;
-	bitstr_t *active_bitmap = NULL, *avail_bitmap = NULL;
-	bitstr_t *exc_core_bitmap = NULL, *resv_bitmap = NULL;
-	time_t now, sched_start, later_start, start_res, resv_end, window_end;
-	time_t pack_time, orig_sched_start, orig_start_time = (time_t) 0;
-	node_space_map_t *node_space;
+	bf_cycle_t cycle;
+	bitstr_t *avail_bitmap;
 	struct timeval bf_time1, bf_time2;
-	int rc = 0, error_code;
-	int job_test_count = 0, test_time_count = 0, pend_time;
-	bool already_counted, many_rpcs = false;
-	uint32_t reject_array_job_id = 0;
-	struct part_record *reject_array_part = NULL;
-	uint32_t start_time;
-	time_t config_update = slurmctld_conf.last_update;
-	time_t part_update = last_part_update;
-	struct timeval start_tv;
-	uint32_t test_array_job_id = 0;
-	uint32_t test_array_count = 0;
-	uint32_t job_no_reserve;
-	bool is_job_array_head, resv_overlap = false;
-	uint8_t save_share_res = 0, save_whole_node = 0;
-	int test_fini;
-	uint32_t qos_flags = 0;
-	time_t qos_blocked_until = 0, qos_part_blocked_until = 0;
-	time_t tmp_preempt_start_time = 0;
-	bool tmp_preempt_in_progress = false;
+	int i, job_test_count;
 	/* QOS Read lock */
 	assoc_mgr_lock_t qos_read_lock =
 		{ NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
@@ -1525,6 +2441,9 @@ static int _attempt_backfill(void)
 
 	bf_sleep_usec = 0;
 	job_start_cnt = 0;
+	memset(&cycle, 0, sizeof(cycle));
+	cycle.config_update = slurmctld_conf.last_update;
+	cycle.part_update = last_part_update;
 
 	if (!fed_mgr_sibs_synced()) {
 		info("backfill: %s returning, federation siblings not synced yet",
@@ -1539,8 +2458,8 @@ static int _attempt_backfill(void)
 		info("backfill: beginning");
 	else
 		debug("backfill: beginning");
-	sched_start = orig_sched_start = now = time(NULL);
-	gettimeofday(&start_tv, NULL);
+	cycle.sched_start = cycle.orig_sched_start = time(NULL);
+	gettimeofday(&cycle.start_tv, NULL);
 
 	job_queue = build_job_queue(true, true);
 	job_test_count = list_count(job_queue);
@@ -1569,22 +2488,23 @@ static int _attempt_backfill(void)
 						 bf_queue_len;
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
-	slurmctld_diag_stats.bf_when_last_cycle = now;
+	slurmctld_diag_stats.bf_when_last_cycle = cycle.sched_start;
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
-	node_space[0].begin_time = sched_start;
-	window_end = sched_start + backfill_window;
-	node_space[0].end_time = window_end;
-
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
+	cycle.window_end = cycle.sched_start + backfill_window;
+	avail_bitmap = bit_copy(avail_node_bitmap);
 	/* Make "resuming" nodes available to be scheduled in backfill */
-	bit_or(node_space[0].avail_bitmap, rs_node_bitmap);
-
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	bit_or(avail_bitmap, rs_node_bitmap);
+	cycle.node_space = node_space_create(cycle.sched_start,
+					     cycle.window_end, avail_bitmap);
+	cycle.node_update = last_node_update;
+	_plan_validate(avail_bitmap);
+	if (bf_plan_age && (bf_threads <= 1))
+		cycle.plan = _plan_create(avail_bitmap, cycle.sched_start);
+	if (cycle.plan && last_plan)
+		cycle.plan_freed = bit_alloc(bit_size(avail_bitmap));
+	FREE_NULL_BITMAP(avail_bitmap);
 	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
-		_dump_node_space_table(node_space);
+		_dump_node_space_table(cycle.node_space);
 
 	if (assoc_limit_stop) {
 		assoc_mgr_lock(&qos_read_lock);
@@ -1598,15 +2518,114 @@ static int _attempt_backfill(void)
 	/* Ignore nodes that have been set as available during this cycle. */
 	bit_clear_all(bf_ignore_node_bitmap);
 
+	cycle.job_queues = _split_job_queue(job_queue, &cycle.queue_cnt);
+	cycle.thread_cnt = MIN(bf_threads, cycle.queue_cnt);
+	if (cycle.thread_cnt > 1)
+		_run_test_threads(&cycle);
+	else
+		_test_jobs(&cycle);
+
+	_job_pack_deadlock_fini();
+	if (!bf_hetjob_immediate &&
+	    (!max_backfill_jobs_start ||
+	     (job_start_cnt < max_backfill_jobs_start)))
+		_pack_start_test(cycle.node_space, 0);
+
+	node_space_destroy(cycle.node_space);
+	for (i = 0; i < cycle.queue_cnt; i++)
+		FREE_NULL_LIST(cycle.job_queues[i]);
+	xfree(cycle.job_queues);
+
+	if (cycle.plan && (debug_flags & DEBUG_FLAG_BACKFILL)) {
+		info("backfill: reused %d of %d reservations planned by last cycle",
+		     cycle.plan_reused, last_plan ? last_plan->rec_cnt : 0);
+	}
+	_plan_free(last_plan);
+	last_plan = cycle.plan;
+	FREE_NULL_BITMAP(cycle.plan_freed);
+
+	gettimeofday(&bf_time2, NULL);
+	_do_diag_stats(&bf_time1, &bf_time2);
+	if (debug_flags & DEBUG_FLAG_BACKFILL) {
+		END_TIMER;
+		info("backfill: completed testing %u(%d) jobs, %s",
+		     slurmctld_diag_stats.bf_last_depth,
+		     cycle.job_test_count, TIME_STR);
+	}
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	if (slurmctld_config.server_thread_count >= 150) {
+		info("backfill: %d pending RPCs at cycle end, consider "
+		     "configuring max_rpc_cnt",
+		     slurmctld_config.server_thread_count);
+	}
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	return cycle.rc;
+}
+
+/* Test the jobs in the cycle's job queues for backfill scheduling */
+static void _test_jobs(bf_cycle_t *cycle)
+{
+	DEF_TIMERS;
+	List job_queue = NULL;
+	job_queue_rec_t *job_queue_rec;
+	int bb, j, mcs_select = 0;
+	slurmdb_qos_rec_t *qos_ptr = NULL;
+	struct job_record *job_ptr = NULL;
+	struct part_record *part_ptr;
+	uint32_t end_time, end_reserve, deadline_time_limit, boot_time;
+	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
+	uint32_t min_nodes, max_nodes, req_nodes;
+	bitstr_t *active_bitmap = NULL, *avail_bitmap = NULL;
+	bitstr_t *exc_core_bitmap = NULL, *resv_bitmap = NULL;
+	time_t now, later_start, start_res, resv_end;
+	time_t pack_time, orig_start_time = (time_t) 0;
+	int error_code, pend_time;
+	bool already_counted, many_rpcs = false;
+	uint32_t reject_array_job_id = 0;
+	struct part_record *reject_array_part = NULL;
+	uint32_t start_time;
+	uint32_t test_array_job_id = 0;
+	uint32_t test_array_count = 0;
+	uint32_t job_no_reserve;
+	bool is_job_array_head, resv_overlap = false;
+	int test_fini;
+	uint32_t qos_flags = 0;
+	time_t qos_blocked_until = 0, qos_part_blocked_until = 0;
+	time_t tmp_preempt_start_time = 0;
+	bool tmp_preempt_in_progress = false;
+	bool changed, queue_end = false;
+	bf_plan_rec_t *plan_rec;
+	time_t plan_time;
+	xhash_t *equiv_table = NULL;	/* jobs known not to start */
+	job_equiv_t *equiv;
+	char *equiv_key = NULL;
+	uint32_t equiv_changes = 0;	/* cycle->state_changes for table */
+	/* QOS Read lock */
+	assoc_mgr_lock_t qos_read_lock =
+		{ NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK,
+		  NO_LOCK, NO_LOCK, NO_LOCK };
+
+	_cycle_enter(cycle);
+	START_TIMER;
+	now = time(NULL);
+
 	while (1) {
 		uint32_t bf_array_task_id, bf_job_priority,
 			prio_reserve;
 		bool get_boot_time = false;
 
-		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
+		job_queue_rec = NULL;
+		while (!job_queue || !(job_queue_rec = list_pop(job_queue))) {
+			if (cycle->next_queue >= cycle->queue_cnt)
+				break;
+			job_queue = cycle->job_queues[cycle->next_queue++];
+		}
 		if (!job_queue_rec) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				info("backfill: reached end of job queue");
+			queue_end = true;
 			break;
 		}
 
@@ -1616,8 +2635,9 @@ static int _attempt_backfill(void)
 		bf_array_task_id = job_queue_rec->array_task_id;
 		xfree(job_queue_rec);
 
-		if (slurmctld_config.shutdown_time ||
-		    (difftime(time(NULL),orig_sched_start) >= bf_max_time)){
+		if (cycle->stop || slurmctld_config.shutdown_time ||
+		    (difftime(time(NULL), cycle->orig_sched_start) >=
+		     bf_max_time)) {
 			break;
 		}
 
@@ -1628,35 +2648,40 @@ static int _attempt_backfill(void)
 			many_rpcs = true;
 		slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
 
-		if (many_rpcs || (slurm_delta_tv(&start_tv) >= yield_interval)) {
+		if (many_rpcs ||
+		    (slurm_delta_tv(&cycle->start_tv) >= yield_interval)) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				END_TIMER;
 				info("backfill: yielding locks after testing "
 				     "%u(%d) jobs, %s",
 				     slurmctld_diag_stats.bf_last_depth,
-				     job_test_count, TIME_STR);
+				     cycle->job_test_count, TIME_STR);
 			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
+			if ((_cycle_yield_locks(cycle) && !backfill_continue) ||
+			    (slurmctld_conf.last_update !=
+			     cycle->config_update) ||
+			    (last_part_update != cycle->part_update)) {
 				if (debug_flags & DEBUG_FLAG_BACKFILL) {
 					info("backfill: system state changed, "
 					     "breaking out after testing "
 					     "%u(%d) jobs",
 					     slurmctld_diag_stats.bf_last_depth,
-					     job_test_count);
+					     cycle->job_test_count);
 				}
-				rc = 1;
+				cycle->rc = 1;
 				break;
 			}
 			if (stop_backfill)
 				break;
 			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			gettimeofday(&start_tv, NULL);
-			job_test_count = 0;
-			test_time_count = 0;
+			cycle->sched_start = time(NULL);
+			gettimeofday(&cycle->start_tv, NULL);
+			cycle->job_test_count = 0;
+			cycle->test_time_count = 0;
 			START_TIMER;
+			/* Jobs may have ended while locks were released */
+			if (equiv_table)
+				xhash_clear(equiv_table);
 		}
 
 		if ((job_ptr->array_task_id != bf_array_task_id) &&
@@ -1817,7 +2842,7 @@ static int _attempt_backfill(void)
 			if (_check_bf_usage(
 				    job_ptr->part_ptr->bf_data->resv_usage,
 				    bf_job_part_count_reserve,
-				    orig_sched_start))
+				    cycle->orig_sched_start))
 				job_no_reserve = TEST_NOW_ONLY;
 		}
 
@@ -1842,7 +2867,7 @@ next_task:
 		job_ptr->details->preempt_start_time = 0;
 		job_ptr->preempt_in_progress = false;
 
-		job_test_count++;
+		cycle->job_test_count++;
 		slurmctld_diag_stats.bf_last_depth++;
 		already_counted = false;
 
@@ -1878,7 +2903,7 @@ next_task:
 		}
 
 		/* Test to see if we've exceeded any per user/partition limit */
-		if (_job_exceeds_max_bf_param(job_ptr, orig_sched_start))
+		if (_job_exceeds_max_bf_param(job_ptr, cycle->orig_sched_start))
 			continue;
 
 		if (((part_ptr->state_up & PARTITION_SCHED) == 0) ||
@@ -1955,6 +2980,38 @@ next_task:
 		else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
 			time_limit = job_ptr->time_limit = job_ptr->time_min;
 
+		/*
+		 * Nodes are only reserved for more jobs as the cycle goes on,
+		 * so a job identical to one found unable to start now (or
+		 * within the window) can not start either
+		 */
+		if (equiv_table && (equiv_changes != cycle->state_changes)) {
+			/* Jobs may have ended while locks were shared */
+			xhash_clear(equiv_table);
+		}
+		equiv_changes = cycle->state_changes;
+		xfree(equiv_key);
+		if ((equiv_key = job_equiv_key(job_ptr))) {
+			slurmctld_diag_stats.bf_equiv_lookups++;
+			if (!equiv_table)
+				equiv_table = job_equiv_create();
+		}
+		equiv = job_equiv_find(equiv_table, equiv_key);
+		if (equiv && (equiv->window_tested || job_no_reserve)) {
+			slurmctld_diag_stats.bf_equiv_hits++;
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				info("backfill: %pJ equivalent to a job which can not start",
+				     job_ptr);
+			_set_job_time_limit(job_ptr, orig_time_limit);
+			if (orig_start_time &&
+			    (!equiv->start_time ||
+			     (orig_start_time < equiv->start_time)))
+				job_ptr->start_time = orig_start_time;
+			else
+				job_ptr->start_time = equiv->start_time;
+			continue;
+		}
+
 		later_start = now;
 
 		if (assoc_limit_stop) {
@@ -1972,14 +3029,32 @@ next_task:
 			}
 		}
 
+		/* Keep the reservation made by the last cycle if still valid */
+		if (!job_no_reserve &&
+		    (plan_rec = _plan_reuse(cycle, job_ptr, part_ptr,
+					    time_limit, min_nodes, now))) {
+			FREE_NULL_BITMAP(avail_bitmap);
+			avail_bitmap = bit_copy(plan_rec->node_bitmap);
+			job_ptr->start_time = plan_rec->start_time;
+			plan_time = plan_rec->plan_time;
+			boot_time = 0;
+			later_start = 0;
+			cycle->plan_reused++;
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				info("backfill: %pJ keeps reservation of last cycle",
+				     job_ptr);
+			goto RESERVE;
+		}
+		plan_time = now;
+
  TRY_LATER:
-		if (slurmctld_config.shutdown_time ||
-		    (difftime(time(NULL), orig_sched_start) >=
+		if (cycle->stop || slurmctld_config.shutdown_time ||
+		    (difftime(time(NULL), cycle->orig_sched_start) >=
 		     bf_max_time)) {
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			break;
 		}
-		test_time_count++;
+		cycle->test_time_count++;
 
 		many_rpcs = false;
 		slurm_mutex_lock(&slurmctld_config.thread_count_lock);
@@ -1988,7 +3063,8 @@ next_task:
 			many_rpcs = true;
 		slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
 
-		if (many_rpcs || (slurm_delta_tv(&start_tv) >= yield_interval)) {
+		if (many_rpcs ||
+		    (slurm_delta_tv(&cycle->start_tv) >= yield_interval)) {
 			uint32_t save_time_limit = job_ptr->time_limit;
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
@@ -1996,30 +3072,34 @@ next_task:
 				info("backfill: yielding locks after testing "
 				     "%u(%d) jobs tested, %u time slots, %s",
 				     slurmctld_diag_stats.bf_last_depth,
-				     job_test_count, test_time_count, TIME_STR);
+				     cycle->job_test_count, cycle->test_time_count,
+				     TIME_STR);
 			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
+			if ((_cycle_yield_locks(cycle) && !backfill_continue) ||
+			    (slurmctld_conf.last_update !=
+			     cycle->config_update) ||
+			    (last_part_update != cycle->part_update)) {
 				if (debug_flags & DEBUG_FLAG_BACKFILL) {
 					info("backfill: system state changed, "
 					     "breaking out after testing "
 					     "%u(%d) jobs",
 					     slurmctld_diag_stats.bf_last_depth,
-					     job_test_count);
+					     cycle->job_test_count);
 				}
-				rc = 1;
+				cycle->rc = 1;
 				break;
 			}
 			if (stop_backfill)
 				break;
 
 			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			gettimeofday(&start_tv, NULL);
-			job_test_count = 1;
-			test_time_count = 0;
+			cycle->sched_start = time(NULL);
+			gettimeofday(&cycle->start_tv, NULL);
+			cycle->job_test_count = 1;
+			cycle->test_time_count = 0;
 			START_TIMER;
+			if (equiv_table)
+				xhash_clear(equiv_table);
 
 			/*
 			 * With bf_continue configured, the original job could
@@ -2068,21 +3148,9 @@ next_task:
 		bit_and_not(avail_bitmap, bf_ignore_node_bitmap);
 		filter_by_node_owner(job_ptr, avail_bitmap);
 		filter_by_node_mcs(job_ptr, mcs_select, avail_bitmap);
-		for (j = 0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
-				break;
-		}
-		if (resv_end && (++resv_end < window_end) &&
+		later_start = node_space_and_avail(cycle->node_space, start_res,
+						   end_time, avail_bitmap);
+		if (resv_end && (++resv_end < cycle->window_end) &&
 		    ((later_start == 0) || (resv_end < later_start))) {
 			later_start = resv_end;
 		}
@@ -2108,6 +3176,8 @@ next_task:
 			}
 
 			/* Job can not start until too far in the future */
+			_equiv_add(equiv_table, &equiv_key, 0,
+				   !job_no_reserve);
 			_set_job_time_limit(job_ptr, orig_time_limit);
 			job_ptr->start_time = 0;
 			if ((orig_start_time != 0) &&
@@ -2136,12 +3206,18 @@ next_task:
 		test_fini = -1;
 		build_active_feature_bitmap(job_ptr, avail_bitmap,
 					    &active_bitmap);
-		job_ptr->bit_flags |= BACKFILL_TEST;
-		job_ptr->bit_flags |= job_no_reserve;	/* 0 or TEST_NOW_ONLY */
 
+		changed = false;
 		if (active_bitmap) {
-			j = _try_sched(job_ptr, &active_bitmap, min_nodes,
-				       max_nodes, req_nodes, exc_core_bitmap);
+			j = _test_job(cycle, job_ptr, orig_time_limit,
+				      job_no_reserve, false, &active_bitmap,
+				      min_nodes, max_nodes, req_nodes,
+				      exc_core_bitmap, &changed);
+			if (changed) {
+				/* Job updated while locks were shared */
+				FREE_NULL_BITMAP(active_bitmap);
+				continue;
+			}
 			if (j == SLURM_SUCCESS) {
 				FREE_NULL_BITMAP(avail_bitmap);
 				avail_bitmap = active_bitmap;
@@ -2151,10 +3227,6 @@ next_task:
 				if (node_features_g_overlap(active_bitmap))
 					get_boot_time = true;
 				FREE_NULL_BITMAP(active_bitmap);
-				save_share_res  = job_ptr->details->share_res;
-				save_whole_node = job_ptr->details->whole_node;
-				job_ptr->details->share_res = 0;
-				job_ptr->details->whole_node = 1;
 				test_fini = 0;
 			}
 		}
@@ -2174,7 +3246,7 @@ next_task:
 					  &resv_overlap, true);
 			if (resv_overlap)
 				resv_end = find_resv_end(start_res);
-			if (resv_end && (++resv_end < window_end) &&
+			if (resv_end && (++resv_end < cycle->window_end) &&
 			    ((later_start == 0) || (resv_end < later_start))) {
 				later_start = resv_end;
 			}
@@ -2186,35 +3258,34 @@ next_task:
 			}
 			if (get_boot_time)
 				boot_time = node_features_g_boot_time();
-			orig_end_time = end_time;
 			end_time += boot_time;
 
-			for (j = 0; ; ) {
-				if (node_space[j].end_time <= start_res)
-					;
-				else if (node_space[j].begin_time <= end_time) {
-					if (node_space[j].begin_time >
-					    orig_end_time)
-						bit_and(avail_bitmap,
-						node_space[j].avail_bitmap);
-				} else
-					break;
-				if ((j = node_space[j].next) == 0)
-					break;
-			}
+			/*
+			 * Slots through the original end_time were already
+			 * applied to avail_bitmap, so this only adds those
+			 * during the node reboot.
+			 */
+			(void) node_space_and_avail(cycle->node_space,
+						    start_res, end_time,
+						    avail_bitmap);
 		}
 		if (test_fini != 1) {
 			/* Either active_bitmap was NULL or not usable by the
 			 * job. Test using avail_bitmap instead */
-			j = _try_sched(job_ptr, &avail_bitmap, min_nodes,
-				       max_nodes, req_nodes, exc_core_bitmap);
-			if (test_fini == 0) {
-				job_ptr->details->share_res = save_share_res;
-				job_ptr->details->whole_node = save_whole_node;
-			}
+			j = _test_job(cycle, job_ptr, orig_time_limit,
+				      job_no_reserve, (test_fini == 0),
+				      &avail_bitmap, min_nodes, max_nodes,
+				      req_nodes, exc_core_bitmap, &changed);
+			if (changed)	/* Job updated while locks were shared */
+				continue;
+		}
+
+		if (!_job_runnable_now(job_ptr) || !avail_front_end(job_ptr) ||
+		    !job_independent(job_ptr, 0)) {
+			/* Job state changed while locks were shared */
+			_set_job_time_limit(job_ptr, orig_time_limit);
+			continue;
 		}
-		job_ptr->bit_flags &= ~BACKFILL_TEST;
-		job_ptr->bit_flags &= ~TEST_NOW_ONLY;
 
 		now = time(NULL);
 		if (j != SLURM_SUCCESS) {
@@ -2223,6 +3294,8 @@ next_task:
 				job_ptr->start_time = 0;
 				goto TRY_LATER;
 			}
+			_equiv_add(equiv_table, &equiv_key, 0,
+				   !job_no_reserve);
 			if (orig_start_time != 0)  /* Can start in other part */
 				job_ptr->start_time = orig_start_time;
 			else
@@ -2349,8 +3422,9 @@ skip_start:
 				 * beforehand for _reset_job_time_limit.
 				 */
 				if (reset_time) {
-					_reset_job_time_limit(job_ptr, now,
-							      node_space);
+					_reset_job_time_limit(
+						job_ptr, now,
+						cycle->node_space);
 					time_limit = job_ptr->time_limit;
 				}
 			} else if (rc == SLURM_SUCCESS) {
@@ -2442,8 +3516,8 @@ skip_start:
 			}
 		} else if (job_ptr->pack_job_id != 0) {
 			uint32_t max_time_limit;
-			max_time_limit =_get_job_max_tl(job_ptr, now,
-						        node_space);
+			max_time_limit = _get_job_max_tl(job_ptr, now,
+							 cycle->node_space);
 			comp_time_limit = MIN(comp_time_limit, max_time_limit);
 			job_ptr->node_cnt_wag =
 					MAX(bit_set_count(avail_bitmap), 1);
@@ -2453,11 +3527,13 @@ skip_start:
 			if (bf_hetjob_immediate &&
 			    (!max_backfill_jobs_start ||
 			     (job_start_cnt < max_backfill_jobs_start)))
-				_pack_start_test(node_space,
+				_pack_start_test(cycle->node_space,
 						 job_ptr->pack_job_id);
 		}
 
 		if ((job_ptr->start_time > now) && (job_no_reserve != 0)) {
+			_equiv_add(equiv_table, &equiv_key,
+				   job_ptr->start_time, false);
 			if ((orig_start_time != 0) &&
 			    (orig_start_time < job_ptr->start_time)) {
 				/* Can start earlier in different partition */
@@ -2478,6 +3554,7 @@ skip_start:
 			goto TRY_LATER;
 		}
 
+ RESERVE:
 		start_time  = job_ptr->start_time;
 		end_reserve = job_ptr->start_time + boot_time +
 			      (time_limit * 60);
@@ -2486,11 +3563,14 @@ skip_start:
 		end_reserve = (end_reserve / backfill_resolution) *
 			      backfill_resolution;
 
-		if (job_ptr->start_time > (sched_start + backfill_window)) {
+		if (job_ptr->start_time >
+		    (cycle->sched_start + backfill_window)) {
 			/* Starts too far in the future to worry about */
 			if (debug_flags & DEBUG_FLAG_BACKFILL)
 				_dump_job_sched(job_ptr, end_reserve,
 						avail_bitmap);
+			_equiv_add(equiv_table, &equiv_key,
+				   job_ptr->start_time, true);
 			if ((orig_start_time != 0) &&
 			    (orig_start_time < job_ptr->start_time)) {
 				/* Can start earlier in different partition */
@@ -2500,7 +3580,8 @@ skip_start:
 			continue;
 		}
 
-		if (node_space_recs >= max_backfill_job_cnt) {
+		if (node_space_count(cycle->node_space) >=
+		    max_backfill_job_cnt) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
 				info("backfill: table size limit of %u reached",
 				     max_backfill_job_cnt);
@@ -2531,8 +3612,8 @@ skip_start:
 		if ((job_ptr->start_time > now) &&
 		    (job_ptr->state_reason != WAIT_BURST_BUFFER_RESOURCE) &&
 		    (job_ptr->state_reason != WAIT_BURST_BUFFER_STAGING) &&
-		    _test_resv_overlap(node_space, avail_bitmap,
-				       start_time, end_reserve)) {
+		    node_space_conflict(cycle->node_space, start_time,
+					end_reserve, 0, avail_bitmap)) {
 			/* This job overlaps with an existing reservation for
 			 * job to be backfill scheduled, which the sched
 			 * plugin does not know about. Try again later. */
@@ -2613,7 +3694,7 @@ skip_start:
 			if (_check_bf_usage(
 				    job_ptr->part_ptr->bf_data->resv_usage,
 				    bf_job_part_count_reserve,
-				    orig_sched_start)) {
+				    cycle->orig_sched_start)) {
 				_set_job_time_limit(job_ptr, orig_time_limit);
 				continue;
 			}
@@ -2624,11 +3705,13 @@ skip_start:
 		reject_array_part   = NULL;
 		xfree(job_ptr->sched_nodes);
 		job_ptr->sched_nodes = bitmap2node_name(avail_bitmap);
+		_plan_record(cycle, job_ptr, part_ptr, time_limit, avail_bitmap,
+			     plan_time, (boot_time == 0) && !job_ptr->pack_job_id);
 		bit_not(avail_bitmap);
-		_add_reservation(start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
+		node_space_reserve(cycle->node_space, start_time, end_reserve,
+				   avail_bitmap);
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
-			_dump_node_space_table(node_space);
+			_dump_node_space_table(cycle->node_space);
 		if ((orig_start_time != 0) &&
 		    (orig_start_time < job_ptr->start_time)) {
 			/* Can start earlier in different partition */
@@ -2658,46 +3741,20 @@ skip_start:
 		}
 	}
 
+
 	/* Restore preemption state if needed. */
 	_restore_preempt_state(job_ptr, &tmp_preempt_start_time,
 			       &tmp_preempt_in_progress);
 
-	_job_pack_deadlock_fini();
-	if (!bf_hetjob_immediate &&
-	    (!max_backfill_jobs_start ||
-	     (job_start_cnt < max_backfill_jobs_start)))
-		_pack_start_test(node_space, 0);
-
+	xfree(equiv_key);
+	xhash_free(equiv_table);
 	FREE_NULL_BITMAP(avail_bitmap);
 	FREE_NULL_BITMAP(exc_core_bitmap);
 	FREE_NULL_BITMAP(resv_bitmap);
 
-	for (i = 0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
-	FREE_NULL_LIST(job_queue);
-
-	gettimeofday(&bf_time2, NULL);
-	_do_diag_stats(&bf_time1, &bf_time2);
-	if (debug_flags & DEBUG_FLAG_BACKFILL) {
-		END_TIMER;
-		info("backfill: completed testing %u(%d) jobs, %s",
-		     slurmctld_diag_stats.bf_last_depth,
-		     job_test_count, TIME_STR);
-	}
-
-	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
-	if (slurmctld_config.server_thread_count >= 150) {
-		info("backfill: %d pending RPCs at cycle end, consider "
-		     "configuring max_rpc_cnt",
-		     slurmctld_config.server_thread_count);
-	}
-	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
-
-	return rc;
+	if (!queue_end)
+		cycle->stop = true;
+	_cycle_exit(cycle);
 }
 
 /* Try to start the job on any non-reserved nodes */
@@ -2780,26 +3837,15 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
 static uint32_t _get_job_max_tl(struct job_record *job_ptr, time_t now,
 				node_space_map_t *node_space)
 {
-	int32_t j;
-	time_t comp_time = 0;
+	time_t comp_time;
 	uint32_t max_tl = NO_VAL;
 
 	if (job_ptr->time_min == 0)
 		return max_tl;
 
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time != now) && // No current conflicts
-		    (node_space[j].begin_time < job_ptr->end_time) &&
-		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
-			/* Job overlaps pending job's resource reservation */
-			if ((comp_time == 0) ||
-			    (comp_time > node_space[j].begin_time))
-				comp_time = node_space[j].begin_time;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
+	/* First future overlap with a pending job's resource reservation */
+	comp_time = node_space_conflict(node_space, 0, job_ptr->end_time, now,
+					job_ptr->node_bitmap);
 
 	if (comp_time != 0)
 		max_tl = (comp_time - now + 59) / 60;
@@ -2816,23 +3862,19 @@ static uint32_t _get_job_max_tl(struct job_record *job_ptr, time_t now,
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space)
 {
-	int32_t j, resv_delay;
+	int32_t resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
 	uint32_t new_time_limit;
-
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time != now) && // No current conflicts
-		    (node_space[j].begin_time < job_ptr->end_time) &&
-		    (!bit_super_set(job_ptr->node_bitmap,
-				    node_space[j].avail_bitmap))) {
-			/* Job overlaps pending job's resource reservation */
-			resv_delay = difftime(node_space[j].begin_time, now);
-			resv_delay /= 60;	/* seconds to minutes */
-			if (resv_delay < job_ptr->time_limit)
-				job_ptr->time_limit = resv_delay;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
+	time_t resv_time;
+
+	/* First future overlap with a pending job's resource reservation */
+	resv_time = node_space_conflict(node_space, 0, job_ptr->end_time, now,
+					job_ptr->node_bitmap);
+	if (resv_time) {
+		resv_delay = difftime(resv_time, now);
+		resv_delay /= 60;	/* seconds to minutes */
+		if (resv_delay < job_ptr->time_limit)
+			job_ptr->time_limit = resv_delay;
 	}
 	new_time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	acct_policy_alter_job(job_ptr, new_time_limit);
@@ -2863,126 +3905,6 @@ static bool _more_work (time_t last_backfill_time)
 	return rc;
 }
 
-/* Create a reservation for a job in the future */
-static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
-			     bitstr_t *res_bitmap,
-			     node_space_map_t *node_space,
-			     int *node_space_recs)
-{
-	bool placed = false;
-	int i, j;
-
-#if 0	
-	info("add job start:%u end:%u", start_time, end_reserve);
-	for (j = 0; ; ) {
-		info("node start:%u end:%u",
-		     (uint32_t) node_space[j].begin_time,
-		     (uint32_t) node_space[j].end_time);
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-#endif
-
-	start_time = MAX(start_time, node_space[0].begin_time);
-	for (j = 0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			while ((j = node_space[j].next)) {
-				if (end_reserve < node_space[j].end_time) {
-					/* insert end entry record */
-					i = *node_space_recs;
-					node_space[i].begin_time = end_reserve;
-					node_space[i].end_time = node_space[j].
-								 end_time;
-					node_space[j].end_time = end_reserve;
-					node_space[i].avail_bitmap =
-						bit_copy(node_space[j].
-							 avail_bitmap);
-					node_space[i].next = node_space[j].next;
-					node_space[j].next = i;
-					(*node_space_recs)++;
-					break;
-				}
-				if (end_reserve == node_space[j].end_time) {
-					break;
-				}
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-
-	for (j = 0; ; ) {
-		if ((node_space[j].begin_time >= start_time) &&
-		    (node_space[j].end_time <= end_reserve))
-			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
-			break;
-	}
-
-	/* Drop records with identical bitmaps (up to one record).
-	 * This can significantly improve performance of the backfill tests. */
-	for (i = 0; ; ) {
-		if ((j = node_space[i].next) == 0)
-			break;
-		if (!bit_equal(node_space[i].avail_bitmap,
-			       node_space[j].avail_bitmap)) {
-			i = j;
-			continue;
-		}
-		node_space[i].end_time = node_space[j].end_time;
-		node_space[i].next = node_space[j].next;
-		FREE_NULL_BITMAP(node_space[j].avail_bitmap);
-		break;
-	}
-}
-
-/*
- * Determine if the resource specification for a new job overlaps with a
- *	reservation that the backfill scheduler has made for a job to be
- *	started in the future.
- * IN use_bitmap - nodes to be allocated
- * IN start_time - start time of job
- * IN end_reserve - end time of job
- */
-static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve)
-{
-	bool overlap = false;
-	int j;
-
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
-			overlap = true;
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
-	}
-	return overlap;
-}
-
 /*
  * Delete pack_job_map_t record from pack_job_list
  */
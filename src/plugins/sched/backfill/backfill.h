@@ -50,4 +50,7 @@ extern void stop_backfill_agent(void);
 /* Note that slurm.conf has changed */
 extern void backfill_reconfig(void);
 
+/* Run one backfill cycle in the calling thread, see slurmctld -s */
+extern void backfill_run_cycle(void);
+
 #endif	/* _SLURM_BACKFILL_H */
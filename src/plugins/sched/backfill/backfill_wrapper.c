@@ -65,6 +65,10 @@ int init( void )
 
 	sched_verbose("Backfill scheduler plugin loaded");
 
+	/* The replay runs backfill_run_cycle() itself */
+	if (slurmctld_config.sched_replay)
+		return SLURM_SUCCESS;
+
 	slurm_mutex_lock( &thread_flag_mutex );
 	if ( backfill_thread ) {
 		debug2( "Backfill thread already running, not starting "
@@ -99,6 +103,12 @@ int slurm_sched_p_reconfig( void )
 	return SLURM_SUCCESS;
 }
 
+int slurm_sched_p_run_cycle( void )
+{
+	backfill_run_cycle();
+	return SLURM_SUCCESS;
+}
+
 uint32_t slurm_sched_p_initial_priority(uint32_t last_prio,
 					struct job_record *job_ptr)
 {
@@ -0,0 +1,459 @@
+/*****************************************************************************\
+ *  node_space.c - Map of node availability through time for the backfill
+ *	scheduler
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <stdint.h>
+
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/plugins/sched/backfill/node_space.h"
+
+/*
+ * One time slot. The slots are the nodes of a treap keyed by begin_time,
+ * with a priority derived from begin_time so the tree shape does not depend
+ * upon the order in which slots are created.
+ *
+ * A reservation covering a whole subtree is applied to the subtree's root and
+ * saved in push_bitmap, to be applied to its children when the tree below
+ * that point is next visited. So the bitmaps of a record are current once
+ * every ancestor's push_bitmap has been pushed down, which the functions
+ * below do on their way down the tree.
+ */
+typedef struct node_space_rec node_space_rec_t;
+struct node_space_rec {
+	time_t begin_time;
+	time_t end_time;
+	bitstr_t *avail_bitmap;	/* nodes available during this slot */
+	bitstr_t *tree_bitmap;	/* AND of avail_bitmap over the subtree */
+	bitstr_t *push_bitmap;	/* reservation to apply to children */
+	time_t tree_begin;	/* begin_time of subtree's first slot */
+	time_t tree_first_end;	/* end_time of subtree's first slot */
+	time_t tree_last_begin;	/* begin_time of subtree's last slot */
+	time_t tree_end;	/* end_time of subtree's last slot */
+	uint32_t priority;
+	node_space_rec_t *left;
+	node_space_rec_t *right;
+};
+
+struct node_space_map {
+	time_t begin_time;
+	time_t end_time;
+	int rec_cnt;
+	node_space_rec_t *root;
+};
+
+static uint32_t _priority(time_t begin_time)
+{
+	/* Fibonacci hashing spreads slot times on a resolution grid */
+	return (uint32_t) (((uint64_t) begin_time * 0x9E3779B97F4A7C15ULL) >>
+			   32);
+}
+
+static node_space_rec_t *_rec_create(time_t begin_time, time_t end_time,
+				     bitstr_t *avail_bitmap)
+{
+	node_space_rec_t *rec = xmalloc(sizeof(node_space_rec_t));
+
+	rec->begin_time = rec->tree_begin = rec->tree_last_begin = begin_time;
+	rec->end_time = rec->tree_first_end = rec->tree_end = end_time;
+	rec->avail_bitmap = bit_copy(avail_bitmap);
+	rec->tree_bitmap = bit_copy(avail_bitmap);
+	rec->priority = _priority(begin_time);
+	return rec;
+}
+
+static void _rec_free(node_space_rec_t *rec)
+{
+	FREE_NULL_BITMAP(rec->avail_bitmap);
+	FREE_NULL_BITMAP(rec->tree_bitmap);
+	FREE_NULL_BITMAP(rec->push_bitmap);
+	xfree(rec);
+}
+
+static void _tree_free(node_space_rec_t *rec)
+{
+	if (!rec)
+		return;
+	_tree_free(rec->left);
+	_tree_free(rec->right);
+	_rec_free(rec);
+}
+
+/* Reserve nodes not set in mask throughout the subtree rooted at rec */
+static void _apply(node_space_rec_t *rec, bitstr_t *mask)
+{
+	bit_and(rec->avail_bitmap, mask);
+	bit_and(rec->tree_bitmap, mask);
+	if (!rec->left && !rec->right)
+		return;
+	if (rec->push_bitmap)
+		bit_and(rec->push_bitmap, mask);
+	else
+		rec->push_bitmap = bit_copy(mask);
+}
+
+static void _push(node_space_rec_t *rec)
+{
+	if (!rec->push_bitmap)
+		return;
+	if (rec->left)
+		_apply(rec->left, rec->push_bitmap);
+	if (rec->right)
+		_apply(rec->right, rec->push_bitmap);
+	FREE_NULL_BITMAP(rec->push_bitmap);
+}
+
+/* Recompute the subtree summary of rec from its children */
+static void _update(node_space_rec_t *rec)
+{
+	_push(rec);
+	bit_copybits(rec->tree_bitmap, rec->avail_bitmap);
+	rec->tree_begin = rec->tree_last_begin = rec->begin_time;
+	rec->tree_first_end = rec->tree_end = rec->end_time;
+	if (rec->left) {
+		bit_and(rec->tree_bitmap, rec->left->tree_bitmap);
+		rec->tree_begin = rec->left->tree_begin;
+		rec->tree_first_end = rec->left->tree_first_end;
+	}
+	if (rec->right) {
+		bit_and(rec->tree_bitmap, rec->right->tree_bitmap);
+		rec->tree_last_begin = rec->right->tree_last_begin;
+		rec->tree_end = rec->right->tree_end;
+	}
+}
+
+/* NOTE: rec and rec->left must have no push_bitmap */
+static node_space_rec_t *_rotate_right(node_space_rec_t *rec)
+{
+	node_space_rec_t *top = rec->left;
+
+	rec->left = top->right;
+	top->right = rec;
+	_update(rec);
+	_update(top);
+	return top;
+}
+
+/* NOTE: rec and rec->right must have no push_bitmap */
+static node_space_rec_t *_rotate_left(node_space_rec_t *rec)
+{
+	node_space_rec_t *top = rec->right;
+
+	rec->right = top->left;
+	top->left = rec;
+	_update(rec);
+	_update(top);
+	return top;
+}
+
+/*
+ * Split the slot holding split_time into two slots, the second beginning at
+ * split_time and initially with the same available nodes
+ */
+static node_space_rec_t *_split(node_space_rec_t *rec, time_t split_time,
+				node_space_rec_t **new_rec)
+{
+	if (!rec)
+		return *new_rec;
+
+	_push(rec);
+	if (split_time < rec->begin_time) {
+		rec->left = _split(rec->left, split_time, new_rec);
+		if (rec->left->priority > rec->priority)
+			return _rotate_right(rec);
+	} else {
+		if (split_time < rec->end_time) {
+			/* The slot being split, its bitmap is now current */
+			*new_rec = _rec_create(split_time, rec->end_time,
+					       rec->avail_bitmap);
+			rec->end_time = split_time;
+		}
+		rec->right = _split(rec->right, split_time, new_rec);
+		if (rec->right->priority > rec->priority)
+			return _rotate_left(rec);
+	}
+	_update(rec);
+	return rec;
+}
+
+/* Join two subtrees, every slot of left preceding every slot of right */
+static node_space_rec_t *_join(node_space_rec_t *left,
+			       node_space_rec_t *right)
+{
+	if (!left)
+		return right;
+	if (!right)
+		return left;
+	if (left->priority > right->priority) {
+		_push(left);
+		left->right = _join(left->right, right);
+		_update(left);
+		return left;
+	}
+	_push(right);
+	right->left = _join(left, right->left);
+	_update(right);
+	return right;
+}
+
+/* Extend the last slot of the subtree to end_time */
+static void _extend_last(node_space_rec_t *rec, time_t end_time)
+{
+	_push(rec);
+	if (rec->right)
+		_extend_last(rec->right, end_time);
+	else
+		rec->end_time = end_time;
+	_update(rec);
+}
+
+/*
+ * Remove the slot beginning at begin_time, extending the previous slot to
+ * the end of the one removed
+ */
+static node_space_rec_t *_remove(node_space_rec_t *rec, time_t begin_time,
+				 time_t end_time)
+{
+	node_space_rec_t *top;
+
+	_push(rec);
+	if (begin_time == rec->begin_time) {
+		if (rec->left)
+			_extend_last(rec->left, end_time);
+		top = _join(rec->left, rec->right);
+		_rec_free(rec);
+		return top;
+	}
+	if (begin_time < rec->begin_time)
+		rec->left = _remove(rec->left, begin_time, end_time);
+	else {
+		if (rec->end_time == begin_time)
+			rec->end_time = end_time;
+		rec->right = _remove(rec->right, begin_time, end_time);
+	}
+	_update(rec);
+	return rec;
+}
+
+/* Find the slot holding find_time, pushing reservations down to it */
+static node_space_rec_t *_find(node_space_rec_t *rec, time_t find_time)
+{
+	while (rec) {
+		_push(rec);
+		if (find_time < rec->begin_time)
+			rec = rec->left;
+		else if (find_time >= rec->end_time)
+			rec = rec->right;
+		else
+			break;
+	}
+	return rec;
+}
+
+static void _reserve(node_space_rec_t *rec, time_t start_time,
+		     time_t end_time, bitstr_t *mask)
+{
+	if (!rec || (rec->tree_end <= start_time) ||
+	    (rec->tree_begin >= end_time))
+		return;
+	if ((start_time <= rec->tree_begin) && (rec->tree_end <= end_time)) {
+		_apply(rec, mask);
+		return;
+	}
+	_push(rec);
+	_reserve(rec->left, start_time, end_time, mask);
+	_reserve(rec->right, start_time, end_time, mask);
+	if ((start_time <= rec->begin_time) && (rec->end_time <= end_time))
+		bit_and(rec->avail_bitmap, mask);
+	_update(rec);
+}
+
+static void _and_avail(node_space_rec_t *rec, time_t start_time,
+		       time_t end_time, bitstr_t *avail_bitmap)
+{
+	if (!rec || (rec->tree_end <= start_time) ||
+	    (rec->tree_begin > end_time))
+		return;
+	if ((rec->tree_first_end > start_time) &&
+	    (rec->tree_last_begin <= end_time)) {
+		bit_and(avail_bitmap, rec->tree_bitmap);
+		return;
+	}
+	_push(rec);
+	_and_avail(rec->left, start_time, end_time, avail_bitmap);
+	if ((rec->end_time > start_time) && (rec->begin_time <= end_time))
+		bit_and(avail_bitmap, rec->avail_bitmap);
+	_and_avail(rec->right, start_time, end_time, avail_bitmap);
+}
+
+static time_t _conflict(node_space_rec_t *rec, time_t start_time,
+			time_t end_time, time_t min_begin,
+			bitstr_t *use_bitmap)
+{
+	time_t begin_time;
+
+	if (!rec || (rec->tree_end <= start_time) ||
+	    (rec->tree_begin >= end_time) ||
+	    (rec->tree_last_begin <= min_begin) ||
+	    bit_super_set(use_bitmap, rec->tree_bitmap))
+		return 0;
+	_push(rec);
+	if ((begin_time = _conflict(rec->left, start_time, end_time,
+				    min_begin, use_bitmap)))
+		return begin_time;
+	if ((rec->end_time > start_time) && (rec->begin_time < end_time) &&
+	    (rec->begin_time > min_begin) &&
+	    !bit_super_set(use_bitmap, rec->avail_bitmap))
+		return rec->begin_time;
+	return _conflict(rec->right, start_time, end_time, min_begin,
+			 use_bitmap);
+}
+
+static void _walk(node_space_rec_t *rec,
+		  void (*func)(time_t begin_time, time_t end_time,
+			       bitstr_t *avail_bitmap, void *arg),
+		  void *arg)
+{
+	if (!rec)
+		return;
+	_push(rec);
+	_walk(rec->left, func, arg);
+	(*func)(rec->begin_time, rec->end_time, rec->avail_bitmap, arg);
+	_walk(rec->right, func, arg);
+}
+
+/* Add a slot boundary at split_time unless there is one already */
+static void _add_boundary(node_space_map_t *map, time_t split_time)
+{
+	node_space_rec_t *new_rec = NULL, *rec;
+
+	if ((split_time <= map->begin_time) || (split_time >= map->end_time))
+		return;
+	rec = _find(map->root, split_time);
+	if (!rec || (rec->begin_time == split_time))
+		return;
+	map->root = _split(map->root, split_time, &new_rec);
+	if (new_rec)
+		map->rec_cnt++;
+}
+
+/*
+ * Drop the slot boundary at merge_time if the slots on either side of it
+ * have the same available nodes. This can significantly improve the
+ * performance of the backfill tests.
+ */
+static void _merge_boundary(node_space_map_t *map, time_t merge_time)
+{
+	node_space_rec_t *prev_rec, *next_rec;
+
+	if ((merge_time <= map->begin_time) || (merge_time >= map->end_time))
+		return;
+	next_rec = _find(map->root, merge_time);
+	if (!next_rec || (next_rec->begin_time != merge_time))
+		return;
+	prev_rec = _find(map->root, merge_time - 1);
+	xassert(prev_rec && (prev_rec->end_time == merge_time));
+	if (!bit_equal(prev_rec->avail_bitmap, next_rec->avail_bitmap))
+		return;
+	map->root = _remove(map->root, merge_time, next_rec->end_time);
+	map->rec_cnt--;
+}
+
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap)
+{
+	node_space_map_t *map = xmalloc(sizeof(node_space_map_t));
+
+	map->begin_time = begin_time;
+	map->end_time = end_time;
+	map->root = _rec_create(begin_time, end_time, avail_bitmap);
+	map->rec_cnt = 1;
+	return map;
+}
+
+extern void node_space_destroy(node_space_map_t *map)
+{
+	if (!map)
+		return;
+	_tree_free(map->root);
+	xfree(map);
+}
+
+extern int node_space_count(node_space_map_t *map)
+{
+	return map->rec_cnt;
+}
+
+extern time_t node_space_and_avail(node_space_map_t *map, time_t start_time,
+				   time_t end_time, bitstr_t *avail_bitmap)
+{
+	node_space_rec_t *rec;
+
+	_and_avail(map->root, start_time, end_time, avail_bitmap);
+
+	rec = _find(map->root, MAX(start_time, map->begin_time));
+	if (rec && (rec->end_time < map->end_time))
+		return rec->end_time;
+	return 0;
+}
+
+extern time_t node_space_conflict(node_space_map_t *map, time_t start_time,
+				  time_t end_time, time_t min_begin,
+				  bitstr_t *use_bitmap)
+{
+	return _conflict(map->root, start_time, end_time, min_begin,
+			 use_bitmap);
+}
+
+extern void node_space_reserve(node_space_map_t *map, time_t start_time,
+			       time_t end_time, bitstr_t *avail_bitmap)
+{
+	start_time = MAX(start_time, map->begin_time);
+	if (end_time <= start_time)
+		return;
+
+	_add_boundary(map, start_time);
+	_add_boundary(map, end_time);
+	_reserve(map->root, start_time, end_time, avail_bitmap);
+	_merge_boundary(map, end_time);
+	_merge_boundary(map, start_time);
+}
+
+extern void node_space_walk(node_space_map_t *map,
+			    void (*func)(time_t begin_time, time_t end_time,
+					 bitstr_t *avail_bitmap, void *arg),
+			    void *arg)
+{
+	_walk(map->root, func, arg);
+}
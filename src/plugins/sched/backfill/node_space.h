@@ -0,0 +1,100 @@
+/*****************************************************************************\
+ *  node_space.h - Map of node availability through time for the backfill
+ *	scheduler
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_BACKFILL_NODE_SPACE_H
+#define _SLURM_BACKFILL_NODE_SPACE_H
+
+#include <time.h>
+
+#include "src/common/bitstring.h"
+
+/*
+ * The map divides the backfill window into contiguous time slots, each with
+ * the bitmap of nodes not reserved for pending jobs during that slot. The
+ * slots are kept in a balanced search tree ordered by time in which every
+ * subtree also records the AND of its slots' bitmaps, and reservations are
+ * applied to whole subtrees lazily. Finding the nodes available through a
+ * time range and adding a reservation each take a number of bitmap
+ * operations logarithmic in the number of slots.
+ */
+typedef struct node_space_map node_space_map_t;
+
+/*
+ * Create a map with a single slot covering the backfill window
+ * IN begin_time - start of the window
+ * IN end_time - end of the window
+ * IN avail_bitmap - nodes available throughout the window, copied
+ * RET map, free with node_space_destroy()
+ */
+extern node_space_map_t *node_space_create(time_t begin_time, time_t end_time,
+					   bitstr_t *avail_bitmap);
+
+extern void node_space_destroy(node_space_map_t *map);
+
+/* Return the number of time slots in the map */
+extern int node_space_count(node_space_map_t *map);
+
+/*
+ * Remove from avail_bitmap any node not available in every slot ending after
+ * start_time and beginning no later than end_time
+ * RET the end of the slot holding start_time if another slot follows it,
+ *	otherwise 0. This is the next time resource availability may change.
+ */
+extern time_t node_space_and_avail(node_space_map_t *map, time_t start_time,
+				   time_t end_time, bitstr_t *avail_bitmap);
+
+/*
+ * Find the first slot ending after start_time and beginning before end_time
+ * in which some node of use_bitmap is not available
+ * IN min_begin - ignore slots beginning at or before this time
+ * RET the beginning of the slot found, or 0 if none
+ */
+extern time_t node_space_conflict(node_space_map_t *map, time_t start_time,
+				  time_t end_time, time_t min_begin,
+				  bitstr_t *use_bitmap);
+
+/*
+ * Reserve the nodes not set in avail_bitmap from start_time to end_time,
+ * splitting slots at those times as needed
+ */
+extern void node_space_reserve(node_space_map_t *map, time_t start_time,
+			       time_t end_time, bitstr_t *avail_bitmap);
+
+/* Call func for every slot in time order */
+extern void node_space_walk(node_space_map_t *map,
+			    void (*func)(time_t begin_time, time_t end_time,
+					 bitstr_t *avail_bitmap, void *arg),
+			    void *arg);
+
+#endif	/* _SLURM_BACKFILL_NODE_SPACE_H */
@@ -275,3 +275,16 @@ extern void *builtin_agent(void *args)
 	}
 	return NULL;
 }
+
+/* Compute expected start times once in the calling thread, see slurmctld -s */
+extern void builtin_run_cycle(void)
+{
+	/* Read config, nodes and partitions; Write jobs */
+	slurmctld_lock_t all_locks = {
+		READ_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+
+	_load_config();
+	lock_slurmctld(all_locks);
+	_compute_start_times();
+	unlock_slurmctld(all_locks);
+}
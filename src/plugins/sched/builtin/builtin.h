@@ -50,4 +50,7 @@ extern void stop_builtin_agent(void);
 /* Note that slurm.conf has changed */
 extern void builtin_reconfig(void);
 
+/* Compute expected start times once in the calling thread, see slurmctld -s */
+extern void builtin_run_cycle(void);
+
 #endif	/* _SLURM_BUILTIN_H */
@@ -61,6 +61,10 @@ int init(void)
 {
 	sched_verbose("Built-in scheduler plugin loaded");
 
+	/* The replay runs builtin_run_cycle() itself */
+	if (slurmctld_config.sched_replay)
+		return SLURM_SUCCESS;
+
 	slurm_mutex_lock( &thread_flag_mutex );
 	if ( builtin_thread ) {
 		debug2( "Built-in scheduler thread already running, "
@@ -95,6 +99,12 @@ int slurm_sched_p_reconfig(void)
 	return SLURM_SUCCESS;
 }
 
+int slurm_sched_p_run_cycle(void)
+{
+	builtin_run_cycle();
+	return SLURM_SUCCESS;
+}
+
 uint32_t slurm_sched_p_initial_priority(uint32_t last_prio,
 					struct job_record *job_ptr)
 {
@@ -69,6 +69,11 @@ int slurm_sched_p_reconfig(void)
 	return SLURM_SUCCESS;
 }
 
+int slurm_sched_p_run_cycle(void)
+{
+	return SLURM_SUCCESS;
+}
+
 uint32_t slurm_sched_p_initial_priority(uint32_t last_prio,
 					struct job_record *job_ptr)
 {
@@ -65,7 +65,8 @@ uint32_t comb_counts[MAX_BOARDS][MAX_BOARDS] =
    {7,21,35,35,21,7,1,0},
    {8,28,56,70,56,28,8,1}};
 
-static int *sockets_core_cnt = NULL;
+/* Per thread, as backfill may test jobs from several threads */
+static __thread int *sockets_core_cnt = NULL;
 
 /* Generate all combinations of k integers from the
  * set of integers 0 to n-1.
@@ -59,7 +59,8 @@ static uint32_t comb_counts[MAX_BOARDS][MAX_BOARDS] =
    {6,15,20,15,6,1,0,0},
    {7,21,35,35,21,7,1,0},
    {8,28,56,70,56,28,8,1}};
-static int *sockets_core_cnt = NULL;
+/* Per thread, as backfill may test jobs from several threads */
+static __thread int *sockets_core_cnt = NULL;
 
 static void _block_sync_core_bitmap(struct job_record *job_ptr,
 				    const uint16_t cr_type);
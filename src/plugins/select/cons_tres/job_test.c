@@ -50,11 +50,13 @@
 extern slurmctld_config_t slurmctld_config __attribute__((weak_import));
 extern bitstr_t *idle_node_bitmap __attribute__((weak_import));
 extern struct node_record *node_record_table_ptr __attribute__((weak_import));
+extern node_sched_table_t node_sched_table __attribute__((weak_import));
 extern List job_list __attribute__((weak_import));
 #else
 slurmctld_config_t slurmctld_config;
 bitstr_t *idle_node_bitmap;
 struct node_record *node_record_table_ptr;
+node_sched_table_t node_sched_table;
 List job_list;
 #endif
 
@@ -65,6 +67,7 @@ typedef struct avail_res {	/* Per-node resource availability */
 	uint16_t *avail_cores_per_sock;	/* Per-socket available core count */
 	uint16_t max_cpus;	/* Maximum available CPUs */
 	uint16_t min_cpus;	/* Minimum allocated CPUs */
+	uint64_t sched_weight;	/* Node weight for this job's selection */
 	uint16_t sock_cnt;	/* Number of sockets on this node */
 	List sock_gres_list;	/* Per-socket GRES availability, sock_gres_t */
 	uint16_t spec_threads;	/* Specialized threads to be reserved */
@@ -2606,7 +2609,8 @@ static int _eval_nodes(struct job_record *job_ptr, gres_mc_data_t *mc_ptr,
 		if (node_ptr &&
 		    !details_ptr->contiguous &&
 		    (consec_weight[consec_index] != NO_VAL64) && /* Init value*/
-		    (node_ptr->sched_weight != consec_weight[consec_index])) {
+		    (avail_res_array[i]->sched_weight !=
+		     consec_weight[consec_index])) {
 			/* End last consecutive set, setup start of next set */
 			if (consec_nodes[consec_index] == 0) {
 				/* Only required nodes, re-use consec record */
@@ -2642,7 +2646,8 @@ static int _eval_nodes(struct job_record *job_ptr, gres_mc_data_t *mc_ptr,
 					job_ptr->gres_list,
 					avail_res_array[i]->sock_gres_list);
 			}
-			consec_weight[consec_index] = node_ptr->sched_weight;
+			consec_weight[consec_index] =
+				avail_res_array[i]->sched_weight;
 		} else if (consec_nodes[consec_index] == 0) {
 			/* Only required nodes, re-use consec record */
 			consec_req[consec_index] = -1;
@@ -3459,7 +3464,6 @@ static int _eval_nodes_dfly(struct job_record *job_ptr,
 	List node_weight_list = NULL;
 	topo_weight_info_t *nw = NULL;
 	ListIterator iter;
-	struct node_record *node_ptr;
 	uint16_t avail_cpus = 0;
 	int64_t rem_max_cpus;
 	int rem_cpus, rem_nodes; /* remaining resources desired */
@@ -3570,14 +3574,13 @@ static int _eval_nodes_dfly(struct job_record *job_ptr,
 			}
 		}
 
-		node_ptr = node_record_table_ptr + i;
-		nw_static.weight = node_ptr->sched_weight;
+		nw_static.weight = avail_res_array[i]->sched_weight;
 		nw = list_find_first(node_weight_list, _topo_weight_find,
 				     &nw_static);
 		if (!nw) {	/* New node weight to add */
 			nw = xmalloc(sizeof(topo_weight_info_t));
 			nw->node_bitmap = bit_alloc(select_node_cnt);
-			nw->weight = node_ptr->sched_weight;
+			nw->weight = nw_static.weight;
 			list_append(node_weight_list, nw);
 		}
 		bit_set(nw->node_bitmap, i);
@@ -4097,7 +4100,6 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 	List node_weight_list = NULL;
 	topo_weight_info_t *nw = NULL;
 	ListIterator iter;
-	struct node_record *node_ptr;
 	uint16_t avail_cpus = 0;
 	int64_t rem_max_cpus;
 	int rem_cpus, rem_nodes; /* remaining resources desired */
@@ -4202,14 +4204,13 @@ static int _eval_nodes_topo(struct job_record *job_ptr,
 			}
 		}
 
-		node_ptr = node_record_table_ptr + i;
-		nw_static.weight = node_ptr->sched_weight;
+		nw_static.weight = avail_res_array[i]->sched_weight;
 		nw = list_find_first(node_weight_list, _topo_weight_find,
 				     &nw_static);
 		if (!nw) {	/* New node weight to add */
 			nw = xmalloc(sizeof(topo_weight_info_t));
 			nw->node_bitmap = bit_alloc(select_node_cnt);
-			nw->weight = node_ptr->sched_weight;
+			nw->weight = nw_static.weight;
 			list_append(node_weight_list, nw);
 		}
 		bit_set(nw->node_bitmap, i);
@@ -5654,6 +5655,7 @@ fini:
 	avail_res = xmalloc(sizeof(avail_res_t));
 	avail_res->max_cpus = MIN(cpu_count, part_cpu_limit);
 	avail_res->min_cpus = *cpu_alloc_size;
+	avail_res->sched_weight = node_sched_table.sched_weight[node_i];
 	avail_res->avail_cores_per_sock = xmalloc(sizeof(uint16_t) * sockets);
 	for (c = 0; c < select_node_record[node_i].tot_cores; c++) {
 		i = (uint16_t) (c / cores_per_socket);
@@ -5941,8 +5943,8 @@ static avail_res_t *_can_job_run_on_node(struct job_record *job_ptr,
 		}
 
 		/* Favor nodes with more co-located GPUs */
-		node_ptr->sched_weight =
-			(node_ptr->sched_weight & 0xffffffffffffff00) |
+		avail_res->sched_weight =
+			(avail_res->sched_weight & 0xffffffffffffff00) |
 			(0xff - near_gpu_cnt);
 	}
 
@@ -6025,6 +6027,8 @@ static avail_res_t *_can_job_run_on_node(struct job_record *job_ptr,
 
 static void _set_gpu_defaults(struct job_record *job_ptr)
 {
+	/* Backfill may test jobs from several threads */
+	static pthread_mutex_t last_part_mutex = PTHREAD_MUTEX_INITIALIZER;
 	static struct part_record *last_part_ptr = NULL;
 	static uint64_t last_cpu_per_gpu = NO_VAL64;
 	static uint64_t last_mem_per_gpu = NO_VAL64;
@@ -6033,6 +6037,7 @@ static void _set_gpu_defaults(struct job_record *job_ptr)
 	if (!job_ptr->gres_list)
 		return;
 
+	slurm_mutex_lock(&last_part_mutex);
 	if (job_ptr->part_ptr != last_part_ptr) {
 		/* Cache data from last partition referenced */
 		last_part_ptr = job_ptr->part_ptr;
@@ -6053,6 +6058,7 @@ static void _set_gpu_defaults(struct job_record *job_ptr)
 		mem_per_gpu = def_mem_per_gpu;
 	else
 		mem_per_gpu = 0;
+	slurm_mutex_unlock(&last_part_mutex);
 
 	gres_plugin_job_set_defs(job_ptr->gres_list, "gpu", cpu_per_gpu,
 				 mem_per_gpu);
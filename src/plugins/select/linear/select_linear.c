@@ -88,6 +88,7 @@
 #if defined (__APPLE__)
 extern slurm_ctl_conf_t slurmctld_conf __attribute__((weak_import));
 extern struct node_record *node_record_table_ptr __attribute__((weak_import));
+extern node_sched_table_t node_sched_table __attribute__((weak_import));
 extern List part_list __attribute__((weak_import));
 extern List job_list __attribute__((weak_import));
 extern int node_record_count __attribute__((weak_import));
@@ -104,6 +105,7 @@ extern struct hypercube_switch ***hypercube_switches __attribute__((weak_import)
 #else
 slurm_ctl_conf_t slurmctld_conf;
 struct node_record *node_record_table_ptr;
+node_sched_table_t node_sched_table;
 List part_list;
 List job_list;
 int node_record_count;
@@ -590,10 +592,7 @@ static int _job_count_bitmap(struct cr_record *cr_ptr,
 		}
 
 		node_ptr = node_record_table_ptr + i;
-		if (select_fast_schedule)
-			cpu_cnt = node_ptr->config_ptr->cpus;
-		else
-			cpu_cnt = node_ptr->cpus;
+		cpu_cnt = node_sched_table.cpus[i];
 
 		if (cr_ptr->nodes[i].gres_list)
 			gres_list = cr_ptr->nodes[i].gres_list;
@@ -627,20 +626,12 @@ static int _job_count_bitmap(struct cr_record *cr_ptr,
 
 		if (job_memory_cpu || job_memory_node) {
 			alloc_mem = cr_ptr->nodes[i].alloc_memory;
-			if (select_fast_schedule) {
-				avail_mem = node_ptr->config_ptr->real_memory;
-				if (job_memory_cpu)
-					job_mem = job_memory_cpu * cpu_cnt;
-				else
-					job_mem = job_memory_node;
-			} else {
-				avail_mem = node_ptr->real_memory;
-				if (job_memory_cpu)
-					job_mem = job_memory_cpu * cpu_cnt;
-				else
-					job_mem = job_memory_node;
-			}
-			avail_mem -= node_ptr->mem_spec_limit;
+			avail_mem = node_sched_table.real_memory[i] -
+				    node_sched_table.mem_spec_limit[i];
+			if (job_memory_cpu)
+				job_mem = job_memory_cpu * cpu_cnt;
+			else
+				job_mem = job_memory_node;
 			if ((alloc_mem + job_mem) > avail_mem) {
 				bit_clear(jobmap, i);
 				continue;
@@ -2324,10 +2315,7 @@ static int _rm_job_from_nodes(struct cr_record *cr_ptr,
 			continue;
 
 		node_ptr = node_record_table_ptr + i;
-		if (select_fast_schedule)
-			cpu_cnt = node_ptr->config_ptr->cpus;
-		else
-			cpu_cnt = node_ptr->cpus;
+		cpu_cnt = node_sched_table.cpus[i];
 		if (job_memory_cpu)
 			job_memory = job_memory_cpu * cpu_cnt;
 		else
@@ -2824,10 +2812,7 @@ static int _add_job_to_nodes(struct cr_record *cr_ptr,
 			continue;
 
 		node_ptr = node_record_table_ptr + i;
-		if (select_fast_schedule)
-			cpu_cnt = node_ptr->config_ptr->cpus;
-		else
-			cpu_cnt = node_ptr->cpus;
+		cpu_cnt = node_sched_table.cpus[i];
 
 		if (job_memory_cpu) {
 			cr_ptr->nodes[i].alloc_memory += job_memory_cpu *
@@ -279,6 +279,10 @@ extern char *process_options_first_pass(int argc, char **argv)
 
 	/* initialize option defaults */
 	slurm_reset_all_options(&opt, true);
+	for (i = 0; i < sbopt.script_argc; i++)
+		xfree(sbopt.script_argv[i]);
+	xfree(sbopt.script_argv);
+	sbopt.script_argc = 0;
 
 	/* cli_filter plugins can change the defaults */
 	if (cli_filter_plugin_setup_defaults(&opt, true)) {
@@ -1089,6 +1093,7 @@ static void _usage(void)
 "              [--switches=max-switches{@max-time-to-wait}] [--reboot]\n"
 "              [--core-spec=cores] [--thread-spec=threads]\n"
 "              [--bb=burst_buffer_spec] [--bbf=burst_buffer_file]\n"
+"              [--bulk=file]\n"
 "              [--array=index_values] [--profile=...] [--ignore-pbs] [--spread-job]\n"
 "              [--export[=names]] [--export-file=file|fd] [--delay-boot=mins]\n"
 "              [--use-min-nodes]\n"
@@ -1111,6 +1116,8 @@ static void _help(void)
 "      --bb=<spec>             burst buffer specifications\n"
 "      --bbf=<file_name>       burst buffer specification file\n"
 "  -b, --begin=time            defer job until HH:MM MM/DD/YY\n"
+"      --bulk=<file_name>      submit one job per line of file, each line\n"
+"                              holding the options and script of a job\n"
 "      --comment=name          arbitrary comment\n"
 "      --cpu-freq=min[-max[:gov]] requested cpu frequency (and governor)\n"
 "  -c, --cpus-per-task=ncpus   number of cpus required per task\n"
@@ -68,6 +68,7 @@
 #define MAX_RETRIES 15
 
 static void  _add_bb_to_script(char **script_body, char *burst_buffer_file);
+static int   _bulk_submit(int argc, char **argv, bool quiet);
 static void  _env_merge_filter(job_desc_msg_t *desc);
 static int   _fill_job_desc_from_opts(job_desc_msg_t *desc);
 static void *_get_script_buffer(const char *filename, int *size);
@@ -128,6 +129,9 @@ int main(int argc, char **argv)
 		log_alter(logopt, 0, NULL);
 	}
 
+	if (sbopt.bulk_file)
+		exit(_bulk_submit(argc, argv, quiet));
+
 	if (sbopt.wrap != NULL) {
 		script_body = _script_wrap(sbopt.wrap);
 	} else {
@@ -343,6 +347,209 @@ int main(int argc, char **argv)
 	return rc;
 }
 
+/*
+ * Submit one job for each line of the --bulk file. Each line is appended to
+ * the command line options and processed as if it were the remainder of an
+ * sbatch command line, then all of the jobs are submitted with
+ * slurm_submit_batch_job_bulk().
+ * RET exit code for sbatch
+ */
+static int _bulk_submit(int argc, char **argv, bool quiet)
+{
+	job_desc_msg_t *desc = NULL;
+	submit_bulk_response_msg_t *resp = NULL;
+	List job_req_list;
+	Buf buf;
+	void *state = NULL;
+	char *bulk_file, *line, *ptr, *arg, **line_argv;
+	char *script_name, *script_body = NULL, *last_script_name = NULL;
+	int *job_lineno = NULL;
+	int line_argc, line_argv_size, argc_off, lineno = 0, skipped;
+	int script_size = 0, job_cnt = 0, i, rc = 0, retries = 0;
+	bool more_packs;
+
+	for (i = 1; i < argc; i++) {
+		if (!xstrcmp(argv[i], ":")) {
+			error("Heterogeneous jobs can not be submitted with --bulk");
+			return error_exit;
+		}
+	}
+	if (sbopt.script_argc) {
+		error("Batch scripts must be given in the --bulk file, not on the command line");
+		return error_exit;
+	}
+
+	bulk_file = xstrdup(sbopt.bulk_file);
+	if (!(buf = create_mmap_buf(bulk_file))) {
+		error("Unable to open --bulk file %s: %m", bulk_file);
+		return error_exit;
+	}
+
+	job_req_list = list_create(NULL);
+	line_argv_size = argc + 16;
+	line_argv = xcalloc(line_argv_size, sizeof(char *));
+	while ((line = next_line(get_buf_data(buf), size_buf(buf), &state))) {
+		lineno++;
+		for (i = 0; i < argc; i++)
+			line_argv[i] = argv[i];
+		line_argc = argc;
+		for (ptr = line;
+		     (arg = get_argument(bulk_file, lineno, ptr, &skipped));
+		     ptr += skipped) {
+			if ((line_argc + 1) >= line_argv_size) {
+				line_argv_size *= 2;
+				xrecalloc(line_argv, line_argv_size,
+					  sizeof(char *));
+			}
+			line_argv[line_argc++] = arg;
+		}
+		xfree(line);
+		if (line_argc == argc)
+			continue;	/* blank or comment */
+		line_argv[line_argc] = NULL;
+
+		script_name = process_options_first_pass(line_argc, line_argv);
+		if (sbopt.wrap) {
+			script_body = _script_wrap(sbopt.wrap);
+			script_size = 0;
+			xfree(last_script_name);
+		} else if (!script_name) {
+			error("%s: line %d: No batch script or --wrap command",
+			      bulk_file, lineno);
+			exit(error_exit);
+		} else if (xstrcmp(script_name, last_script_name)) {
+			/* Jobs in a bulk file commonly share a script */
+			script_body = _get_script_buffer(script_name,
+							 &script_size);
+			xfree(last_script_name);
+			last_script_name = xstrdup(script_name);
+		}
+		if (!script_body)
+			exit(error_exit);
+
+		init_envs(&pack_env);
+		process_options_second_pass(line_argc - sbopt.script_argc,
+					    line_argv, &argc_off, 0,
+					    &more_packs, script_name ?
+					    xbasename(script_name) : "stdin",
+					    script_body, script_size);
+		if (more_packs) {
+			error("%s: line %d: Heterogeneous jobs can not be submitted with --bulk",
+			      bulk_file, lineno);
+			exit(error_exit);
+		}
+		if (sbopt.test_only || sbopt.wait || opt.burst_buffer_file) {
+			error("--test-only, --wait and --bbf can not be used with --bulk");
+			exit(error_exit);
+		}
+
+		if (!job_cnt && (spank_init_post_opt() < 0)) {
+			error("Plugin stack post-option processing failed");
+			exit(error_exit);
+		}
+		if (opt.get_user_env_time < 0)
+			(void) _set_rlimit_env();
+		if (sbopt.export_file != NULL)
+			env_unset_environment();
+		_set_prio_process_env();
+		_set_spank_env();
+		_set_submit_dir_env();
+		_set_umask_env();
+
+		desc = xmalloc(sizeof(job_desc_msg_t));
+		slurm_init_job_desc_msg(desc);
+		if (_fill_job_desc_from_opts(desc) == -1)
+			exit(error_exit);
+		set_env_from_opts(&opt, &desc->environment, -1);
+		set_envs(&desc->environment, &pack_env, -1);
+		desc->env_size = envcount(desc->environment);
+		desc->script = script_body;
+		list_append(job_req_list, desc);
+
+		xrecalloc(job_lineno, job_cnt + 1, sizeof(int));
+		job_lineno[job_cnt++] = lineno;
+		for (i = argc; i < line_argc; i++)
+			xfree(line_argv[i]);
+	}
+	xfree(line_argv);
+	xfree(last_script_name);
+	free_buf(buf);
+
+	if (!job_cnt) {
+		error("No jobs found in --bulk file %s", bulk_file);
+		exit(error_exit);
+	}
+
+	/*
+	 * If can run on multiple clusters find the earliest run time
+	 * of the first job and run them all there
+	 */
+	if (opt.clusters &&
+	    (slurmdb_get_first_avail_cluster(list_peek(job_req_list),
+					     opt.clusters,
+					     &working_cluster_rec) !=
+	     SLURM_SUCCESS)) {
+		print_db_notok(opt.clusters, 0);
+		exit(error_exit);
+	}
+
+	while (slurm_submit_batch_job_bulk(job_req_list, &resp) < 0) {
+		static char *msg;
+		if (errno == ESLURM_ERROR_ON_DESC_TO_RECORD_COPY) {
+			msg = "Slurm job queue full, sleeping and retrying";
+		} else if (errno == EAGAIN) {
+			msg = "Slurm temporarily unable to accept job, "
+			      "sleeping and retrying";
+		} else
+			msg = NULL;
+		if ((msg == NULL) || (retries >= MAX_RETRIES)) {
+			error("Batch job submission failed: %m");
+			exit(error_exit);
+		}
+
+		if (retries)
+			debug("%s", msg);
+		else
+			error("%s", msg);
+		sleep(++retries);
+	}
+
+	print_multi_line_string(resp->job_submit_user_msg, -1, LOG_LEVEL_INFO);
+
+	for (i = 0; i < resp->job_cnt; i++) {
+		if (!resp->job_id[i]) {
+			error("%s: line %d: Batch job submission failed: %s",
+			      bulk_file, job_lineno[i],
+			      slurm_strerror(resp->error_code[i]));
+			rc = error_exit;
+			continue;
+		}
+
+		/* run cli_filter post_submit */
+		cli_filter_plugin_post_submit(0, resp->job_id[i], NO_VAL);
+
+		if (quiet)
+			continue;
+		if (!sbopt.parsable) {
+			printf("Submitted batch job %u", resp->job_id[i]);
+			if (working_cluster_rec)
+				printf(" on cluster %s",
+				       working_cluster_rec->name);
+			printf("\n");
+		} else {
+			printf("%u", resp->job_id[i]);
+			if (working_cluster_rec)
+				printf(";%s", working_cluster_rec->name);
+			printf("\n");
+		}
+	}
+
+	slurm_free_submit_bulk_response_msg(resp);
+	xfree(job_lineno);
+	xfree(bulk_file);
+	return rc;
+}
+
 /* Insert the contents of "burst_buffer_file" into "script_body" */
 static void  _add_bb_to_script(char **script_body, char *burst_buffer_file)
 {
@@ -596,7 +803,7 @@ static int _fill_job_desc_from_opts(job_desc_msg_t *desc)
 	if (opt.account)
 		desc->account = xstrdup(opt.account);
 	if (opt.burst_buffer)
-		desc->burst_buffer = opt.burst_buffer;
+		desc->burst_buffer = xstrdup(opt.burst_buffer);
 	if (opt.comment)
 		desc->comment = xstrdup(opt.comment);
 	if (opt.qos)
@@ -148,6 +148,8 @@ static int _print_stats(void)
 		       ((buf->req_time - buf->req_time_start) / 60)));
 	}
 	printf("\tLast queue length: %u\n", buf->schedule_queue_len);
+	printf("\tEquivalent jobs skipped: %u of %u\n",
+	       buf->schedule_equiv_hits, buf->schedule_equiv_lookups);
 
 	if (buf->bf_active) {
 		printf("\nBackfilling stats (WARNING: data obtained"
@@ -183,10 +185,67 @@ static int _print_stats(void)
 		printf("\tQueue length mean: %u\n",
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
+	printf("\tEquivalent jobs skipped: %u of %u\n",
+	       buf->bf_equiv_hits, buf->bf_equiv_lookups);
+
+	if (buf->fairshare_cycle_counter) {
+		printf("\nFair Tree fairshare stats (times in microseconds)\n");
+		printf("\tTotal cycles: %u\n", buf->fairshare_cycle_counter);
+		printf("\tLast cycle: %u\n", buf->fairshare_cycle_last);
+		printf("\tMax cycle:  %u\n", buf->fairshare_cycle_max);
+		printf("\tMean cycle: %u\n",
+		       buf->fairshare_cycle_sum / buf->fairshare_cycle_counter);
+		printf("\tLast cycle sibling sets sorted: %u of %u\n",
+		       buf->fairshare_last_sorted, buf->fairshare_last_sets);
+	}
 
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
 
+	if (buf->rpc_worker_count) {
+		printf("\nRPC worker pool (wait times in microseconds)\n");
+		printf("\tWorker threads: %u\n", buf->rpc_worker_count);
+		printf("\tUnread connections: %u\n", buf->rpc_unread_count);
+		for (i = 0; i < buf->rpc_class_count; i++) {
+			printf("\t%-10s depth:%-4u max_depth:%-4u active:%-4u "
+			       "count:%-8u ave_wait:%-8"PRIu64" max_wait:%"PRIu64
+			       "\n",
+			       buf->rpc_class_name[i], buf->rpc_class_depth[i],
+			       buf->rpc_class_max_depth[i],
+			       buf->rpc_class_active[i], buf->rpc_class_cnt[i],
+			       buf->rpc_class_cnt[i] ?
+			       (buf->rpc_class_wait_time[i] /
+				buf->rpc_class_cnt[i]) : 0,
+			       buf->rpc_class_max_wait[i]);
+		}
+	}
+
+	if (buf->state_load_count) {
+		printf("\nState recovery at startup (microseconds)\n");
+		for (i = 0; i < buf->state_load_count; i++) {
+			printf("\t%-16s %"PRIu64"\n", buf->state_load_name[i],
+			       buf->state_load_time[i]);
+		}
+	}
+
+	if (buf->job_hash_count) {
+		printf("\nJob hash tables\n");
+		for (i = 0; i < buf->job_hash_count; i++) {
+			printf("\t%-10s size:%-8u records:%-8u load:%3u%% "
+			       "ave_probe:%.2f max_probe:%-4u resizes:%u\n",
+			       buf->job_hash_name[i], buf->job_hash_size[i],
+			       buf->job_hash_records[i],
+			       buf->job_hash_size[i] ?
+			       (buf->job_hash_records[i] * 100 /
+				buf->job_hash_size[i]) : 0,
+			       buf->job_hash_records[i] ?
+			       ((double) buf->job_hash_probe_sum[i] /
+				buf->job_hash_records[i]) : 0.0,
+			       buf->job_hash_probe_max[i],
+			       buf->job_hash_resizes[i]);
+		}
+	}
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
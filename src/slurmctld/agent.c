@@ -1709,6 +1709,12 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 		message_timeout = MAX(slurm_get_msg_timeout(), 30);
 	}
 
+	if (slurmctld_config.sched_replay) {
+		/* Replayed state, there is no one to send the request to */
+		_purge_agent_args(agent_arg_ptr);
+		return;
+	}
+
 	if (agent_arg_ptr->msg_type == REQUEST_SHUTDOWN) {
 		/* execute now */
 		slurm_thread_create_detached(NULL, agent, agent_arg_ptr);
@@ -2060,6 +2066,9 @@ extern void mail_job_info (struct job_record *job_ptr, uint16_t mail_type)
 	if (job_ptr->pack_job_id && (job_ptr->pack_job_offset != 0))
 		return;
 
+	if (slurmctld_config.sched_replay)
+		return;
+
 	mi = _mail_alloc();
 	if (!job_ptr->mail_user) {
 		mi->user_name = uid_to_string((uid_t)job_ptr->user_id);
@@ -102,6 +102,7 @@
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
 #include "src/slurmctld/heartbeat.h"
+#include "src/slurmctld/info_snapshot.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
@@ -114,6 +115,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
@@ -243,6 +245,7 @@ static void *       _purge_files_thread(void *no_data);
 static void         _remove_assoc(slurmdb_assoc_rec_t *rec);
 static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _run_primary_prog(bool primary_on);
+static void         _run_sched_replay(void);
 static void *       _service_connection(void *arg);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(void);
@@ -321,7 +324,7 @@ int main(int argc, char **argv)
 	create_clustername_file = _verify_clustername();
 
 	_update_nice();
-	if (!test_config)
+	if (!test_config && !slurmctld_config.sched_replay)
 		_kill_old_slurmctld();
 
 	for (i = 0; i < 3; i++)
@@ -341,7 +344,7 @@ int main(int argc, char **argv)
 		slurmctld_config.daemonize = 0;
 	}
 
-	if (!test_config) {
+	if (!test_config && !slurmctld_config.sched_replay) {
 		/*
 		 * Need to create pidfile here in case we setuid() below
 		 * (init_pidfile() exits if it can't initialize pid file).
@@ -432,6 +435,16 @@ int main(int argc, char **argv)
 		      slurmctld_conf.accounting_storage_type);
 	}
 
+	if (slurmctld_config.sched_replay) {
+		/*
+		 * Never record replayed job starts in the database, the
+		 * associations are recovered from the state files instead.
+		 */
+		xfree(slurmctld_conf.accounting_storage_type);
+		slurmctld_conf.accounting_storage_type =
+			xstrdup("accounting_storage/none");
+	}
+
 	memset(&callbacks, 0, sizeof(slurm_trigger_callbacks_t));
 	callbacks.acct_full   = trigger_primary_ctld_acct_full;
 	callbacks.dbd_fail    = trigger_primary_dbd_fail;
@@ -609,11 +622,12 @@ int main(int argc, char **argv)
 			if (slurm_acct_storage_init(NULL) != SLURM_SUCCESS)
 				fatal("failed to initialize accounting_storage plugin");
 		} else if (test_config || slurmctld_primary) {
-			if (!test_config) {
+			if (!test_config && !slurmctld_config.sched_replay) {
 				(void) _shutdown_backup_controller();
 				trigger_primary_ctld_res_ctrl();
-				ctld_assoc_mgr_init(&callbacks);
 			}
+			if (!test_config)
+				ctld_assoc_mgr_init(&callbacks);
 			if (slurm_acct_storage_init(NULL) != SLURM_SUCCESS) {
 				if (test_config) {
 					error("failed to initialize accounting_storage plugin");
@@ -673,6 +687,9 @@ int main(int argc, char **argv)
 			}
 		}
 
+		if (slurmctld_config.sched_replay)
+			_run_sched_replay();	/* Does not return */
+
 		if (!acct_db_conn) {
 			acct_db_conn = acct_storage_g_get_connection(
 				&callbacks, 0, NULL, false,
@@ -882,6 +899,7 @@ int main(int argc, char **argv)
 	assoc_mgr_fini(1);
 	reserve_port_config(NULL);
 	free_rpc_stats();
+	info_snapshot_fini();
 
 	/* Some plugins are needed to purge job/node data structures,
 	 * unplug after other data structures are purged */
@@ -1176,6 +1194,11 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
 
+	if (rpc_queue_init() == SLURM_SUCCESS) {
+		rpc_queue_event_loop(fds, nports, max_server_threads);
+		goto fini;
+	}
+
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
@@ -1230,10 +1253,12 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 		}
 	}
 
+fini:
 	debug3("%s shutting down", __func__);
 	for (i = 0; i < nports; i++)
 		close(fds[i].fd);
 	xfree(fds);
+	rpc_queue_fini();
 	server_thread_decr();
 	pthread_exit((void *) 0);
 	return NULL;
@@ -1248,49 +1273,18 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 static void *_service_connection(void *arg)
 {
 	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
 	slurm_msg_t msg;
+	int rc;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "srvcn", NULL, NULL, NULL) < 0) {
 		error("%s: cannot set my name to %s %m", __func__, "srvcn");
 	}
 #endif
-	slurm_msg_t_init(&msg);
-	msg.flags |= SLURM_MSG_KEEP_BUFFER;
-	/*
-	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
-	 * possibility for slurmctld_req() to close accepted connection.
-	 */
-	if (slurm_receive_msg(conn->newsockfd, &msg, 0) != 0) {
-		char addr_buf[32];
-		slurm_print_slurm_addr(&conn->cli_addr, addr_buf,
-				       sizeof(addr_buf));
-		error("slurm_receive_msg [%s]: %m", addr_buf);
-		/* close the new socket */
-		close(conn->newsockfd);
-		goto cleanup;
-	}
-
-	if (errno != SLURM_SUCCESS) {
-		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
-			slurm_send_rc_msg(&msg, SLURM_PROTOCOL_VERSION_ERROR);
-		} else
-			info("_service_connection/slurm_receive_msg %m");
-	} else {
-		/* process the request */
-		slurmctld_req(&msg, conn);
-	}
-
-	if ((conn->newsockfd >= 0) && (close(conn->newsockfd) < 0))
-		error ("close(%d): %m",  conn->newsockfd);
-
-cleanup:
-	slurm_free_msg_members(&msg);
-	xfree(arg);
-	server_thread_decr();
+	if ((rc = rpc_receive_connection(conn, &msg)) != SLURM_ERROR)
+		rpc_process_connection(conn, &msg, rc);
 
-	return return_code;
+	return NULL;
 }
 
 /* Increment slurmctld_config.server_thread_count and don't return
@@ -2294,7 +2288,7 @@ extern void save_all_state(void)
 extern void ctld_assoc_mgr_init(slurm_trigger_callbacks_t *callbacks)
 {
 	assoc_init_args_t assoc_init_arg;
-	int num_jobs = 0;
+	int db_conn_errno = SLURM_ERROR, num_jobs = 0;
 	slurmctld_lock_t job_read_lock =
 		{ NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -2327,11 +2321,15 @@ extern void ctld_assoc_mgr_init(slurm_trigger_callbacks_t *callbacks)
 	if (acct_db_conn)
 		acct_storage_g_close_connection(&acct_db_conn);
 
-	acct_db_conn = acct_storage_g_get_connection(
-		callbacks, 0, NULL, false,
-		slurmctld_conf.cluster_name);
+	/* A scheduling replay reads the associations from the state files */
+	if (!slurmctld_config.sched_replay) {
+		acct_db_conn = acct_storage_g_get_connection(
+			callbacks, 0, NULL, false,
+			slurmctld_conf.cluster_name);
+		db_conn_errno = errno;
+	}
 
-	if (assoc_mgr_init(acct_db_conn, &assoc_init_arg, errno)) {
+	if (assoc_mgr_init(acct_db_conn, &assoc_init_arg, db_conn_errno)) {
 		if (accounting_enforce & ACCOUNTING_ENFORCE_ASSOCS)
 			error("Association database appears down, "
 			      "reading from state file.");
@@ -2606,7 +2604,7 @@ static void _parse_commandline(int argc, char **argv)
 	char *tmp_char;
 
 	opterr = 0;
-	while ((c = getopt(argc, argv, "cdDf:hiL:n:rRvV")) != -1) {
+	while ((c = getopt(argc, argv, "cdDf:hiL:n:rRsvV")) != -1) {
 		switch (c) {
 		case 'c':
 			recover = 0;
@@ -2646,6 +2644,9 @@ static void _parse_commandline(int argc, char **argv)
 		case 'R':
 			recover = 2;
 			break;
+		case 's':
+			slurmctld_config.sched_replay = true;
+			break;
 		case 'v':
 			debug_level++;
 			break;
@@ -2663,6 +2664,10 @@ static void _parse_commandline(int argc, char **argv)
 		recover = 0;
 		config_test_start();
 	}
+	if (slurmctld_config.sched_replay) {
+		daemonize = 0;
+		recover = 2;
+	}
 }
 
 /* _usage - print a message describing the command line arguments of
@@ -2697,6 +2702,8 @@ static void _usage(char *prog_name)
 	fprintf(stderr, "  -R      "
 			"\tRecover full state from last checkpoint.\n");
 #endif
+	fprintf(stderr, "  -s      "
+			"\tReplay one scheduling cycle on the saved state and exit.\n");
 	fprintf(stderr, "  -v      "
 			"\tVerbose mode. Multiple -v's increase verbosity.\n");
 	fprintf(stderr, "  -V      "
@@ -3436,6 +3443,81 @@ static void _update_diag_job_state_counts(void)
 	list_for_each(job_list, _foreach_job_running, NULL);
 }
 
+/* Return the number of microseconds since start */
+static long _replay_usec(struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) * 1000000 +
+	       (now.tv_usec - start->tv_usec);
+}
+
+/*
+ * Run one main scheduler pass and one cycle of the scheduling plugin (e.g.
+ * backfill) against the state recovered from StateSaveLocation, report the
+ * jobs each started, the time each took and their select_g_job_test() calls,
+ * then exit. No RPC is sent or accepted, no job, node or reservation state is
+ * saved and no accounting record is written, so the state files can be
+ * replayed again with other SchedulerParameters or another build to compare
+ * scheduler costs.
+ */
+static void _run_sched_replay(void)
+{
+	/* Locks: Read job */
+	slurmctld_lock_t job_read_lock = {
+		NO_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	struct timeval start;
+	uint32_t job_cnt = 0, pend_cnt = 0, started;
+	uint64_t test_cnt;
+	long usec;
+
+	if (slurm_priority_init() != SLURM_SUCCESS)
+		fatal("failed to initialize priority plugin");
+	if (slurm_sched_init() != SLURM_SUCCESS)
+		fatal("failed to initialize scheduling plugin");
+	if (bb_g_init() != SLURM_SUCCESS)
+		fatal("failed to initialize burst buffer plugin");
+	if (slurm_mcs_init() != SLURM_SUCCESS)
+		fatal("failed to initialize mcs plugin");
+
+	lock_slurmctld(job_read_lock);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = list_next(job_iterator))) {
+		job_cnt++;
+		if (IS_JOB_PENDING(job_ptr))
+			pend_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+	unlock_slurmctld(job_read_lock);
+	printf("Recovered %u jobs (%u pending), %d nodes from %s\n",
+	       job_cnt, pend_cnt, node_record_count,
+	       slurmctld_conf.state_save_location);
+
+	started = slurmctld_diag_stats.jobs_started;
+	test_cnt = select_g_job_test_count();
+	gettimeofday(&start, NULL);
+	(void) schedule(0);
+	usec = _replay_usec(&start);
+	printf("Main scheduler: %u jobs started, %"PRIu64" job tests, "
+	       "%ld usec\n", slurmctld_diag_stats.jobs_started - started,
+	       select_g_job_test_count() - test_cnt, usec);
+
+	started = slurmctld_diag_stats.jobs_started;
+	test_cnt = select_g_job_test_count();
+	gettimeofday(&start, NULL);
+	(void) slurm_sched_g_run_cycle();
+	usec = _replay_usec(&start);
+	printf("%s: %u jobs started, %"PRIu64" job tests, %ld usec\n",
+	       slurmctld_conf.schedtype,
+	       slurmctld_diag_stats.jobs_started - started,
+	       select_g_job_test_count() - test_cnt, usec);
+
+	exit(0);
+}
+
 static void *_wait_primary_prog(void *arg)
 {
 	primary_thread_arg_t *wait_arg = (primary_thread_arg_t *) arg;
@@ -95,7 +95,7 @@ static Buf _open_front_end_state_file(char **state_file)
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/front_end_state");
 
-	if (!(buf = create_mmap_buf(*state_file)))
+	if (!(buf = open_state_file(*state_file)))
 		error("Could not open front_end state file %s: %m",
 		      *state_file);
 	else
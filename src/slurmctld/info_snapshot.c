@@ -0,0 +1,206 @@
+/*****************************************************************************\
+ *  info_snapshot.c - Published, read-only snapshots of packed state
+ *	information used to answer info RPCs without slurmctld locks
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <pthread.h>
+
+#include "src/common/macros.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+#include "src/slurmctld/info_snapshot.h"
+
+/*
+ * Snapshots are keyed by (show_flags, protocol_version). Only a handful of
+ * distinct keys are in use at any time (one per client release and command
+ * option combination), so a small table replaced in LRU order is sufficient.
+ */
+#define SNAPSHOT_SLOTS 8
+
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+static info_snapshot_t *snapshot_table[SNAPSHOT_TYPE_COUNT][SNAPSHOT_SLOTS];
+
+static void _free_snapshot(info_snapshot_t *snapshot)
+{
+	xfree(snapshot->buffer);
+	xfree(snapshot);
+}
+
+/* Remove a snapshot from the table, free it if it has no readers.
+ * snapshot_mutex must be locked */
+static void _retire_snapshot(info_snapshot_t **slot)
+{
+	info_snapshot_t *snapshot = *slot;
+
+	if (!snapshot)
+		return;
+	*slot = NULL;
+	if (snapshot->ref_cnt == 0)
+		_free_snapshot(snapshot);
+	else
+		snapshot->retired = true;
+}
+
+extern info_snapshot_t *info_snapshot_acquire(snapshot_type_t type,
+					      uint16_t show_flags,
+					      uint16_t protocol_version,
+					      time_t data_time, int max_age)
+{
+	info_snapshot_t *snapshot, *found = NULL;
+	time_t now = time(NULL);
+	int i;
+
+	xassert(type < SNAPSHOT_TYPE_COUNT);
+
+	slurm_mutex_lock(&snapshot_mutex);
+	for (i = 0; i < SNAPSHOT_SLOTS; i++) {
+		snapshot = snapshot_table[type][i];
+		if (!snapshot ||
+		    (snapshot->show_flags != show_flags) ||
+		    (snapshot->protocol_version != protocol_version))
+			continue;
+		/*
+		 * last_*_update has one second resolution, so a change made
+		 * in the second the buffer was built may not be in it. The
+		 * buffer is built under the slurmctld locks, so it is only
+		 * known to be current if built after that second.
+		 */
+		if ((snapshot->build_time > data_time) ||
+		    ((max_age > 0) &&
+		     (difftime(now, snapshot->build_time) <= max_age))) {
+			snapshot->ref_cnt++;
+			found = snapshot;
+		}
+		break;
+	}
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	return found;
+}
+
+extern info_snapshot_t *info_snapshot_publish(snapshot_type_t type,
+					      uint16_t show_flags,
+					      uint16_t protocol_version,
+					      time_t data_time,
+					      bool uid_independent,
+					      char *buffer, int buffer_size)
+{
+	info_snapshot_t *snapshot, *old;
+	int i, slot = -1, oldest = -1;
+
+	xassert(type < SNAPSHOT_TYPE_COUNT);
+
+	snapshot = xmalloc(sizeof(info_snapshot_t));
+	snapshot->buffer = buffer;
+	snapshot->buffer_size = buffer_size;
+	snapshot->build_time = time(NULL);
+	snapshot->data_time = data_time;
+	snapshot->protocol_version = protocol_version;
+	snapshot->show_flags = show_flags;
+	snapshot->uid_independent = uid_independent;
+	snapshot->ref_cnt = 1;
+
+	slurm_mutex_lock(&snapshot_mutex);
+	for (i = 0; i < SNAPSHOT_SLOTS; i++) {
+		old = snapshot_table[type][i];
+		if (!old) {
+			if (slot == -1)
+				slot = i;
+			continue;
+		}
+		if ((old->show_flags == show_flags) &&
+		    (old->protocol_version == protocol_version)) {
+			slot = i;
+			break;
+		}
+		if ((oldest == -1) ||
+		    (old->build_time <
+		     snapshot_table[type][oldest]->build_time))
+			oldest = i;
+	}
+	if (slot == -1)
+		slot = oldest;
+	old = snapshot_table[type][slot];
+	/*
+	 * Two threads may race to rebuild the same stale snapshot, never let
+	 * a buffer built from older data replace a newer one.
+	 */
+	if (old && (old->show_flags == show_flags) &&
+	    (old->protocol_version == protocol_version) &&
+	    (old->data_time > data_time)) {
+		snapshot->retired = true;
+		slurm_mutex_unlock(&snapshot_mutex);
+		return snapshot;
+	}
+	_retire_snapshot(&snapshot_table[type][slot]);
+	snapshot_table[type][slot] = snapshot;
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	return snapshot;
+}
+
+extern void info_snapshot_release(info_snapshot_t *snapshot)
+{
+	bool free_it;
+
+	if (!snapshot)
+		return;
+
+	slurm_mutex_lock(&snapshot_mutex);
+	if (snapshot->ref_cnt > 0)
+		snapshot->ref_cnt--;
+	free_it = (snapshot->retired && (snapshot->ref_cnt == 0));
+	slurm_mutex_unlock(&snapshot_mutex);
+
+	if (free_it)
+		_free_snapshot(snapshot);
+}
+
+extern void info_snapshot_invalidate(snapshot_type_t type)
+{
+	int i;
+
+	xassert(type < SNAPSHOT_TYPE_COUNT);
+
+	slurm_mutex_lock(&snapshot_mutex);
+	for (i = 0; i < SNAPSHOT_SLOTS; i++)
+		_retire_snapshot(&snapshot_table[type][i]);
+	slurm_mutex_unlock(&snapshot_mutex);
+}
+
+extern void info_snapshot_fini(void)
+{
+	int type;
+
+	for (type = 0; type < SNAPSHOT_TYPE_COUNT; type++)
+		info_snapshot_invalidate(type);
+}
@@ -0,0 +1,105 @@
+/*****************************************************************************\
+ *  info_snapshot.h - Published, read-only snapshots of packed state
+ *	information used to answer info RPCs without slurmctld locks
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMCTLD_INFO_SNAPSHOT_H
+#define _SLURMCTLD_INFO_SNAPSHOT_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Read-mostly data is published as an immutable, reference counted packed
+ * buffer. Readers take a reference under a short private mutex and never
+ * touch the slurmctld locks, writers build a new buffer under the normal
+ * slurmctld read locks and swap it in. A replaced snapshot is freed once the
+ * last reader drops its reference (RCU-style grace period).
+ */
+typedef enum {
+	SNAPSHOT_JOB,		/* pack_all_jobs() output */
+	SNAPSHOT_NODE,		/* pack_all_node() output */
+	SNAPSHOT_PART,		/* pack_all_part() output */
+	SNAPSHOT_TYPE_COUNT
+} snapshot_type_t;
+
+typedef struct info_snapshot {
+	char *buffer;		/* packed RPC response body */
+	int buffer_size;	/* size of buffer in bytes */
+	time_t build_time;	/* when the buffer was packed, under locks */
+	time_t data_time;	/* last_*_update value the buffer reflects */
+	uint16_t protocol_version;
+	uint16_t show_flags;
+	bool uid_independent;	/* content identical for every requester */
+	/* private to info_snapshot.c */
+	int ref_cnt;
+	bool retired;
+} info_snapshot_t;
+
+/*
+ * Find a published snapshot matching the request and take a reference on it.
+ * IN type - data type of the snapshot
+ * IN show_flags - show_flags of the request
+ * IN protocol_version - protocol version of the request
+ * IN data_time - last update time of the underlying data, snapshots not
+ *	built after that second are only returned if younger than max_age
+ * IN max_age - staleness bound in seconds, zero to require current data
+ * RET snapshot to be released by info_snapshot_release() or NULL if none
+ */
+extern info_snapshot_t *info_snapshot_acquire(snapshot_type_t type,
+					      uint16_t show_flags,
+					      uint16_t protocol_version,
+					      time_t data_time, int max_age);
+
+/*
+ * Publish a newly packed buffer, replacing any snapshot with the same key.
+ * The buffer is owned by the snapshot module from here on.
+ * RET the new snapshot with a reference already taken for the caller
+ */
+extern info_snapshot_t *info_snapshot_publish(snapshot_type_t type,
+					      uint16_t show_flags,
+					      uint16_t protocol_version,
+					      time_t data_time,
+					      bool uid_independent,
+					      char *buffer, int buffer_size);
+
+/* Drop a reference obtained from info_snapshot_acquire/publish() */
+extern void info_snapshot_release(info_snapshot_t *snapshot);
+
+/* Retire every published snapshot of the given type */
+extern void info_snapshot_invalidate(snapshot_type_t type);
+
+/* Free all snapshot memory, call at slurmctld shutdown */
+extern void info_snapshot_fini(void);
+
+#endif /* !_SLURMCTLD_INFO_SNAPSHOT_H */
@@ -1,7 +1,7 @@
 /*****************************************************************************\
  *  job_mgr.c - manage the job information of slurm
  *	Note: there is a global job list (job_list), time stamp
- *	(last_job_update), and hash table (job_hash)
+ *	(last_job_update), and hash tables (job_id_table, job_task_table)
  *****************************************************************************
  *  Copyright (C) 2002-2007 The Regents of the University of California.
  *  Copyright (C) 2008-2010 Lawrence Livermore National Security.
@@ -113,13 +113,38 @@
 #define PURGE_OLD_JOB_IN_SEC 2592000 /* 30 days in seconds */
 
 #define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-#define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
-	((_job_id + _task_id) % hash_table_size)
+
+/*
+ * Job records are found by job ID and by array job ID plus task ID through
+ * open addressing tables using linear probing. A table is a power of two in
+ * size and doubles once more than JOB_TABLE_LOAD_PCT percent of its slots are
+ * in use, so lookups stay short however far the job count grows.
+ */
+#define JOB_TABLE_LOAD_PCT	70
+#define JOB_TABLE_MIN_SIZE	1024
+#define JOB_TABLE_TASK_KEY(_job_id, _task_id) \
+	((((uint64_t) _job_id) << 32) | ((uint64_t) _task_id))
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION     "PROTOCOL_VERSION"
 #define JOB_CKPT_VERSION      "PROTOCOL_VERSION"
 
+typedef struct {
+	uint64_t key;
+	struct job_record *job_ptr;	/* NULL if the slot is empty */
+} job_table_slot_t;
+
+typedef struct {
+	char *name;
+	job_table_slot_t *slots;
+	uint32_t size;		/* slot count, a power of 2 */
+	uint32_t bits;		/* log2(size) */
+	uint32_t cnt;		/* slots in use */
+	uint64_t probe_sum;	/* sum of each entry's distance from its home */
+	uint32_t probe_max;	/* longest distance since last resize */
+	uint32_t resizes;	/* times the table grew after creation */
+} job_table_t;
+
 typedef enum {
 	JOB_HASH_JOB,
 	JOB_HASH_ARRAY_JOB,
@@ -142,6 +167,28 @@ typedef struct {
 	uid_t     uid;
 } _foreach_pack_job_info_t;
 
+typedef struct {
+	uint32_t job_id;
+	uint64_t seq;		/* job info sequence number of the purge */
+} job_info_purge_t;
+
+/* Purged job IDs remembered for delta job info clients */
+#define JOB_INFO_PURGE_CNT 16384
+
+/* Job state journal record types */
+#define JOB_JOURNAL_UPDATE	1	/* packed job state follows */
+#define JOB_JOURNAL_PURGE	2	/* job record was purged */
+
+/* Never compact a job state journal smaller than this */
+#define JOB_JOURNAL_MIN_COMPACT	(1024 * 1024)
+
+typedef struct {
+	uint32_t job_id;
+	uint16_t type;
+	uint32_t offset;	/* of packed job state in the journal */
+	uint32_t seq;		/* position in the journal */
+} job_journal_rec_t;
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
@@ -153,12 +200,12 @@ static int      bf_min_age_reserve = 0;
 static uint32_t delay_boot = 0;
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
+static int      hash_table_size = 0;	/* size of job_array_hash_j */
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
+static job_table_t job_id_table = { .name = "job_id" };
+static job_table_t job_task_table = { .name = "array_task" };
 static struct   job_record **job_array_hash_j = NULL;
-static struct   job_record **job_array_hash_t = NULL;
 static bool     kill_invalid_dep;
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
@@ -166,6 +213,24 @@ static bitstr_t *requeue_exit = NULL;
 static bitstr_t *requeue_exit_hold = NULL;
 static bool     validate_cfgd_licenses = true;
 
+/* Delta job info state, see pack_delta_jobs() */
+static pthread_mutex_t job_info_seq_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t job_info_seq = 0;	/* last job info sequence number */
+static uint64_t job_info_min_seq = 0;	/* oldest usable client sequence */
+static time_t   job_info_refresh_time = (time_t) 0;
+static job_info_purge_t *job_info_purged = NULL;
+static int      job_info_purge_next = 0;
+
+/* Job state journal, see dump_all_job_state() */
+static bool     job_journal_compact = true;	/* rewrite job_state on the
+						 * next save */
+static uint32_t job_journal_size = 0;	/* bytes appended since compaction */
+static uint32_t job_state_snapshot_size = 0;	/* size of job_state file */
+static uint32_t *job_state_purged = NULL;	/* saved job IDs purged since
+						 * the last save */
+static int      job_state_purged_cnt = 0;
+static int      job_state_purged_size = 0;
+
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
 static void _add_job_array_hash(struct job_record *job_ptr);
@@ -201,6 +266,9 @@ static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 static void _job_timed_out(struct job_record *job_ptr, bool preempted);
 static void _kill_dependent(struct job_record *job_ptr);
 static void _list_delete_job(void *job_entry);
+static uint64_t _job_info_hash(char *data, uint32_t size);
+static void _record_job_info_purge(struct job_record *job_ptr);
+static void _record_job_state_purge(struct job_record *job_ptr);
 static int  _list_find_job_old(void *job_entry, void *key);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
@@ -220,6 +288,9 @@ static void _pack_default_job_details(struct job_record *job_ptr,
 static void _pack_pending_job_details(struct job_details *detail_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
+static void _pack_job_at(struct job_record *dump_job_ptr, uint16_t show_flags,
+			 Buf buffer, uint16_t protocol_version, uid_t uid,
+			 time_t now);
 static bool _parse_array_tok(char *tok, bitstr_t *array_bitmap, uint32_t max);
 static void _purge_missing_jobs(int node_inx, time_t now);
 static int  _read_data_array_from_file(int fd, char *file_name, char ***data,
@@ -790,10 +861,195 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 	return qos_ptr;
 }
 
+/* Write a buffer to an open state file, RET 0 or errno */
+static int _write_job_state_buf(int fd, char *file, Buf buffer)
+{
+	int pos = 0, nwrite, amount;
+	char *data;
+
+	nwrite = get_buf_offset(buffer);
+	data = (char *)get_buf_data(buffer);
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if ((amount < 0) && (errno != EINTR)) {
+			error("Error writing file %s, %m", file);
+			return errno;
+		}
+		if (amount > 0) {
+			nwrite -= amount;
+			pos    += amount;
+		}
+	}
+	return SLURM_SUCCESS;
+}
+
+/*
+ * Start an empty job state journal for the job_state file written at
+ * snapshot_time. A journal whose header time does not match the job_state
+ * file is ignored when state is recovered, so this can follow the job_state
+ * file shuffle without a window in which stale records would be replayed.
+ * state files must be locked
+ */
+static int _reset_job_journal(time_t snapshot_time)
+{
+	char *new_file, *reg_file;
+	int error_code = SLURM_SUCCESS, fd, rc;
+	Buf buffer = init_buf(BUF_SIZE);
+
+	packstr(JOB_STATE_VERSION, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(snapshot_time, buffer);
+
+	reg_file = xstrdup_printf("%s/job_state.journal",
+				  slurmctld_conf.state_save_location);
+	new_file = xstrdup_printf("%s.new", reg_file);
+	fd = open(new_file, O_CREAT|O_WRONLY|O_TRUNC|O_CLOEXEC, 0600);
+	if (fd < 0) {
+		error("Can't save state, create file %s error %m", new_file);
+		error_code = errno;
+	} else {
+		error_code = _write_job_state_buf(fd, new_file, buffer);
+		rc = fsync_and_close(fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (!error_code && (rename(new_file, reg_file) < 0)) {
+		error("Can't rename %s to %s: %m", new_file, reg_file);
+		error_code = errno;
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else
+		job_journal_size = 0;
+
+	xfree(new_file);
+	xfree(reg_file);
+	free_buf(buffer);
+	return error_code;
+}
+
+/*
+ * Append the job records which changed since the last save, plus the IDs of
+ * purged job records, to the job state journal as one batch:
+ *	batch length, time, job_id_sequence, record count, records
+ * Records are a type, job ID and for JOB_JOURNAL_UPDATE the packed job state.
+ * A failed or partial append makes the next save rewrite the job_state file.
+ */
+static int _append_job_journal(void)
+{
+	static int high_buffer_size = BUF_SIZE;
+	static uint32_t last_job_id_sequence = 0;
+	/* Locks: Read config and job */
+	slurmctld_lock_t job_read_lock =
+		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	Buf buffer = init_buf(high_buffer_size);
+	Buf job_buffer = init_buf(BUF_SIZE);
+	uint32_t cnt_offset, end_offset, rec_cnt = 0, id_sequence;
+	uint64_t hash;
+	char *reg_file;
+	int error_code = SLURM_SUCCESS, fd, i, rc;
+
+	pack32(0, buffer);	/* batch length, set below */
+	pack_time(time(NULL), buffer);
+
+	lock_slurmctld(job_read_lock);
+	id_sequence = job_id_sequence;
+	pack32(id_sequence, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(rec_cnt, buffer);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		set_buf_offset(job_buffer, 0);
+		_dump_job_state(job_ptr, job_buffer);
+		hash = _job_info_hash(get_buf_data(job_buffer),
+				      get_buf_offset(job_buffer));
+		if (hash == job_ptr->state_hash)
+			continue;
+		job_ptr->state_hash = hash;
+		pack16(JOB_JOURNAL_UPDATE, buffer);
+		pack32(job_ptr->job_id, buffer);
+		packmem(get_buf_data(job_buffer), get_buf_offset(job_buffer),
+			buffer);
+		rec_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+	for (i = 0; i < job_state_purged_cnt; i++) {
+		pack16(JOB_JOURNAL_PURGE, buffer);
+		pack32(job_state_purged[i], buffer);
+		rec_cnt++;
+	}
+	job_state_purged_cnt = 0;
+	unlock_slurmctld(job_read_lock);
+	free_buf(job_buffer);
+
+	if (!rec_cnt && (id_sequence == last_job_id_sequence)) {
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
+	end_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(end_offset - sizeof(uint32_t), buffer);
+	set_buf_offset(buffer, cnt_offset);
+	pack32(rec_cnt, buffer);
+	set_buf_offset(buffer, end_offset);
+	high_buffer_size = MAX(end_offset, high_buffer_size);
+
+	reg_file = xstrdup_printf("%s/job_state.journal",
+				  slurmctld_conf.state_save_location);
+	lock_state_files();
+	fd = open(reg_file, O_WRONLY|O_APPEND|O_CLOEXEC);
+	if (fd < 0) {
+		error("Can't save state, open file %s error %m", reg_file);
+		error_code = errno;
+	} else {
+		error_code = _write_job_state_buf(fd, reg_file, buffer);
+		rc = fsync_and_close(fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code) {
+		job_journal_compact = true;
+	} else {
+		job_journal_size += end_offset;
+		last_job_id_sequence = id_sequence;
+	}
+	unlock_state_files();
+	xfree(reg_file);
+
+	debug3("%s: wrote %u job state records in %u bytes",
+	       __func__, rec_cnt, end_offset);
+	free_buf(buffer);
+	return error_code;
+}
+
+/* Remember the ID of a saved job record being purged for the journal.
+ * job write lock must be held */
+static void _record_job_state_purge(struct job_record *job_ptr)
+{
+	if (!job_ptr->state_hash)
+		return;		/* never written to job state */
+	if (job_state_purged_cnt >= job_state_purged_size) {
+		job_state_purged_size = MAX(1024, job_state_purged_size * 2);
+		xrealloc(job_state_purged,
+			 sizeof(uint32_t) * job_state_purged_size);
+	}
+	job_state_purged[job_state_purged_cnt++] = job_ptr->job_id;
+}
+
 /*
  * dump_all_job_state - save the state of all jobs to file for checkpoint
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
+ *
+ *	Rewriting every job record on each save costs I/O proportional to the
+ *	number of jobs, so normally only the records which changed since the
+ *	last save are appended to the job state journal. The job_state file is
+ *	rewritten (compacted) when the journal grows larger than it, after
+ *	recovery or a failed save, and at shutdown so a cleanly stopped
+ *	slurmctld leaves a complete job_state file.
  * RET 0 or error code
  */
 int dump_all_job_state(void)
@@ -808,9 +1064,10 @@ int dump_all_job_state(void)
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	Buf buffer = init_buf(high_buffer_size);
+	Buf buffer;
 	time_t now = time(NULL);
 	time_t last_state_file_time;
+	uint32_t offset;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -833,7 +1090,16 @@ int dump_all_job_state(void)
 		}
 	}
 
+	if (!job_journal_compact && !slurmctld_config.shutdown_time &&
+	    (job_journal_size <
+	     MAX(job_state_snapshot_size, JOB_JOURNAL_MIN_COMPACT))) {
+		error_code = _append_job_journal();
+		END_TIMER2("dump_all_job_state");
+		return error_code;
+	}
+
 	/* write header: version, time */
+	buffer = init_buf(high_buffer_size);
 	packstr(JOB_STATE_VERSION, buffer);
 	pack16(SLURM_PROTOCOL_VERSION, buffer);
 	pack_time(now, buffer);
@@ -852,10 +1118,14 @@ int dump_all_job_state(void)
 	lock_slurmctld(job_read_lock);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		offset = get_buf_offset(buffer);
 		_dump_job_state(job_ptr, buffer);
+		job_ptr->state_hash = _job_info_hash(
+			get_buf_data(buffer) + offset,
+			get_buf_offset(buffer) - offset);
 	}
 	list_iterator_destroy(job_iterator);
-
+	job_state_purged_cnt = 0;
 
 	/* write the buffer to file */
 	old_file = xstrdup(slurmctld_conf.state_save_location);
@@ -888,23 +1158,11 @@ int dump_all_job_state(void)
 		      new_file);
 		error_code = errno;
 	} else {
-		int pos = 0, nwrite, amount, rc;
-		char *data;
-
-		nwrite = get_buf_offset(buffer);
-		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
+		int rc;
 
+		high_buffer_size = MAX(get_buf_offset(buffer),
+				       high_buffer_size);
+		error_code = _write_job_state_buf(log_fd, new_file, buffer);
 		rc = fsync_and_close(log_fd, "job");
 		if (rc && !error_code)
 			error_code = rc;
@@ -922,7 +1180,9 @@ int dump_all_job_state(void)
 			       new_file, reg_file);
 		(void) unlink(new_file);
 		last_file_write_time = now;
+		job_state_snapshot_size = get_buf_offset(buffer);
 	}
+	job_journal_compact = (error_code || _reset_job_journal(now));
 	xfree(old_file);
 	xfree(reg_file);
 	xfree(new_file);
@@ -957,7 +1217,7 @@ static Buf _open_job_state_file(char **state_file)
 	*state_file = xstrdup_printf("%s/job_state",
 				     slurmctld_conf.state_save_location);
 
-	if (!(buf = create_mmap_buf(*state_file)))
+	if (!(buf = open_state_file(*state_file)))
 		error("Could not open job state file %s: %m", *state_file);
 	else
 		return buf;
@@ -1015,6 +1275,7 @@ extern void set_job_tres_alloc_str(struct job_record *job_ptr,
 extern void backup_slurmctld_restart(void)
 {
 	last_file_write_time = (time_t) 0;
+	job_journal_compact = true;
 }
 
 /* Return the time stamp in the current job state save file, 0 is returned on
@@ -1049,9 +1310,168 @@ unpack_error:
 	return buf_time;
 }
 
+/*
+ * Open the job state journal and check that it belongs to the job_state file
+ * written at snapshot_time. A journal written by an older release is kept,
+ * so that the jobs changed after the last job_state file survive an upgrade.
+ * OUT protocol_version - protocol version the journal records were packed with
+ * RET the journal positioned at its first batch, or NULL if none applies
+ */
+static Buf _open_job_journal(time_t snapshot_time, uint16_t *protocol_version)
+{
+	char *state_file, *ver_str = NULL;
+	uint32_t ver_str_len;
+	time_t journal_time = 0;
+	Buf buffer;
+
+	state_file = xstrdup_printf("%s/job_state.journal",
+				    slurmctld_conf.state_save_location);
+	if (!(buffer = open_state_file(state_file))) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		return NULL;
+	}
+
+	*protocol_version = NO_VAL16;
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (ver_str && !xstrcmp(ver_str, JOB_STATE_VERSION))
+		safe_unpack16(protocol_version, buffer);
+	if ((*protocol_version == NO_VAL16) ||
+	    (*protocol_version < SLURM_MIN_PROTOCOL_VERSION) ||
+	    (*protocol_version > SLURM_PROTOCOL_VERSION)) {
+		error("Job state journal %s has incompatible version %s/%hu",
+		      state_file, ver_str, *protocol_version);
+		goto version_error;
+	}
+	safe_unpack_time(&journal_time, buffer);
+	if (journal_time != snapshot_time) {
+		info("Job state journal %s does not match job_state file, ignored",
+		     state_file);
+		goto ignore;
+	}
+	xfree(ver_str);
+	xfree(state_file);
+	return buffer;
+
+unpack_error:
+	error("Incomplete job state journal %s header", state_file);
+version_error:
+	/* Jobs changed since the job_state file was written would be lost */
+	if (!ignore_state_errors)
+		fatal("Can not recover job state journal, start with '-i' to ignore this");
+ignore:
+	xfree(ver_str);
+	xfree(state_file);
+	free_buf(buffer);
+	return NULL;
+}
+
+/*
+ * Unpack the next batch header of the job state journal.
+ * RET SLURM_SUCCESS, or SLURM_ERROR at the end of the journal or if the batch
+ *	is incomplete (the save writing it was interrupted)
+ */
+static int _unpack_job_journal_batch(Buf buffer, uint32_t *batch_end,
+				     uint32_t *id_sequence, uint32_t *rec_cnt)
+{
+	uint32_t batch_len;
+	time_t batch_time;
+
+	if (remaining_buf(buffer) == 0)
+		return SLURM_ERROR;
+	safe_unpack32(&batch_len, buffer);
+	if (batch_len > remaining_buf(buffer))
+		goto unpack_error;
+	*batch_end = get_buf_offset(buffer) + batch_len;
+	safe_unpack_time(&batch_time, buffer);
+	safe_unpack32(id_sequence, buffer);
+	safe_unpack32(rec_cnt, buffer);
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("Incomplete job state journal batch ignored");
+	return SLURM_ERROR;
+}
+
+static int _cmp_job_journal_rec(const void *x, const void *y)
+{
+	const job_journal_rec_t *rec1 = x, *rec2 = y;
+
+	if (rec1->job_id != rec2->job_id)
+		return (rec1->job_id < rec2->job_id) ? -1 : 1;
+	if (rec1->seq != rec2->seq)
+		return (rec1->seq < rec2->seq) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Replay the job state journal on top of the job records just loaded from
+ * the job_state file written at snapshot_time. Only the last record of each
+ * job is applied, replacing any job record already loaded.
+ * RET SLURM_SUCCESS or SLURM_ERROR if a job record could not be loaded
+ */
+static int _replay_job_journal(time_t snapshot_time)
+{
+	Buf buffer;
+	job_journal_rec_t *recs = NULL;
+	uint32_t batch_end, id_sequence, rec_cnt, i, len;
+	int cnt = 0, size = 0, j, replaced = 0, error_code = SLURM_SUCCESS;
+	uint16_t protocol_version;
+	char *data;
+
+	if (!(buffer = _open_job_journal(snapshot_time, &protocol_version)))
+		return SLURM_SUCCESS;
+
+	while (_unpack_job_journal_batch(buffer, &batch_end, &id_sequence,
+					 &rec_cnt) == SLURM_SUCCESS) {
+		for (i = 0; i < rec_cnt; i++) {
+			if (cnt >= size) {
+				size = MAX(1024, size * 2);
+				xrealloc(recs, sizeof(job_journal_rec_t) * size);
+			}
+			safe_unpack16(&recs[cnt].type, buffer);
+			safe_unpack32(&recs[cnt].job_id, buffer);
+			if (recs[cnt].type == JOB_JOURNAL_UPDATE) {
+				safe_unpackmem_ptr(&data, &len, buffer);
+				recs[cnt].offset = get_buf_offset(buffer) - len;
+			}
+			recs[cnt].seq = cnt;
+			cnt++;
+		}
+		if (get_buf_offset(buffer) != batch_end)
+			goto unpack_error;
+		if (id_sequence <= slurmctld_conf.max_job_id)
+			job_id_sequence = MAX(id_sequence, job_id_sequence);
+	}
+
+	qsort(recs, cnt, sizeof(job_journal_rec_t), _cmp_job_journal_rec);
+	for (j = 0; j < cnt; j++) {
+		if (((j + 1) < cnt) && (recs[j + 1].job_id == recs[j].job_id))
+			continue;	/* superseded by a later record */
+		replaced += purge_job_record(recs[j].job_id);
+		if (recs[j].type != JOB_JOURNAL_UPDATE)
+			continue;
+		set_buf_offset(buffer, recs[j].offset);
+		if ((error_code = _load_job_state(buffer, protocol_version)))
+			break;
+	}
+	info("Replayed %d job state journal records, %d job records replaced",
+	     cnt, replaced);
+	xfree(recs);
+	free_buf(buffer);
+	return error_code;
+
+unpack_error:
+	error("Invalid job state journal record");
+	xfree(recs);
+	free_buf(buffer);
+	return SLURM_ERROR;
+}
+
 /*
  * load_all_job_state - load the job state from file, recover from last
- *	checkpoint. Execute this after loading the configuration file data.
+ *	checkpoint and replay the job state journal. Execute this after
+ *	loading the configuration file data.
  *	Changes here should be reflected in load_last_job_id().
  * RET 0 or error code
  */
@@ -1115,9 +1535,19 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	free_buf(buffer);
+
+	error_code = _replay_job_journal(buf_time);
+	if (error_code != SLURM_SUCCESS) {
+		if (!ignore_state_errors)
+			fatal("Invalid job state journal, start with '-i' to ignore this");
+		error("Invalid job state journal");
+	}
+	job_cnt = list_count(job_list);
+	/* The next save writes a new job_state file and journal */
+	job_journal_compact = true;
 	debug3("Set job_id_sequence to %u", job_id_sequence);
 
-	free_buf(buffer);
 	info("Recovered information about %d jobs", job_cnt);
 	return error_code;
 
@@ -1179,6 +1609,21 @@ extern int load_last_job_id( void )
 
 	xfree(ver_str);
 	free_buf(buffer);
+
+	/* Later job IDs may be recorded in the job state journal */
+	if ((protocol_version != NO_VAL16) &&
+	    (buffer = _open_job_journal(buf_time, &protocol_version))) {
+		uint32_t batch_end, id_sequence, rec_cnt;
+
+		while (_unpack_job_journal_batch(buffer, &batch_end,
+						 &id_sequence, &rec_cnt) ==
+		       SLURM_SUCCESS) {
+			job_id_sequence = MAX(id_sequence, job_id_sequence);
+			set_buf_offset(buffer, batch_end);
+		}
+		free_buf(buffer);
+		debug3("Job ID in job state journal is %u", job_id_sequence);
+	}
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -2622,6 +3067,183 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Home slot of a key, Fibonacci hashing spreads sequential job IDs */
+static inline uint32_t _job_table_home(job_table_t *table, uint64_t key)
+{
+	return (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >> (64 - table->bits));
+}
+
+/* Store an entry in the first free slot at or after its home slot */
+static void _job_table_insert(job_table_t *table, uint64_t key,
+			      struct job_record *job_ptr)
+{
+	uint32_t mask = table->size - 1, dist = 0;
+	uint32_t inx = _job_table_home(table, key);
+
+	while (table->slots[inx].job_ptr) {
+		inx = (inx + 1) & mask;
+		dist++;
+	}
+	table->slots[inx].key = key;
+	table->slots[inx].job_ptr = job_ptr;
+	table->cnt++;
+	table->probe_sum += dist;
+	if (dist > table->probe_max)
+		table->probe_max = dist;
+}
+
+/* Rebuild the job array chains, sized to match job_task_table */
+static void _rebuild_job_array_hash(void)
+{
+	job_table_slot_t *slot;
+	struct job_record *job_ptr;
+	int inx;
+	uint32_t i;
+
+	xfree(job_array_hash_j);
+	hash_table_size = job_task_table.size;
+	job_array_hash_j = xcalloc(hash_table_size,
+				   sizeof(struct job_record *));
+	for (i = 0, slot = job_task_table.slots; i < job_task_table.size;
+	     i++, slot++) {
+		if (!(job_ptr = slot->job_ptr))
+			continue;
+		inx = JOB_HASH_INX(job_ptr->array_job_id);
+		job_ptr->job_array_next_j = job_array_hash_j[inx];
+		job_array_hash_j[inx] = job_ptr;
+	}
+}
+
+/* Move all entries into a new table of the given size (a power of 2) */
+static void _job_table_resize(job_table_t *table, uint32_t size)
+{
+	job_table_slot_t *old_slots = table->slots;
+	uint32_t i, old_size = table->size;
+
+	if (old_slots) {
+		table->resizes++;
+		debug("%s: growing %s table from %u to %u slots",
+		      __func__, table->name, old_size, size);
+	}
+	table->slots = xcalloc(size, sizeof(job_table_slot_t));
+	table->size = size;
+	table->bits = 0;
+	while ((1U << table->bits) < size)
+		table->bits++;
+	table->cnt = 0;
+	table->probe_sum = 0;
+	table->probe_max = 0;
+	for (i = 0; i < old_size; i++) {
+		if (old_slots[i].job_ptr)
+			_job_table_insert(table, old_slots[i].key,
+					  old_slots[i].job_ptr);
+	}
+	xfree(old_slots);
+
+	if (table == &job_task_table)
+		_rebuild_job_array_hash();
+}
+
+/* Smallest table size to hold job_cnt entries within the load limit */
+static uint32_t _job_table_size(uint32_t job_cnt)
+{
+	uint64_t want = ((uint64_t) job_cnt * 100) / JOB_TABLE_LOAD_PCT + 1;
+	uint32_t size = JOB_TABLE_MIN_SIZE;
+
+	while ((size < want) && (size < (1U << 31)))
+		size <<= 1;
+	return size;
+}
+
+static void _job_table_add(job_table_t *table, uint64_t key,
+			   struct job_record *job_ptr)
+{
+	if (!table->slots)
+		_job_table_resize(table, _job_table_size(0));
+	else if (((uint64_t) (table->cnt + 1) * 100) >
+		 ((uint64_t) table->size * JOB_TABLE_LOAD_PCT))
+		_job_table_resize(table, table->size << 1);
+	_job_table_insert(table, key, job_ptr);
+}
+
+static struct job_record *_job_table_find(job_table_t *table, uint64_t key)
+{
+	job_table_slot_t *slot;
+	uint32_t mask = table->size - 1, inx;
+
+	if (!table->slots)
+		return NULL;
+	inx = _job_table_home(table, key);
+	while ((slot = &table->slots[inx])->job_ptr) {
+		if (slot->key == key)
+			return slot->job_ptr;
+		inx = (inx + 1) & mask;
+	}
+	return NULL;
+}
+
+/*
+ * Remove the entry for a given key and job record. Later entries of the same
+ * probe sequence are shifted back to fill the hole, so no tombstones are left
+ * behind to lengthen future probes.
+ * RET true if the entry was found
+ */
+static bool _job_table_remove(job_table_t *table, uint64_t key,
+			      struct job_record *job_ptr)
+{
+	job_table_slot_t *slot;
+	uint32_t mask = table->size - 1, hole, inx, home, dist;
+
+	if (!table->slots)
+		return false;
+	inx = _job_table_home(table, key);
+	while ((slot = &table->slots[inx])->job_ptr) {
+		if ((slot->key == key) && (slot->job_ptr == job_ptr))
+			break;
+		inx = (inx + 1) & mask;
+	}
+	if (!slot->job_ptr)
+		return false;
+
+	table->probe_sum -= (inx - _job_table_home(table, key)) & mask;
+	table->cnt--;
+	hole = inx;
+	inx = (inx + 1) & mask;
+	while ((slot = &table->slots[inx])->job_ptr) {
+		home = _job_table_home(table, slot->key);
+		dist = (inx - hole) & mask;
+		if (((inx - home) & mask) >= dist) {
+			table->slots[hole] = *slot;
+			table->probe_sum -= dist;
+			hole = inx;
+		}
+		inx = (inx + 1) & mask;
+	}
+	table->slots[hole].job_ptr = NULL;
+	table->slots[hole].key = 0;
+	return true;
+}
+
+/* Grow a table, if needed, to hold job_cnt entries within the load limit */
+static void _job_table_reserve(job_table_t *table, uint32_t job_cnt)
+{
+	uint32_t size = _job_table_size(job_cnt);
+
+	if (size > table->size)
+		_job_table_resize(table, size);
+}
+
+static void _job_table_free(job_table_t *table)
+{
+	xfree(table->slots);
+	table->size = 0;
+	table->bits = 0;
+	table->cnt = 0;
+	table->probe_sum = 0;
+	table->probe_max = 0;
+	table->resizes = 0;
+}
+
 /* _add_job_hash - add a job hash entry for given job record, job_id must
  *	already be set
  * IN job_ptr - pointer to job record
@@ -2629,11 +3251,7 @@ unpack_error:
  */
 static void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
-
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	_job_table_add(&job_id_table, job_ptr->job_id, job_ptr);
 }
 
 /* _remove_job_hash - remove a job hash entry for given job record, job_id must
@@ -2651,72 +3269,48 @@ static void _remove_job_hash(struct job_record *job_entry,
 
 	switch (type) {
 	case JOB_HASH_JOB:
-		job_pptr = &job_hash[JOB_HASH_INX(job_entry->job_id)];
-		break;
+		if (!_job_table_remove(&job_id_table, job_entry->job_id,
+				       job_entry)) {
+			error("%s: Could not find hash entry for JobId=%u",
+			      __func__, job_entry->job_id);
+		}
+		return;
 	case JOB_HASH_ARRAY_JOB:
-		job_pptr = &job_array_hash_j[
-			JOB_HASH_INX(job_entry->array_job_id)];
 		break;
 	case JOB_HASH_ARRAY_TASK:
-		job_pptr = &job_array_hash_t[
-			JOB_ARRAY_HASH_INX(job_entry->array_job_id,
-					   job_entry->array_task_id)];
-		break;
-	default:
-		fatal("%s: unknown job_hash_type_t %d", __func__, type);
-		return;
-	}
-
-	while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != job_entry)) {
-		xassert(job_ptr->magic == JOB_MAGIC);
-		switch (type) {
-		case JOB_HASH_JOB:
-			job_pptr = &job_ptr->job_next;
-			break;
-		case JOB_HASH_ARRAY_JOB:
-			job_pptr = &job_ptr->job_array_next_j;
-			break;
-		case JOB_HASH_ARRAY_TASK:
-			job_pptr = &job_ptr->job_array_next_t;
-			break;
-		}
-	}
-
-	if (job_pptr == NULL) {
-		switch (type) {
-		case JOB_HASH_JOB:
-			error("%s: Could not find hash entry for JobId=%u",
-			      __func__, job_entry->job_id);
-			break;
-		case JOB_HASH_ARRAY_JOB:
-			error("%s: job array hash error %u", __func__,
-			      job_entry->array_job_id);
-			break;
-		case JOB_HASH_ARRAY_TASK:
+		if (!_job_table_remove(&job_task_table,
+				       JOB_TABLE_TASK_KEY(
+					       job_entry->array_job_id,
+					       job_entry->array_task_id),
+				       job_entry)) {
 			error("%s: job array, task ID hash error %u_%u",
 			      __func__,
 			      job_entry->array_job_id,
 			      job_entry->array_task_id);
-			break;
 		}
 		return;
+	default:
+		fatal("%s: unknown job_hash_type_t %d", __func__, type);
+		return;
 	}
 
-	switch (type) {
-	case JOB_HASH_JOB:
-		*job_pptr = job_entry->job_next;
-		job_entry->job_next = NULL;
-		break;
-	case JOB_HASH_ARRAY_JOB:
-		*job_pptr = job_entry->job_array_next_j;
-		job_entry->job_array_next_j = NULL;
-		break;
-	case JOB_HASH_ARRAY_TASK:
-		*job_pptr = job_entry->job_array_next_t;
-		job_entry->job_array_next_t = NULL;
-		break;
+	if (!job_array_hash_j) {
+		error("%s: job array hash error %u", __func__,
+		      job_entry->array_job_id);
+		return;
 	}
+	job_pptr = &job_array_hash_j[JOB_HASH_INX(job_entry->array_job_id)];
+	while ((*job_pptr != NULL) && ((job_ptr = *job_pptr) != job_entry)) {
+		xassert(job_ptr->magic == JOB_MAGIC);
+		job_pptr = &job_ptr->job_array_next_j;
+	}
+	if (*job_pptr == NULL) {
+		error("%s: job array hash error %u", __func__,
+		      job_entry->array_job_id);
+		return;
+	}
+	*job_pptr = job_entry->job_array_next_j;
+	job_entry->job_array_next_j = NULL;
 }
 
 /* _add_job_array_hash - add a job hash entry for given job record,
@@ -2731,13 +3325,43 @@ void _add_job_array_hash(struct job_record *job_ptr)
 	if (job_ptr->array_task_id == NO_VAL)
 		return;	/* Not a job array */
 
+	/* Adding to job_task_table may rebuild job_array_hash_j */
+	_job_table_add(&job_task_table,
+		       JOB_TABLE_TASK_KEY(job_ptr->array_job_id,
+					  job_ptr->array_task_id),
+		       job_ptr);
+
 	inx = JOB_HASH_INX(job_ptr->array_job_id);
 	job_ptr->job_array_next_j = job_array_hash_j[inx];
 	job_array_hash_j[inx] = job_ptr;
+}
 
-	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
-	job_ptr->job_array_next_t = job_array_hash_t[inx];
-	job_array_hash_t[inx] = job_ptr;
+/*
+ * Pack job hash table statistics for sdiag. The counters are read without
+ * the job lock, so they may be slightly out of date.
+ */
+extern void job_hash_pack_stats(Buf buffer)
+{
+	job_table_t *tables[] = { &job_id_table, &job_task_table };
+	char *name[2];
+	uint32_t size[2], cnt[2], probe_max[2], resizes[2];
+	uint64_t probe_sum[2];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		name[i] = tables[i]->name;
+		size[i] = tables[i]->size;
+		cnt[i] = tables[i]->cnt;
+		probe_sum[i] = tables[i]->probe_sum;
+		probe_max[i] = tables[i]->probe_max;
+		resizes[i] = tables[i]->resizes;
+	}
+	packstr_array(name, 2, buffer);
+	pack32_array(size, 2, buffer);
+	pack32_array(cnt, 2, buffer);
+	pack64_array(probe_sum, 2, buffer);
+	pack32_array(probe_max, 2, buffer);
+	pack32_array(resizes, 2, buffer);
 }
 
 /* For the job array data structure, build the string representation of the
@@ -2966,15 +3590,11 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		}
 		return match_job_ptr;
 	} else {		/* Find specific task ID */
-		inx = JOB_ARRAY_HASH_INX(array_job_id, array_task_id);
-		job_ptr = job_array_hash_t[inx];
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == array_job_id) &&
-			    (job_ptr->array_task_id == array_task_id)) {
-				return job_ptr;
-			}
-			job_ptr = job_ptr->job_array_next_t;
-		}
+		job_ptr = _job_table_find(&job_task_table,
+					  JOB_TABLE_TASK_KEY(array_job_id,
+							     array_task_id));
+		if (job_ptr)
+			return job_ptr;
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
@@ -3002,12 +3622,7 @@ extern struct job_record *find_job_pack_record(uint32_t job_id,
 	struct job_record *pack_leader, *pack_job;
 	ListIterator iter;
 
-	pack_leader = job_hash[JOB_HASH_INX(job_id)];
-	while (pack_leader) {
-		if (pack_leader->job_id == job_id)
-			break;
-		pack_leader = pack_leader->job_next;
-	}
+	pack_leader = find_job_record(job_id);
 	if (!pack_leader)
 		return NULL;
 	if (pack_leader->pack_job_offset == pack_id)
@@ -3037,16 +3652,7 @@ extern struct job_record *find_job_pack_record(uint32_t job_id,
  */
 extern struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return _job_table_find(&job_id_table, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -4129,29 +4735,19 @@ int init_job_conf(void)
 }
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash tables or grow them to fit MaxJobCount.
  */
 extern void rehash_jobs(void)
 {
 	xassert(verify_lock(CONF_LOCK, READ_LOCK));
 	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
 
-	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = xcalloc(hash_table_size,
-				   sizeof(struct job_record *));
-		job_array_hash_j = xcalloc(hash_table_size,
-					   sizeof(struct job_record *));
-		job_array_hash_t = xcalloc(hash_table_size,
-					   sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
-	}
+	/*
+	 * The tables grow on demand, sizing them for MaxJobCount up front
+	 * just avoids rehashing while jobs are being recovered or submitted.
+	 */
+	_job_table_reserve(&job_id_table, slurmctld_conf.max_job_cnt);
+	_job_table_reserve(&job_task_table, slurmctld_conf.max_job_cnt);
 }
 
 /* Create an exact copy of an existing job record for a job array.
@@ -4161,7 +4757,7 @@ extern void rehash_jobs(void)
  * RET - The new job record, which is the new META job record. */
 extern struct job_record *job_array_split(struct job_record *job_ptr)
 {
-	struct job_record *job_ptr_pend = NULL, *save_job_next;
+	struct job_record *job_ptr_pend = NULL;
 	struct job_details *job_details, *details_new, *save_details;
 	uint32_t save_job_id;
 	uint64_t save_db_index = job_ptr->db_index;
@@ -4187,14 +4783,12 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	 * This could be done in parallel, but performance was worse.
 	 */
 	save_job_id   = job_ptr_pend->job_id;
-	save_job_next = job_ptr_pend->job_next;
 	save_details  = job_ptr_pend->details;
 	save_prio_factors = job_ptr_pend->prio_factors;
 	save_step_list = job_ptr_pend->step_list;
 	memcpy(job_ptr_pend, job_ptr, sizeof(struct job_record));
 
 	job_ptr_pend->job_id   = save_job_id;
-	job_ptr_pend->job_next = save_job_next;
 	job_ptr_pend->details  = save_details;
 	job_ptr_pend->db_flags = 0;
 	job_ptr_pend->step_list = save_step_list;
@@ -4255,8 +4849,8 @@ extern struct job_record *job_array_split(struct job_record *job_ptr)
 	memcpy(job_ptr_pend->limit_set.tres, job_ptr->limit_set.tres,
 	       sizeof(uint16_t) * slurmctld_tres_cnt);
 
-	_add_job_hash(job_ptr);		/* Sets job_next */
-	_add_job_hash(job_ptr_pend);	/* Sets job_next */
+	_add_job_hash(job_ptr);
+	_add_job_hash(job_ptr_pend);
 	_add_job_array_hash(job_ptr);
 	job_ptr_pend->job_resrcs = NULL;
 
@@ -9051,6 +9645,9 @@ static void _list_delete_job(void *job_entry)
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
+	_record_job_info_purge(job_ptr);
+	_record_job_state_purge(job_ptr);
+
 	/* Remove record from fed_job_list */
 	fed_mgr_remove_fed_job_info(job_ptr->job_id);
 
@@ -9313,27 +9910,29 @@ static bool _hide_job(struct job_record *job_ptr, uid_t uid,
 	return false;
 }
 
-static void _pack_job(struct job_record *job_ptr,
+/* Pack a job record if visible to the requester, RET true if packed */
+static bool _pack_job(struct job_record *job_ptr,
 		      _foreach_pack_job_info_t *pack_info)
 {
 	xassert (job_ptr->magic == JOB_MAGIC);
 
 	if ((pack_info->filter_uid != NO_VAL) &&
 	    (pack_info->filter_uid != job_ptr->user_id))
-		return;
+		return false;
 
 	if (((pack_info->show_flags & SHOW_ALL) == 0) &&
 	    (pack_info->uid != 0) &&
 	    _all_parts_hidden(job_ptr, pack_info->uid))
-		return;
+		return false;
 
 	if (_hide_job(job_ptr, pack_info->uid, pack_info->show_flags))
-		return;
+		return false;
 
 	pack_job(job_ptr, pack_info->show_flags, pack_info->buffer,
 		 pack_info->protocol_version, pack_info->uid);
 
 	(*pack_info->jobs_packed)++;
+	return true;
 }
 
 static int _foreach_pack_jobid(void *object, void *arg)
@@ -9461,6 +10060,198 @@ extern void pack_spec_jobs(char **buffer_ptr, int *buffer_size, List job_ids,
 	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
+/* 64-bit FNV-1a hash of a packed job record */
+static uint64_t _job_info_hash(char *data, uint32_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	if (hash == 0)	/* zero is reserved for "never packed" */
+		hash = 1;
+	return hash;
+}
+
+/*
+ * Bring every job record's info_seq up to date. Job records are changed in
+ * too many places to instrument each one, so changes are detected by packing
+ * each record and comparing a hash of the result with the previous one. This
+ * is done at most once per second in which last_job_update changed and the
+ * cost is shared by all clients polling for changes.
+ *
+ * Only time independent job state is hashed, otherwise every pending job
+ * would change on every refresh. Clients move a pending job's expected start
+ * time up to the time of their response themselves, see _merge_job_delta().
+ * The one change they can not derive is a job's begin time passing, which
+ * is added to the hash.
+ * job_info_seq_mutex must be locked, and a job read lock held.
+ */
+static void _refresh_job_info_seq(void)
+{
+	ListIterator itr;
+	struct job_record *job_ptr;
+	Buf buffer;
+	uint64_t hash;
+	time_t now;
+
+	if ((last_job_update < job_info_refresh_time) &&
+	    (last_part_update < job_info_refresh_time))
+		return;
+
+	/*
+	 * A partition change can alter which jobs a user may see without
+	 * changing the job records, force clients to do a full reload.
+	 */
+	if (last_part_update >= job_info_refresh_time)
+		job_info_min_seq = job_info_seq + 1;
+	now = time(NULL);
+	job_info_refresh_time = now;
+
+	buffer = init_buf(BUF_SIZE);
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		set_buf_offset(buffer, 0);
+		_pack_job_at(job_ptr, SHOW_ALL | SHOW_DETAIL, buffer,
+			     SLURM_PROTOCOL_VERSION, 0, 0);
+		pack8((IS_JOB_PENDING(job_ptr) && job_ptr->details &&
+		       (job_ptr->details->begin_time > now)), buffer);
+		hash = _job_info_hash(get_buf_data(buffer),
+				      get_buf_offset(buffer));
+		if (hash != job_ptr->info_hash) {
+			job_ptr->info_hash = hash;
+			job_ptr->info_seq = ++job_info_seq;
+		}
+	}
+	list_iterator_destroy(itr);
+	free_buf(buffer);
+}
+
+/* Record the removal of a job record for delta job info clients.
+ * A job write lock must be held. */
+static void _record_job_info_purge(struct job_record *job_ptr)
+{
+	job_info_purge_t *purge;
+
+	if (!job_ptr->info_hash)	/* Never reported to any client */
+		return;
+
+	slurm_mutex_lock(&job_info_seq_mutex);
+	if (!job_info_purged)
+		job_info_purged = xcalloc(JOB_INFO_PURGE_CNT,
+					  sizeof(job_info_purge_t));
+	purge = &job_info_purged[job_info_purge_next];
+	if (purge->seq)		/* Overwriting oldest, can't go back further */
+		job_info_min_seq = MAX(job_info_min_seq, purge->seq + 1);
+	purge->job_id = job_ptr->job_id;
+	purge->seq = ++job_info_seq;
+	job_info_purge_next = (job_info_purge_next + 1) % JOB_INFO_PURGE_CNT;
+	slurm_mutex_unlock(&job_info_seq_mutex);
+}
+
+/*
+ * pack_delta_jobs - dump information for jobs which changed since a
+ *	previous job information sequence number
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN epoch - epoch returned with the client's previous response, zero if none
+ * IN sequence - sequence number returned with the client's previous response
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * global: job_list - global list of job records
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: change _unpack_job_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern void pack_delta_jobs(char **buffer_ptr, int *buffer_size, time_t epoch,
+			    uint64_t sequence, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version)
+{
+	uint32_t jobs_packed = 0, purged_cnt = 0, purged_size = 0;
+	uint32_t count_offset, tmp_offset;
+	uint32_t *purged_ids = NULL;
+	uint16_t flags = 0;
+	uint64_t current_seq;
+	_foreach_pack_job_info_t pack_info = {0};
+	Buf buffer;
+	ListIterator itr;
+	struct job_record *job_ptr = NULL;
+	int i;
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	slurm_mutex_lock(&job_info_seq_mutex);
+	_refresh_job_info_seq();
+	current_seq = job_info_seq;
+	if ((epoch != slurmctld_config.boot_time) ||
+	    (sequence < job_info_min_seq) || (sequence > current_seq)) {
+		flags |= JOB_DELTA_FULL;
+		sequence = 0;
+	} else if (job_info_purged) {
+		for (i = 0; i < JOB_INFO_PURGE_CNT; i++) {
+			if (job_info_purged[i].seq <= sequence)
+				continue;
+			if (purged_cnt >= purged_size) {
+				purged_size += 64;
+				xrealloc(purged_ids,
+					 sizeof(uint32_t) * purged_size);
+			}
+			purged_ids[purged_cnt++] = job_info_purged[i].job_id;
+		}
+	}
+
+	buffer = init_buf(BUF_SIZE);
+
+	/* write message body header : delta position and records count */
+	/* put in a place holder job record count of 0 for now */
+	pack_time(slurmctld_config.boot_time, buffer);
+	pack64(current_seq, buffer);
+	pack16(flags, buffer);
+	count_offset = get_buf_offset(buffer);
+	pack32(jobs_packed, buffer);
+	pack_time(time(NULL), buffer);
+
+	/* write individual job records */
+	pack_info.buffer           = buffer;
+	pack_info.filter_uid       = NO_VAL;
+	pack_info.jobs_packed      = &jobs_packed;
+	pack_info.protocol_version = protocol_version;
+	pack_info.show_flags       = show_flags;
+	pack_info.uid              = uid;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(itr))) {
+		if (job_ptr->info_seq <= sequence)
+			continue;
+		if (_pack_job(job_ptr, &pack_info) || (flags & JOB_DELTA_FULL))
+			continue;
+		/* Job changed but is now hidden, remove from client's copy */
+		if (purged_cnt >= purged_size) {
+			purged_size += 64;
+			xrealloc(purged_ids, sizeof(uint32_t) * purged_size);
+		}
+		purged_ids[purged_cnt++] = job_ptr->job_id;
+	}
+	list_iterator_destroy(itr);
+	slurm_mutex_unlock(&job_info_seq_mutex);
+
+	pack32_array(purged_ids, purged_cnt, buffer);
+	xfree(purged_ids);
+
+	/* put the real record count in the message body header */
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, count_offset);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
 static int _pack_hetero_job(struct job_record *job_ptr, uint16_t show_flags,
 			    Buf buffer, uint16_t protocol_version, uid_t uid)
 {
@@ -9601,6 +10392,20 @@ static void _pack_job_gres(struct job_record *dump_job_ptr, Buf buffer,
  */
 void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 	      uint16_t protocol_version, uid_t uid)
+{
+	_pack_job_at(dump_job_ptr, show_flags, buffer, protocol_version, uid,
+		     time(NULL));
+}
+
+/*
+ * Pack a job record as seen at time "now". A "now" of zero packs only the
+ * time independent state used to detect changes, see _refresh_job_info_seq():
+ * a pending job's expected start time is not moved up to the current time
+ * and last_sched_eval, which every scheduling pass sets, is left out.
+ */
+static void _pack_job_at(struct job_record *dump_job_ptr, uint16_t show_flags,
+			 Buf buffer, uint16_t protocol_version, uid_t uid,
+			 time_t now)
 {
 	struct job_details *detail_ptr;
 	time_t accrue_time = 0, begin_time = 0, start_time = 0, end_time = 0;
@@ -9687,12 +10492,12 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		} else if (dump_job_ptr->start_time != 0) {
 			/* Report expected start time,
 			 * making sure that time is not in the past */
-			start_time = MAX(dump_job_ptr->start_time, time(NULL));
+			start_time = MAX(dump_job_ptr->start_time, now);
 			if (time_limit != NO_VAL) {
 				end_time = MAX(dump_job_ptr->end_time,
 					       (start_time + time_limit * 60));
 			}
-		} else	if (begin_time > time(NULL)) {
+		} else	if (begin_time > now) {
 			/* earliest start time in the future */
 			start_time = begin_time;
 			if (time_limit != NO_VAL) {
@@ -9706,7 +10511,7 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		pack_time(dump_job_ptr->suspend_time, buffer);
 		pack_time(dump_job_ptr->pre_sus_time, buffer);
 		pack_time(dump_job_ptr->resize_time, buffer);
-		pack_time(dump_job_ptr->last_sched_eval, buffer);
+		pack_time(now ? dump_job_ptr->last_sched_eval : 0, buffer);
 		pack_time(dump_job_ptr->preempt_time, buffer);
 		pack32(dump_job_ptr->priority, buffer);
 		packdouble(dump_job_ptr->billable_tres, buffer);
@@ -9907,12 +10712,12 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		} else if (dump_job_ptr->start_time != 0) {
 			/* Report expected start time,
 			 * making sure that time is not in the past */
-			start_time = MAX(dump_job_ptr->start_time, time(NULL));
+			start_time = MAX(dump_job_ptr->start_time, now);
 			if (time_limit != NO_VAL) {
 				end_time = MAX(dump_job_ptr->end_time,
 					       (start_time + time_limit * 60));
 			}
-		} else	if (begin_time > time(NULL)) {
+		} else	if (begin_time > now) {
 			/* earliest start time in the future */
 			start_time = begin_time;
 			if (time_limit != NO_VAL) {
@@ -9926,7 +10731,7 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		pack_time(dump_job_ptr->suspend_time, buffer);
 		pack_time(dump_job_ptr->pre_sus_time, buffer);
 		pack_time(dump_job_ptr->resize_time, buffer);
-		pack_time(dump_job_ptr->last_sched_eval, buffer);
+		pack_time(now ? dump_job_ptr->last_sched_eval : 0, buffer);
 		pack_time(dump_job_ptr->preempt_time, buffer);
 		pack32(dump_job_ptr->priority, buffer);
 		packdouble(dump_job_ptr->billable_tres, buffer);
@@ -13313,6 +14118,10 @@ fini:
 				   job_ptr->fed_details->siblings_active, uid);
 	}
 
+	/* Any change may let the job or others in its partitions start */
+	if (IS_JOB_PENDING(job_ptr))
+		sched_event_job(job_ptr);
+
 	return error_code;
 }
 
@@ -14738,12 +15547,15 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 void job_fini (void)
 {
 	FREE_NULL_LIST(job_list);
-	xfree(job_hash);
+	_job_table_free(&job_id_table);
+	_job_table_free(&job_task_table);
 	xfree(job_array_hash_j);
-	xfree(job_array_hash_t);
+	hash_table_size = 0;
 	FREE_NULL_LIST(purge_files_list);
 	FREE_NULL_BITMAP(requeue_exit);
 	FREE_NULL_BITMAP(requeue_exit_hold);
+	xfree(job_info_purged);
+	xfree(job_state_purged);
 }
 
 /* Record the start of one job array task */
@@ -14852,6 +15664,9 @@ extern void job_completion_logger(struct job_record *job_ptr, bool requeue)
 	if (job_ptr->bit_flags & JOB_WAS_RUNNING) {
 		job_ptr->bit_flags &= ~JOB_WAS_RUNNING;
 		was_running = true;
+	} else {
+		/* Pending job left the queue, its limits may be released */
+		sched_event_job(job_ptr);
 	}
 
 	_job_array_comp(job_ptr, was_running, requeue);
@@ -15310,6 +16125,7 @@ static int _suspend_job_nodes(struct job_record *job_ptr, bool indf_susp)
 			if (node_ptr->no_share_job_cnt == 0)
 				bit_set(share_node_bitmap, i);
 		}
+		sched_event_node(i);
 		node_flags = node_ptr->node_state & NODE_STATE_FLAGS;
 		if ((node_ptr->run_job_cnt  == 0) &&
 		    (node_ptr->comp_job_cnt == 0)) {
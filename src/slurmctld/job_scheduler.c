@@ -141,6 +141,16 @@ static int	build_queue_timeout = BUILD_TIMEOUT;
 static int	save_last_part_update = 0;
 
 static pthread_mutex_t sched_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Events since the last scheduling pass, see sched_event_*() */
+static pthread_mutex_t sched_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool sched_event_full = true;	/* test all pending jobs */
+static bitstr_t *sched_event_nodes = NULL; /* nodes with resources freed */
+static List sched_event_parts = NULL;	/* names of partitions in which
+					 * pending jobs changed or ended */
+static time_t sched_event_conf_update = 0;
+static time_t sched_event_part_update = 0;
+static time_t sched_event_resv_update = 0;
+static bool sched_incremental = false;
 static int sched_pend_thread = 0;
 static bool sched_running = false;
 static struct timeval sched_last = {0, 0};
@@ -152,6 +162,41 @@ static int sched_min_interval = 2;
 static int bb_array_stage_cnt = 10;
 extern diag_stats_t slurmctld_diag_stats;
 
+/*
+ * Order of the job queue last sorted by sort_job_queue(). Job queue records
+ * whose sort key is unchanged since then are kept in this order rather than
+ * sorted again.
+ */
+typedef struct {
+	uint32_t job_id;
+	uint32_t array_task_id;
+	struct part_record *part_ptr;
+} queue_id_t;
+
+typedef struct {
+	uint32_t has_resv;
+	uint32_t priority_tier;
+	uint32_t priority;
+	uint32_t array_job_id;		/* job_id if not a job array task */
+	uint32_t array_task_id;
+	time_t submit_time;
+} queue_key_t;
+
+typedef struct {
+	queue_id_t id;
+	queue_key_t key;
+} queue_index_rec_t;
+
+typedef struct {
+	queue_index_rec_t index_rec;
+	job_queue_rec_t *job_queue_rec;
+	bool indexed;			/* found in queue_index */
+} queue_sort_rec_t;
+
+static pthread_mutex_t queue_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static queue_index_rec_t *queue_index = NULL;
+static int queue_index_cnt = 0;
+
 /*
  * Calculate how busy the system is by figuring out how busy each node is.
  */
@@ -607,6 +652,100 @@ extern List build_job_queue(bool clear_start, bool backfill)
 	return job_queue;
 }
 
+/* Fetch key from job_equiv_t item. Called from function ptr */
+static void _job_equiv_key_id(void *item, const char **key, uint32_t *key_len)
+{
+	job_equiv_t *equiv = (job_equiv_t *) item;
+
+	*key = equiv->key;
+	*key_len = strlen(equiv->key);
+}
+
+/* Free job_equiv_t item. Called from function ptr */
+static void _job_equiv_free(void *item)
+{
+	job_equiv_t *equiv = (job_equiv_t *) item;
+
+	if (!equiv)
+		return;
+	xfree(equiv->key);
+	xfree(equiv);
+}
+
+extern xhash_t *job_equiv_create(void)
+{
+	return xhash_init(_job_equiv_key_id, _job_equiv_free);
+}
+
+extern job_equiv_t *job_equiv_add(xhash_t *table, char *key)
+{
+	job_equiv_t *equiv = xmalloc(sizeof(job_equiv_t));
+
+	equiv->key = key;
+	equiv->state_reason = WAIT_RESOURCES;
+	if (!xhash_add(table, equiv)) {
+		_job_equiv_free(equiv);
+		return NULL;
+	}
+	return equiv;
+}
+
+extern job_equiv_t *job_equiv_find(xhash_t *table, char *key)
+{
+	if (!table || !key)
+		return NULL;
+	return xhash_get_str(table, key);
+}
+
+extern char *job_equiv_key(struct job_record *job_ptr)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	multi_core_data_t *mc_ptr;
+	char *key = NULL;
+
+	/*
+	 * Which jobs a job may preempt depends upon its priority and QOS and
+	 * preempting them changes the result for the next job tested
+	 */
+	if (!detail_ptr || job_ptr->pack_job_id ||
+	    detail_ptr->expanding_jobid || slurm_preemption_enabled())
+		return NULL;
+
+	xstrfmtcat(key, "%p|%p|%u|%u|%s|%u|%u|%u|%u",
+		   job_ptr->part_ptr, job_ptr->resv_ptr, job_ptr->user_id,
+		   job_ptr->qos_id, job_ptr->account, job_ptr->time_limit,
+		   job_ptr->time_min, job_ptr->bit_flags & ~BACKFILL_TEST,
+		   job_ptr->req_switch);
+	xstrfmtcat(key, "|%u|%u|%u|%u|%u|%u|%u|%u|%"PRIu64"|%u",
+		   detail_ptr->min_nodes, detail_ptr->max_nodes,
+		   detail_ptr->num_tasks, detail_ptr->min_cpus,
+		   detail_ptr->max_cpus, detail_ptr->pn_min_cpus,
+		   detail_ptr->cpus_per_task, detail_ptr->ntasks_per_node,
+		   detail_ptr->pn_min_memory, detail_ptr->pn_min_tmp_disk);
+	xstrfmtcat(key, "|%u|%u|%u|%u|%u|%u|%u|%u|%u",
+		   detail_ptr->contiguous, detail_ptr->core_spec,
+		   detail_ptr->share_res, detail_ptr->whole_node,
+		   detail_ptr->overcommit, detail_ptr->task_dist,
+		   detail_ptr->plane_size, job_ptr->reboot,
+		   job_ptr->power_flags);
+	if ((mc_ptr = detail_ptr->mc_ptr)) {
+		xstrfmtcat(key, "|%u|%u|%u|%u|%u|%u|%u|%u",
+			   mc_ptr->boards_per_node, mc_ptr->sockets_per_board,
+			   mc_ptr->sockets_per_node, mc_ptr->cores_per_socket,
+			   mc_ptr->threads_per_core, mc_ptr->ntasks_per_board,
+			   mc_ptr->ntasks_per_socket, mc_ptr->ntasks_per_core);
+	}
+	xstrfmtcat(key, "|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s|%s",
+		   detail_ptr->req_nodes, detail_ptr->exc_nodes,
+		   detail_ptr->features, job_ptr->tres_per_job,
+		   job_ptr->tres_per_node, job_ptr->tres_per_socket,
+		   job_ptr->tres_per_task, job_ptr->cpus_per_tres,
+		   job_ptr->mem_per_tres, job_ptr->licenses,
+		   job_ptr->mcs_label, job_ptr->network);
+
+	return key;
+}
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * IN/OUT  eff_cg_bitmap - optional bitmap of all relevent completing nodes,
@@ -741,6 +880,151 @@ static bool _all_partition_priorities_same(void)
 	return result;
 }
 
+/*
+ * Note that all pending jobs must be tested by the next scheduling pass
+ * (e.g. after priorities are recalculated)
+ */
+extern void sched_event_all(void)
+{
+	if (!sched_incremental)
+		return;
+	slurm_mutex_lock(&sched_event_mutex);
+	sched_event_full = true;
+	slurm_mutex_unlock(&sched_event_mutex);
+}
+
+/*
+ * Note that a pending job changed, started or ended, so jobs queued behind it
+ * in its partitions must be tested by the next scheduling pass
+ */
+extern void sched_event_job(struct job_record *job_ptr)
+{
+	struct part_record *part_ptr;
+	ListIterator part_iterator;
+
+	if (!sched_incremental)
+		return;
+	slurm_mutex_lock(&sched_event_mutex);
+	if (sched_event_full) {
+		;
+	} else if (job_ptr->part_ptr_list) {
+		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
+		while ((part_ptr = list_next(part_iterator))) {
+			if (!list_find_first(sched_event_parts,
+					     slurm_find_char_in_list,
+					     part_ptr->name))
+				list_append(sched_event_parts,
+					    xstrdup(part_ptr->name));
+		}
+		list_iterator_destroy(part_iterator);
+	} else if (job_ptr->part_ptr) {
+		if (!list_find_first(sched_event_parts,
+				     slurm_find_char_in_list,
+				     job_ptr->part_ptr->name))
+			list_append(sched_event_parts,
+				    xstrdup(job_ptr->part_ptr->name));
+	} else {
+		sched_event_full = true;
+	}
+	slurm_mutex_unlock(&sched_event_mutex);
+}
+
+/*
+ * Note that resources on a node were freed or the node became available, so
+ * jobs in its partitions must be tested by the next scheduling pass
+ */
+extern void sched_event_node(int node_inx)
+{
+	if (!sched_incremental)
+		return;
+	slurm_mutex_lock(&sched_event_mutex);
+	if (sched_event_full) {
+		;
+	} else if (bit_size(sched_event_nodes) <= node_inx) {
+		sched_event_full = true;	/* node count changed */
+	} else {
+		bit_set(sched_event_nodes, node_inx);
+	}
+	slurm_mutex_unlock(&sched_event_mutex);
+}
+
+/*
+ * Collect and clear the events since the last scheduling pass
+ * IN full - set if this pass is to test all pending jobs anyway
+ * RET bitmap of nodes on which events happened, NULL if all pending jobs are
+ *	to be tested. Caller must free.
+ * NOTE: Caller must hold partition read lock.
+ */
+static bitstr_t *_sched_event_take(bool full)
+{
+	struct part_record *part_ptr;
+	bitstr_t *event_nodes = NULL;
+	char *part_name;
+
+	slurm_mutex_lock(&sched_event_mutex);
+	if ((sched_event_conf_update != slurmctld_conf.last_update) ||
+	    (sched_event_part_update != last_part_update) ||
+	    (sched_event_resv_update != last_resv_update) ||
+	    !sched_event_nodes ||
+	    (bit_size(sched_event_nodes) != node_record_count))
+		full = true;
+	if (!full && !sched_event_full) {
+		event_nodes = sched_event_nodes;
+		sched_event_nodes = NULL;
+		while ((part_name = list_pop(sched_event_parts))) {
+			if ((part_ptr = find_part_record(part_name)) &&
+			    part_ptr->node_bitmap)
+				bit_or(event_nodes, part_ptr->node_bitmap);
+			xfree(part_name);
+		}
+	}
+
+	sched_event_conf_update = slurmctld_conf.last_update;
+	sched_event_part_update = last_part_update;
+	sched_event_resv_update = last_resv_update;
+	sched_event_full = !sched_incremental;
+	FREE_NULL_BITMAP(sched_event_nodes);
+	sched_event_nodes = bit_alloc(node_record_count);
+	if (sched_event_parts)
+		list_flush(sched_event_parts);
+	else
+		sched_event_parts = list_create(slurm_destroy_char);
+	slurm_mutex_unlock(&sched_event_mutex);
+
+	return event_nodes;
+}
+
+/*
+ * Add back events which a scheduling pass ended before handling
+ * IN event_nodes - _sched_event_take() value, NULL if pass tested all jobs
+ */
+static void _sched_event_restore(bitstr_t *event_nodes)
+{
+	slurm_mutex_lock(&sched_event_mutex);
+	if (!event_nodes ||
+	    (bit_size(event_nodes) != bit_size(sched_event_nodes)))
+		sched_event_full = true;
+	else
+		bit_or(sched_event_nodes, event_nodes);
+	slurm_mutex_unlock(&sched_event_mutex);
+}
+
+/*
+ * Return true if a job was waiting for resources in a partition without events
+ * since the last pass, so it can not have become runnable
+ */
+static bool _job_unchanged(struct job_record *job_ptr,
+			   struct part_record *part_ptr, bitstr_t *event_nodes)
+{
+	if ((job_ptr->state_reason != WAIT_RESOURCES) &&
+	    (job_ptr->state_reason != WAIT_PRIORITY))
+		return false;
+	if (part_ptr->node_bitmap &&
+	    bit_overlap(part_ptr->node_bitmap, event_nodes))
+		return false;
+	return true;
+}
+
 /*
  * schedule - attempt to schedule all pending jobs
  *	pending jobs for each partition will be scheduled in priority
@@ -946,6 +1230,12 @@ static int _schedule(uint32_t job_limit)
 	bool fail_by_part;
 	uint32_t deadline_time_limit, save_time_limit = 0;
 	uint32_t prio_reserve;
+	xhash_t *equiv_table = NULL;
+	job_equiv_t *equiv;
+	char *equiv_key;
+	bitstr_t *event_nodes;
+	int unchanged_cnt = 0;
+	bool queue_end = false;
 #if HAVE_SYS_PRCTL_H
 	char get_name[16];
 #endif
@@ -1086,6 +1376,11 @@ static int _schedule(uint32_t job_limit)
 		else
 			reduce_completing_frag = false;
 
+		if (xstrcasestr(sched_params, "sched_incremental"))
+			sched_incremental = true;
+		else
+			sched_incremental = false;
+
 		if ((tmp_ptr = xstrcasestr(sched_params, "max_rpc_cnt=")))
 			defer_rpc_cnt = atoi(tmp_ptr + 12);
 		else if ((tmp_ptr = xstrcasestr(sched_params,
@@ -1275,6 +1570,7 @@ static int _schedule(uint32_t job_limit)
 	 *
 	 * In both cases, we test each partition associated with the job.
 	 */
+	event_nodes = _sched_event_take(fifo_sched || (job_limit == INFINITE));
 	if (fifo_sched) {
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_list);
 		job_iterator = list_iterator_create(job_list);
@@ -1289,8 +1585,10 @@ static int _schedule(uint32_t job_limit)
 			    IS_JOB_PENDING(job_ptr)) /* test job in next part */
 				goto next_part;
 			job_ptr = (struct job_record *) list_next(job_iterator);
-			if (!job_ptr)
+			if (!job_ptr) {
+				queue_end = true;
 				break;
+			}
 
 			/* When not fifo we do this in build_job_queue(). */
 			if (IS_JOB_PENDING(job_ptr))
@@ -1329,8 +1627,10 @@ next_part:			part_ptr = (struct part_record *)
 			}
 		} else {
 			job_queue_rec = list_pop(job_queue);
-			if (!job_queue_rec)
+			if (!job_queue_rec) {
+				queue_end = true;
 				break;
+			}
 			array_task_id = job_queue_rec->array_task_id;
 			job_ptr  = job_queue_rec->job_ptr;
 			part_ptr = job_queue_rec->part_ptr;
@@ -1362,6 +1662,22 @@ next_part:			part_ptr = (struct part_record *)
 		if (job_ptr->preempt_in_progress)
 			continue;	/* scheduled in another partition */
 
+		if (event_nodes &&
+		    _job_unchanged(job_ptr, job_ptr->part_ptr, event_nodes)) {
+			/*
+			 * Not runnable after the last pass and nothing has
+			 * happened since in its partition. A job waiting for
+			 * resources still reserves the partition's nodes
+			 * from lower priority jobs, as if tested again.
+			 */
+			unchanged_cnt++;
+			fail_by_part = (job_ptr->state_reason ==
+					WAIT_RESOURCES) &&
+				       !job_ptr->resv_name &&
+				       !job_ptr->details->req_node_bitmap;
+			goto fail_this_part;
+		}
+
 		if (job_ptr->pack_job_id) {
 			fail_by_part = true;
 			goto fail_this_part;
@@ -1619,14 +1935,41 @@ next_task:
 			job_ptr->time_limit = deadline_time_limit;
 		}
 
+		/*
+		 * Nodes only become less available during this pass, so a job
+		 * identical to one which could not start can not start either
+		 */
+		equiv_key = job_equiv_key(job_ptr);
+		if (equiv_key) {
+			slurmctld_diag_stats.schedule_equiv_lookups++;
+			if (!equiv_table)
+				equiv_table = job_equiv_create();
+		}
+		if ((equiv = job_equiv_find(equiv_table, equiv_key))) {
+			slurmctld_diag_stats.schedule_equiv_hits++;
+			xfree(equiv_key);
+			job_ptr->state_reason = equiv->state_reason;
+			xfree(job_ptr->state_desc);
+			last_job_update = now;
+			error_code = ESLURM_NODES_BUSY;
+			goto skip_start;
+		}
+
 		/* get fed job lock from origin cluster */
 		if (fed_mgr_job_lock(job_ptr)) {
+			xfree(equiv_key);
 			error_code = ESLURM_FED_JOB_LOCK;
 			goto skip_start;
 		}
 
 		error_code = select_nodes(job_ptr, false, NULL, NULL, false,
 					  SLURMDB_JOB_FLAG_SCHED);
+		if (equiv_key && (error_code == ESLURM_NODES_BUSY) &&
+		    (job_ptr->state_reason == WAIT_RESOURCES)) {
+			(void) job_equiv_add(equiv_table, equiv_key);
+			equiv_key = NULL;
+		}
+		xfree(equiv_key);
 
 		if (error_code == SLURM_SUCCESS) {
 			/*
@@ -1830,11 +2173,19 @@ fail_this_part:	if (fail_by_part) {
 	if (bb_wait_cnt)
 		(void) bb_g_job_try_stage_in();
 
+	if (event_nodes) {
+		sched_debug("skipped %d jobs without events on their partitions",
+			    unchanged_cnt);
+	}
+	if (!queue_end && sched_incremental)
+		_sched_event_restore(event_nodes);
+	FREE_NULL_BITMAP(event_nodes);
 	save_last_part_update = last_part_update;
 	FREE_NULL_BITMAP(avail_node_bitmap);
 	avail_node_bitmap = save_avail_node_bitmap;
 	xfree(failed_parts);
 	xfree(failed_resv);
+	xhash_free(equiv_table);
 	if (fifo_sched) {
 		if (job_iterator)
 			list_iterator_destroy(job_iterator);
@@ -1867,13 +2218,176 @@ out:
 	return job_cnt;
 }
 
+/* Return the sort_job_queue2() order of two queue keys */
+static int _queue_key_cmp(queue_key_t *key1, queue_key_t *key2)
+{
+	if (key1->has_resv != key2->has_resv)
+		return key1->has_resv ? -1 : 1;
+	if (key1->priority_tier != key2->priority_tier)
+		return (key1->priority_tier > key2->priority_tier) ? -1 : 1;
+	if (key1->priority != key2->priority)
+		return (key1->priority > key2->priority) ? -1 : 1;
+	if (key1->submit_time != key2->submit_time)
+		return (key1->submit_time < key2->submit_time) ? -1 : 1;
+	if (key1->array_job_id != key2->array_job_id)
+		return (key1->array_job_id < key2->array_job_id) ? -1 : 1;
+	if (key1->array_task_id != key2->array_task_id)
+		return (key1->array_task_id < key2->array_task_id) ? -1 : 1;
+	return 0;
+}
+
+static int _queue_sort_rec_cmp(const void *x, const void *y)
+{
+	queue_sort_rec_t *rec1 = *(queue_sort_rec_t **) x;
+	queue_sort_rec_t *rec2 = *(queue_sort_rec_t **) y;
+
+	return _queue_key_cmp(&rec1->index_rec.key, &rec2->index_rec.key);
+}
+
+static void _queue_sort_rec_id(void *item, const char **key, uint32_t *len)
+{
+	queue_sort_rec_t *sort_rec = item;
+
+	*key = (char *) &sort_rec->index_rec.id;
+	*len = sizeof(queue_id_t);
+}
+
+/*
+ * Set the sort key of a job queue record, the fields compared by
+ * sort_job_queue2() when neither preemption nor bf_hetjob_prio are in use
+ * RET false if the job has no details, so no submit time to compare
+ */
+static bool _queue_key_set(job_queue_rec_t *job_queue_rec, queue_key_t *key)
+{
+	struct job_record *job_ptr = job_queue_rec->job_ptr;
+
+	if (!job_ptr->details)
+		return false;
+	key->has_resv = (job_ptr->resv_id != 0);
+	key->priority_tier = job_queue_rec->part_ptr ?
+			     job_queue_rec->part_ptr->priority_tier : 0;
+	if (job_ptr->part_ptr_list && job_ptr->priority_array)
+		key->priority = job_queue_rec->priority;
+	else
+		key->priority = job_ptr->priority;
+	key->submit_time = job_ptr->details->submit_time;
+	if (job_queue_rec->array_task_id == NO_VAL)
+		key->array_job_id = job_queue_rec->job_id;
+	else
+		key->array_job_id = job_ptr->array_job_id;
+	key->array_task_id = job_queue_rec->array_task_id;
+	return true;
+}
+
+/*
+ * Sort the job queue using the order of the previous sort for records whose
+ * sort key did not change: those are taken in queue_index order, only the
+ * others are sorted, and the two sequences are merged.
+ * RET false if the keys do not describe the queue order, job_queue unchanged
+ */
+static bool _sort_by_index(List job_queue)
+{
+	queue_sort_rec_t *sort_recs, **kept, **moved, *sort_rec;
+	job_queue_rec_t *job_queue_rec;
+	ListIterator iter;
+	xhash_t *id_table;
+	int i, rec_cnt, kept_cnt = 0, moved_cnt = 0, k, m;
+
+	rec_cnt = list_count(job_queue);
+	sort_recs = xcalloc(rec_cnt + 1, sizeof(queue_sort_rec_t));
+	i = 0;
+	iter = list_iterator_create(job_queue);
+	while ((job_queue_rec = list_next(iter))) {
+		if ((i >= rec_cnt) ||
+		    !_queue_key_set(job_queue_rec, &sort_recs[i].index_rec.key))
+			break;
+		sort_recs[i].index_rec.id.job_id = job_queue_rec->job_id;
+		sort_recs[i].index_rec.id.array_task_id =
+			job_queue_rec->array_task_id;
+		sort_recs[i].index_rec.id.part_ptr = job_queue_rec->part_ptr;
+		sort_recs[i].job_queue_rec = job_queue_rec;
+		i++;
+	}
+	list_iterator_destroy(iter);
+	if (job_queue_rec) {
+		xfree(sort_recs);
+		return false;
+	}
+
+	id_table = xhash_init(_queue_sort_rec_id, NULL);
+	for (i = 0; i < rec_cnt; i++)
+		xhash_add(id_table, &sort_recs[i]);
+
+	kept = xcalloc(rec_cnt + 1, sizeof(queue_sort_rec_t *));
+	moved = xcalloc(rec_cnt + 1, sizeof(queue_sort_rec_t *));
+	slurm_mutex_lock(&queue_index_mutex);
+	for (i = 0; i < queue_index_cnt; i++) {
+		sort_rec = xhash_pop(id_table, (char *) &queue_index[i].id,
+				     sizeof(queue_id_t));
+		if (!sort_rec ||
+		    _queue_key_cmp(&sort_rec->index_rec.key,
+				   &queue_index[i].key))
+			continue;
+		sort_rec->indexed = true;
+		kept[kept_cnt++] = sort_rec;
+	}
+	xhash_free(id_table);
+
+	for (i = 0; i < rec_cnt; i++) {
+		if (!sort_recs[i].indexed)
+			moved[moved_cnt++] = &sort_recs[i];
+	}
+	if (moved_cnt > 1) {
+		qsort(moved, moved_cnt, sizeof(queue_sort_rec_t *),
+		      _queue_sort_rec_cmp);
+	}
+
+	/* Merge into the job queue and record the new order */
+	while (list_pop(job_queue))
+		;
+	xrecalloc(queue_index, rec_cnt + 1, sizeof(queue_index_rec_t));
+	queue_index_cnt = 0;
+	for (k = 0, m = 0; (k < kept_cnt) || (m < moved_cnt); ) {
+		if ((m >= moved_cnt) ||
+		    ((k < kept_cnt) &&
+		     (_queue_sort_rec_cmp(&kept[k], &moved[m]) <= 0)))
+			sort_rec = kept[k++];
+		else
+			sort_rec = moved[m++];
+		list_append(job_queue, sort_rec->job_queue_rec);
+		queue_index[queue_index_cnt++] = sort_rec->index_rec;
+	}
+	slurm_mutex_unlock(&queue_index_mutex);
+
+	debug2("%s: %d of %d job queue records sorted", __func__,
+	       moved_cnt, rec_cnt);
+	xfree(kept);
+	xfree(moved);
+	xfree(sort_recs);
+
+	return true;
+}
+
 /*
  * sort_job_queue - sort job_queue in descending priority order
  * IN/OUT job_queue - sorted job queue
  */
 extern void sort_job_queue(List job_queue)
 {
-	list_sort(job_queue, sort_job_queue2);
+	static time_t config_update = 0;
+	static bool preemption_enabled = true;
+
+	if (config_update != slurmctld_conf.last_update) {
+		preemption_enabled = slurm_preemption_enabled();
+		config_update = slurmctld_conf.last_update;
+	}
+
+	/*
+	 * Preemption and bf_hetjob_prio order jobs by comparing them pairwise,
+	 * which a persistent index of sort keys can not capture.
+	 */
+	if (preemption_enabled || bf_hetjob_prio || !_sort_by_index(job_queue))
+		list_sort(job_queue, sort_job_queue2);
 }
 
 /* Note this differs from the ListCmpF typedef since we want jobs sorted
@@ -4228,7 +4742,8 @@ extern void prolog_slurmctld(struct job_record *job_ptr)
 	pthread_t tid;
 
 	if ((slurmctld_conf.prolog_slurmctld == NULL) ||
-	    (slurmctld_conf.prolog_slurmctld[0] == '\0'))
+	    (slurmctld_conf.prolog_slurmctld[0] == '\0') ||
+	    slurmctld_config.sched_replay)
 		return;
 
 	if (access(slurmctld_conf.prolog_slurmctld, X_OK) < 0) {
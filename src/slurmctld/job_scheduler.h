@@ -42,6 +42,7 @@
 #ifndef _JOB_SCHEDULER_H
 #define _JOB_SCHEDULER_H
 
+#include "src/common/xhash.h"
 #include "src/slurmctld/slurmctld.h"
 
 typedef struct job_queue_rec {
@@ -53,6 +54,21 @@ typedef struct job_queue_rec {
 	uint32_t priority;		/* Job priority in THIS partition */
 } job_queue_rec_t;
 
+/*
+ * Result of testing a pending job in a scheduling pass, kept in a table by
+ * job_equiv_key() so that jobs with identical resource requests need not be
+ * tested again. Only failures are recorded: a job which can not start can
+ * not be started by an equivalent job either, while one that starts uses
+ * resources the next job would have needed.
+ */
+typedef struct job_equiv {
+	char *key;			/* job_equiv_key() value */
+	time_t start_time;		/* expected start time, 0 if unknown */
+	uint32_t state_reason;		/* reason the job could not start */
+	bool window_tested;		/* backfill: no start time found in the
+					 * whole window, not only now */
+} job_equiv_t;
+
 /*
  * build_feature_list - Translate a job's feature string into a feature_list
  * IN  details->features
@@ -94,6 +110,33 @@ extern void epilog_slurmctld(struct job_record *job_ptr);
  */
 extern void feature_list_delete(void *x);
 
+/*
+ * job_equiv_create - create a table of job_equiv_t records, free with
+ *	xhash_free()
+ */
+extern xhash_t *job_equiv_create(void);
+
+/*
+ * job_equiv_add - add a record for a job's equivalence class to the table
+ * IN key - job_equiv_key() value, moved into the record
+ * RET the new record, with state_reason WAIT_RESOURCES and other fields clear
+ */
+extern job_equiv_t *job_equiv_add(xhash_t *table, char *key);
+
+/* job_equiv_find - find the record for key, RET NULL if none */
+extern job_equiv_t *job_equiv_find(xhash_t *table, char *key);
+
+/*
+ * job_equiv_key - build a key shared by pending jobs which the select plugin
+ *	can not tell apart: same partition, reservation, user, QOS, time limit,
+ *	node, CPU, memory and TRES counts, constraints and layout options
+ * IN job_ptr - pending job, tested in job_ptr->part_ptr with its current
+ *	time_limit
+ * RET xmalloc'ed key or NULL if results for this job can not be shared, as for
+ *	heterogeneous jobs or when preemption is enabled
+ */
+extern char *job_equiv_key(struct job_record *job_ptr);
+
 /*
  * job_is_completing - Determine if jobs are in the process of completing.
  * IN/OUT  eff_cg_bitmap - optional bitmap of all relevent completing nodes,
@@ -171,6 +214,20 @@ extern int reboot_job_nodes(struct job_record *job_ptr);
  * actually used is first in the string. Needed for job state save/restore */
 extern void rebuild_job_part_list(struct job_record *job_ptr);
 
+/*
+ * With SchedulerParameters=sched_incremental, scheduling passes other than
+ * the periodic full one only test pending jobs which could have become
+ * runnable since the last pass. These note the events which make them so.
+ * sched_event_all - all pending jobs (e.g. priorities recalculated)
+ * sched_event_job - jobs behind a pending job which changed, started or
+ *	ended
+ * sched_event_node - jobs in partitions including a node whose resources
+ *	were freed or which became available
+ */
+extern void sched_event_all(void);
+extern void sched_event_job(struct job_record *job_ptr);
+extern void sched_event_node(int node_inx);
+
 /*
  * schedule - attempt to schedule all pending jobs
  *	pending jobs for each partition will be scheduled in priority
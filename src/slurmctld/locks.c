@@ -162,6 +162,21 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 		slurm_rwlock_unlock(&slurmctld_locks[CONF_LOCK]);
 }
 
+/*
+ * lock_slurmctld_delegate - Note that the calling thread works on behalf of
+ *	another thread which holds lock_levels
+ */
+extern void lock_slurmctld_delegate(slurmctld_lock_t lock_levels)
+{
+	xassert(_store_locks(lock_levels));
+}
+
+/* unlock_slurmctld_delegate - End lock_slurmctld_delegate() */
+extern void unlock_slurmctld_delegate(slurmctld_lock_t lock_levels)
+{
+	xassert(_clear_locks(lock_levels));
+}
+
 /*
  * _report_lock_set - report whether the read or write lock is set
  */
@@ -133,6 +133,17 @@ extern void lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/*
+ * lock_slurmctld_delegate - Note that the calling thread works on behalf of
+ *	another thread which holds lock_levels and waits on this thread while
+ *	it accesses the protected data. No locks are acquired, this only keeps
+ *	lock verification in development builds consistent.
+ */
+extern void lock_slurmctld_delegate(slurmctld_lock_t lock_levels);
+
+/* unlock_slurmctld_delegate - End lock_slurmctld_delegate() */
+extern void unlock_slurmctld_delegate(slurmctld_lock_t lock_levels);
+
 extern int report_locks_set(void);
 
 /* un/lock semaphore used for saving state of slurmctld */
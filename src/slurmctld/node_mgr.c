@@ -72,6 +72,7 @@
 
 #include "src/slurmctld/agent.h"
 #include "src/slurmctld/front_end.h"
+#include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/ping_nodes.h"
 #include "src/slurmctld/proc_req.h"
@@ -261,7 +262,7 @@ static Buf _open_node_state_file(char **state_file)
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/node_state");
 
-	if (!(buf = create_mmap_buf(*state_file)))
+	if (!(buf = open_state_file(*state_file)))
 		error("Could not open node state file %s: %m", *state_file);
 	else
 		return buf;
@@ -2509,6 +2510,7 @@ extern int validate_node_specs(slurm_node_registration_status_msg_t *reg_msg,
 		}
 	}
 	node_ptr->real_memory = reg_msg->real_memory;
+	node_sched_table_update(node_inx, slurmctld_conf.fast_schedule);
 
 	if (reg_msg->tmp_disk < config_ptr->tmp_disk) {
 		if (slurmctld_conf.fast_schedule == 0) {
@@ -3650,6 +3652,7 @@ extern void make_node_avail(int node_inx)
 	 * priority jobs on to newly available resources.
 	 */
 	bit_set(bf_ignore_node_bitmap, node_inx);
+	sched_event_node(node_inx);
 }
 
 /* make_node_comp - flag specified node as completing a job
@@ -3774,6 +3777,7 @@ void make_node_idle(struct node_record *node_ptr,
 		/* Not a replay */
 		last_job_update = now;
 		bit_clear(node_bitmap, inx);
+		sched_event_node(inx);
 
 		if (!IS_JOB_FINISHED(job_ptr))
 			job_update_tres_cnt(job_ptr, inx);
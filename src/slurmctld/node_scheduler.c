@@ -1796,7 +1796,7 @@ _get_req_features(struct node_set *node_set_ptr, int node_set_size,
 static void _sync_node_weight(struct node_set *node_set_ptr, int node_set_size)
 {
 	int i, i_first, i_last, s;
-	struct node_record *node_ptr;
+	uint64_t *sched_weight = node_sched_table.sched_weight;
 
 	for (s = 0; s < node_set_size; s++) {
 		if (!node_set_ptr[s].my_bitmap)
@@ -1809,8 +1809,7 @@ static void _sync_node_weight(struct node_set *node_set_ptr, int node_set_size)
 		for (i = i_first; i <= i_last; i++) {
 			if (!bit_test(node_set_ptr[s].my_bitmap, i))
 				continue;
-			node_ptr = node_record_table_ptr + i;
-			node_ptr->sched_weight = node_set_ptr[s].sched_weight;
+			sched_weight[i] = node_set_ptr[s].sched_weight;
 		}
 	}
 }
@@ -2137,7 +2136,7 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 			if (single_select_job_test && ((i+1) < node_set_size)) {
 				/*
 				 * Execute select_g_job_test() _once_ using
-				 * sched_weight in struct node_record as set
+				 * sched_weight in node_sched_table as set
 				 * by _sync_node_weight()
 				 */
 				continue;
@@ -2575,6 +2574,7 @@ static void _end_null_job(struct job_record *job_ptr)
 	(void) bb_g_job_begin(job_ptr);
 	job_array_start(job_ptr);
 	rebuild_job_part_list(job_ptr);
+	sched_event_job(job_ptr);
 	if ((job_ptr->mail_type & MAIL_JOB_BEGIN) &&
 	    ((job_ptr->mail_type & MAIL_ARRAY_TASKS) ||
 	     _first_array_task(job_ptr)))
@@ -3081,6 +3081,8 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	job_array_start(job_ptr);
 	build_node_details(job_ptr, true);
 	rebuild_job_part_list(job_ptr);
+	/* Jobs queued behind this one may have been waiting for it */
+	sched_event_job(job_ptr);
 
 	if (nonstop_ops.job_begin)
 		(nonstop_ops.job_begin)(job_ptr);
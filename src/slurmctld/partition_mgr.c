@@ -564,7 +564,7 @@ static Buf _open_part_state_file(char **state_file)
 
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/part_state");
-	buf = create_mmap_buf(*state_file);
+	buf = open_state_file(*state_file);
 	if (!buf) {
 		error("Could not open partition state file %s: %m",
 		      *state_file);
@@ -1072,6 +1072,26 @@ extern bool part_is_visible(struct part_record *part_ptr, uid_t uid)
 	return true;
 }
 
+static int _find_restricted_part(void *x, void *key)
+{
+	struct part_record *part_ptr = (struct part_record *) x;
+
+	if ((part_ptr->flags & PART_FLAG_HIDDEN) || part_ptr->allow_groups)
+		return 1;
+	return 0;
+}
+
+/*
+ * part_visibility_restricted - test if any partition is hidden or limited to
+ *	specific groups, in which case partition information differs by user
+ */
+extern bool part_visibility_restricted(void)
+{
+	xassert(verify_lock(PART_LOCK, READ_LOCK));
+
+	return (list_find_first(part_list, _find_restricted_part, NULL) != NULL);
+}
+
 /*
  * pack_all_part - dump all partition information for all partitions in
  *	machine independent form (for network transmission)
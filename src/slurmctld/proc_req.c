@@ -90,6 +90,7 @@
 #include "src/slurmctld/fed_mgr.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/gang.h"
+#include "src/slurmctld/info_snapshot.h"
 #include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
@@ -98,6 +99,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/slurmctld_plugstack.h"
@@ -151,6 +153,7 @@ inline static void  _slurm_rpc_dump_batch_script(slurm_msg_t *msg);
 inline static void  _slurm_rpc_dump_conf(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_front_end(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs_user(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_job_single(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_licenses(slurm_msg_t * msg);
@@ -179,6 +182,8 @@ inline static void  _slurm_rpc_job_will_run(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_alloc_info(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_pack_alloc_info(slurm_msg_t * msg);
 inline static void  _slurm_rpc_kill_job(slurm_msg_t *msg);
+inline static void  _slurm_rpc_node_heartbeat(slurm_msg_t *msg,
+					      bool running_composite);
 inline static void  _slurm_rpc_node_registration(slurm_msg_t *msg,
 						 bool running_composite);
 inline static void  _slurm_rpc_ping(slurm_msg_t * msg);
@@ -208,6 +213,7 @@ inline static void  _slurm_rpc_step_layout(slurm_msg_t * msg);
 inline static void  _slurm_rpc_step_update(slurm_msg_t * msg);
 inline static void  _slurm_rpc_submit_batch_job(slurm_msg_t * msg);
 inline static void  _slurm_rpc_submit_batch_pack_job(slurm_msg_t * msg);
+inline static void  _slurm_rpc_submit_batch_job_bulk(slurm_msg_t * msg);
 inline static void  _slurm_rpc_suspend(slurm_msg_t * msg);
 inline static void  _slurm_rpc_top_job(slurm_msg_t * msg);
 inline static void  _slurm_rpc_trigger_clear(slurm_msg_t * msg);
@@ -260,8 +266,8 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		fd_set_nonblocking(arg->newsockfd);
 
 #ifndef NDEBUG
-	if ((msg->flags & SLURM_DROP_PRIV))
-		drop_priv = true;
+	/* RPC worker threads are reused, clear any previous request's flag */
+	drop_priv = (msg->flags & SLURM_DROP_PRIV);
 #endif
 
 	/* Validate the credential */
@@ -342,6 +348,9 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	case REQUEST_JOB_INFO_SINGLE:
 		_slurm_rpc_dump_job_single(msg);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_slurm_rpc_dump_jobs_delta(msg);
+		break;
 	case REQUEST_BATCH_SCRIPT:
 		_slurm_rpc_dump_batch_script(msg);
 		break;
@@ -408,6 +417,9 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	case MESSAGE_NODE_REGISTRATION_STATUS:
 		_slurm_rpc_node_registration(msg, 0);
 		break;
+	case MESSAGE_NODE_HEARTBEAT:
+		_slurm_rpc_node_heartbeat(msg, 0);
+		break;
 	case REQUEST_JOB_ALLOCATION_INFO:
 		_slurm_rpc_job_alloc_info(msg);
 		break;
@@ -441,6 +453,9 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 	case REQUEST_SUBMIT_BATCH_JOB_PACK:
 		_slurm_rpc_submit_batch_pack_job(msg);
 		break;
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
+		_slurm_rpc_submit_batch_job_bulk(msg);
+		break;
 	case REQUEST_UPDATE_FRONT_END:
 		_slurm_rpc_update_front_end(msg);
 		break;
@@ -1805,54 +1820,191 @@ static void _slurm_rpc_dump_conf(slurm_msg_t * msg)
 	}
 }
 
+/*
+ * Return the SchedulerParameters info_max_age value, the number of seconds a
+ * published job or node information snapshot may be served after the
+ * underlying records have changed.
+ */
+static int _get_info_max_age(void)
+{
+	static time_t config_update = 0;
+	static int info_max_age = 0;
+
+	if (config_update != slurmctld_conf.last_update) {
+		char *sched_params = slurm_get_sched_params();
+		char *tmp_ptr;
+
+		info_max_age = 0;
+		if ((tmp_ptr = xstrcasestr(sched_params, "info_max_age="))) {
+			info_max_age = atoi(tmp_ptr + 13);
+			if (info_max_age < 0) {
+				error("Invalid info_max_age: %d",
+				      info_max_age);
+				info_max_age = 0;
+			}
+		}
+		xfree(sched_params);
+		config_update = slurmctld_conf.last_update;
+	}
+
+	return info_max_age;
+}
+
+/*
+ * Info snapshots are packed as seen by SlurmUser. Test if a request may be
+ * answered from one, which is the case unless partition visibility differs
+ * for the requesting user. Visibility was judged when the snapshot was built,
+ * so that judgement only holds if no partition changed since.
+ */
+static bool _snapshot_usable(info_snapshot_t *snapshot, uint16_t show_flags,
+			     uid_t uid)
+{
+	if (snapshot && snapshot->uid_independent &&
+	    (snapshot->build_time > last_part_update))
+		return true;
+	if ((show_flags & SHOW_ALL) || validate_slurm_user(uid))
+		return true;
+	return false;
+}
+
+/* Send a packed info RPC response from a snapshot or a private buffer */
+static void _send_info_buffer(slurm_msg_t *msg, uint16_t msg_type,
+			      info_snapshot_t *snapshot, char *dump,
+			      int dump_size)
+{
+	slurm_msg_t response_msg;
+
+	if (snapshot) {
+		dump = snapshot->buffer;
+		dump_size = snapshot->buffer_size;
+	}
+
+	response_init(&response_msg, msg);
+	response_msg.msg_type = msg_type;
+	response_msg.data = dump;
+	response_msg.data_size = dump_size;
+
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	if (snapshot)
+		info_snapshot_release(snapshot);
+	else
+		xfree(dump);
+}
+
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
 static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
-	slurm_msg_t response_msg;
+	char *dump = NULL;
+	int dump_size = 0;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
+	info_snapshot_t *snapshot = NULL;
+	bool restricted, use_snapshot;
 	/* Locks: Read config job part */
 	slurmctld_lock_t job_read_lock = {
 		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+	uint16_t show_flags = job_info_request_msg->show_flags;
+	time_t data_time;
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
-	lock_slurmctld(job_read_lock);
 
-	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
-		unlock_slurmctld(job_read_lock);
-		debug3("_slurm_rpc_dump_jobs, no change");
-		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
+	/*
+	 * Without private job data the full job table looks the same to
+	 * every user with the same view of the partitions, so answer from
+	 * the published snapshot if it is current (or within info_max_age).
+	 */
+	use_snapshot = (!job_info_request_msg->job_ids &&
+			!(slurmctld_conf.private_data & PRIVATE_DATA_JOBS));
+	if (use_snapshot) {
+		if ((job_info_request_msg->last_update - 1) >=
+		    last_job_update) {
+			debug3("_slurm_rpc_dump_jobs, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+		/* Hidden jobs depend on partition flags and access too */
+		data_time = MAX(last_job_update, last_part_update);
+		snapshot = info_snapshot_acquire(SNAPSHOT_JOB, show_flags,
+						 msg->protocol_version,
+						 data_time,
+						 _get_info_max_age());
+		if (snapshot && !_snapshot_usable(snapshot, show_flags, uid)) {
+			info_snapshot_release(snapshot);
+			snapshot = NULL;
+		}
+	}
+
+	if (!snapshot) {
+		lock_slurmctld(job_read_lock);
+
+		if ((job_info_request_msg->last_update - 1) >=
+		    last_job_update) {
+			unlock_slurmctld(job_read_lock);
+			debug3("_slurm_rpc_dump_jobs, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+
+		restricted = part_visibility_restricted();
 		if (job_info_request_msg->job_ids) {
 			pack_spec_jobs(&dump, &dump_size,
 				       job_info_request_msg->job_ids,
-				       job_info_request_msg->show_flags, uid,
-				       NO_VAL, msg->protocol_version);
+				       show_flags, uid, NO_VAL,
+				       msg->protocol_version);
+		} else if (use_snapshot &&
+			   (!restricted ||
+			    _snapshot_usable(NULL, show_flags, uid))) {
+			pack_all_jobs(&dump, &dump_size, show_flags, 0,
+				      NO_VAL, msg->protocol_version);
+			data_time = MAX(last_job_update, last_part_update);
+			snapshot = info_snapshot_publish(
+				SNAPSHOT_JOB, show_flags,
+				msg->protocol_version, data_time,
+				!restricted, dump, dump_size);
 		} else {
-			pack_all_jobs(&dump, &dump_size,
-				      job_info_request_msg->show_flags, uid,
+			pack_all_jobs(&dump, &dump_size, show_flags, uid,
 				      NO_VAL, msg->protocol_version);
 		}
 		unlock_slurmctld(job_read_lock);
-		END_TIMER2("_slurm_rpc_dump_jobs");
+	}
+	END_TIMER2("_slurm_rpc_dump_jobs");
 #if 0
-		info("_slurm_rpc_dump_jobs, size=%d %s", dump_size, TIME_STR);
+	info("_slurm_rpc_dump_jobs, size=%d %s", dump_size, TIME_STR);
 #endif
 
-		response_init(&response_msg, msg);
-		response_msg.msg_type = RESPONSE_JOB_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+	_send_info_buffer(msg, RESPONSE_JOB_INFO, snapshot, dump, dump_size);
+}
 
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
-	}
+/*
+ * _slurm_rpc_dump_jobs_delta - process RPC for job state information which
+ *	changed since the client's previous request
+ */
+static void _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	char *dump = NULL;
+	int dump_size = 0;
+	job_info_delta_request_msg_t *delta_req =
+		(job_info_delta_request_msg_t *) msg->data;
+	/* Locks: Read config job part */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+
+	START_TIMER;
+	debug3("Processing RPC: REQUEST_JOB_INFO_DELTA from uid=%d", uid);
+	lock_slurmctld(job_read_lock);
+	pack_delta_jobs(&dump, &dump_size, delta_req->epoch,
+			delta_req->sequence, delta_req->show_flags, uid,
+			msg->protocol_version);
+	unlock_slurmctld(job_read_lock);
+	END_TIMER2("_slurm_rpc_dump_jobs_delta");
+
+	_send_info_buffer(msg, RESPONSE_JOB_INFO_DELTA, NULL, dump, dump_size);
 }
 
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
@@ -2080,16 +2232,19 @@ static void _slurm_rpc_dump_front_end(slurm_msg_t * msg)
 static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
-	slurm_msg_t response_msg;
+	char *dump = NULL;
+	int dump_size = 0;
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
+	info_snapshot_t *snapshot = NULL;
+	bool restricted;
 	/* Locks: Read config, write node (reset allocated CPU count in some
 	 * select plugins), read part (for part_is_visible) */
 	slurmctld_lock_t node_write_lock = {
 		READ_LOCK, NO_LOCK, WRITE_LOCK, READ_LOCK, NO_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+	uint16_t show_flags = node_req_msg->show_flags;
+	time_t data_time;
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_NODE_INFO from uid=%d", uid);
@@ -2102,32 +2257,54 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 		return;
 	}
 
-	lock_slurmctld(node_write_lock);
-
-	select_g_select_nodeinfo_set_all();
-
 	if ((node_req_msg->last_update - 1) >= last_node_update) {
-		unlock_slurmctld(node_write_lock);
 		debug3("_slurm_rpc_dump_nodes, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
-		pack_all_node(&dump, &dump_size, node_req_msg->show_flags,
-			      uid, msg->protocol_version);
+		return;
+	}
+	/* Hidden nodes depend on partition flags and access too */
+	data_time = MAX(last_node_update, last_part_update);
+	snapshot = info_snapshot_acquire(SNAPSHOT_NODE, show_flags,
+					 msg->protocol_version, data_time,
+					 _get_info_max_age());
+	if (snapshot && !_snapshot_usable(snapshot, show_flags, uid)) {
+		info_snapshot_release(snapshot);
+		snapshot = NULL;
+	}
+
+	if (!snapshot) {
+		lock_slurmctld(node_write_lock);
+
+		select_g_select_nodeinfo_set_all();
+
+		if ((node_req_msg->last_update - 1) >= last_node_update) {
+			unlock_slurmctld(node_write_lock);
+			debug3("_slurm_rpc_dump_nodes, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+
+		restricted = part_visibility_restricted();
+		if (!restricted || _snapshot_usable(NULL, show_flags, uid)) {
+			pack_all_node(&dump, &dump_size, show_flags, 0,
+				      msg->protocol_version);
+			data_time = MAX(last_node_update, last_part_update);
+			snapshot = info_snapshot_publish(
+				SNAPSHOT_NODE, show_flags,
+				msg->protocol_version, data_time,
+				!restricted, dump, dump_size);
+		} else {
+			pack_all_node(&dump, &dump_size, show_flags, uid,
+				      msg->protocol_version);
+		}
 		unlock_slurmctld(node_write_lock);
-		END_TIMER2("_slurm_rpc_dump_nodes");
+	}
+	END_TIMER2("_slurm_rpc_dump_nodes");
 #if 0
-		info("_slurm_rpc_dump_nodes, size=%d %s", dump_size, TIME_STR);
+	info("_slurm_rpc_dump_nodes, size=%d %s", dump_size, TIME_STR);
 #endif
 
-		response_init(&response_msg, msg);
-		response_msg.msg_type = RESPONSE_NODE_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
-
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
-	}
+	_send_info_buffer(msg, RESPONSE_NODE_INFO, snapshot, dump, dump_size);
 }
 
 /* _slurm_rpc_dump_node_single - done RPC state information for one node */
@@ -2185,10 +2362,11 @@ static void _slurm_rpc_dump_node_single(slurm_msg_t * msg)
 static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 {
 	DEF_TIMERS;
-	char *dump;
-	int dump_size;
-	slurm_msg_t response_msg;
+	char *dump = NULL;
+	int dump_size = 0;
 	part_info_request_msg_t  *part_req_msg;
+	info_snapshot_t *snapshot = NULL;
+	bool restricted;
 
 	/* Locks: Read configuration and partition */
 	slurmctld_lock_t part_read_lock = {
@@ -2198,35 +2376,69 @@ static void _slurm_rpc_dump_partitions(slurm_msg_t * msg)
 	START_TIMER;
 	debug2("Processing RPC: REQUEST_PARTITION_INFO uid=%d", uid);
 	part_req_msg = (part_info_request_msg_t  *) msg->data;
-	lock_slurmctld(part_read_lock);
 
-	if ((slurmctld_conf.private_data & PRIVATE_DATA_PARTITIONS) &&
-	    !validate_operator(uid)) {
-		unlock_slurmctld(part_read_lock);
-		debug2("Security violation, PARTITION_INFO RPC from uid=%d",
-		       uid);
-		slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
-	} else if ((part_req_msg->last_update - 1) >= last_part_update) {
-		unlock_slurmctld(part_read_lock);
-		debug2("_slurm_rpc_dump_partitions, no change");
-		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
-	} else {
-		pack_all_part(&dump, &dump_size, part_req_msg->show_flags,
-			      uid, msg->protocol_version);
-		unlock_slurmctld(part_read_lock);
-		END_TIMER2("_slurm_rpc_dump_partitions");
-		debug2("_slurm_rpc_dump_partitions, size=%d %s",
-		       dump_size, TIME_STR);
+	/*
+	 * Partition records change rarely, so answer from the published
+	 * snapshot whenever possible without taking any slurmctld locks.
+	 * Snapshots are always packed with SHOW_ALL.
+	 */
+	if (!(slurmctld_conf.private_data & PRIVATE_DATA_PARTITIONS)) {
+		if ((part_req_msg->last_update - 1) >= last_part_update) {
+			debug2("_slurm_rpc_dump_partitions, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+		snapshot = info_snapshot_acquire(SNAPSHOT_PART, SHOW_ALL,
+						 msg->protocol_version,
+						 last_part_update, 0);
+		if (snapshot &&
+		    !_snapshot_usable(snapshot, part_req_msg->show_flags,
+				      uid)) {
+			info_snapshot_release(snapshot);
+			snapshot = NULL;
+		}
+	}
 
-		response_init(&response_msg, msg);
-		response_msg.msg_type = RESPONSE_PARTITION_INFO;
-		response_msg.data = dump;
-		response_msg.data_size = dump_size;
+	if (!snapshot) {
+		lock_slurmctld(part_read_lock);
 
-		/* send message */
-		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		if ((slurmctld_conf.private_data & PRIVATE_DATA_PARTITIONS) &&
+		    !validate_operator(uid)) {
+			unlock_slurmctld(part_read_lock);
+			debug2("Security violation, PARTITION_INFO RPC "
+			       "from uid=%d", uid);
+			slurm_send_rc_msg(msg, ESLURM_ACCESS_DENIED);
+			return;
+		} else if ((part_req_msg->last_update - 1) >=
+			   last_part_update) {
+			unlock_slurmctld(part_read_lock);
+			debug2("_slurm_rpc_dump_partitions, no change");
+			slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
+			return;
+		}
+
+		restricted = part_visibility_restricted();
+		if (!restricted ||
+		    _snapshot_usable(NULL, part_req_msg->show_flags, uid)) {
+			pack_all_part(&dump, &dump_size, SHOW_ALL, uid,
+				      msg->protocol_version);
+			snapshot = info_snapshot_publish(
+				SNAPSHOT_PART, SHOW_ALL,
+				msg->protocol_version, last_part_update,
+				!restricted, dump, dump_size);
+		} else {
+			pack_all_part(&dump, &dump_size,
+				      part_req_msg->show_flags, uid,
+				      msg->protocol_version);
+		}
+		unlock_slurmctld(part_read_lock);
 	}
+	END_TIMER2("_slurm_rpc_dump_partitions");
+	debug2("_slurm_rpc_dump_partitions, size=%d %s",
+	       snapshot ? snapshot->buffer_size : dump_size, TIME_STR);
+
+	_send_info_buffer(msg, RESPONSE_PARTITION_INFO, snapshot, dump,
+			  dump_size);
 }
 
 /* _slurm_rpc_epilog_complete - process RPC noting the completion of
@@ -3127,6 +3339,42 @@ static void _slurm_rpc_node_registration(slurm_msg_t * msg,
 	}
 }
 
+/*
+ * _slurm_rpc_node_heartbeat - process heartbeat pushed by a slurmd through
+ *	the message aggregation collectors. It records the same state as a
+ *	reply to REQUEST_PING, so ping_nodes() skips the node while its
+ *	heartbeats keep arriving. There is no response.
+ */
+static void _slurm_rpc_node_heartbeat(slurm_msg_t *msg,
+				      bool running_composite)
+{
+	DEF_TIMERS;
+	node_heartbeat_msg_t *heartbeat_msg =
+		(node_heartbeat_msg_t *) msg->data;
+	/* Locks: Write node */
+	slurmctld_lock_t node_write_lock = {
+		NO_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK, NO_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+
+	START_TIMER;
+	debug3("Processing RPC: MESSAGE_NODE_HEARTBEAT from uid=%d", uid);
+	if (!validate_slurm_user(uid)) {
+		error("Security violation, NODE_HEARTBEAT RPC from uid=%d",
+		      uid);
+		return;
+	}
+
+	if (!running_composite)
+		lock_slurmctld(node_write_lock);
+	node_did_resp(heartbeat_msg->node_name);
+	reset_node_load(heartbeat_msg->node_name, heartbeat_msg->cpu_load);
+	reset_node_free_mem(heartbeat_msg->node_name,
+			    heartbeat_msg->free_mem);
+	if (!running_composite)
+		unlock_slurmctld(node_write_lock);
+	END_TIMER2("_slurm_rpc_node_heartbeat");
+}
+
 /* _slurm_rpc_job_alloc_info - process RPC to get details on existing job */
 static void _slurm_rpc_job_alloc_info(slurm_msg_t * msg)
 {
@@ -4030,6 +4278,151 @@ send_msg:
 	xfree(job_submit_user_msg);
 }
 
+/*
+ * _slurm_rpc_submit_batch_job_bulk - process RPC to submit many independent
+ *	batch jobs. Every job is validated first, then all of the valid jobs
+ *	are created under a single job write lock.
+ */
+static void _slurm_rpc_submit_batch_job_bulk(slurm_msg_t *msg)
+{
+	static int active_rpc_cnt = 0;
+	int error_code = SLURM_SUCCESS, i, job_cnt, alloc_cnt = 0;
+	DEF_TIMERS;
+	struct job_record *job_ptr;
+	slurm_msg_t response_msg;
+	submit_bulk_response_msg_t bulk_msg;
+	List job_req_list = (List) msg->data;
+	job_desc_msg_t *job_desc_msg;
+	ListIterator iter;
+	/* Locks: Read config, read job, read node, read partition */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+	/* Locks: Read config, write job, write node, read partition, read
+	 * federation */
+	slurmctld_lock_t job_write_lock = {
+		READ_LOCK, WRITE_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred);
+	gid_t gid = g_slurm_auth_get_gid(msg->auth_cred);
+	char *hostname = g_slurm_auth_get_host(msg->auth_cred);
+	char *err_msg = NULL, *job_submit_user_msg = NULL;
+
+	START_TIMER;
+	job_cnt = job_req_list ? list_count(job_req_list) : 0;
+	debug2("Processing RPC: REQUEST_SUBMIT_BATCH_JOB_BULK of %d jobs from uid=%d",
+	       job_cnt, uid);
+	if (slurmctld_config.submissions_disabled) {
+		info("Submissions disabled on system");
+		error_code = ESLURM_SUBMISSIONS_DISABLED;
+	} else if ((job_cnt == 0) || (job_cnt > SUBMIT_BULK_MAX_JOBS)) {
+		info("REQUEST_SUBMIT_BATCH_JOB_BULK from uid=%d has invalid job count (%d)",
+		     uid, job_cnt);
+		error_code = SLURM_ERROR;
+	} else if (fed_mgr_fed_rec) {
+		/* Each job would need its own sibling negotiation */
+		info("REQUEST_SUBMIT_BATCH_JOB_BULK not supported in federation");
+		error_code = ESLURM_NOT_SUPPORTED;
+	}
+	if (error_code) {
+		xfree(hostname);
+		END_TIMER2("_slurm_rpc_submit_batch_job_bulk");
+		slurm_send_rc_msg(msg, error_code);
+		return;
+	}
+
+	memset(&bulk_msg, 0, sizeof(bulk_msg));
+	bulk_msg.job_cnt = job_cnt;
+	bulk_msg.job_id = xcalloc(job_cnt, sizeof(uint32_t));
+	bulk_msg.error_code = xcalloc(job_cnt, sizeof(uint32_t));
+
+	/* Locks are for job_submit plugin use */
+	lock_slurmctld(job_read_lock);
+	iter = list_iterator_create(job_req_list);
+	for (i = 0; (job_desc_msg = list_next(iter)); i++) {
+		if ((error_code = _valid_id("REQUEST_SUBMIT_BATCH_JOB_BULK",
+					    job_desc_msg, uid, gid))) {
+			bulk_msg.error_code[i] = error_code;
+			continue;
+		}
+
+		/* use the credential to validate where we came from */
+		if (hostname) {
+			xfree(job_desc_msg->alloc_node);
+			job_desc_msg->alloc_node = xstrdup(hostname);
+		}
+		if ((job_desc_msg->alloc_node == NULL) ||
+		    (job_desc_msg->alloc_node[0] == '\0')) {
+			error("REQUEST_SUBMIT_BATCH_JOB_BULK lacks alloc_node from uid=%d",
+			      uid);
+			bulk_msg.error_code[i] = ESLURM_INVALID_NODE_NAME;
+			continue;
+		}
+
+		dump_job_desc(job_desc_msg);
+
+		job_desc_msg->pack_job_offset = NO_VAL;
+		bulk_msg.error_code[i] =
+			validate_job_create_req(job_desc_msg, uid, &err_msg);
+		if (err_msg) {
+			xstrfmtcat(job_submit_user_msg, "%sjob %d: %s",
+				   job_submit_user_msg ? "\n" : "", i, err_msg);
+			xfree(err_msg);
+		}
+	}
+	list_iterator_destroy(iter);
+	unlock_slurmctld(job_read_lock);
+	xfree(hostname);
+
+	_throttle_start(&active_rpc_cnt);
+	lock_slurmctld(job_write_lock);
+	START_TIMER;	/* Restart after we have locks */
+	iter = list_iterator_create(job_req_list);
+	for (i = 0; (job_desc_msg = list_next(iter)); i++) {
+		if (bulk_msg.error_code[i])
+			continue;
+		job_ptr = NULL;
+		job_desc_msg->pack_job_offset = NO_VAL;
+		error_code = job_allocate(job_desc_msg,
+					  job_desc_msg->immediate,
+					  false, NULL, 0, uid, &job_ptr,
+					  &err_msg,
+					  msg->protocol_version);
+		if (job_desc_msg->immediate && error_code)
+			error_code = ESLURM_CAN_NOT_START_IMMEDIATELY;
+		else if (job_ptr &&
+			 (!error_code || (job_ptr->job_state != JOB_FAILED))) {
+			bulk_msg.job_id[i] = job_ptr->job_id;
+			alloc_cnt++;
+		}
+		bulk_msg.error_code[i] = error_code;
+		if (err_msg) {
+			xstrfmtcat(job_submit_user_msg, "%sjob %d: %s",
+				   job_submit_user_msg ? "\n" : "", i, err_msg);
+			xfree(err_msg);
+		}
+	}
+	list_iterator_destroy(iter);
+	unlock_slurmctld(job_write_lock);
+	_throttle_fini(&active_rpc_cnt);
+	END_TIMER2("_slurm_rpc_submit_batch_job_bulk");
+
+	info("%s: created %d of %d jobs %s",
+	     __func__, alloc_cnt, job_cnt, TIME_STR);
+	bulk_msg.job_submit_user_msg = job_submit_user_msg;
+	response_init(&response_msg, msg);
+	response_msg.msg_type = RESPONSE_SUBMIT_BATCH_JOB_BULK;
+	response_msg.data = &bulk_msg;
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+
+	if (alloc_cnt) {
+		schedule_job_save();	/* Has own locks */
+		schedule_node_save();	/* Has own locks */
+		queue_job_scheduler();
+	}
+	xfree(bulk_msg.job_id);
+	xfree(bulk_msg.error_code);
+	xfree(job_submit_user_msg);
+}
+
 /* _slurm_rpc_submit_batch_pack_job - process RPC to submit a batch pack job */
 static void _slurm_rpc_submit_batch_pack_job(slurm_msg_t *msg)
 {
@@ -6125,6 +6518,12 @@ static void _pack_rpc_stats(int resp, char **buffer_ptr, int *buffer_size,
 
 		agent_pack_pending_rpc_stats(buffer);
 
+		if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+			rpc_queue_pack_stats(buffer);
+			pack_state_load_stats(buffer);
+			job_hash_pack_stats(buffer);
+		}
+
 	}
 
 	slurm_mutex_unlock(&rpc_mutex);
@@ -6567,6 +6966,9 @@ static void  _slurm_rpc_comp_msg_list(composite_msg_t * comp_msg,
 		case MESSAGE_NODE_REGISTRATION_STATUS:
 			_slurm_rpc_node_registration(next_msg, 1);
 			break;
+		case MESSAGE_NODE_HEARTBEAT:
+			_slurm_rpc_node_heartbeat(next_msg, 1);
+			break;
 		default:
 			error("_slurm_rpc_comp_msg_list: invalid msg type");
 			break;
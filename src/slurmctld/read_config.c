@@ -90,6 +90,7 @@
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/srun_comm.h"
+#include "src/slurmctld/state_save.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 #define FEATURE_MAGIC	0x34dfd8b5
@@ -1096,6 +1097,8 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *mpi_params;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
 	bool cgroup_mem_confinement = false;
+	bool time_recovery = (!reconfig && recover && !test_config);
+	struct timeval load_start = { 0, 0 }, phase_start = { 0, 0 };
 
 	/* initialization */
 	START_TIMER;
@@ -1143,6 +1146,11 @@ int read_slurm_conf(int recover, bool reconfig)
 	if (reconfig)
 		xcgroup_reconfig_slurm_cgroup_conf();
 
+	if (time_recovery) {
+		clear_state_load_phases();
+		prefetch_state_files(recover);
+	}
+
 	cgroup_mem_confinement = xcgroup_mem_cgroup_job_confinement();
 
 	if (slurmctld_conf.job_acct_oom_kill && cgroup_mem_confinement)
@@ -1192,7 +1200,7 @@ int read_slurm_conf(int recover, bool reconfig)
 		load_config_state_lite();
 
 		/* store new config */
-		if (!test_config)
+		if (!test_config && !slurmctld_config.sched_replay)
 			dump_config_state_lite();
 	}
 	update_logging();
@@ -1227,6 +1235,7 @@ int read_slurm_conf(int recover, bool reconfig)
 		_purge_old_node_state(old_node_table_ptr,
 				      old_node_record_count);
 		_purge_old_part_state(old_part_list, old_def_part_name);
+		prefetch_state_files_fini();
 		return EINVAL;
 	}
 
@@ -1307,24 +1316,37 @@ int read_slurm_conf(int recover, bool reconfig)
 		reset_first_job_id();
 		(void) slurm_sched_g_reconfig();
 	} else if (recover == 1) {	/* Load job & node state files */
+		gettimeofday(&load_start, NULL);
+		phase_start = load_start;
 		(void) load_all_node_state(true);
 		_set_features(node_record_table_ptr, node_record_count,
 			      recover);
+		record_state_load_phase("node_state", &phase_start);
 		(void) load_all_front_end_state(true);
+		record_state_load_phase("front_end_state", &phase_start);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		record_state_load_phase("job_state", &phase_start);
 	} else if (recover > 1) {	/* Load node, part & job state files */
+		gettimeofday(&load_start, NULL);
+		phase_start = load_start;
 		(void) load_all_node_state(false);
 		_set_features(old_node_table_ptr, old_node_record_count,
 			      recover);
+		record_state_load_phase("node_state", &phase_start);
 		(void) load_all_front_end_state(false);
+		record_state_load_phase("front_end_state", &phase_start);
 		(void) load_all_part_state();
+		record_state_load_phase("part_state", &phase_start);
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
+		record_state_load_phase("job_state", &phase_start);
 	}
 
 	_sync_part_prio();
 	_build_bitmaps_pre_select();
+	node_sched_table_init(node_record_table_ptr, node_record_count,
+			      slurmctld_conf.fast_schedule);
 	if ((select_g_node_init(node_record_table_ptr, node_record_count)
 	     != SLURM_SUCCESS)						||
 	    (select_g_block_init(part_list) != SLURM_SUCCESS)		||
@@ -1344,6 +1366,8 @@ int read_slurm_conf(int recover, bool reconfig)
 	reset_job_bitmaps();		/* must follow select_g_job_init() */
 
 	(void) _sync_nodes_to_jobs(reconfig);
+	if (time_recovery)
+		record_state_load_phase("job_node_sync", &phase_start);
 	(void) sync_job_files();
 	_purge_old_node_state(old_node_table_ptr, old_node_record_count);
 	_purge_old_part_state(old_part_list, old_def_part_name);
@@ -1408,9 +1432,17 @@ int read_slurm_conf(int recover, bool reconfig)
 	if (reconfig) {
 		load_all_resv_state(0);
 	} else {
+		if (time_recovery)
+			gettimeofday(&phase_start, NULL);
 		load_all_resv_state(recover);
 		if (recover >= 1) {
+			if (time_recovery)
+				record_state_load_phase("resv_state",
+							&phase_start);
 			trigger_state_restore();
+			if (time_recovery)
+				record_state_load_phase("trigger_state",
+							&phase_start);
 			(void) slurm_sched_g_reconfig();
 		}
 	}
@@ -1480,6 +1512,10 @@ int read_slurm_conf(int recover, bool reconfig)
 	_set_response_cluster_rec();
 
 	slurmctld_conf.last_update = time(NULL);
+	if (time_recovery) {
+		prefetch_state_files_fini();
+		record_state_load_phase("total", &load_start);
+	}
 	END_TIMER2("read_slurm_conf");
 	return error_code;
 }
@@ -0,0 +1,777 @@
+/*****************************************************************************\
+ *  rpc_queue.c - Worker thread pool and per-class queues for slurmctld RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#if HAVE_SYS_PRCTL_H
+#  include <sys/prctl.h>
+#endif
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "src/common/fd.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+#define DEFAULT_RPC_WORKERS	64
+#define DEFAULT_RPC_QUEUE_DEPTH	64
+#define RPC_FAIRNESS_INTERVAL	8	/* every Nth pick takes oldest message */
+#define RPC_MAX_READING		(MAX_SERVER_THREADS * 4)
+/* Same limit as slurm_msg_recvfrom_timeout() */
+#define RPC_MAX_MSG_SIZE	(1024 * 1024 * 1024)
+
+/* In priority order */
+typedef enum {
+	RPC_CLASS_COMPLETE,	/* job, step and epilog completion */
+	RPC_CLASS_NODE,		/* node registration */
+	RPC_CLASS_OTHER,	/* everything else */
+	RPC_CLASS_SUBMIT,	/* job submission and update */
+	RPC_CLASS_INFO,		/* state information queries */
+	RPC_CLASS_COUNT
+} rpc_class_t;
+
+/* A connection being read by the event loop */
+typedef struct {
+	connection_arg_t *conn;
+	uint32_t msglen;	/* from the 4 byte length header */
+	uint32_t hdr_got;	/* bytes of length header read */
+	char *buf;		/* message body, NULL until header is read */
+	uint32_t got;		/* bytes of message body read */
+	time_t deadline;	/* MessageTimeout after accept */
+} rpc_frame_t;
+
+typedef struct {
+	connection_arg_t *conn;
+	slurm_msg_t msg;
+	int recv_errno;
+	struct timeval queue_time;
+} rpc_work_t;
+
+typedef struct {
+	char *name;
+	bool urgent;		/* process before reading new connections */
+	int active_ratio;	/* if set, workers/active_ratio may be busy */
+	/* protected by rpc_queue_mutex */
+	List queue;		/* rpc_work_t records */
+	uint32_t active;	/* workers processing this class */
+	uint32_t max_active;
+	uint32_t max_depth;	/* statistics since last reset */
+	uint32_t cnt;
+	uint64_t wait_time;	/* usec */
+	uint64_t max_wait;	/* usec */
+} rpc_class_rec_t;
+
+static rpc_class_rec_t rpc_classes[RPC_CLASS_COUNT] = {
+	[RPC_CLASS_COMPLETE] = { .name = "complete", .urgent = true },
+	[RPC_CLASS_NODE]     = { .name = "node", .urgent = true },
+	[RPC_CLASS_OTHER]    = { .name = "other" },
+	[RPC_CLASS_SUBMIT]   = { .name = "submit", .active_ratio = 4 },
+	[RPC_CLASS_INFO]     = { .name = "info", .active_ratio = 2 },
+};
+
+static pthread_mutex_t rpc_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static List      frame_queue = NULL;	/* fully read, not yet unpacked */
+static uint32_t  reading_cnt = 0;	/* connections being read */
+static uint32_t  queue_depth = DEFAULT_RPC_QUEUE_DEPTH;
+static uint32_t  pick_cnt = 0;
+static bool      rpc_queue_stop = false;
+static pthread_t *worker_ids = NULL;
+static uint32_t  worker_cnt = 0;
+
+static rpc_class_t _rpc_class(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_COMPLETE_PROLOG:
+	case REQUEST_STEP_COMPLETE:
+	case MESSAGE_EPILOG_COMPLETE:
+	case MESSAGE_COMPOSITE:
+		return RPC_CLASS_COMPLETE;
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+		return RPC_CLASS_NODE;
+	case REQUEST_SUBMIT_BATCH_JOB:
+	case REQUEST_SUBMIT_BATCH_JOB_PACK:
+	case REQUEST_SUBMIT_BATCH_JOB_BULK:
+	case REQUEST_RESOURCE_ALLOCATION:
+	case REQUEST_JOB_PACK_ALLOCATION:
+	case REQUEST_JOB_WILL_RUN:
+	case REQUEST_UPDATE_JOB:
+		return RPC_CLASS_SUBMIT;
+	case REQUEST_ASSOC_MGR_INFO:
+	case REQUEST_BUILD_INFO:
+	case REQUEST_BURST_BUFFER_INFO:
+	case REQUEST_FED_INFO:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_LAYOUT_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_SINGLE:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_POWERCAP_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_TOPO_INFO:
+	case REQUEST_TRIGGER_GET:
+		return RPC_CLASS_INFO;
+	default:
+		return RPC_CLASS_OTHER;
+	}
+}
+
+static void _free_work(void *x)
+{
+	rpc_work_t *work = (rpc_work_t *) x;
+
+	if (work->conn && (work->conn->newsockfd >= 0))
+		close(work->conn->newsockfd);
+	slurm_free_msg_members(&work->msg);
+	xfree(work->conn);
+	xfree(work);
+	server_thread_decr();
+}
+
+static void _close_frame(rpc_frame_t *frame)
+{
+	close(frame->conn->newsockfd);
+	xfree(frame->conn);
+	xfree(frame->buf);
+	xfree(frame);
+}
+
+/* Free a frame that was counted against the server thread limit */
+static void _free_frame(void *x)
+{
+	_close_frame((rpc_frame_t *) x);
+	server_thread_decr();
+}
+
+static bool _class_runnable(rpc_class_rec_t *class)
+{
+	if (!list_count(class->queue))
+		return false;
+	if (class->max_active && (class->active >= class->max_active))
+		return false;
+	return true;
+}
+
+/* Return true if any class queue is at its depth limit.
+ * rpc_queue_mutex must be locked */
+static bool _queues_full(void)
+{
+	int i;
+
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		if (list_count(rpc_classes[i].queue) >= queue_depth)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Pick the next class to process, normally the first runnable class in
+ * priority order. To keep the low priority classes from starving, every
+ * RPC_FAIRNESS_INTERVAL picks take the class with the oldest message instead.
+ * rpc_queue_mutex must be locked
+ * IN urgent_only - only consider urgent classes
+ * RET class index or -1 if nothing is runnable
+ */
+static int _pick_class(bool urgent_only)
+{
+	rpc_work_t *work, *oldest = NULL;
+	int i, inx = -1;
+
+	if (!urgent_only && ((++pick_cnt % RPC_FAIRNESS_INTERVAL) == 0)) {
+		for (i = 0; i < RPC_CLASS_COUNT; i++) {
+			if (!_class_runnable(&rpc_classes[i]))
+				continue;
+			work = list_peek(rpc_classes[i].queue);
+			if (!oldest ||
+			    timercmp(&work->queue_time, &oldest->queue_time,
+				     <)) {
+				oldest = work;
+				inx = i;
+			}
+		}
+		return inx;
+	}
+
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		if (urgent_only && !rpc_classes[i].urgent)
+			continue;
+		if (_class_runnable(&rpc_classes[i]))
+			return i;
+	}
+	return -1;
+}
+
+static void _process_work(rpc_class_rec_t *class, rpc_work_t *work)
+{
+	struct timeval now;
+	uint64_t wait;
+
+	gettimeofday(&now, NULL);
+	wait = (now.tv_sec - work->queue_time.tv_sec) * 1000000 +
+	       (now.tv_usec - work->queue_time.tv_usec);
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	class->cnt++;
+	class->wait_time += wait;
+	class->max_wait = MAX(class->max_wait, wait);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	rpc_process_connection(work->conn, &work->msg, work->recv_errno);
+	xfree(work);
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	class->active--;
+	slurm_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/*
+ * Unpack and authenticate a message read by the event loop and queue it by
+ * class. Authentication is the expensive part of receiving a message, so it
+ * is done here by a worker rather than by the event loop.
+ */
+static void _receive_work(rpc_frame_t *frame)
+{
+	rpc_work_t *work = xmalloc(sizeof(rpc_work_t));
+	connection_arg_t *conn = frame->conn;
+	rpc_class_rec_t *class;
+	uint32_t depth;
+	Buf buffer;
+
+	slurm_msg_t_init(&work->msg);
+	work->msg.flags |= SLURM_MSG_KEEP_BUFFER;
+	work->msg.conn_fd = conn->newsockfd;
+	buffer = create_buf(frame->buf, frame->msglen);
+	frame->buf = NULL;
+	if (slurm_unpack_received_msg(&work->msg, conn->newsockfd, buffer)) {
+		char addr_buf[32];
+		slurm_print_slurm_addr(&conn->cli_addr, addr_buf,
+				       sizeof(addr_buf));
+		error("slurm_receive_msg [%s]: %m", addr_buf);
+		free_buf(buffer);
+		slurm_free_msg_members(&work->msg);
+		xfree(work);
+		_free_frame(frame);
+		return;
+	}
+	work->msg.buffer = buffer;
+	work->recv_errno = SLURM_SUCCESS;
+	work->conn = conn;
+	frame->conn = NULL;
+	xfree(frame);
+	gettimeofday(&work->queue_time, NULL);
+	class = &rpc_classes[_rpc_class(work->msg.msg_type)];
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	list_enqueue(class->queue, work);
+	depth = list_count(class->queue);
+	class->max_depth = MAX(class->max_depth, depth);
+	slurm_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+static void *_rpc_worker(void *arg)
+{
+	rpc_frame_t *frame;
+	rpc_work_t *work;
+	int inx;
+
+#if HAVE_SYS_PRCTL_H
+	if (prctl(PR_SET_NAME, "rpcwrk", NULL, NULL, NULL) < 0) {
+		error("%s: cannot set my name to %s %m", __func__, "rpcwrk");
+	}
+#endif
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	while (1) {
+		frame = NULL;
+		work = NULL;
+		/*
+		 * Completion traffic first, then unpack new messages unless
+		 * a class queue is full, then everything else. New messages
+		 * are also taken if nothing else is runnable.
+		 */
+		if ((inx = _pick_class(true)) == -1) {
+			if (list_count(frame_queue) && !_queues_full())
+				frame = list_dequeue(frame_queue);
+			else if ((inx = _pick_class(false)) == -1)
+				frame = list_dequeue(frame_queue);
+		}
+
+		if (inx != -1) {
+			work = list_dequeue(rpc_classes[inx].queue);
+			rpc_classes[inx].active++;
+			slurm_mutex_unlock(&rpc_queue_mutex);
+			_process_work(&rpc_classes[inx], work);
+			slurm_mutex_lock(&rpc_queue_mutex);
+		} else if (frame) {
+			slurm_mutex_unlock(&rpc_queue_mutex);
+			_receive_work(frame);
+			slurm_mutex_lock(&rpc_queue_mutex);
+		} else if (rpc_queue_stop) {
+			break;
+		} else {
+			slurm_cond_wait(&rpc_queue_cond, &rpc_queue_mutex);
+		}
+	}
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	return NULL;
+}
+
+static void _read_config(void)
+{
+	char *ctld_params = slurm_get_slurmctld_params();
+	char *tmp_ptr;
+	int i;
+
+	worker_cnt = DEFAULT_RPC_WORKERS;
+	if ((tmp_ptr = xstrcasestr(ctld_params, "rpc_workers="))) {
+		i = atoi(tmp_ptr + 12);
+		if ((i < 0) || (i > MAX_SERVER_THREADS)) {
+			error("Invalid SlurmctldParameters rpc_workers: %d", i);
+		} else
+			worker_cnt = i;
+	}
+
+	queue_depth = DEFAULT_RPC_QUEUE_DEPTH;
+	if ((tmp_ptr = xstrcasestr(ctld_params, "rpc_queue_depth="))) {
+		i = atoi(tmp_ptr + 16);
+		if (i < 1) {
+			error("Invalid SlurmctldParameters rpc_queue_depth: %d",
+			      i);
+		} else
+			queue_depth = i;
+	}
+	xfree(ctld_params);
+
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		if (rpc_classes[i].active_ratio) {
+			rpc_classes[i].max_active =
+				MAX(1, worker_cnt / rpc_classes[i].active_ratio);
+		}
+	}
+}
+
+extern int rpc_queue_init(void)
+{
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	if (worker_ids) {
+		slurm_mutex_unlock(&rpc_queue_mutex);
+		return SLURM_SUCCESS;
+	}
+	_read_config();
+	if (!worker_cnt) {
+		slurm_mutex_unlock(&rpc_queue_mutex);
+		return SLURM_ERROR;
+	}
+	rpc_queue_stop = false;
+	frame_queue = list_create(_free_frame);
+	for (i = 0; i < RPC_CLASS_COUNT; i++)
+		rpc_classes[i].queue = list_create(_free_work);
+	worker_ids = xcalloc(worker_cnt, sizeof(pthread_t));
+	for (i = 0; i < worker_cnt; i++)
+		slurm_thread_create(&worker_ids[i], _rpc_worker, NULL);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	verbose("%s: started %u RPC worker threads", __func__, worker_cnt);
+
+	return SLURM_SUCCESS;
+}
+
+extern void rpc_queue_fini(void)
+{
+	pthread_t *ids;
+	uint32_t cnt;
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	ids = worker_ids;
+	cnt = worker_cnt;
+	worker_ids = NULL;
+	rpc_queue_stop = true;
+	slurm_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	if (!ids)
+		return;
+	for (i = 0; i < cnt; i++)
+		pthread_join(ids[i], NULL);
+	xfree(ids);
+
+	/* Workers drain all queues before exiting */
+	FREE_NULL_LIST(frame_queue);
+	for (i = 0; i < RPC_CLASS_COUNT; i++)
+		FREE_NULL_LIST(rpc_classes[i].queue);
+}
+
+/*
+ * Try to count a message against the server thread limit.
+ * RET true if the message may be handed to the workers now
+ */
+static bool _server_thread_try_incr(uint32_t max_threads)
+{
+	static time_t last_print_time = 0;
+	bool rc = false;
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	if (slurmctld_config.server_thread_count < max_threads) {
+		slurmctld_config.server_thread_count++;
+		rc = true;
+	} else {
+		time_t now = time(NULL);
+		if (difftime(now, last_print_time) > 2) {
+			verbose("server_thread_count over limit (%d), waiting",
+				slurmctld_config.server_thread_count);
+			last_print_time = now;
+		}
+	}
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	return rc;
+}
+
+/* Hand a fully read message to the worker threads */
+static void _queue_frame(rpc_frame_t *frame)
+{
+	fd_set_blocking(frame->conn->newsockfd);
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	list_enqueue(frame_queue, frame);
+	slurm_cond_signal(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/* Accept a connection and set it up for non-blocking reads */
+static rpc_frame_t *_accept_frame(int listen_fd, time_t deadline)
+{
+	rpc_frame_t *frame;
+	slurm_addr_t cli_addr;
+	int newsockfd;
+
+	if ((newsockfd = slurm_accept_msg_conn(listen_fd, &cli_addr)) ==
+	    SLURM_ERROR) {
+		if (errno != EINTR)
+			error("slurm_accept_msg_conn: %m");
+		return NULL;
+	}
+	fd_set_close_on_exec(newsockfd);
+	fd_set_nonblocking(newsockfd);
+
+	frame = xmalloc(sizeof(rpc_frame_t));
+	frame->conn = xmalloc(sizeof(connection_arg_t));
+	frame->conn->newsockfd = newsockfd;
+	memcpy(&frame->conn->cli_addr, &cli_addr, sizeof(slurm_addr_t));
+	frame->deadline = deadline;
+
+	if (slurmctld_conf.debug_flags & DEBUG_FLAG_PROTOCOL) {
+		char inetbuf[64];
+
+		slurm_print_slurm_addr(&cli_addr, inetbuf, sizeof(inetbuf));
+		info("%s: accept() connection from %s", __func__, inetbuf);
+	}
+
+	return frame;
+}
+
+/*
+ * Read whatever is available of a length prefixed message without blocking.
+ * RET 1 if the message is complete, 0 if more data is needed, -1 on error
+ *	with errno set
+ */
+static int _read_frame(rpc_frame_t *frame)
+{
+	int fd = frame->conn->newsockfd;
+	ssize_t n;
+
+	while (1) {
+		if (frame->hdr_got < sizeof(frame->msglen)) {
+			n = read(fd, ((char *) &frame->msglen) + frame->hdr_got,
+				 sizeof(frame->msglen) - frame->hdr_got);
+		} else if (frame->got < frame->msglen) {
+			n = read(fd, frame->buf + frame->got,
+				 frame->msglen - frame->got);
+		} else
+			return 1;
+
+		if (n == 0) {
+			slurm_seterrno(SLURM_PROTOCOL_SOCKET_ZERO_BYTES_SENT);
+			return -1;
+		} else if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+
+		if (frame->hdr_got < sizeof(frame->msglen)) {
+			frame->hdr_got += n;
+			if (frame->hdr_got < sizeof(frame->msglen))
+				continue;
+			frame->msglen = ntohl(frame->msglen);
+			if (frame->msglen > RPC_MAX_MSG_SIZE) {
+				slurm_seterrno(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
+				return -1;
+			}
+			frame->buf = xmalloc_nz(frame->msglen);
+		} else
+			frame->got += n;
+	}
+}
+
+extern void rpc_queue_event_loop(struct pollfd *listen_fds, int nports,
+				 uint32_t max_threads)
+{
+	rpc_frame_t **reading, *frame;
+	struct pollfd *pfds;
+	List parked = list_create(NULL);  /* read, over server thread limit */
+	uint16_t msg_timeout = slurm_get_msg_timeout();
+	int i, j, n, nlisten, rc, timeout, cnt = 0;
+	time_t now;
+
+	reading = xcalloc(RPC_MAX_READING, sizeof(rpc_frame_t *));
+	pfds = xcalloc(nports + RPC_MAX_READING, sizeof(struct pollfd));
+
+	while (!slurmctld_config.shutdown_time) {
+		while ((frame = list_peek(parked)) &&
+		       _server_thread_try_incr(max_threads)) {
+			(void) list_dequeue(parked);
+			_queue_frame(frame);
+		}
+
+		/* Stop accepting while too many connections are unfinished */
+		n = 0;
+		if ((cnt + list_count(parked)) < RPC_MAX_READING) {
+			for (i = 0; i < nports; i++) {
+				pfds[n].fd = listen_fds[i].fd;
+				pfds[n++].events = POLLIN;
+			}
+		}
+		nlisten = n;
+		for (j = 0; j < cnt; j++) {
+			pfds[n].fd = reading[j]->conn->newsockfd;
+			pfds[n++].events = POLLIN;
+		}
+
+		if (list_count(parked))
+			timeout = 100;	/* poll for server_thread_count */
+		else if (cnt)
+			timeout = 1000;	/* check read deadlines */
+		else
+			timeout = -1;
+		if (poll(pfds, n, timeout) == -1) {
+			if (errno != EINTR)
+				error("%s: poll: %m", __func__);
+			continue;
+		}
+		now = time(NULL);
+
+		for (j = 0; j < cnt; j++) {
+			frame = reading[j];
+			rc = 0;
+			if (pfds[nlisten + j].revents)
+				rc = _read_frame(frame);
+			if ((rc == 0) && (now > frame->deadline)) {
+				slurm_seterrno(SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT);
+				rc = -1;
+			}
+			if (rc == 0)
+				continue;
+
+			reading[j] = NULL;
+			if (rc < 0) {
+				char addr_buf[32];
+				slurm_print_slurm_addr(&frame->conn->cli_addr,
+						       addr_buf,
+						       sizeof(addr_buf));
+				error("slurm_receive_msg [%s]: %m", addr_buf);
+				_close_frame(frame);
+			} else if (_server_thread_try_incr(max_threads))
+				_queue_frame(frame);
+			else
+				list_enqueue(parked, frame);
+		}
+		for (i = j = 0; j < cnt; j++) {
+			if (reading[j])
+				reading[i++] = reading[j];
+		}
+		cnt = i;
+
+		for (i = 0; i < nlisten; i++) {
+			if (!pfds[i].revents ||
+			    ((cnt + list_count(parked)) >= RPC_MAX_READING))
+				continue;
+			if ((frame = _accept_frame(pfds[i].fd,
+						   now + msg_timeout)))
+				reading[cnt++] = frame;
+		}
+
+		slurm_mutex_lock(&rpc_queue_mutex);
+		reading_cnt = cnt + list_count(parked);
+		slurm_mutex_unlock(&rpc_queue_mutex);
+	}
+
+	/* Abandon partial reads, process messages already read */
+	for (j = 0; j < cnt; j++)
+		_close_frame(reading[j]);
+	while ((frame = list_dequeue(parked))) {
+		server_thread_incr();
+		_queue_frame(frame);
+	}
+	slurm_mutex_lock(&rpc_queue_mutex);
+	reading_cnt = 0;
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	FREE_NULL_LIST(parked);
+	xfree(reading);
+	xfree(pfds);
+}
+
+extern int rpc_receive_connection(connection_arg_t *conn, slurm_msg_t *msg)
+{
+	slurm_msg_t_init(msg);
+	msg->flags |= SLURM_MSG_KEEP_BUFFER;
+	/*
+	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
+	 * possibility for slurmctld_req() to close accepted connection.
+	 */
+	if (slurm_receive_msg(conn->newsockfd, msg, 0) != 0) {
+		char addr_buf[32];
+		slurm_print_slurm_addr(&conn->cli_addr, addr_buf,
+				       sizeof(addr_buf));
+		error("slurm_receive_msg [%s]: %m", addr_buf);
+		/* close the new socket */
+		close(conn->newsockfd);
+		slurm_free_msg_members(msg);
+		xfree(conn);
+		server_thread_decr();
+		return SLURM_ERROR;
+	}
+
+	return errno;
+}
+
+extern void rpc_process_connection(connection_arg_t *conn, slurm_msg_t *msg,
+				   int recv_errno)
+{
+	if (recv_errno != SLURM_SUCCESS) {
+		if (recv_errno == SLURM_PROTOCOL_VERSION_ERROR) {
+			slurm_send_rc_msg(msg, SLURM_PROTOCOL_VERSION_ERROR);
+		} else {
+			info("%s/slurm_receive_msg %s", __func__,
+			     slurm_strerror(recv_errno));
+		}
+	} else {
+		/* process the request */
+		slurmctld_req(msg, conn);
+	}
+
+	if ((conn->newsockfd >= 0) && (close(conn->newsockfd) < 0))
+		error ("close(%d): %m",  conn->newsockfd);
+
+	slurm_free_msg_members(msg);
+	xfree(conn);
+	server_thread_decr();
+}
+
+extern void rpc_queue_pack_stats(Buf buffer)
+{
+	char *names[RPC_CLASS_COUNT];
+	uint32_t depth[RPC_CLASS_COUNT], max_depth[RPC_CLASS_COUNT];
+	uint32_t active[RPC_CLASS_COUNT], cnt[RPC_CLASS_COUNT];
+	uint64_t wait_time[RPC_CLASS_COUNT], max_wait[RPC_CLASS_COUNT];
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		names[i] = rpc_classes[i].name;
+		depth[i] = rpc_classes[i].queue ?
+			   list_count(rpc_classes[i].queue) : 0;
+		max_depth[i] = rpc_classes[i].max_depth;
+		active[i] = rpc_classes[i].active;
+		cnt[i] = rpc_classes[i].cnt;
+		wait_time[i] = rpc_classes[i].wait_time;
+		max_wait[i] = rpc_classes[i].max_wait;
+	}
+	pack32(worker_ids ? worker_cnt : 0, buffer);
+	pack32(reading_cnt + (frame_queue ? list_count(frame_queue) : 0),
+	       buffer);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	packstr_array(names, RPC_CLASS_COUNT, buffer);
+	pack32_array(depth, RPC_CLASS_COUNT, buffer);
+	pack32_array(max_depth, RPC_CLASS_COUNT, buffer);
+	pack32_array(active, RPC_CLASS_COUNT, buffer);
+	pack32_array(cnt, RPC_CLASS_COUNT, buffer);
+	pack64_array(wait_time, RPC_CLASS_COUNT, buffer);
+	pack64_array(max_wait, RPC_CLASS_COUNT, buffer);
+}
+
+extern void rpc_queue_reset_stats(void)
+{
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	for (i = 0; i < RPC_CLASS_COUNT; i++) {
+		rpc_classes[i].max_depth = 0;
+		rpc_classes[i].cnt = 0;
+		rpc_classes[i].wait_time = 0;
+		rpc_classes[i].max_wait = 0;
+	}
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
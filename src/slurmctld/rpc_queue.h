@@ -0,0 +1,100 @@
+/*****************************************************************************\
+ *  rpc_queue.h - Worker thread pool and per-class queues for slurmctld RPCs
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMCTLD_RPC_QUEUE_H
+#define _SLURMCTLD_RPC_QUEUE_H
+
+#include <poll.h>
+
+#include "src/common/pack.h"
+#include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/proc_req.h"
+
+/*
+ * Connections are accepted and read by a single event loop using
+ * non-blocking sockets, so a slow or stalled client only holds a file
+ * descriptor rather than a thread. Once a message has been completely read
+ * it is handed to a fixed pool of worker threads. A worker unpacks and
+ * authenticates the message, then queues it by RPC class. Queued messages
+ * are processed in class priority order, job/step completion and node
+ * registration traffic first, with a cap on the number of workers busy with
+ * the submit and info classes so a storm of one kind of RPC can not occupy
+ * every worker.
+ */
+
+/*
+ * Start the worker threads configured by SlurmctldParameters=rpc_workers.
+ * RET SLURM_SUCCESS, or SLURM_ERROR if rpc_workers=0 and the caller has to
+ *	service each connection with its own thread
+ */
+extern int rpc_queue_init(void);
+
+/* Process everything still queued, then stop the worker threads */
+extern void rpc_queue_fini(void);
+
+/*
+ * Accept and read connections on the listening sockets, handing complete
+ * messages to the worker threads, until slurmctld shutdown. Reads that do not
+ * finish within MessageTimeout are abandoned. Only messages handed to the
+ * workers count against the server thread limit.
+ * IN listen_fds - listening sockets
+ * IN nports - number of listening sockets
+ * IN max_threads - server thread limit
+ */
+extern void rpc_queue_event_loop(struct pollfd *listen_fds, int nports,
+				 uint32_t max_threads);
+
+/*
+ * Read the message from an accepted connection with a blocking read, used
+ * when the worker pool is disabled.
+ * On failure the connection is closed and its resources released.
+ * RET SLURM_ERROR if no message could be read, otherwise the errno left by
+ *	slurm_receive_msg() (e.g. SLURM_PROTOCOL_VERSION_ERROR), to be passed
+ *	to rpc_process_connection()
+ */
+extern int rpc_receive_connection(connection_arg_t *conn, slurm_msg_t *msg);
+
+/*
+ * Process a message read by rpc_receive_connection(), then close the
+ * connection and release its resources, including the server thread count.
+ */
+extern void rpc_process_connection(connection_arg_t *conn, slurm_msg_t *msg,
+				   int recv_errno);
+
+/* Pack RPC queue statistics for sdiag */
+extern void rpc_queue_pack_stats(Buf buffer);
+
+/* Clear RPC queue statistics */
+extern void rpc_queue_reset_stats(void);
+
+#endif /* !_SLURMCTLD_RPC_QUEUE_H */
@@ -73,4 +73,11 @@ int slurm_sched_g_reconfig(void);
 uint32_t slurm_sched_g_initial_priority(uint32_t max_prio,
 					struct job_record *job_ptr);
 
+/*
+ * Run one cycle of the plugin's own scheduler, if any, in the calling
+ * thread. Used by the scheduling replay (slurmctld -s), in which the plugin
+ * starts no thread of its own.
+ */
+extern int slurm_sched_g_run_cycle(void);
+
 #endif /*__SLURM_CONTROLLER_SCHED_PLUGIN_API_H__*/
@@ -139,6 +139,7 @@ typedef struct slurmctld_config {
 	char    node_name_long[MAX_SLURM_NAME];
 	char    node_name_short[MAX_SLURM_NAME];
 	bool	resume_backup;
+	bool	sched_replay;	/* slurmctld -s, nothing leaves the daemon */
 	bool    scheduling_disabled;
 	int	server_thread_count;
 	time_t	shutdown_time;
@@ -166,6 +167,8 @@ typedef struct diag_stats {
 	uint32_t schedule_cycle_counter;
 	uint32_t schedule_cycle_depth;
 	uint32_t schedule_queue_len;
+	uint32_t schedule_equiv_lookups;
+	uint32_t schedule_equiv_hits;
 
 	uint32_t jobs_submitted;
 	uint32_t jobs_started;
@@ -192,6 +195,15 @@ typedef struct diag_stats {
 	uint32_t bf_queue_len_sum;
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
+	uint32_t bf_equiv_lookups;
+	uint32_t bf_equiv_hits;
+
+	uint32_t fairshare_cycle_counter;
+	uint32_t fairshare_cycle_last;
+	uint32_t fairshare_cycle_max;
+	uint32_t fairshare_cycle_sum;
+	uint32_t fairshare_last_sets;
+	uint32_t fairshare_last_sorted;
 
 	uint32_t latency;
 } diag_stats_t;
@@ -721,10 +733,12 @@ struct job_record {
 	char *gres_used;		/* Actual GRES use added over all nodes
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
+	uint64_t info_hash;		/* hash of packed job info, used to
+					 * detect changes for delta RPCs */
+	uint64_t info_seq;		/* job info sequence number of the
+					 * last change seen in the record */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
 	struct job_record *job_array_next_j; /* job array linked list by job_id */
-	struct job_record *job_array_next_t; /* job array linked list by task_id */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -819,6 +833,9 @@ struct job_record {
 	time_t start_time;		/* time execution begins,
 					 * actual or expected */
 	char *state_desc;		/* optional details for state_reason */
+	uint64_t state_hash;		/* hash of the record as last written
+					 * to the job state journal, zero if
+					 * not yet saved */
 	uint32_t state_reason;		/* reason job still pending or failed
 					 * see slurm.h:enum job_state_reason */
 	uint32_t state_reason_prev;	/* Previous state_reason, needed to
@@ -1156,7 +1173,8 @@ extern List depended_list_copy(List depend_list_src);
  */
 extern int drain_nodes ( char *nodes, char *reason, uint32_t reason_uid );
 
-/* dump_all_job_state - save the state of all jobs to file
+/* dump_all_job_state - save the state of all jobs to file, normally by
+ *	appending changed job records to the job state journal
  * RET 0 or error code */
 extern int dump_all_job_state ( void );
 
@@ -1480,6 +1498,8 @@ extern void job_fini (void);
  */
 extern int job_fail(uint32_t job_id, uint32_t job_state);
 
+/* Pack job ID and array task hash table statistics for sdiag */
+extern void job_hash_pack_stats(Buf buffer);
 
 /* job_hold_requeue()
  *
@@ -1855,7 +1875,8 @@ extern int list_find_job_id(void *job_entry, void *key);
 
 /*
  * load_all_job_state - load the job state from file, recover from last
- *	checkpoint. Execute this after loading the configuration file data.
+ *	checkpoint and replay the job state journal. Execute this after
+ *	loading the configuration file data.
  * RET 0 or error code
  */
 extern int load_all_job_state ( void );
@@ -1979,6 +2000,23 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
+/*
+ * pack_delta_jobs - dump information for jobs which changed since a
+ *	previous job information sequence number
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN epoch - epoch returned with the client's previous response, zero if none
+ * IN sequence - sequence number returned with the client's previous response
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * global: job_list - global list of job records
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern void pack_delta_jobs(char **buffer_ptr, int *buffer_size, time_t epoch,
+			    uint64_t sequence, uint16_t show_flags, uid_t uid,
+			    uint16_t protocol_version);
+
 /*
  * pack_spec_jobs - dump job information for specified jobs in
  *	machine independent form (for network transmission)
@@ -2114,6 +2152,13 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 /* part_is_visible - should user be able to see this partition */
 extern bool part_is_visible(struct part_record *part_ptr, uid_t uid);
 
+/*
+ * part_visibility_restricted - test if any partition is hidden or limited to
+ *	specific groups, in which case partition information differs by user
+ * NOTE: READ lock_slurmctld partition before entry
+ */
+extern bool part_visibility_restricted(void);
+
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
 
@@ -2198,7 +2243,7 @@ extern void qos_list_build(char *qos, bitstr_t **qos_bits);
 extern void queue_job_scheduler(void);
 
 /*
- * rehash_jobs - Create or rebuild the job hash table.
+ * rehash_jobs - Create the job hash tables or grow them to fit MaxJobCount.
  * NOTE: run lock_slurmctld before entry: Read config, write job
  */
 extern void rehash_jobs(void);
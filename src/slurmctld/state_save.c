@@ -43,12 +43,19 @@
 #  include <sys/prctl.h>
 #endif
 
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
 
 #include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
 #include "src/slurmctld/front_end.h"
 #include "src/slurmctld/reservation.h"
 #include "src/slurmctld/slurmctld.h"
+#include "src/slurmctld/state_save.h"
 #include "src/slurmctld/trigger_mgr.h"
 
 /* Maximum delay for pending state save to be processed, in seconds */
@@ -62,6 +69,22 @@ static int save_jobs = 0, save_nodes = 0, save_parts = 0;
 static int save_front_end = 0, save_triggers = 0, save_resv = 0;
 static bool run_save_thread = true;
 
+typedef struct {
+	char *file_name;
+	pthread_t thread_id;
+	Buf buffer;		/* file contents, NULL if it could not be read */
+	bool done;		/* thread joined */
+} state_prefetch_t;
+
+static state_prefetch_t *prefetch_table = NULL;
+static int prefetch_cnt = 0;
+
+/* Time spent in each state recovery phase, for sdiag */
+static pthread_mutex_t state_load_lock = PTHREAD_MUTEX_INITIALIZER;
+static char **state_load_name = NULL;
+static uint64_t *state_load_time = NULL;	/* usec */
+static uint32_t state_load_cnt = 0;
+
 /* fsync() and close() a file,
  * Execute fsync() and close() multiple times if necessary and log failures
  * RET 0 on success or -1 on error */
@@ -94,6 +117,151 @@ extern int fsync_and_close(int fd, char *file_type)
 	return rc;
 }
 
+/*
+ * State file prefetch. Reading the state files, typically from a shared
+ * file system, is a large part of recovery time but has no dependencies
+ * between files. Each file is read into memory by its own thread while the
+ * files needed first are being unpacked.
+ */
+static void *_prefetch_state_file(void *arg)
+{
+	state_prefetch_t *prefetch = (state_prefetch_t *) arg;
+	struct stat stat_buf;
+	char *data = NULL;
+	ssize_t amount;
+	size_t pos = 0;
+	int fd;
+
+	if ((fd = open(prefetch->file_name, O_RDONLY | O_CLOEXEC)) < 0)
+		return NULL;
+	if ((fstat(fd, &stat_buf) < 0) || (stat_buf.st_size > MAX_BUF_SIZE))
+		goto fini;
+	data = xmalloc_nz(stat_buf.st_size);
+	while (pos < stat_buf.st_size) {
+		amount = read(fd, data + pos, stat_buf.st_size - pos);
+		if (amount <= 0) {
+			if ((amount < 0) && (errno == EINTR))
+				continue;
+			xfree(data);	/* fall back to create_mmap_buf() */
+			goto fini;
+		}
+		pos += amount;
+	}
+	prefetch->buffer = create_buf(data, stat_buf.st_size);
+
+fini:
+	close(fd);
+	return NULL;
+}
+
+extern void prefetch_state_files(int recover)
+{
+	char *names[] = { "node_state", "front_end_state", "part_state",
+			  "job_state", "job_state.journal", "resv_state",
+			  "trigger_state", NULL };
+	int i;
+
+	if (prefetch_table || !recover)
+		return;
+
+	for (i = 0; names[i]; i++) {
+		if ((recover == 1) && !xstrcmp(names[i], "part_state"))
+			continue;	/* partitions come from slurm.conf */
+		xrealloc(prefetch_table,
+			 sizeof(state_prefetch_t) * (prefetch_cnt + 1));
+		prefetch_table[prefetch_cnt].file_name =
+			xstrdup_printf("%s/%s",
+				       slurmctld_conf.state_save_location,
+				       names[i]);
+		prefetch_table[prefetch_cnt].buffer = NULL;
+		prefetch_table[prefetch_cnt].done = false;
+		prefetch_cnt++;
+	}
+	for (i = 0; i < prefetch_cnt; i++) {
+		slurm_thread_create(&prefetch_table[i].thread_id,
+				    _prefetch_state_file, &prefetch_table[i]);
+	}
+}
+
+extern Buf open_state_file(char *file_name)
+{
+	Buf buffer = NULL;
+	int i;
+
+	for (i = 0; i < prefetch_cnt; i++) {
+		if (prefetch_table[i].done ||
+		    xstrcmp(prefetch_table[i].file_name, file_name))
+			continue;
+		pthread_join(prefetch_table[i].thread_id, NULL);
+		prefetch_table[i].done = true;
+		buffer = prefetch_table[i].buffer;
+		prefetch_table[i].buffer = NULL;
+		break;
+	}
+	if (!buffer)
+		buffer = create_mmap_buf(file_name);
+
+	return buffer;
+}
+
+extern void prefetch_state_files_fini(void)
+{
+	int i;
+
+	for (i = 0; i < prefetch_cnt; i++) {
+		if (!prefetch_table[i].done)
+			pthread_join(prefetch_table[i].thread_id, NULL);
+		if (prefetch_table[i].buffer)
+			free_buf(prefetch_table[i].buffer);
+		xfree(prefetch_table[i].file_name);
+	}
+	xfree(prefetch_table);
+	prefetch_cnt = 0;
+}
+
+extern void record_state_load_phase(char *name, struct timeval *start)
+{
+	struct timeval now;
+	uint64_t usec;
+
+	gettimeofday(&now, NULL);
+	usec = (now.tv_sec - start->tv_sec) * 1000000 +
+	       (now.tv_usec - start->tv_usec);
+	*start = now;
+
+	info("State recovery phase %s took %"PRIu64" usec", name, usec);
+
+	slurm_mutex_lock(&state_load_lock);
+	xrealloc(state_load_name, sizeof(char *) * (state_load_cnt + 1));
+	xrealloc(state_load_time, sizeof(uint64_t) * (state_load_cnt + 1));
+	state_load_name[state_load_cnt] = xstrdup(name);
+	state_load_time[state_load_cnt] = usec;
+	state_load_cnt++;
+	slurm_mutex_unlock(&state_load_lock);
+}
+
+extern void clear_state_load_phases(void)
+{
+	int i;
+
+	slurm_mutex_lock(&state_load_lock);
+	for (i = 0; i < state_load_cnt; i++)
+		xfree(state_load_name[i]);
+	xfree(state_load_name);
+	xfree(state_load_time);
+	state_load_cnt = 0;
+	slurm_mutex_unlock(&state_load_lock);
+}
+
+extern void pack_state_load_stats(Buf buffer)
+{
+	slurm_mutex_lock(&state_load_lock);
+	packstr_array(state_load_name, state_load_cnt, buffer);
+	pack64_array(state_load_time, state_load_cnt, buffer);
+	slurm_mutex_unlock(&state_load_lock);
+}
+
+
 /* Queue saving of front_end state information */
 extern void schedule_front_end_save(void)
 {
@@ -40,11 +40,44 @@
 #ifndef _SLURMCTLD_STATE_SAVE_H
 #define _SLURMCTLD_STATE_SAVE_H
 
+#include <sys/time.h>
+
+#include "src/common/pack.h"
+
 /* fsync() and close() a file,
  * Execute fsync() and close() multiple times if necessary and log failures
  * RET 0 on success or -1 on error */
 extern int fsync_and_close(int fd, char *file_type);
 
+/*
+ * Start reading the state files needed to recover at the given level (see
+ * read_slurm_conf()) into memory, one thread per file.
+ */
+extern void prefetch_state_files(int recover);
+
+/*
+ * Open a state file for unpacking, using the contents read by
+ * prefetch_state_files() if available (waiting for the read to finish).
+ * RET buffer to be freed with free_buf() or NULL on error with errno set
+ */
+extern Buf open_state_file(char *file_name);
+
+/* Discard prefetched state files which were not used */
+extern void prefetch_state_files_fini(void);
+
+/*
+ * Log and remember for sdiag the time taken by a state recovery phase.
+ * IN name - name of the phase
+ * IN/OUT start - when the phase started, set to the current time
+ */
+extern void record_state_load_phase(char *name, struct timeval *start);
+
+/* Forget recorded state recovery phases, called before a new recovery */
+extern void clear_state_load_phases(void);
+
+/* Pack recorded state recovery phase names and times for sdiag */
+extern void pack_state_load_stats(Buf buffer);
+
 /* Queue saving of front_end state information */
 extern void schedule_front_end_save(void);
 
@@ -39,6 +39,7 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
@@ -135,6 +136,29 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_active, buffer);
 			pack32(slurmctld_diag_stats.backfilled_pack_jobs,
 			       buffer);
+
+			if (protocol_version >= SLURM_20_02_PROTOCOL_VERSION) {
+				pack32(slurmctld_diag_stats.
+				       schedule_equiv_lookups, buffer);
+				pack32(slurmctld_diag_stats.schedule_equiv_hits,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_equiv_lookups,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_equiv_hits,
+				       buffer);
+				pack32(slurmctld_diag_stats.
+				       fairshare_cycle_counter, buffer);
+				pack32(slurmctld_diag_stats.fairshare_cycle_last,
+				       buffer);
+				pack32(slurmctld_diag_stats.fairshare_cycle_max,
+				       buffer);
+				pack32(slurmctld_diag_stats.fairshare_cycle_sum,
+				       buffer);
+				pack32(slurmctld_diag_stats.fairshare_last_sets,
+				       buffer);
+				pack32(slurmctld_diag_stats.
+				       fairshare_last_sorted, buffer);
+			}
 		}
 	}
 
@@ -152,6 +176,8 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.schedule_cycle_sum = 0;
 	slurmctld_diag_stats.schedule_cycle_counter = 0;
 	slurmctld_diag_stats.schedule_cycle_depth = 0;
+	slurmctld_diag_stats.schedule_equiv_lookups = 0;
+	slurmctld_diag_stats.schedule_equiv_hits = 0;
 	slurmctld_diag_stats.jobs_submitted = 0;
 	slurmctld_diag_stats.jobs_started = 0;
 	slurmctld_diag_stats.jobs_completed = 0;
@@ -175,6 +201,13 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.bf_equiv_lookups = 0;
+	slurmctld_diag_stats.bf_equiv_hits = 0;
+	slurmctld_diag_stats.fairshare_cycle_counter = 0;
+	slurmctld_diag_stats.fairshare_cycle_max = 0;
+	slurmctld_diag_stats.fairshare_cycle_sum = 0;
+
+	rpc_queue_reset_stats();
 
 	last_proc_req_start = time(NULL);
 }
@@ -909,7 +909,7 @@ static Buf _open_trigger_state_file(char **state_file)
 
 	*state_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(*state_file, "/trigger_state");
-	if (!(buf = create_mmap_buf(*state_file)))
+	if (!(buf = open_state_file(*state_file)))
 		error("Could not open trigger state file %s: %m",
 		      *state_file);
 	else
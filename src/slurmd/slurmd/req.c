@@ -2745,7 +2745,7 @@ _rpc_reconfig(slurm_msg_t *msg)
 		      req_uid);
 	else
 		kill(conf->pid, SIGHUP);
-	forward_wait(msg);
+	forward_wait(msg, -1);
 	/* Never return a message, slurmctld does not expect one */
 }
 
@@ -2754,7 +2754,7 @@ _rpc_shutdown(slurm_msg_t *msg)
 {
 	uid_t req_uid = g_slurm_auth_get_uid(msg->auth_cred);
 
-	forward_wait(msg);
+	forward_wait(msg, -1);
 	if (!_slurm_authorized_user(req_uid))
 		error("Security violation, shutdown RPC from uid %d",
 		      req_uid);
@@ -3160,6 +3160,26 @@ _rpc_ping(slurm_msg_t *msg)
 	return rc;
 }
 
+extern void send_heartbeat_msg(void)
+{
+	slurm_msg_t *msg = xmalloc_nz(sizeof(slurm_msg_t));
+	node_heartbeat_msg_t *heartbeat;
+
+	heartbeat = xmalloc(sizeof(node_heartbeat_msg_t));
+	get_cpu_load(&heartbeat->cpu_load);
+	get_free_mem(&heartbeat->free_mem);
+	heartbeat->node_name = xstrdup(conf->node_name);
+
+	slurm_msg_t_init(msg);
+	msg->msg_type = MESSAGE_NODE_HEARTBEAT;
+	msg->data     = heartbeat;
+	msg_aggr_add_msg(msg, 0, NULL);
+
+	/* Pings are skipped while heartbeats arrive, do their work here */
+	_enforce_job_mem_limit();
+	_file_bcast_cleanup();
+}
+
 static int
 _rpc_health_check(slurm_msg_t *msg)
 {
@@ -54,6 +54,12 @@ void gids_cache_purge(void);
 /* Add record for every launched job so we know they are ready for suspend */
 extern void record_launched_jobs(void);
 
+/*
+ * Push this node's CPU load and free memory to slurmctld through the message
+ * aggregation collectors in place of answering REQUEST_PING
+ */
+extern void send_heartbeat_msg(void);
+
 void file_bcast_init(void);
 void file_bcast_purge(void);
 
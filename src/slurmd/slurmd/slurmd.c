@@ -53,6 +53,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <stdlib.h>
@@ -60,6 +61,7 @@
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -185,6 +187,7 @@ static int       _drain_node(char *reason);
 static void      _fill_registration_msg(slurm_node_registration_status_msg_t *);
 static uint64_t  _get_int(const char *my_str);
 static void      _handle_connection(int fd, slurm_addr_t *client);
+static void     *_heartbeat_engine(void *arg);
 static void      _hup_handler(int);
 static void      _increment_thd_count(void);
 static void      _init_conf(void);
@@ -394,6 +397,7 @@ main (int argc, char **argv)
 			     conf->msg_aggr_window_msgs);
 
 	slurm_thread_create_detached(NULL, _registration_engine, NULL);
+	slurm_thread_create_detached(NULL, _heartbeat_engine, NULL);
 
 	_msg_engine();
 
@@ -443,6 +447,33 @@ _registration_engine(void *arg)
 	return NULL;
 }
 
+/*
+ * Spawn a thread to push heartbeats to slurmctld through the message
+ * aggregation collectors every MsgAggregationParams Heartbeat seconds once
+ * the node has registered. slurmctld does not ping nodes whose heartbeats
+ * keep arriving.
+ */
+static void *
+_heartbeat_engine(void *arg)
+{
+	time_t now, last_heartbeat = (time_t) 0;
+
+	/* Not counted in active_threads, reconfigure waits on those */
+	while (!_shutdown) {
+		sleep(1);
+		if ((conf->msg_aggr_window_msgs <= 1) ||
+		    !conf->msg_aggr_heartbeat || !sent_reg_time)
+			continue;
+		now = time(NULL);
+		if (difftime(now, last_heartbeat) < conf->msg_aggr_heartbeat)
+			continue;
+		last_heartbeat = now;
+		send_heartbeat_msg();
+	}
+
+	return NULL;
+}
+
 static void
 _msg_engine(void)
 {
@@ -550,6 +581,44 @@ static void _handle_connection(int fd, slurm_addr_t *cli)
 	slurm_thread_create_detached(NULL, _service_connection, arg);
 }
 
+/*
+ * Wait for the sender of a message with SLURM_MSG_KEEP_CONN to reuse its
+ * connection. The thread is not counted as active while idle.
+ * RET true if another message is ready to read
+ */
+static bool _wait_next_msg(slurm_msg_t *msg)
+{
+	struct pollfd pfd;
+	time_t start = time(NULL);
+	char c;
+	bool ready = false;
+	int rc;
+
+	if (!(msg->flags & SLURM_MSG_KEEP_CONN) || (msg->conn_fd < 0) ||
+	    !forward_keep_conn())
+		return false;
+
+	_decrement_thd_count();
+	pfd.fd = msg->conn_fd;
+	pfd.events = POLLIN;
+	while (!_shutdown && !_reconfig &&
+	       (difftime(time(NULL), start) < (KEEP_CONN_IDLE + 60))) {
+		pfd.revents = 0;
+		if ((rc = poll(&pfd, 1, 1000)) == 0)
+			continue;
+		if ((rc < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+			continue;
+		/* Nothing to read means the sender closed the connection */
+		if ((rc > 0) &&
+		    (recv(msg->conn_fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0))
+			ready = true;
+		break;
+	}
+	_increment_thd_count();
+
+	return ready;
+}
+
 static void *
 _service_connection(void *arg)
 {
@@ -559,6 +628,7 @@ _service_connection(void *arg)
 
 	debug3("in the service_connection");
 	slurm_msg_t_init(msg);
+next_msg:
 	if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg, 0))
 	   != SLURM_SUCCESS) {
 		error("service_connection: slurm_receive_msg: %m");
@@ -575,6 +645,15 @@ _service_connection(void *arg)
 	if (msg->msg_type != MESSAGE_COMPOSITE)
 		slurmd_req(msg);
 
+	if (_wait_next_msg(msg)) {
+		debug2("Finish processing RPC: %s",
+		       rpc_num2string(msg->msg_type));
+		slurm_free_msg(msg);
+		msg = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(msg);
+		goto next_msg;
+	}
+
 cleanup:
 	if ((msg->conn_fd >= 0) && close(msg->conn_fd) < 0)
 		error ("close(%d): %m", con->fd);
@@ -1092,7 +1171,6 @@ _read_config(void)
 		      xstrdup(cf->job_acct_gather_type));
 	_free_and_set(conf->msg_aggr_params,
 		      xstrdup(cf->msg_aggr_params));
-	_set_msg_aggr_params();
 
 	if ( (conf->node_name == NULL) ||
 	     (conf->node_name[0] == '\0') )
@@ -1103,6 +1181,7 @@ _read_config(void)
 	if (cf->slurmctld_port == 0)
 		fatal("Unable to establish controller port");
 	conf->slurmd_timeout = cf->slurmd_timeout;
+	_set_msg_aggr_params();
 	conf->kill_wait = cf->kill_wait;
 	conf->use_pam = cf->use_pam;
 	conf->task_plugin_param = cf->task_plugin_param;
@@ -2193,6 +2272,10 @@ static uint64_t _parse_msg_aggr_params(int type, char *params)
 		if ((sub_str = xstrcasestr(params, "WindowMsgs=")))
 			value = _get_int(sub_str + 11);
 		break;
+	case HEARTBEAT:
+		if ((sub_str = xstrcasestr(params, "Heartbeat=")))
+			value = _get_int(sub_str + 10);
+		break;
 	default:
 		fatal("invalid message aggregation parameters: %s", params);
 	}
@@ -2205,14 +2288,22 @@ static void _set_msg_aggr_params(void)
 			       conf->msg_aggr_params);
 	conf->msg_aggr_window_msgs = _parse_msg_aggr_params(WINDOW_MSGS,
 			       conf->msg_aggr_params);
+	conf->msg_aggr_heartbeat = _parse_msg_aggr_params(HEARTBEAT,
+			       conf->msg_aggr_params);
 
 	if (conf->msg_aggr_window_time == NO_VAL)
 		conf->msg_aggr_window_time = DEFAULT_MSG_AGGR_WINDOW_TIME;
 	if (conf->msg_aggr_window_msgs == NO_VAL)
 		conf->msg_aggr_window_msgs = DEFAULT_MSG_AGGR_WINDOW_MSGS;
+	if (conf->msg_aggr_heartbeat == NO_VAL)
+		conf->msg_aggr_heartbeat = 0;
 	if (conf->msg_aggr_window_msgs > 1) {
-		info("Message aggregation enabled: WindowMsgs=%"PRIu64", WindowTime=%"PRIu64,
-		     conf->msg_aggr_window_msgs, conf->msg_aggr_window_time);
+		info("Message aggregation enabled: WindowMsgs=%"PRIu64", WindowTime=%"PRIu64", Heartbeat=%"PRIu64,
+		     conf->msg_aggr_window_msgs, conf->msg_aggr_window_time,
+		     conf->msg_aggr_heartbeat);
+		if (conf->msg_aggr_heartbeat &&
+		    (conf->msg_aggr_heartbeat >= conf->slurmd_timeout / 3))
+			info("Message aggregation Heartbeat is not below SlurmdTimeout/3, nodes will still be pinged");
 	} else
 		info("Message aggregation disabled");
 }
@@ -61,7 +61,8 @@ extern bool get_reg_resp;
  */
 typedef enum {
 	WINDOW_TIME,
-	WINDOW_MSGS
+	WINDOW_MSGS,
+	HEARTBEAT
 } msg_aggr_param_type_t;
 
 /*
@@ -157,6 +158,7 @@ typedef struct slurmd_config {
 	char           *msg_aggr_params;      /* message aggregation params */
 	uint64_t        msg_aggr_window_msgs; /* msg aggr window size in msgs */
 	uint64_t        msg_aggr_window_time; /* msg aggr window size in time */
+	uint64_t        msg_aggr_heartbeat;   /* heartbeat interval in seconds */
 	uint16_t	use_pam;
 	uint32_t	task_plugin_param; /* TaskPluginParams, expressed
 					 * using cpu_bind_type_t flags */
@@ -185,7 +185,19 @@ _print_job ( bool clear_old )
 	if (params.format && strstr(params.format, "C"))
 		show_flags |= SHOW_DETAIL;
 
-	if (old_job_ptr) {
+	/*
+	 * Only transfer jobs changed since the previous iteration. Setting
+	 * LastSchedEval alone does not count as a change, so do not use
+	 * deltas when it is shown.
+	 */
+	if (params.iterate && !params.job_id && !params.user_id &&
+	    !params.clusters && !(show_flags & SHOW_FEDERATION) &&
+	    !xstrcasestr(params.format_long, "lastschedeval")) {
+		if (old_job_ptr && clear_old)
+			old_job_ptr->delta_epoch = 0;
+		error_code = slurm_load_jobs_delta(&old_job_ptr, show_flags);
+		new_job_ptr = old_job_ptr;
+	} else if (old_job_ptr) {
 		if (clear_old)
 			old_job_ptr->last_update = 0;
 		if (params.job_id) {
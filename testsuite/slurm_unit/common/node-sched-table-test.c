@@ -0,0 +1,216 @@
+/*****************************************************************************\
+ *  node-sched-table-test.c - Test node_sched_table and time scans of it
+ *	against scans of the node records
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#define _SYS_WAIT_H 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/node_conf.h"
+#include "src/common/xmalloc.h"
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define CONFIG_CNT 4
+#define SCAN_PASSES 50
+
+static struct config_record config_rec[CONFIG_CNT];
+
+static struct node_record *_build_nodes(int node_cnt)
+{
+	struct node_record *node_ptr;
+	int i;
+
+	for (i = 0; i < CONFIG_CNT; i++) {
+		config_rec[i].cpus = 32 << i;
+		config_rec[i].real_memory = 64000 << i;
+		config_rec[i].weight = i + 1;
+	}
+
+	node_ptr = xcalloc(node_cnt, sizeof(struct node_record));
+	for (i = 0; i < node_cnt; i++) {
+		/* Nodes grouped by configuration, as in slurm.conf */
+		node_ptr[i].config_ptr =
+			&config_rec[(i * CONFIG_CNT) / node_cnt];
+		node_ptr[i].cpus = node_ptr[i].config_ptr->cpus - (i % 2);
+		node_ptr[i].real_memory =
+			node_ptr[i].config_ptr->real_memory - (i % 3);
+		node_ptr[i].mem_spec_limit = i % 5;
+	}
+	return node_ptr;
+}
+
+static bool _table_matches(struct node_record *node_ptr, int node_cnt,
+			   uint16_t fast_schedule)
+{
+	int i;
+
+	if (node_sched_table.node_cnt != node_cnt)
+		return false;
+	for (i = 0; i < node_cnt; i++) {
+		struct config_record *config_ptr = node_ptr[i].config_ptr;
+		if (node_sched_table.cpus[i] !=
+		    (fast_schedule ? config_ptr->cpus : node_ptr[i].cpus))
+			return false;
+		if (node_sched_table.real_memory[i] !=
+		    (fast_schedule ? config_ptr->real_memory :
+		     node_ptr[i].real_memory))
+			return false;
+		if (node_sched_table.mem_spec_limit[i] !=
+		    node_ptr[i].mem_spec_limit)
+			return false;
+	}
+	return true;
+}
+
+static uint64_t _usec_since(struct timeval *start)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (now.tv_sec - start->tv_sec) * 1000000 +
+	       (now.tv_usec - start->tv_usec);
+}
+
+/*
+ * Walk every other node the way the select plugins do, looking for breaks in
+ * node weight and totaling CPUs and free memory, first through the node
+ * records and then through node_sched_table.
+ */
+static void _time_scans(struct node_record *node_ptr, int node_cnt)
+{
+	bitstr_t *node_map = bit_alloc(node_cnt);
+	struct timeval start;
+	uint64_t rec_usec, table_usec;
+	uint64_t rec_sum = 0, table_sum = 0, last_weight;
+	int i, scan;
+
+	for (i = 0; i < node_cnt; i += 2)
+		bit_set(node_map, i);
+	node_sched_table_init(node_ptr, node_cnt, 1);
+	for (i = 0; i < node_cnt; i++)
+		node_sched_table.sched_weight[i] =
+			node_ptr[i].config_ptr->weight;
+
+	gettimeofday(&start, NULL);
+	for (scan = 0; scan < SCAN_PASSES; scan++) {
+		last_weight = NO_VAL64;
+		for (i = 0; i < node_cnt; i++) {
+			if (!bit_test(node_map, i))
+				continue;
+			if (node_ptr[i].config_ptr->weight != last_weight) {
+				last_weight = node_ptr[i].config_ptr->weight;
+				rec_sum++;
+			}
+			rec_sum += node_ptr[i].config_ptr->cpus;
+			rec_sum += node_ptr[i].config_ptr->real_memory -
+				   node_ptr[i].mem_spec_limit;
+		}
+	}
+	rec_usec = _usec_since(&start);
+
+	gettimeofday(&start, NULL);
+	for (scan = 0; scan < SCAN_PASSES; scan++) {
+		last_weight = NO_VAL64;
+		for (i = 0; i < node_cnt; i++) {
+			if (!bit_test(node_map, i))
+				continue;
+			if (node_sched_table.sched_weight[i] != last_weight) {
+				last_weight = node_sched_table.sched_weight[i];
+				table_sum++;
+			}
+			table_sum += node_sched_table.cpus[i];
+			table_sum += node_sched_table.real_memory[i] -
+				     node_sched_table.mem_spec_limit[i];
+		}
+	}
+	table_usec = _usec_since(&start);
+
+	TEST(rec_sum == table_sum, "node record and table scans agree");
+	note("%d nodes, %d scans: node records %"PRIu64" usec, "
+	     "node_sched_table %"PRIu64" usec", node_cnt, SCAN_PASSES,
+	     rec_usec, table_usec);
+	bit_free(node_map);
+}
+
+int main(int argc, char *argv[])
+{
+	int node_cnts[] = { 10000, 50000 };
+	struct node_record *node_ptr;
+	int i, n;
+
+	note("Testing node_sched_table");
+	for (n = 0; n < 2; n++) {
+		node_ptr = _build_nodes(node_cnts[n]);
+
+		node_sched_table_init(node_ptr, node_cnts[n], 1);
+		TEST(_table_matches(node_ptr, node_cnts[n], 1),
+		     "table holds configured values with FastSchedule");
+		node_sched_table_init(node_ptr, node_cnts[n], 0);
+		TEST(_table_matches(node_ptr, node_cnts[n], 0),
+		     "table holds node values without FastSchedule");
+
+		for (i = 0; i < node_cnts[n]; i++)
+			if (node_sched_table.sched_weight[i])
+				break;
+		TEST(i == node_cnts[n], "sched_weight starts cleared");
+
+		node_record_table_ptr = node_ptr;
+		node_ptr[7].cpus = 3;
+		node_ptr[7].real_memory = 1000;
+		node_sched_table_update(7, 0);
+		TEST((node_sched_table.cpus[7] == 3) &&
+		     (node_sched_table.real_memory[7] == 1000),
+		     "table entry updated");
+		node_sched_table_update(node_cnts[n], 0);	/* ignored */
+		node_record_table_ptr = NULL;
+
+		_time_scans(node_ptr, node_cnts[n]);
+
+		node_sched_table_fini();
+		TEST((node_sched_table.node_cnt == 0) &&
+		     !node_sched_table.cpus, "table freed");
+		xfree(node_ptr);
+	}
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,334 @@
+/*****************************************************************************\
+ *  node-space-test.c - Test the backfill scheduler's node_space map against
+ *	a map holding the available nodes of every second
+ *****************************************************************************
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#define _SYS_WAIT_H 1
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+#include "src/plugins/sched/backfill/node_space.h"
+#include <testsuite/dejagnu.h>
+
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define NODE_CNT 64
+#define WINDOW_BEGIN 1000
+#define WINDOW_LEN 400
+#define RESV_CNT 400
+
+/* Available nodes of every second of the window */
+static bitstr_t *sec_bitmap[WINDOW_LEN];
+
+typedef struct {
+	time_t next_begin;	/* where the next slot must begin */
+	int slot_cnt;
+	bool ok;
+} walk_check_t;
+
+/* Check that the slots tile the window and match sec_bitmap */
+static void _check_slot(time_t begin_time, time_t end_time,
+			bitstr_t *avail_bitmap, void *arg)
+{
+	walk_check_t *check = arg;
+	time_t t;
+
+	check->slot_cnt++;
+	if ((begin_time != check->next_begin) || (end_time <= begin_time))
+		check->ok = false;
+	check->next_begin = end_time;
+	for (t = begin_time; (t < end_time) && check->ok; t++) {
+		if ((t < WINDOW_BEGIN) || (t >= WINDOW_BEGIN + WINDOW_LEN) ||
+		    !bit_equal(avail_bitmap, sec_bitmap[t - WINDOW_BEGIN]))
+			check->ok = false;
+	}
+}
+
+static bool _walk_matches(node_space_map_t *map)
+{
+	walk_check_t check = { WINDOW_BEGIN, 0, true };
+
+	node_space_walk(map, _check_slot, &check);
+	return (check.ok && (check.next_begin == WINDOW_BEGIN + WINDOW_LEN) &&
+		(check.slot_cnt == node_space_count(map)));
+}
+
+static void _reserve(node_space_map_t *map, time_t start_time,
+		     time_t end_time, bitstr_t *avail_bitmap)
+{
+	time_t t;
+
+	node_space_reserve(map, start_time, end_time, avail_bitmap);
+	for (t = MAX(start_time, WINDOW_BEGIN);
+	     (t < end_time) && (t < WINDOW_BEGIN + WINDOW_LEN); t++)
+		bit_and(sec_bitmap[t - WINDOW_BEGIN], avail_bitmap);
+}
+
+/* Nodes available in every second from start_time through end_time */
+static void _and_avail(time_t start_time, time_t end_time,
+		       bitstr_t *avail_bitmap)
+{
+	time_t t;
+
+	for (t = MAX(start_time, WINDOW_BEGIN);
+	     (t <= end_time) && (t < WINDOW_BEGIN + WINDOW_LEN); t++)
+		bit_and(avail_bitmap, sec_bitmap[t - WINDOW_BEGIN]);
+}
+
+typedef struct {
+	time_t start_time;
+	time_t end_time;
+	time_t min_begin;
+	bitstr_t *use_bitmap;
+	time_t found;
+} conflict_check_t;
+
+static void _check_conflict(time_t begin_time, time_t end_time,
+			    bitstr_t *avail_bitmap, void *arg)
+{
+	conflict_check_t *check = arg;
+
+	if (!check->found && (end_time > check->start_time) &&
+	    (begin_time < check->end_time) &&
+	    (begin_time > check->min_begin) &&
+	    !bit_super_set(check->use_bitmap, avail_bitmap))
+		check->found = begin_time;
+}
+
+/* Find the first conflicting slot by walking every slot in order */
+static time_t _conflict(node_space_map_t *map, time_t start_time,
+			time_t end_time, time_t min_begin,
+			bitstr_t *use_bitmap)
+{
+	conflict_check_t check = { start_time, end_time, min_begin,
+				   use_bitmap, 0 };
+
+	node_space_walk(map, _check_conflict, &check);
+	return check.found;
+}
+
+static bitstr_t *_bitmap(int first, int last)
+{
+	bitstr_t *bitmap = bit_alloc(NODE_CNT);
+
+	bit_nset(bitmap, first, last);
+	return bitmap;
+}
+
+static void _reset(node_space_map_t **map)
+{
+	bitstr_t *all_bitmap = _bitmap(0, NODE_CNT - 1);
+	int i;
+
+	node_space_destroy(*map);
+	*map = node_space_create(WINDOW_BEGIN, WINDOW_BEGIN + WINDOW_LEN,
+				 all_bitmap);
+	for (i = 0; i < WINDOW_LEN; i++) {
+		FREE_NULL_BITMAP(sec_bitmap[i]);
+		sec_bitmap[i] = bit_copy(all_bitmap);
+	}
+	bit_free(all_bitmap);
+}
+
+static void _test_split_merge(node_space_map_t **map)
+{
+	bitstr_t *mask = _bitmap(8, NODE_CNT - 1);
+	bitstr_t *other_mask = _bitmap(0, NODE_CNT - 9);
+	time_t b = WINDOW_BEGIN;
+
+	_reset(map);
+	_reserve(*map, b + 10, b + 20, mask);
+	TEST((node_space_count(*map) == 3) && _walk_matches(*map),
+	     "reservation splits its slot in three");
+	_reserve(*map, b + 20, b + 30, mask);
+	TEST((node_space_count(*map) == 3) && _walk_matches(*map),
+	     "adjacent equal reservation merges at its start");
+	_reserve(*map, b, b + 10, mask);
+	TEST((node_space_count(*map) == 2) && _walk_matches(*map),
+	     "adjacent equal reservation merges at its end");
+	_reserve(*map, b + 5, b + 15, mask);
+	TEST((node_space_count(*map) == 2) && _walk_matches(*map),
+	     "reservation changing nothing adds no slot");
+	_reserve(*map, b + 12, b + 18, other_mask);
+	TEST((node_space_count(*map) == 4) && _walk_matches(*map),
+	     "different reservation splits a merged slot");
+	_reserve(*map, b - 50, b + 2, other_mask);
+	_reserve(*map, b + WINDOW_LEN - 2, b + WINDOW_LEN + 50, other_mask);
+	TEST((node_space_count(*map) == 6) && _walk_matches(*map),
+	     "reservations are clipped to the window");
+	_reserve(*map, b + 50, b + 50, other_mask);
+	TEST((node_space_count(*map) == 6) && _walk_matches(*map),
+	     "empty reservation ignored");
+
+	bit_free(mask);
+	bit_free(other_mask);
+}
+
+static void _test_conflict_boundaries(node_space_map_t **map)
+{
+	bitstr_t *mask = _bitmap(1, NODE_CNT - 1);
+	bitstr_t *use_bitmap = _bitmap(0, 3);
+	bitstr_t *free_bitmap = _bitmap(4, 7);
+	time_t b = WINDOW_BEGIN;
+
+	_reset(map);
+	_reserve(*map, b + 10, b + 20, mask);	/* node 0 busy [10,20) */
+
+	TEST(!node_space_conflict(*map, b, b + 10, 0, use_bitmap),
+	     "no conflict ending where the slot begins");
+	TEST(node_space_conflict(*map, b, b + 11, 0, use_bitmap) == b + 10,
+	     "conflict ending one second into the slot");
+	TEST(!node_space_conflict(*map, b + 20, b + 30, 0, use_bitmap),
+	     "no conflict starting where the slot ends");
+	TEST(node_space_conflict(*map, b + 19, b + 30, 0, use_bitmap) ==
+	     b + 10, "conflict starting in the slot's last second");
+	TEST(node_space_conflict(*map, b + 15, b + 16, 0, use_bitmap) ==
+	     b + 10, "conflict inside the slot");
+	TEST(!node_space_conflict(*map, b, b + 30, b + 10, use_bitmap),
+	     "slot beginning at min_begin skipped");
+	TEST(node_space_conflict(*map, b, b + 30, b + 9, use_bitmap) ==
+	     b + 10, "slot beginning after min_begin found");
+	TEST(!node_space_conflict(*map, b, b + WINDOW_LEN, 0, free_bitmap),
+	     "no conflict on free nodes");
+
+	bit_free(mask);
+	bit_free(use_bitmap);
+	bit_free(free_bitmap);
+}
+
+/*
+ * Many overlapping reservations leave reservations saved for whole subtrees
+ * throughout the tree. Compare every query against sec_bitmap as they are
+ * pushed down by later reservations and queries.
+ */
+static void _test_random(node_space_map_t **map)
+{
+	bitstr_t *mask = bit_alloc(NODE_CNT);
+	bitstr_t *avail_bitmap = bit_alloc(NODE_CNT);
+	bitstr_t *ref_bitmap = bit_alloc(NODE_CNT);
+	time_t start_time, end_time, min_begin, next_time, ref_time;
+	bool and_ok = true, next_ok = true, conflict_ok = true;
+	int i, j, first, last;
+
+	srand(1);
+	_reset(map);
+	for (i = 0; i < RESV_CNT; i++) {
+		bit_nset(mask, 0, NODE_CNT - 1);
+		first = rand() % NODE_CNT;
+		last = first + rand() % 4;
+		last = MIN(last, NODE_CNT - 1);
+		bit_nclear(mask, first, last);
+		start_time = WINDOW_BEGIN - 10 + rand() % (WINDOW_LEN + 20);
+		end_time = start_time + 1 + rand() % (WINDOW_LEN / 4);
+		_reserve(*map, start_time, end_time, mask);
+
+		for (j = 0; j < 4; j++) {
+			start_time = WINDOW_BEGIN + rand() % WINDOW_LEN;
+			end_time = start_time + rand() % (WINDOW_LEN / 2);
+
+			bit_nset(avail_bitmap, 0, NODE_CNT - 1);
+			bit_nset(ref_bitmap, 0, NODE_CNT - 1);
+			next_time = node_space_and_avail(*map, start_time,
+							 end_time,
+							 avail_bitmap);
+			_and_avail(start_time, end_time, ref_bitmap);
+			if (!bit_equal(avail_bitmap, ref_bitmap))
+				and_ok = false;
+			/* Next change after start_time, if in the window */
+			for (ref_time = start_time + 1;
+			     ref_time < WINDOW_BEGIN + WINDOW_LEN; ref_time++) {
+				if (!bit_equal(sec_bitmap[ref_time -
+							  WINDOW_BEGIN],
+					       sec_bitmap[start_time -
+							  WINDOW_BEGIN]))
+					break;
+			}
+			if (ref_time == WINDOW_BEGIN + WINDOW_LEN)
+				ref_time = 0;
+			/* Unmerged boundaries may come earlier */
+			if ((next_time && ((next_time <= start_time) ||
+					   (ref_time &&
+					    (next_time > ref_time)))) ||
+			    (!next_time && ref_time))
+				next_ok = false;
+
+			bit_nclear(mask, 0, NODE_CNT - 1);
+			first = rand() % NODE_CNT;
+			last = first + rand() % 8;
+			last = MIN(last, NODE_CNT - 1);
+			bit_nset(mask, first, last);
+			min_begin = (rand() % 2) ?
+				    (WINDOW_BEGIN + rand() % WINDOW_LEN) : 0;
+			if (node_space_conflict(*map, start_time, end_time,
+						min_begin, mask) !=
+			    _conflict(*map, start_time, end_time, min_begin,
+				      mask))
+				conflict_ok = false;
+		}
+	}
+	TEST(and_ok, "node_space_and_avail matches per-second map");
+	TEST(next_ok, "node_space_and_avail returns next slot boundary");
+	TEST(conflict_ok, "node_space_conflict matches slot walk");
+	TEST(_walk_matches(*map), "slots match per-second map");
+	note("%d reservations left %d slots", RESV_CNT,
+	     node_space_count(*map));
+
+	bit_free(mask);
+	bit_free(avail_bitmap);
+	bit_free(ref_bitmap);
+}
+
+int main(int argc, char *argv[])
+{
+	node_space_map_t *map = NULL;
+	int i;
+
+	note("Testing node_space");
+	_test_split_merge(&map);
+	_test_conflict_boundaries(&map);
+	_test_random(&map);
+
+	node_space_destroy(map);
+	for (i = 0; i < WINDOW_LEN; i++)
+		FREE_NULL_BITMAP(sec_bitmap[i]);
+
+	totals();
+	return failed;
+}
@@ -0,0 +1,274 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/forward.h"
+#include "src/common/list.h"
+#include "src/common/slurm_protocol_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/common/slurm_protocol_common.h"
+
+static void _add_ret(List ret_list, char *node_name, uint16_t type,
+		     uint32_t err, uint32_t rc)
+{
+	ret_data_info_t *ret_data_info = xmalloc(sizeof(ret_data_info_t));
+	return_code_msg_t *rc_msg;
+	ping_slurmd_resp_msg_t *ping_resp;
+
+	ret_data_info->node_name = xstrdup(node_name);
+	ret_data_info->type = type;
+	ret_data_info->err = err;
+	if (type == RESPONSE_SLURM_RC) {
+		rc_msg = xmalloc(sizeof(return_code_msg_t));
+		rc_msg->return_code = rc;
+		ret_data_info->data = rc_msg;
+	} else if (type == RESPONSE_PING_SLURMD) {
+		ping_resp = xmalloc(sizeof(ping_slurmd_resp_msg_t));
+		ping_resp->cpu_load = rc;
+		ping_resp->free_mem = 1024;
+		ret_data_info->data = ping_resp;
+	}
+	list_append(ret_list, ret_data_info);
+}
+
+static int _find_node(void *x, void *key)
+{
+	ret_data_info_t *ret_data_info = x;
+
+	return !xstrcmp(ret_data_info->node_name, key);
+}
+
+static uint32_t _ret_rc(ret_data_info_t *ret_data_info)
+{
+	if (!ret_data_info->data)
+		return NO_VAL;
+	if (ret_data_info->type == RESPONSE_PING_SLURMD)
+		return ((ping_slurmd_resp_msg_t *)
+			ret_data_info->data)->cpu_load;
+	return ((return_code_msg_t *) ret_data_info->data)->return_code;
+}
+
+/* Pack a header carrying ret_list and unpack it into unpack_header */
+static int _round_trip(List ret_list, uint16_t protocol_version,
+		       header_t *unpack_header_ptr, uint32_t *size)
+{
+	header_t header;
+	Buf buf = init_buf(1024);
+	int rc;
+
+	memset(&header, 0, sizeof(header));
+	forward_init(&header.forward, NULL);
+	header.version = protocol_version;
+	header.msg_type = RESPONSE_FORWARD_PARTIAL;
+	header.ret_cnt = list_count(ret_list);
+	header.ret_list = ret_list;
+	pack_header(&header, buf);
+	*size = get_buf_offset(buf);
+
+	set_buf_offset(buf, 0);
+	rc = unpack_header(unpack_header_ptr, buf);
+	free_buf(buf);
+	return rc;
+}
+
+/* Check every record of ret_list is in unpacked with the same reply */
+static void _check_same(List ret_list, List unpacked)
+{
+	ListIterator itr;
+	ret_data_info_t *ret_data_info, *found;
+
+	ck_assert(unpacked);
+	ck_assert_int_eq(list_count(unpacked), list_count(ret_list));
+	itr = list_iterator_create(ret_list);
+	while ((ret_data_info = list_next(itr))) {
+		found = list_find_first(unpacked, _find_node,
+					ret_data_info->node_name);
+		ck_assert(found);
+		ck_assert_uint_eq(found->type, ret_data_info->type);
+		ck_assert_uint_eq(found->err, ret_data_info->err);
+		ck_assert_uint_eq(_ret_rc(found), _ret_rc(ret_data_info));
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Pack the start of a header, up to its ret_list */
+static Buf _pack_header_start(uint16_t ret_cnt)
+{
+	Buf buf = init_buf(1024);
+
+	pack16(SLURM_PROTOCOL_VERSION, buf);
+	pack16(0, buf);				/* flags */
+	pack16(0, buf);				/* msg_index */
+	pack16(RESPONSE_FORWARD_PARTIAL, buf);
+	pack32(0, buf);				/* body_length */
+	pack16(0, buf);				/* forward.cnt */
+	pack16(ret_cnt, buf);
+	return buf;
+}
+
+static void _pack_group(Buf buf, uint32_t node_cnt, uint16_t type,
+			char *hosts)
+{
+	slurm_msg_t msg;
+	return_code_msg_t rc_msg = { 0 };
+	ping_slurmd_resp_msg_t ping_resp = { 0 };
+
+	pack32(node_cnt, buf);
+	pack32(0, buf);				/* err */
+	pack16(type, buf);
+	packstr(hosts, buf);
+
+	slurm_msg_t_init(&msg);
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.msg_type = type;
+	if (type == RESPONSE_SLURM_RC)
+		msg.data = &rc_msg;
+	else if (type == RESPONSE_PING_SLURMD)
+		msg.data = &ping_resp;
+	pack_msg(&msg, buf);
+}
+
+static int _unpack_bad(Buf buf)
+{
+	header_t header;
+	int rc;
+
+	set_buf_offset(buf, 0);
+	rc = unpack_header(&header, buf);
+	free_buf(buf);
+	return rc;
+}
+
+START_TEST(pack_mixed_ret_list)
+{
+	List ret_list = list_create(destroy_data_info);
+	header_t header;
+	uint32_t size, old_size;
+
+	_add_ret(ret_list, "n1", RESPONSE_SLURM_RC, 0, 0);
+	_add_ret(ret_list, "n2", RESPONSE_SLURM_RC, 0, 0);
+	_add_ret(ret_list, "n3", RESPONSE_SLURM_RC, 0, 5);
+	_add_ret(ret_list, "n4", RESPONSE_PING_SLURMD, 0, 42);
+	_add_ret(ret_list, "n5", RESPONSE_SLURM_RC, 0, 0);
+	_add_ret(ret_list, "n10", RESPONSE_SLURM_RC, 0, 5);
+
+	ck_assert_int_eq(_round_trip(ret_list, SLURM_PROTOCOL_VERSION,
+				     &header, &size), SLURM_SUCCESS);
+	_check_same(ret_list, header.ret_list);
+	FREE_NULL_LIST(header.ret_list);
+	destroy_forward(&header.forward);
+
+	/* One record per node for older releases */
+	ck_assert_int_eq(_round_trip(ret_list, SLURM_MIN_PROTOCOL_VERSION,
+				     &header, &old_size), SLURM_SUCCESS);
+	_check_same(ret_list, header.ret_list);
+	FREE_NULL_LIST(header.ret_list);
+	destroy_forward(&header.forward);
+	ck_assert_uint_lt(size, old_size);
+
+	FREE_NULL_LIST(ret_list);
+}
+END_TEST
+
+START_TEST(pack_forward_failed_groups)
+{
+	List ret_list = list_create(destroy_data_info);
+	header_t header;
+	uint32_t size;
+	char name[16];
+	int i;
+
+	for (i = 0; i < 40; i++) {
+		snprintf(name, sizeof(name), "n%d", i);
+		_add_ret(ret_list, name, RESPONSE_FORWARD_FAILED,
+			 (i % 2) ? SLURM_COMMUNICATIONS_CONNECTION_ERROR :
+			 SLURM_COMMUNICATIONS_RECEIVE_ERROR, 0);
+	}
+	_add_ret(ret_list, "single", RESPONSE_SLURM_RC, 0, 0);
+
+	ck_assert_int_eq(_round_trip(ret_list, SLURM_PROTOCOL_VERSION,
+				     &header, &size), SLURM_SUCCESS);
+	_check_same(ret_list, header.ret_list);
+	FREE_NULL_LIST(header.ret_list);
+	destroy_forward(&header.forward);
+
+	FREE_NULL_LIST(ret_list);
+}
+END_TEST
+
+START_TEST(unpack_bad_node_cnt)
+{
+	Buf buf;
+
+	/* Zero nodes in a record */
+	buf = _pack_header_start(2);
+	_pack_group(buf, 0, RESPONSE_SLURM_RC, "n[1-2]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+
+	/* More nodes than ret_cnt */
+	buf = _pack_header_start(2);
+	_pack_group(buf, 3, RESPONSE_SLURM_RC, "n[1-3]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+
+	/* Group overrunning ret_cnt after a first group */
+	buf = _pack_header_start(4);
+	_pack_group(buf, 2, RESPONSE_SLURM_RC, "n[1-2]");
+	_pack_group(buf, 3, RESPONSE_FORWARD_FAILED, "n[3-5]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+}
+END_TEST
+
+START_TEST(unpack_bad_group)
+{
+	Buf buf;
+
+	/* Hostlist naming fewer nodes than node_cnt */
+	buf = _pack_header_start(3);
+	_pack_group(buf, 3, RESPONSE_SLURM_RC, "n[1-2]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+
+	/* Hostlist naming more nodes than node_cnt */
+	buf = _pack_header_start(3);
+	_pack_group(buf, 2, RESPONSE_FORWARD_FAILED, "n[1-3]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+
+	/* Only RESPONSE_SLURM_RC and RESPONSE_FORWARD_FAILED are grouped */
+	buf = _pack_header_start(2);
+	_pack_group(buf, 2, RESPONSE_PING_SLURMD, "n[1-2]");
+	ck_assert_int_ne(_unpack_bad(buf), SLURM_SUCCESS);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite* suite(SRunner *sr)
+{
+	Suite* s = suite_create("Pack ret_list");
+	TCase* tc_core = tcase_create("Pack grouped ret_list");
+	tcase_add_test(tc_core, pack_mixed_ret_list);
+	tcase_add_test(tc_core, pack_forward_failed_groups);
+	tcase_add_test(tc_core, unpack_bad_node_cnt);
+	tcase_add_test(tc_core, unpack_bad_group);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner* sr = srunner_create(NULL);
+	srunner_add_suite(sr, suite(sr));
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}